@@ -0,0 +1,76 @@
+% Description: Drift of the estimates under approximate searching
+
+clear all;
+close all;
+
+% This example measures how much the estimates drift from the 
+% exact mode when the nearest neighbor searches are allowed a 
+% relative error epsilon, and how much time that saves. The 
+% estimates are compared against the analytic values for normal 
+% distributions. The drift should stay well below the error of 
+% the estimator itself for small epsilon.
+
+n = 100000;
+k = 4;
+epsilonSet = [0, 0.1, 0.25, 0.5, 1, 2];
+
+% Differential entropy of a standard normal distribution.
+
+for d = [2, 5, 10]
+    X = randn(d, n);
+    correct = tim.differential_entropy_normal(d);
+
+    disp(['differential_entropy_kl, d = ', num2str(d), ...
+        ', correct = ', num2str(correct)]);
+
+    exact = 0;
+    for epsilon = epsilonSet
+        tic;
+        [H, ~, E] = tim.differential_entropy_kl(X, 'k', k, 'epsilon', epsilon);
+        time = toc;
+        if epsilon == 0
+            exact = H;
+        end
+        disp(['  epsilon = ', num2str(E), ...
+            ', estimate = ', num2str(H), ...
+            ', drift = ', num2str(H - exact), ...
+            ', error = ', num2str(H - correct), ...
+            ', time = ', num2str(time), ' s']);
+    end
+end
+
+% Mutual information between the halves of a correlated 
+% normal distribution.
+
+for d = [2, 4, 8]
+    R = pastelmatlab.random_orthogonal(d, 'orientation', 1);
+    M = R * diag(0.5 + rand(d, 1));
+    cov = M * M';
+
+    XY = tim.random_normal(d, n, 'cov', cov);
+    dx = floor(d / 2);
+    X = XY(1 : dx, :);
+    Y = XY((dx + 1) : end, :);
+
+    xCov = cov(1 : dx, 1 : dx);
+    yCov = cov((dx + 1) : end, (dx + 1) : end);
+    correct = tim.mutual_information_normal(det(xCov) * det(yCov), det(cov));
+
+    disp(['mutual_information, d = ', num2str(d), ...
+        ', correct = ', num2str(correct)]);
+
+    exact = 0;
+    for epsilon = epsilonSet
+        tic;
+        [I, ~, E] = tim.mutual_information(X, Y, 'k', k, 'epsilon', epsilon);
+        time = toc;
+        if epsilon == 0
+            exact = I;
+        end
+        disp(['  epsilon = ', num2str(E), ...
+            ', estimate = ', num2str(I), ...
+            ', drift = ', num2str(I - exact), ...
+            ', error = ', num2str(I - correct), ...
+            ', time = ', num2str(time), ' s']);
+    end
+end
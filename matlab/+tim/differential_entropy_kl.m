@@ -4,35 +4,86 @@
 %
 % H = differential_entropy_kl(S)
 % H = differential_entropy_kl(S, 'key', value, ...)
+% [H, M] = differential_entropy_kl(...)
+% [H, M, E] = differential_entropy_kl(...)
 %
 % where
 %
-% S is a signal set.
+% S is a signal set, or a handle returned by PREPARE. With a 
+% handle, the joint signal of the signals SIGNALRANGE of the handle 
+% is estimated, and the point set is kept in the handle for 
+% later estimates.
 %
 % H is the estimated differential entropy.
 %
+% M is a struct which contains the measurements of the estimate,
+% as in ENTROPY_COMBINATION_T. The estimate is measured only when
+% M is asked for.
+%
+% E is the relative error that the nearest neighbor searches actually
+% had. This is EPSILON, except that it is zero when the searches are 
+% exact anyway (one-dimensional points).
+%
 % Optional arguments
 % ------------------
 %
 % K ('k') is an integer which denotes the number of nearest neighbors 
 % to be used by the estimator.
 %
+% EPSILON ('epsilon') is a non-negative real which denotes the allowed
+% relative error in the nearest neighbor distances. Larger values trade
+% accuracy for speed. Default 0, which gives exact searches.
+%
+% SIGNALRANGE ('signalRange') is an integer pair [a, b], which denotes the 
+% signals (a : b) of a handle S. Default: all the signals.
+%
 % Type 'help tim' for more documentation.
 
 % Description: Differential entropy estimation
 % Detail: Kozachenko-Leonenko nearest neighbor estimator
 % Documentation: differential_entropy_kl.txt
 
-function H = differential_entropy_kl(S, varargin)
+function [H, M, E] = differential_entropy_kl(S, varargin)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 1);
-concept_check(nargout, 'outputs', 0 : 1);
+concept_check(nargout, 'outputs', 0 : 3);
 
 % Optional input arguments
 k = 1;
-eval(process_options({'k'}, varargin));
+epsilon = 0;
+signalRange = [];
+eval(process_options({'k', 'epsilon', 'signalRange'}, varargin));
+
+if isstruct(S) && isfield(S, 'tim_prepared')
+    if isempty(signalRange)
+        signalRange = [1, S.signals];
+    end
+
+    pastelmatlab.concept_check(...
+        k, 'integer', ...
+        k, 'positive', ...
+        epsilon, 'real', ...
+        epsilon, 'non_negative');
+
+    if numel(signalRange) ~= 2 || signalRange(1) < 1 || ...
+        signalRange(1) > signalRange(2) || signalRange(2) > S.signals
+        error('SIGNALRANGE must be a pair [a, b] with 1 <= a <= b <= signals.');
+    end
+
+    outputSet = cell(1, max(nargout, 1));
+    [outputSet{:}] = tim_matlab('prepared_differential_entropy_kl', ...
+        S.tim_prepared, signalRange(1), signalRange(2), k, epsilon);
+    H = outputSet{1};
+    if nargout > 1
+        M = outputSet{2};
+    end
+    if nargout > 2
+        E = outputSet{3};
+    end
+    return
+end
 
 if isnumeric(S)
     S = {S};
@@ -42,7 +93,17 @@ end
 pastelmatlab.concept_check(...
 	S, tim_package('signal_set'), ...
 	k, 'integer', ...
-	k, 'positive');
+	k, 'positive', ...
+	epsilon, 'real', ...
+	epsilon, 'non_negative');
 
-H = tim_matlab('differential_entropy_kl', ...
-	S, k);
+outputSet = cell(1, max(nargout, 1));
+[outputSet{:}] = tim_matlab('differential_entropy_kl', ...
+	S, k, epsilon);
+H = outputSet{1};
+if nargout > 1
+    M = outputSet{2};
+end
+if nargout > 2
+    E = outputSet{3};
+end
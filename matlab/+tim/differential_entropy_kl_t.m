@@ -4,6 +4,8 @@
 %
 % H = differential_entropy_kl_t(S, timeWindowRadius)
 % H = differential_entropy_kl_t(S, timeWindowRadius, 'key', value, ...)
+% [H, M] = differential_entropy_kl_t(...)
+% [H, M, E] = differential_entropy_kl_t(...)
 %
 % where
 %
@@ -14,6 +16,14 @@
 %
 % H is the estimated temporal differential entropy.
 %
+% M is a struct which contains the measurements of the estimate,
+% as in ENTROPY_COMBINATION_T. The estimate is measured only when
+% M is asked for.
+%
+% E is the relative error that the nearest neighbor searches actually
+% had. This is EPSILON, except that it is zero when the searches are 
+% exact anyway (one-dimensional points).
+%
 % Optional input arguments in 'key'-value pairs:
 %
 % K ('k') is an integer which denotes the number of nearest neighbors 
@@ -22,24 +32,43 @@
 % FILTER ('filter') is a real array, which gives the temporal 
 % weighting coefficients. Default 1.
 %
+% EPSILON ('epsilon') is a non-negative real which denotes the allowed
+% relative error in the nearest neighbor distances. Larger values trade
+% accuracy for speed. Default 0, which gives exact searches.
+%
+% HOP ('hop') is a positive integer. The estimate is evaluated only at 
+% every HOP:th time instant, and at the last time instant. Default 1.
+%
+% REFINE ('refine') is a non-negative real. Where two consecutive 
+% evaluated estimates differ by more than REFINE, the time instants 
+% between them are evaluated by bisection. Default Inf (no refinement).
+%
+% FILL ('fill') is a boolean which denotes whether the time instants 
+% which are not evaluated are filled by linear interpolation, or left 
+% as NaNs. Default true.
+%
 % Type 'help tim' for more documentation.
 
 % Description: Temporal differential entropy estimation
 % Detail: Kozachenko-Leonenko nearest neighbor estimator
 % Documentation: differential_entropy_kl.txt
 
-function H = differential_entropy_kl_t(...
+function [H, M, E] = differential_entropy_kl_t(...
     S, timeWindowRadius, varargin)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 2);
-concept_check(nargout, 'outputs', 0 : 1);
+concept_check(nargout, 'outputs', 0 : 3);
 
 % Optional input arguments
 k = 1;
 filter = 1;
-eval(process_options({'k', 'filter'}, varargin));
+hop = 1;
+refine = Inf;
+fill = true;
+epsilon = 0;
+eval(process_options({'k', 'filter', 'hop', 'refine', 'fill', 'epsilon'}, varargin));
 
 if isnumeric(S)
     S = {S};
@@ -51,7 +80,21 @@ pastelmatlab.concept_check(...
 	timeWindowRadius, 'non_negative', ...
 	k, 'integer', ...
 	k, 'positive', ...
-	filter, tim_package('filter'));
+	filter, tim_package('filter'), ...
+	hop, 'integer', ...
+	hop, 'positive', ...
+	refine, 'non_negative', ...
+	epsilon, 'real', ...
+	epsilon, 'non_negative');
 
-H = tim_matlab('differential_entropy_kl_t', ...
-    S, timeWindowRadius, k, filter);
+outputSet = cell(1, max(nargout, 1));
+[outputSet{:}] = tim_matlab('differential_entropy_kl_t', ...
+    S, timeWindowRadius, k, filter, epsilon, ...
+    hop, refine, double(fill));
+H = outputSet{1};
+if nargout > 1
+    M = outputSet{2};
+end
+if nargout > 2
+    E = outputSet{3};
+end
@@ -3,11 +3,9 @@
 % using Nilsson-Kleijn manifold nearest neighbor
 % estimator.
 %
-% [H, d] = differential_entropy_nk(S)
-%
-% or
-%
 % H = differential_entropy_nk(S)
+% [H, M] = differential_entropy_nk(S)
+% [H, M, d] = differential_entropy_nk(S)
 %
 % where
 %
@@ -17,18 +15,22 @@
 % lieing on a d-dimensional differentiable manifold, where d is
 % also estimated from the data and is an integer.
 %
+% M is a struct which contains the measurements of the estimate,
+% as in ENTROPY_COMBINATION_T. The estimate is measured only when
+% M is asked for.
+%
 % Type 'help tim' for more documentation.
 
 % Description: Differential entropy estimation
 % Detail: Nilsson-Kleijn manifold nearest neighbor estimator
 % Documentation: differential_entropy_nk.txt
 
-function [H, d] = differential_entropy_nk(S)
+function [H, M, d] = differential_entropy_nk(S)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 1);
-concept_check(nargout, 'outputs', 0 : 2);
+concept_check(nargout, 'outputs', 0 : 3);
 
 if isnumeric(S)
     S = {S};
@@ -36,10 +38,14 @@ end
 
 pastelmatlab.concept_check(S, tim_package('signal_set'));
 
-[H, dOut] = tim_matlab(...
+outputSet = cell(1, max(nargout, 1));
+[outputSet{:}] = tim_matlab(...
     'differential_entropy_nk', ...
 	S);
-
+H = outputSet{1};
 if nargout > 1
-    d = dOut;
+    M = outputSet{2};
+end
+if nargout > 2
+    d = outputSet{3};
 end
@@ -3,23 +3,44 @@
 % using Wang-Kulkarni-Verdu nearest neighbor estimator.
 %
 % D = divergence_wkv(X, Y)
+% D = divergence_wkv(X, Y, 'key', value, ...)
+% [D, M] = divergence_wkv(...)
+% [D, M, E] = divergence_wkv(...)
 %
 % where
 %
 % X and Y are signal sets.
 %
+% M is a struct which contains the measurements of the estimate,
+% as in ENTROPY_COMBINATION_T. The estimate is measured only when
+% M is asked for.
+%
+% E is the relative error that the nearest neighbor searches actually
+% had. This is EPSILON, except that it is zero when the searches are 
+% exact anyway (one-dimensional points).
+%
+% Optional input arguments in 'key'-value pairs:
+%
+% EPSILON ('epsilon') is a non-negative real which denotes the allowed
+% relative error in the nearest neighbor distances. Larger values trade
+% accuracy for speed. Default 0, which gives exact searches.
+%
 % Type 'help tim' for documentation.
 
 % Description: Kullback-Leibler divergence estimation
 % Detail: Wang-Kulkarni-Verdu nearest neighbor estimator
 % Documentation: divergence_wkv.txt
 
-function D = divergence_wkv(X, Y)
+function [D, M, E] = divergence_wkv(X, Y, varargin)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 2);
-concept_check(nargout, 'outputs', 0 : 1);
+concept_check(nargout, 'outputs', 0 : 3);
+
+% Optional input arguments
+epsilon = 0;
+eval(process_options({'epsilon'}, varargin));
 
 if isnumeric(X)
     X = {X};
@@ -31,6 +52,9 @@ end
 
 pastelmatlab.concept_check(X, tim_package('signal_set'));
 pastelmatlab.concept_check(Y, tim_package('signal_set'));
+pastelmatlab.concept_check(...
+	epsilon, 'real', ...
+	epsilon, 'non_negative');
 
 if numel(X) ~= numel(Y)
 	error('The number of trials in X and Y do not match.');
@@ -40,7 +64,15 @@ if size(X{1}, 1) ~= size(Y{1}, 1)
     error('The dimensions of X and Y do not match.');
 end
 
-D = tim_matlab('divergence_wkv', ...
-	X, Y);
+outputSet = cell(1, max(nargout, 1));
+[outputSet{:}] = tim_matlab('divergence_wkv', ...
+	X, Y, epsilon);
+D = outputSet{1};
+if nargout > 1
+    M = outputSet{2};
+end
+if nargout > 2
+    E = outputSet{3};
+end
 
 end
@@ -49,22 +49,30 @@ pastelmatlab.concept_check(...
 	maxLag, 'integer', ...
 	maxLag, 'positive');
 
+% The lags are estimated in blocks, each in a single
+% lag sweep, since the minimum is usually found early.
+blockSize = 32;
+
 prevMi = Inf;
 yLag = 0;
-while yLag <= maxLag;
-	mi = tim.mutual_information(...
+found = false;
+while ~found && yLag <= maxLag
+	miSet = tim.mutual_information(...
 	    pointSet, pointSet, ...
-	    'yLag', yLag + 1);
-	
-	if prevMi < mi
-		% We are at a local minimum.
-		% Return the current yLag  
-		% as the embedding delay.
-		break;
-	end
+	    'yLag', yLag + 1 : min(yLag + blockSize, maxLag + 1));
 
-	prevMi = mi;
-	yLag = yLag + 1;
+	for i = 1 : numel(miSet)
+		if prevMi < miSet(i)
+			% We are at a local minimum.
+			% Return the current yLag  
+			% as the embedding delay.
+			found = true;
+			break;
+		end
+
+		prevMi = miSet(i);
+		yLag = yLag + 1;
+	end
 end
 
 dt = yLag;
@@ -3,11 +3,15 @@
 %
 % I = entropy_combination(signalSet, rangeSet)
 % I = entropy_combination(signalSet, rangeSet, 'key', value, ...)
+% [I, M] = entropy_combination(...)
+% [I, M, E] = entropy_combination(...)
 %
 % where
 %
 % SIGNALSET is a 2-dimensional (p x q) cell-array 
-% containing q trials of p signals.
+% containing q trials of p signals, or a handle to such 
+% signals returned by PREPARE. With a handle, the point
+% sets are kept in the handle for later estimates.
 %
 % RANGESET is a 2-dimensional (m x 3) array which on each row 
 % contains an integer triple of the form (a, b, s). Each triple
@@ -21,6 +25,16 @@
 % the number of specified lags. The I(i) corresponds to the entropy
 % combination estimate using the lag LAGSET{j}(i) for signal j.
 %
+% M is a (1 x L) struct-array, which contains the measurements of the
+% estimate of each lag, as in ENTROPY_COMBINATION_T. When the lag varies 
+% for only one signal, all the lags are estimated in a single sweep, and 
+% M is a single struct which measures the whole sweep. The estimate is 
+% measured only when M is asked for.
+%
+% E is the relative error that the nearest neighbor searches actually
+% had. This is EPSILON, except that it is zero when the searches are 
+% exact anyway (one-dimensional points).
+%
 % Optional input arguments in 'key'-value pairs:
 %
 % LAGSET ('lagSet') is an arbitrary-dimensional cell-array whose 
@@ -34,32 +48,48 @@
 % K ('k') is a positive integer which denotes the number of nearest neighbors 
 % to be used by the estimator.
 %
+% EPSILON ('epsilon') is a non-negative real which denotes the allowed
+% relative error in the nearest neighbor distances. Larger values trade
+% accuracy for speed. Default 0, which gives exact searches.
+%
 % Type 'help tim' for more documentation.
 
 % Description: Entropy combination estimation
 % Documentation: entropy_combination.txt
 
-function I = entropy_combination(signalSet, rangeSet, varargin)
+function [I, M, E] = entropy_combination(signalSet, rangeSet, varargin)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 2);
-concept_check(nargout, 'outputs', 0 : 1);
+concept_check(nargout, 'outputs', 0 : 3);
+
+prepared = isstruct(signalSet) && isfield(signalSet, 'tim_prepared');
+
+if prepared
+    signals = signalSet.signals;
+else
+    signals = size(signalSet, 1);
+end
 
 % Optional input arguments.
 k = 1;
-lagSet = num2cell(zeros(size(signalSet, 1), 1));
-eval(process_options({'lagSet', 'k'}, varargin));
+epsilon = 0;
+lagSet = num2cell(zeros(signals, 1));
+eval(process_options({'lagSet', 'k', 'epsilon'}, varargin));
 
 pastelmatlab.concept_check(...
     k, 'integer', ...
-    k, 'positive');
+    k, 'positive', ...
+    epsilon, 'real', ...
+    epsilon, 'non_negative');
 
-signals = size(signalSet, 1);
 marginals = size(rangeSet, 1);
 
-for i = 1 : signals
-    pastelmatlab.concept_check(signalSet(i, :), tim_package('signal_set'));
+if ~prepared
+    for i = 1 : signals
+        pastelmatlab.concept_check(signalSet(i, :), tim_package('signal_set'));
+    end
 end
 
 if marginals == 0
@@ -90,11 +120,49 @@ end
 lagArray = compute_lagarray(lagSet);
 
 lags = size(lagArray, 2);
+
+% When the lag varies for only one signal, all the lags 
+% are estimated in a single sweep, which reuses the 
+% marginals that do not depend on that lag.
+varying = find(any(lagArray ~= repmat(lagArray(:, 1), 1, lags), 2));
+outputSet = cell(1, max(nargout, 1));
+
+if numel(varying) == 1 && ~prepared
+    [outputSet{:}] = tim_matlab(...
+        'entropy_combination_lag_sweep', ...
+        signalSet, rangeSet, ...
+        lagArray(:, 1), varying, ...
+        lagArray(varying, :), k, epsilon);
+    I = outputSet{1};
+    if nargout > 1
+        M = outputSet{2};
+    end
+    if nargout > 2
+        E = outputSet{3};
+    end
+    return
+end
+
 I = zeros(lags, 1);
+E = 0;
 
 for i = 1 : lags
-    I(i) = tim_matlab(...
-        'entropy_combination', ...
-        signalSet, rangeSet, ...
-        lagArray(:, i), k);
+    if prepared
+        [outputSet{:}] = tim_matlab(...
+            'prepared_entropy_combination', ...
+            signalSet.tim_prepared, rangeSet, ...
+            lagArray(:, i), k, epsilon);
+    else
+        [outputSet{:}] = tim_matlab(...
+            'entropy_combination', ...
+            signalSet, rangeSet, ...
+            lagArray(:, i), k, epsilon);
+    end
+    I(i) = outputSet{1};
+    if nargout > 1
+        M(i) = outputSet{2};
+    end
+    if nargout > 2
+        E = outputSet{3};
+    end
 end
@@ -0,0 +1,113 @@
+% ENTROPY_COMBINATION_PERMUTATION_TEST
+% A permutation test for an entropy combination estimate.
+%
+% [I, nullSet, maxNull, p] = entropy_combination_permutation_test(...
+%     signalSet, rangeSet, groupSet)
+% [I, nullSet, maxNull, p] = entropy_combination_permutation_test(...
+%     signalSet, rangeSet, groupSet, 'key', value, ...)
+% [I, nullSet, maxNull, p, M] = entropy_combination_permutation_test(...)
+%
+% where
+%
+% SIGNALSET and RANGESET are as in ENTROPY_COMBINATION.
+%
+% GROUPSET is an array with as many elements as SIGNALSET has
+% rows. The signals with the same value in GROUPSET have their
+% trials permuted together, as with PINDEX in PERMUTE_PSET. The
+% signals in the group of the first signal are not permuted.
+%
+% I is the estimate from the unpermuted signals.
+%
+% NULLSET is a real (PERMUTATIONS x 1)-matrix of the estimates
+% from the permuted signals.
+%
+% MAXNULL is the maximum of NULLSET.
+%
+% P is the fraction of the estimates, including I, which are at 
+% least I.
+%
+% M is a struct which contains the measurements of the estimates,
+% as in ENTROPY_COMBINATION_T. The estimates are measured only when
+% M is asked for.
+%
+% Optional input arguments in 'key'-value pairs:
+%
+% LAGSET ('lagSet') is a cell-array containing a scalar lag 
+% for each signal. Default: zeros.
+%
+% K ('k') is a positive integer which denotes the number of 
+% nearest neighbors to be used by the estimator. Default 1.
+%
+% PERMUTATIONS ('permutations') is a non-negative integer which 
+% denotes the number of permutations. Default 100.
+%
+% SEED ('seed') is an integer which seeds the random permutations.
+% The same seed gives the same permutations. Default 0.
+%
+% The permutations are estimated in parallel, and the marginals
+% which do not span several groups are shared between them.
+%
+% Type 'help tim' for more documentation.
+
+% Description: Permutation test for entropy combinations
+% Documentation: permutation_test.txt
+
+function [I, nullSet, maxNull, p, M] = entropy_combination_permutation_test(...
+    signalSet, rangeSet, groupSet, varargin)
+
+import([tim_package, '.*']);
+
+concept_check(nargin, 'inputs', 3);
+concept_check(nargout, 'outputs', 0 : 5);
+
+% Optional input arguments.
+k = 1;
+permutations = 100;
+seed = 0;
+lagSet = num2cell(zeros(size(signalSet, 1), 1));
+eval(process_options(...
+    {'lagSet', 'k', 'permutations', 'seed'}, ...
+    varargin));
+
+pastelmatlab.concept_check(...
+    k, 'integer', ...
+    k, 'positive', ...
+    permutations, 'integer', ...
+    permutations, 'non_negative', ...
+    seed, 'integer');
+
+signals = size(signalSet, 1);
+
+if numel(groupSet) ~= signals
+    error(['GROUPSET must contain the same number of elements as ', ...
+        'there are signals in SIGNALSET.']);
+end
+
+if numel(lagSet) ~= signals
+    error(['LAGSET must contain the same number of elements as ', ...
+        'there are signals in SIGNALSET.']);
+end
+
+lagArray = compute_lagarray(lagSet);
+if size(lagArray, 2) ~= 1
+    error('The lags in LAGSET must be scalars.');
+end
+
+outputSet = cell(1, max(nargout, 4));
+[outputSet{:}] = tim_matlab(...
+    'entropy_combination_permutation_test', ...
+    signalSet, rangeSet, lagArray, ...
+    groupSet, permutations, k, seed);
+I = outputSet{1};
+if nargout > 1
+    nullSet = outputSet{2};
+end
+if nargout > 2
+    maxNull = outputSet{3};
+end
+if nargout > 3
+    p = outputSet{4};
+end
+if nargout > 4
+    M = outputSet{5};
+end
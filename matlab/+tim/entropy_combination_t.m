@@ -3,6 +3,8 @@
 %
 % I = entropy_combination_t(signalSet, rangeSet)
 % I = entropy_combination_t(signalSet, rangeSet, 'key', value, ...)
+% [I, M] = entropy_combination_t(...)
+% [I, M, E] = entropy_combination_t(...)
 %
 % where 
 %
@@ -38,24 +40,58 @@
 % linearization contains temporal weighting coefficients. 
 % Default: 1 (i.e. no temporal weighting is performed)
 %
+% HOP ('hop') is a positive integer. The estimate is evaluated only at 
+% every HOP:th time instant, and at the last time instant. Default 1.
+%
+% REFINE ('refine') is a non-negative real. Where two consecutive 
+% evaluated estimates differ by more than REFINE, the time instants 
+% between them are evaluated by bisection. Default Inf (no refinement).
+%
+% FILL ('fill') is a boolean which denotes whether the time instants 
+% which are not evaluated are filled by linear interpolation, or left 
+% as NaNs. Default true.
+%
+% EPSILON ('epsilon') is a non-negative real which denotes the allowed
+% relative error in the nearest neighbor distances. Larger values trade
+% accuracy for speed. Default 0, which gives exact searches.
+%
+% M is a (1 x L) struct-array, which contains the measurements of the
+% estimate of each lag: the seconds spent in each phase of the estimator 
+% (merge, build, time_window, joint_search, marginal_count, reconstruct),
+% and the number of nearest neighbor queries, range queries, visited 
+% kd-tree nodes, computed distances, and points hidden and shown by the 
+% time-windows. The measurements are zero, and M.enabled is false, unless 
+% TIM was built with the Instrumentation option. The estimate is measured 
+% only when M is asked for.
+%
+% E is the relative error that the nearest neighbor searches actually
+% had. This is EPSILON, except that it is zero when the searches are 
+% exact anyway (one-dimensional points).
+%
 % Type 'help tim' for more documentation.
 
 % Description: Temporal entropy combination estimation
 % Documentation: entropy_combination.txt
 
-function I = entropy_combination_t(...
+function [I, M, E] = entropy_combination_t(...
     signalSet, rangeSet, timeWindowRadius, varargin)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 3);
-concept_check(nargout, 'outputs', 0 : 1);
+concept_check(nargout, 'outputs', 0 : 3);
 
 % Optional input arguments.
 lagSet = num2cell(zeros(size(signalSet, 1), 1));
 k = 1;
 filter = 1;
-eval(process_options({'lagSet', 'k', 'filter'}, varargin));
+hop = 1;
+refine = Inf;
+fill = true;
+epsilon = 0;
+eval(process_options(...
+    {'lagSet', 'k', 'filter', 'hop', 'refine', 'fill', 'epsilon'}, ...
+    varargin));
 
 signals = size(signalSet, 1);
 
@@ -95,17 +131,32 @@ lagArray = compute_lagarray(lagSet);
 pastelmatlab.concept_check(...
     k, 'integer', ...
     k, 'positive', ...
-    filter, tim_package('filter'));
+    filter, tim_package('filter'), ...
+    hop, 'integer', ...
+    hop, 'positive', ...
+    refine, 'non_negative', ...
+    epsilon, 'real', ...
+    epsilon, 'non_negative');
 
 lags = size(lagArray, 2);
 
 estimateSet = cell(1, lags);
+outputSet = cell(1, max(nargout, 1));
+E = 0;
 
 for i = 1 : lags
-    estimateSet{i} = tim_matlab(...
+    [outputSet{:}] = tim_matlab(...
         'entropy_combination_t', ...
         signalSet, rangeSet, timeWindowRadius, ...
-        lagArray(:, i), k, filter(:));
+        lagArray(:, i), k, filter(:), ...
+        hop, refine, double(fill), epsilon);
+    estimateSet{i} = outputSet{1};
+    if nargout > 1
+        M(i) = outputSet{2};
+    end
+    if nargout > 2
+        E = outputSet{3};
+    end
 end
 
 maxSamples = 0;
@@ -3,6 +3,8 @@
 %
 % I = mutual_information(X, Y)
 % I = mutual_information(X, Y, 'key', value, ...)
+% [I, M] = mutual_information(...)
+% [I, M, E] = mutual_information(...)
 %
 % where
 %
@@ -19,17 +21,24 @@
 % K ('k') is an integer which denotes the number of nearest 
 % neighbors to be used by the estimator.
 %
+% EPSILON ('epsilon') is a non-negative real which denotes the allowed
+% relative error in the nearest neighbor distances. See 
+% entropy_combination.
+%
+% M and E contain the measurements of the estimate and the 
+% relative error of its searches, as in entropy_combination.
+%
 % Type 'help tim' for more documentation.
 
 % Description: Mutual information estimation
 % Documentation: mutual_information.txt
 
-function I = mutual_information(X, Y, varargin)
+function [I, varargout] = mutual_information(X, Y, varargin)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 2);
-concept_check(nargout, 'outputs', 0 : 1);
+concept_check(nargout, 'outputs', 0 : 3);
 
 if isnumeric(X)
     X = {X};
@@ -41,10 +50,11 @@ end
 
 % Optional input arguments.
 k = 1;
+epsilon = 0;
 xLag = 0;
 yLag = 0;
 eval(process_options(...
-    {'k', 'xLag', 'yLag'}, ...
+    {'k', 'epsilon', 'xLag', 'yLag'}, ...
     varargin));
 
 if ~iscell(X) || ~iscell(Y)
@@ -57,8 +67,9 @@ end
 
 % Pass parameter error checking to entropy_combination.
 
-I = entropy_combination(...
+[I, varargout{1 : nargout - 1}] = entropy_combination(...
     [X(:)'; Y(:)'], ...
     [1, 1, 1; 2, 2, 1], ...
     'lagSet', {xLag, yLag}, ...
-    'k', k);
+    'k', k, ...
+    'epsilon', epsilon);
@@ -0,0 +1,83 @@
+% MUTUAL_INFORMATION_MATRIX
+% Mutual information estimates between all pairs of signals.
+%
+% I = mutual_information_matrix(signalSet)
+% I = mutual_information_matrix(signalSet, 'key', value, ...)
+% [I, M] = mutual_information_matrix(...)
+%
+% where
+%
+% SIGNALSET is a 2-dimensional (p x q) cell-array 
+% containing q trials of p signals.
+%
+% I is a (p x p) real array, where I(i, j) is the mutual information
+% between the i:th signal, lagged by XLAG, and the j:th signal, lagged
+% by YLAG. The diagonal is NaN when XLAG == YLAG.
+%
+% M is a struct which contains the measurements of the estimates,
+% as in ENTROPY_COMBINATION_T. The estimates are measured only when
+% M is asked for.
+%
+% Optional input arguments in 'key'-value pairs:
+%
+% XLAG and YLAG ('xLag', 'yLag') are integers which
+% denote the amount of lag to apply to the first and 
+% the second signal of each pair, respectively. Default 0.
+%
+% K ('k') is an integer which denotes the number of nearest 
+% neighbors to be used by the estimator. Default 1.
+%
+% SYMMETRIC ('symmetric') is a boolean which denotes whether to 
+% estimate only one of I(i, j) and I(j, i), when XLAG == YLAG.
+% Default: true.
+%
+% MAXMEMORY ('maxMemory') is a non-negative integer which denotes an
+% approximate bound, in bytes, for the memory of the shared point
+% sets and of the pairs being estimated in parallel. The shared point
+% sets must fit in the bound. Zero means no bound. Default: 0.
+%
+% Type 'help tim' for more documentation.
+
+% Description: Mutual information between all pairs of signals
+% Documentation: connectivity_matrix.txt
+
+function [I, M] = mutual_information_matrix(signalSet, varargin)
+
+import([tim_package, '.*']);
+
+concept_check(nargin, 'inputs', 1);
+concept_check(nargout, 'outputs', 0 : 2);
+
+% Optional input arguments.
+xLag = 0;
+yLag = 0;
+k = 1;
+symmetric = true;
+maxMemory = 0;
+eval(process_options(...
+    {'k', 'xLag', 'yLag', 'symmetric', 'maxMemory'}, ...
+    varargin));
+
+if isnumeric(signalSet)
+    signalSet = {signalSet};
+end
+
+for i = 1 : size(signalSet, 1)
+    pastelmatlab.concept_check(signalSet(i, :), tim_package('signal_set'));
+end
+
+pastelmatlab.concept_check(...
+    xLag, 'integer', ...
+    yLag, 'integer', ...
+    k, 'integer', ...
+    k, 'positive', ...
+    maxMemory, 'integer', ...
+    maxMemory, 'non_negative');
+
+outputSet = cell(1, max(nargout, 1));
+[outputSet{:}] = tim_matlab('mutual_information_matrix', ...
+    signalSet, xLag, yLag, k, double(symmetric), maxMemory);
+I = outputSet{1};
+if nargout > 1
+    M = outputSet{2};
+end
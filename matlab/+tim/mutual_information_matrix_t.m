@@ -0,0 +1,105 @@
+% MUTUAL_INFORMATION_MATRIX_T
+% Temporal mutual information estimates between all pairs of signals.
+%
+% I = mutual_information_matrix_t(signalSet, timeWindowRadius)
+% I = mutual_information_matrix_t(signalSet, timeWindowRadius, 'key', value, ...)
+% [I, M] = mutual_information_matrix_t(...)
+%
+% where
+%
+% SIGNALSET is a 2-dimensional (p x q) cell-array 
+% containing q trials of p signals.
+%
+% TIMEWINDOWRADIUS is an integer which determines the temporal radius 
+% around each point that will be used by the estimator.
+%
+% I is a (p x p x T) real array, where I(i, j, :) is the temporal 
+% mutual information between the i:th signal, lagged by XLAG, and 
+% the j:th signal, lagged by YLAG. The time instants without an 
+% estimate are NaN.
+%
+% M is a struct which contains the measurements of the estimates,
+% as in ENTROPY_COMBINATION_T. The estimates are measured only when
+% M is asked for.
+%
+% Optional input arguments in 'key'-value pairs:
+%
+% XLAG, YLAG, K, SYMMETRIC and MAXMEMORY are as in 
+% mutual_information_matrix.
+%
+% FILTER ('filter') is an arbitrary-dimensional real-array, whose
+% linearization contains temporal weighting coefficients. 
+% Default: 1 (i.e. no temporal weighting is performed)
+%
+% HOP ('hop') is a positive integer. The estimate is evaluated only at 
+% every HOP:th time instant, and at the last time instant. Default 1.
+%
+% REFINE ('refine') is a non-negative real. Where two consecutive 
+% evaluated estimates differ by more than REFINE, the time instants 
+% between them are evaluated by bisection. Default Inf (no refinement).
+%
+% FILL ('fill') is a boolean which denotes whether the time instants 
+% which are not evaluated are filled by linear interpolation, or left 
+% as NaNs. Default true.
+%
+% Type 'help tim' for more documentation.
+
+% Description: Temporal mutual information between all pairs of signals
+% Documentation: connectivity_matrix.txt
+
+function [I, M] = mutual_information_matrix_t(...
+    signalSet, timeWindowRadius, varargin)
+
+import([tim_package, '.*']);
+
+concept_check(nargin, 'inputs', 2);
+concept_check(nargout, 'outputs', 0 : 2);
+
+% Optional input arguments.
+xLag = 0;
+yLag = 0;
+k = 1;
+filter = 1;
+hop = 1;
+refine = Inf;
+fill = true;
+symmetric = true;
+maxMemory = 0;
+eval(process_options(...
+    {'k', 'xLag', 'yLag', 'filter', 'hop', 'refine', 'fill', 'symmetric', 'maxMemory'}, ...
+    varargin));
+
+if isnumeric(signalSet)
+    signalSet = {signalSet};
+end
+
+signals = size(signalSet, 1);
+
+for i = 1 : signals
+    pastelmatlab.concept_check(signalSet(i, :), tim_package('signal_set'));
+end
+
+pastelmatlab.concept_check(...
+    timeWindowRadius, 'integer', ...
+    timeWindowRadius, 'non_negative', ...
+    xLag, 'integer', ...
+    yLag, 'integer', ...
+    k, 'integer', ...
+    k, 'positive', ...
+    filter, tim_package('filter'), ...
+    hop, 'integer', ...
+    hop, 'positive', ...
+    refine, 'non_negative', ...
+    maxMemory, 'integer', ...
+    maxMemory, 'non_negative');
+
+outputSet = cell(1, max(nargout, 1));
+[outputSet{:}] = tim_matlab('mutual_information_matrix_t', ...
+    signalSet, timeWindowRadius, xLag, yLag, k, filter(:), ...
+    double(symmetric), maxMemory, hop, refine, double(fill));
+I = outputSet{1};
+if nargout > 1
+    M = outputSet{2};
+end
+
+I = reshape(I, signals, signals, []);
@@ -3,6 +3,7 @@
 %
 % I = mutual_information_p(X, Y, Z)
 % I = mutual_information_p(X, Y, Z, 'key', value, ...)
+% [I, M] = mutual_information_p(...)
 %
 % where
 %
@@ -16,18 +17,21 @@
 % denote the amount of lag to apply to signal X, Y, and Z, 
 % respectively. Default 0.
 %
+% M contains the measurements of the estimate, as in 
+% entropy_combination.
+%
 % Type 'help tim' for more documentation.
 
 % Description: Partial mutual information estimation
 % Documentation: mutual_information.txt
 
-function I = mutual_information_p(...
+function [I, varargout] = mutual_information_p(...
     X, Y, Z, varargin)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 3);
-concept_check(nargout, 'outputs', 0 : 1);
+concept_check(nargout, 'outputs', 0 : 2);
 
 % Optional input arguments.
 k = 1;
@@ -60,7 +64,7 @@ end
 
 % Pass parameter error checking to entropy_combination.
 
-I = entropy_combination(...
+[I, varargout{1 : nargout - 1}] = entropy_combination(...
     [X(:)'; Z(:)'; Y(:)'], ...
     [1, 2, 1; 2, 3, 1; 2, 2, -1], ...
     'lagSet', {xLag, zLag, yLag}, ...
@@ -3,6 +3,8 @@
 %
 % I = mutual_information_pt(X, Y, Z, timeWindowRadius)
 % I = mutual_information_pt(X, Y, Z, timeWindowRadius, 'key', value, ...)
+% [I, M] = mutual_information_pt(...)
+% [I, M, E] = mutual_information_pt(...)
 %
 % where
 %
@@ -23,17 +25,23 @@
 % linearization contains temporal weighting coefficients. 
 % Default: 1 (i.e. no temporal weighting is performed)
 %
+% HOP, REFINE, FILL and EPSILON ('epsilon') are as in 
+% entropy_combination_t.
+%
+% M and E contain the measurements of the estimate and the 
+% relative error of its searches, as in entropy_combination_t.
+%
 % Type 'help tim' for more documentation.
 
 % Description: Temporal partial mutual information estimation
 % Documentation: mutual_information.txt
 
-function I = mutual_information_pt(X, Y, Z, timeWindowRadius, varargin)
+function [I, varargout] = mutual_information_pt(X, Y, Z, timeWindowRadius, varargin)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 4);
-concept_check(nargout, 'outputs', 0 : 1);
+concept_check(nargout, 'outputs', 0 : 3);
 
 % Optional input arguments.
 xLag = 0;
@@ -41,8 +49,12 @@ yLag = 0;
 zLag = 0;
 k = 1;
 filter = 1;
+hop = 1;
+refine = Inf;
+fill = true;
+epsilon = 0;
 eval(process_options(...
-    {'k', 'xLag', 'yLag', 'zLag', 'filter'}, ...
+    {'k', 'xLag', 'yLag', 'zLag', 'filter', 'hop', 'refine', 'fill', 'epsilon'}, ...
     varargin));
 
 if isnumeric(X)
@@ -67,9 +79,13 @@ end
 
 % Pass parameter error checking to entropy_combination.
 
-I = entropy_combination_t(...
+[I, varargout{1 : nargout - 1}] = entropy_combination_t(...
     [X(:)'; Z(:)'; Y(:)'], ...
     [1, 2, 1; 2, 3, 1; 2, 2, -1], timeWindowRadius, ...
     'lagSet', {xLag, zLag, yLag}, ...
     'k', k, ...
-    'filter', filter);
+    'filter', filter, ...
+    'hop', hop, ...
+    'refine', refine, ...
+    'fill', fill, ...
+    'epsilon', epsilon);
@@ -2,6 +2,8 @@
 % A temporal mutual information estimate from samples.
 %
 % I = mutual_information_t(X, Y, timeWindowRadius)
+% [I, M] = mutual_information_t(...)
+% [I, M, E] = mutual_information_t(...)
 %
 % where
 %
@@ -25,25 +27,35 @@
 % linearization contains temporal weighting coefficients. 
 % Default: 1 (i.e. no temporal weighting is performed)
 %
+% HOP, REFINE, FILL and EPSILON ('epsilon') are as in 
+% entropy_combination_t.
+%
+% M and E contain the measurements of the estimate and the 
+% relative error of its searches, as in entropy_combination_t.
+%
 % Type 'help tim' for more documentation.
 
 % Description: Temporal mutual information estimation
 % Documentation: mutual_information.txt
 
-function I = mutual_information_t(X, Y, timeWindowRadius, varargin)
+function [I, varargout] = mutual_information_t(X, Y, timeWindowRadius, varargin)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 3);
-concept_check(nargout, 'outputs', 0 : 1);
+concept_check(nargout, 'outputs', 0 : 3);
 
 % Optional input arguments.
 xLag = 0;
 yLag = 0;
 k = 1;
 filter = 1;
+hop = 1;
+refine = Inf;
+fill = true;
+epsilon = 0;
 eval(process_options(...
-    {'k', 'xLag', 'yLag', 'filter'}, ...
+    {'k', 'xLag', 'yLag', 'filter', 'hop', 'refine', 'fill', 'epsilon'}, ...
     varargin));
 
 if isnumeric(X)
@@ -64,9 +76,13 @@ end
 
 % Pass parameter error checking to entropy_combination.
 
-I = entropy_combination_t(...
+[I, varargout{1 : nargout - 1}] = entropy_combination_t(...
     [X(:)'; Y(:)'], ...
     [1, 1, 1; 2, 2, 1], timeWindowRadius, ...
     'lagSet', {xLag, yLag}, ...
     'k', k, ...
-    'filter', filter);
+    'filter', filter, ...
+    'hop', hop, ...
+    'refine', refine, ...
+    'fill', fill, ...
+    'epsilon', epsilon);
@@ -0,0 +1,97 @@
+% PARTIAL_MUTUAL_INFORMATION_MATRIX
+% Partial mutual information estimates between all pairs of signals.
+%
+% I = partial_mutual_information_matrix(signalSet, Z)
+% I = partial_mutual_information_matrix(signalSet, Z, 'key', value, ...)
+% [I, M] = partial_mutual_information_matrix(...)
+%
+% where
+%
+% SIGNALSET is a 2-dimensional (p x q) cell-array 
+% containing q trials of p signals.
+%
+% Z is a signal set with q trials, on which the mutual information
+% is conditioned.
+%
+% I is a (p x p) real array, where I(i, j) is the partial mutual 
+% information between the i:th signal and the j:th signal, given Z.
+% The diagonal is NaN when XLAG == YLAG.
+%
+% M is a struct which contains the measurements of the estimates,
+% as in ENTROPY_COMBINATION_T. The estimates are measured only when
+% M is asked for.
+%
+% Optional input arguments in 'key'-value pairs:
+%
+% XLAG, YLAG, and ZLAG ('xLag', 'yLag', 'zLag') are integers which
+% denote the amount of lag to apply to the first and the second 
+% signal of each pair, and to Z, respectively. Default 0.
+%
+% K ('k') is an integer which denotes the number of nearest 
+% neighbors to be used by the estimator. Default 1.
+%
+% SYMMETRIC ('symmetric') is a boolean which denotes whether to 
+% estimate only one of I(i, j) and I(j, i), when XLAG == YLAG.
+% Default: true.
+%
+% MAXMEMORY ('maxMemory') is a non-negative integer which denotes an
+% approximate bound, in bytes, for the memory of the shared point
+% sets and of the pairs being estimated in parallel. The shared point
+% sets must fit in the bound. Zero means no bound. Default: 0.
+%
+% Type 'help tim' for more documentation.
+
+% Description: Partial mutual information between all pairs of signals
+% Documentation: connectivity_matrix.txt
+
+function [I, M] = partial_mutual_information_matrix(signalSet, Z, varargin)
+
+import([tim_package, '.*']);
+
+concept_check(nargin, 'inputs', 2);
+concept_check(nargout, 'outputs', 0 : 2);
+
+% Optional input arguments.
+xLag = 0;
+yLag = 0;
+zLag = 0;
+k = 1;
+symmetric = true;
+maxMemory = 0;
+eval(process_options(...
+    {'k', 'xLag', 'yLag', 'zLag', 'symmetric', 'maxMemory'}, ...
+    varargin));
+
+if isnumeric(signalSet)
+    signalSet = {signalSet};
+end
+
+if isnumeric(Z)
+    Z = {Z};
+end
+
+if numel(Z) ~= size(signalSet, 2)
+    error('The number of trials in SIGNALSET and Z differ.');
+end
+
+for i = 1 : size(signalSet, 1)
+    pastelmatlab.concept_check(signalSet(i, :), tim_package('signal_set'));
+end
+
+pastelmatlab.concept_check(...
+    Z, tim_package('signal_set'), ...
+    xLag, 'integer', ...
+    yLag, 'integer', ...
+    zLag, 'integer', ...
+    k, 'integer', ...
+    k, 'positive', ...
+    maxMemory, 'integer', ...
+    maxMemory, 'non_negative');
+
+outputSet = cell(1, max(nargout, 1));
+[outputSet{:}] = tim_matlab('partial_mutual_information_matrix', ...
+    signalSet, Z(:)', xLag, yLag, zLag, k, double(symmetric), maxMemory);
+I = outputSet{1};
+if nargout > 1
+    M = outputSet{2};
+end
@@ -24,7 +24,11 @@
 %
 % y = permutation_test(pset, [1 2 1 1], ifunc);
 %
-% See also: permute_pset
+% For entropy combinations, ENTROPY_COMBINATION_PERMUTATION_TEST 
+% performs the permutations natively and in parallel, which is much
+% faster.
+%
+% See also: permute_pset, entropy_combination_permutation_test
 
 % Description: Permutation test to determine significance threshold
 % Documentation: tim_matlab_impl.txt
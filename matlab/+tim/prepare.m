@@ -0,0 +1,64 @@
+% PREPARE
+% Prepares a signal set for repeated estimation.
+%
+% H = prepare(signalSet)
+% H = prepare(signalSet, 'key', value, ...)
+%
+% where
+%
+% SIGNALSET is a 2-dimensional (p x q) cell-array 
+% containing q trials of p signals, as in ENTROPY_COMBINATION.
+% A single signal can also be given as a matrix.
+%
+% H is a handle to a copy of the signals, which is accepted
+% in place of SIGNALSET by ENTROPY_COMBINATION, and in place 
+% of S by DIFFERENTIAL_ENTROPY_KL. The point sets which the 
+% estimators build are kept in H, so that later estimates 
+% with the same lags reuse them, whatever the K, EPSILON or 
+% RANGESET. For example, mutual information and conditional
+% entropies between the signals of H can be estimated with 
+% ENTROPY_COMBINATION while building the point sets once.
+%
+% The memory of H is freed by RELEASE_PREPARED.
+%
+% Optional input arguments in 'key'-value pairs:
+%
+% CACHESIZE ('cacheSize') is a positive integer which denotes
+% the number of lag combinations whose point sets are kept.
+% When more lags are used, the least recently used point sets
+% are freed. Default 4.
+%
+% Type 'help tim' for more documentation.
+
+% Description: Prepared signal sets
+% Documentation: prepared_signals.txt
+
+function H = prepare(signalSet, varargin)
+
+import([tim_package, '.*']);
+
+concept_check(nargin, 'inputs', 1);
+concept_check(nargout, 'outputs', 0 : 1);
+
+% Optional input arguments.
+cacheSize = 4;
+eval(process_options({'cacheSize'}, varargin));
+
+if isnumeric(signalSet)
+    signalSet = {signalSet};
+end
+
+pastelmatlab.concept_check(...
+    cacheSize, 'integer', ...
+    cacheSize, 'positive');
+
+signals = size(signalSet, 1);
+
+for i = 1 : signals
+    pastelmatlab.concept_check(signalSet(i, :), tim_package('signal_set'));
+end
+
+H = struct(...
+    'tim_prepared', tim_matlab('prepare', signalSet, cacheSize), ...
+    'signals', signals, ...
+    'trials', size(signalSet, 2));
@@ -0,0 +1,27 @@
+% RELEASE_PREPARED
+% Frees the memory of a prepared signal set.
+%
+% release_prepared(H)
+%
+% where
+%
+% H is a handle returned by PREPARE. The handle can not
+% be used after this. Releasing a handle twice does nothing.
+%
+% Type 'help tim' for more documentation.
+
+% Description: Prepared signal sets
+% Documentation: prepared_signals.txt
+
+function release_prepared(H)
+
+import([tim_package, '.*']);
+
+concept_check(nargin, 'inputs', 1);
+concept_check(nargout, 'outputs', 0);
+
+if ~isstruct(H) || ~isfield(H, 'tim_prepared')
+    error('H is not a prepared signal set.');
+end
+
+tim_matlab('release_prepared', H.tim_prepared);
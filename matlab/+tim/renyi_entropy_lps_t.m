@@ -4,6 +4,8 @@
 %
 % H = renyi_entropy_lps_t(S, timeWindowRadius)
 % H = renyi_entropy_lps_t(S, timeWindowRadius, 'key', value, ...)
+% [H, M] = renyi_entropy_lps_t(...)
+% [H, M, E] = renyi_entropy_lps_t(...)
 %
 % where
 %
@@ -12,6 +14,14 @@
 % TIMEWINDOWRADIUS is an integer which determines the temporal radius 
 % around each point that will be used by the estimator.
 %
+% M is a struct which contains the measurements of the estimate,
+% as in ENTROPY_COMBINATION_T. The estimate is measured only when
+% M is asked for.
+%
+% E is the relative error that the nearest neighbor searches actually
+% had. This is EPSILON, except that it is zero when the searches are 
+% exact anyway (one-dimensional points).
+%
 % Optional input arguments in 'key'-value pairs:
 %
 % Q ('q') is the power in the definition Renyi entropy.
@@ -31,24 +41,43 @@
 % linearization contains temporal weighting coefficients. 
 % Default: 1 (i.e. no temporal weighting is performed)
 %
+% HOP ('hop') is a positive integer. The estimate is evaluated only at 
+% every HOP:th time instant, and at the last time instant. Default 1.
+%
+% REFINE ('refine') is a non-negative real. Where two consecutive 
+% evaluated estimates differ by more than REFINE, the time instants 
+% between them are evaluated by bisection. Default Inf (no refinement).
+%
+% FILL ('fill') is a boolean which denotes whether the time instants 
+% which are not evaluated are filled by linear interpolation, or left 
+% as NaNs. Default true.
+%
+% EPSILON ('epsilon') is a non-negative real which denotes the allowed
+% relative error in the nearest neighbor distances. Larger values trade
+% accuracy for speed. Default 0, which gives exact searches.
+%
 % Type 'help tim' for more documentation.
 
 % Description: Temporal Renyi entropy estimation
 % Detail: Leonenko-Pronzato-Savani nearest neighbor estimator
 % Documentation: renyi_entropy_lps.txt
 
-function H = renyi_entropy_lps_t(S, timeWindowRadius, varargin)
+function [H, M, E] = renyi_entropy_lps_t(S, timeWindowRadius, varargin)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 2);
-concept_check(nargout, 'outputs', 0 : 1);
+concept_check(nargout, 'outputs', 0 : 3);
 
 % Optional input arguments.
 q = 2;
 kSuggestion = 0;
 filter = 1;
-eval(process_options({'q', 'kSuggestion', 'filter'}, varargin));
+hop = 1;
+refine = Inf;
+fill = true;
+epsilon = 0;
+eval(process_options({'q', 'kSuggestion', 'filter', 'hop', 'refine', 'fill', 'epsilon'}, varargin));
 
 if isnumeric(S)
     S = {S};
@@ -62,7 +91,21 @@ pastelmatlab.concept_check(...
   kSuggestion, 'non_negative', ...
   q, 'real', ...
   q, 'positive', ...
-  filter, tim_package('filter'));
+  filter, tim_package('filter'), ...
+  hop, 'integer', ...
+  hop, 'positive', ...
+  refine, 'non_negative', ...
+  epsilon, 'real', ...
+  epsilon, 'non_negative');
 
-H = tim_matlab('renyi_entropy_lps_t', ...
-    S, timeWindowRadius, q, kSuggestion, filter);
+outputSet = cell(1, max(nargout, 1));
+[outputSet{:}] = tim_matlab('renyi_entropy_lps_t', ...
+    S, timeWindowRadius, q, kSuggestion, filter, ...
+    hop, refine, double(fill), epsilon);
+H = outputSet{1};
+if nargout > 1
+    M = outputSet{2};
+end
+if nargout > 2
+    E = outputSet{3};
+end
@@ -3,6 +3,7 @@
 %
 % I = transfer_entropy(X, Y, W)
 % I = transfer_entropy(X, Y, W, 'key', value, ...)
+% [I, M] = transfer_entropy(...)
 %
 % where
 %
@@ -17,17 +18,20 @@
 % K ('k') is an integer which denotes the number of nearest 
 % neighbors to be used by the estimator. Default 1.
 %
+% M contains the measurements of the estimate, as in 
+% entropy_combination.
+%
 % Type 'help tim' for more documentation.
 
 % Description: Transfer entropy estimation
 % Documentation: transfer_entropy.txt
 
-function I = transfer_entropy(X, Y, W, varargin)
+function [I, varargout] = transfer_entropy(X, Y, W, varargin)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 3);
-concept_check(nargout, 'outputs', 0 : 1);
+concept_check(nargout, 'outputs', 0 : 2);
 
 % Optional input arguments.
 xLag = 0;
@@ -60,7 +64,7 @@ end
 
 % Pass parameter error checking to entropy_combination.
 
-I = entropy_combination(...
+[I, varargout{1 : nargout - 1}] = entropy_combination(...
     [W(:)'; X(:)'; Y(:)'], ...
     [1, 2, 1; 2, 3, 1; 2, 2, -1], ...
     'lagSet', {wLag, xLag, yLag}, ...
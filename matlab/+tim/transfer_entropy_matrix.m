@@ -0,0 +1,95 @@
+% TRANSFER_ENTROPY_MATRIX
+% Transfer entropy estimates between all pairs of signals.
+%
+% I = transfer_entropy_matrix(signalSet, futureSet)
+% I = transfer_entropy_matrix(signalSet, futureSet, 'key', value, ...)
+% [I, M] = transfer_entropy_matrix(...)
+%
+% where
+%
+% SIGNALSET is a 2-dimensional (p x q) cell-array 
+% containing q trials of p signals.
+%
+% FUTURESET is a 2-dimensional (p x q) cell-array, which contains
+% the future of each signal in SIGNALSET, such as given by 
+% delay_embed_future.
+%
+% I is a (p x p) real array, where I(i, j) is the transfer entropy
+% from the i:th signal to the j:th signal; that is, transfer_entropy
+% with X the j:th signal, Y the i:th signal, and W the future of the
+% j:th signal. The diagonal is NaN.
+%
+% M is a struct which contains the measurements of the estimates,
+% as in ENTROPY_COMBINATION_T. The estimates are measured only when
+% M is asked for.
+%
+% Optional input arguments in 'key'-value pairs:
+%
+% XLAG, YLAG, and WLAG ('xLag', 'yLag', 'wLag') are integers which
+% denote the amount of lag to apply to X, Y, and W, respectively. 
+% Default 0.
+%
+% K ('k') is an integer which denotes the number of nearest 
+% neighbors to be used by the estimator. Default 1.
+%
+% MAXMEMORY ('maxMemory') is a non-negative integer which denotes an
+% approximate bound, in bytes, for the memory of the shared point
+% sets and of the pairs being estimated in parallel. The shared point
+% sets must fit in the bound. Zero means no bound. Default: 0.
+%
+% Type 'help tim' for more documentation.
+
+% Description: Transfer entropy between all pairs of signals
+% Documentation: connectivity_matrix.txt
+
+function [I, M] = transfer_entropy_matrix(signalSet, futureSet, varargin)
+
+import([tim_package, '.*']);
+
+concept_check(nargin, 'inputs', 2);
+concept_check(nargout, 'outputs', 0 : 2);
+
+% Optional input arguments.
+xLag = 0;
+yLag = 0;
+wLag = 0;
+k = 1;
+maxMemory = 0;
+eval(process_options(...
+    {'k', 'xLag', 'yLag', 'wLag', 'maxMemory'}, ...
+    varargin));
+
+if isnumeric(signalSet)
+    signalSet = {signalSet};
+end
+
+if isnumeric(futureSet)
+    futureSet = {futureSet};
+end
+
+if ~isequal(size(signalSet), size(futureSet))
+    error('The sizes of SIGNALSET and FUTURESET differ.');
+end
+
+for i = 1 : size(signalSet, 1)
+    pastelmatlab.concept_check(...
+        signalSet(i, :), tim_package('signal_set'), ...
+        futureSet(i, :), tim_package('signal_set'));
+end
+
+pastelmatlab.concept_check(...
+    xLag, 'integer', ...
+    yLag, 'integer', ...
+    wLag, 'integer', ...
+    k, 'integer', ...
+    k, 'positive', ...
+    maxMemory, 'integer', ...
+    maxMemory, 'non_negative');
+
+outputSet = cell(1, max(nargout, 1));
+[outputSet{:}] = tim_matlab('transfer_entropy_matrix', ...
+    signalSet, futureSet, xLag, yLag, wLag, k, maxMemory);
+I = outputSet{1};
+if nargout > 1
+    M = outputSet{2};
+end
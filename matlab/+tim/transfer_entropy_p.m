@@ -3,6 +3,7 @@
 %
 % I = transfer_entropy_p(X, Y, Z, W)
 % I = transfer_entropy_p(X, Y, Z, W, 'key', value, ...)
+% [I, M] = transfer_entropy_p(...)
 %
 % where
 %
@@ -17,17 +18,20 @@
 % K ('k') is an integer which denotes the number of nearest 
 % neighbors to be used by the estimator. Default 1.
 %
+% M contains the measurements of the estimate, as in 
+% entropy_combination.
+%
 % Type 'help tim' for more documentation.
 
 % Description: Partial transfer entropy estimation
 % Documentation: transfer_entropy.txt
 
-function I = transfer_entropy_p(X, Y, Z, W, varargin)
+function [I, varargout] = transfer_entropy_p(X, Y, Z, W, varargin)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 4);
-concept_check(nargout, 'outputs', 0 : 1);
+concept_check(nargout, 'outputs', 0 : 2);
 
 % Optional input arguments
 k = 1;
@@ -66,7 +70,7 @@ end
 
 % Pass parameter error checking to entropy_combination.
 
-I = entropy_combination(...
+[I, varargout{1 : nargout - 1}] = entropy_combination(...
     [W(:)'; X(:)'; Z(:)'; Y(:)'], ...
     [1, 3, 1; 2, 4, 1; 2, 3, -1], ...
     'lagSet', {wLag, xLag, zLag, yLag}, ...
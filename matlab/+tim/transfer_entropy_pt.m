@@ -3,6 +3,8 @@
 %
 % I = transfer_entropy_pt(X, Y, Z, W, timeWindowRadius)
 % I = transfer_entropy_pt(X, Y, Z, W, timeWindowRadius, 'key', value, ...)
+% [I, M] = transfer_entropy_pt(...)
+% [I, M, E] = transfer_entropy_pt(...)
 %
 % where
 %
@@ -25,18 +27,24 @@
 % FILTER ('filter') is a real array, which gives the temporal 
 % weighting coefficients. Default 1.
 %
+% HOP, REFINE, FILL and EPSILON ('epsilon') are as in 
+% entropy_combination_t.
+%
+% M and E contain the measurements of the estimate and the 
+% relative error of its searches, as in entropy_combination_t.
+%
 % Type 'help tim' for more documentation.
 
 % Description: Temporal partial transfer entropy estimation
 % Documentation: transfer_entropy.txt
 
-function I = transfer_entropy_pt(...
+function [I, varargout] = transfer_entropy_pt(...
     X, Y, Z, W, timeWindowRadius, varargin)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 5);
-concept_check(nargout, 'outputs', 0 : 1);
+concept_check(nargout, 'outputs', 0 : 3);
 
 % Optional input arguments
 k = 1;
@@ -45,8 +53,12 @@ yLag = 0;
 zLag = 0;
 wLag = 0;
 filter = 1;
+hop = 1;
+refine = Inf;
+fill = true;
+epsilon = 0;
 eval(process_options(...
-    {'k', 'xLag', 'yLag', 'zLag', 'wLag', 'filter'}, varargin));
+    {'k', 'xLag', 'yLag', 'zLag', 'wLag', 'filter', 'hop', 'refine', 'fill', 'epsilon'}, varargin));
 
 if isnumeric(X)
     X = {X};
@@ -75,10 +87,14 @@ end
 
 % Pass parameter error checking to entropy_combination.
 
-I = entropy_combination_t(...
+[I, varargout{1 : nargout - 1}] = entropy_combination_t(...
     [W(:)'; X(:)'; Z(:)'; Y(:)'], ...
     [1, 3, 1; 2, 4, 1; 2, 3, -1], ...
     timeWindowRadius, ...
     'lagSet', {wLag, xLag, zLag, yLag}, ...
     'k', k, ...
-    'filter', filter);
+    'filter', filter, ...
+    'hop', hop, ...
+    'refine', refine, ...
+    'fill', fill, ...
+    'epsilon', epsilon);
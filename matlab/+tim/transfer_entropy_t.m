@@ -3,6 +3,8 @@
 %
 % I = transfer_entropy_t(X, Y, W, timeWindowRadius)
 % I = transfer_entropy_t(X, Y, W, timeWindowRadius, 'key', value, ...)
+% [I, M] = transfer_entropy_t(...)
+% [I, M, E] = transfer_entropy_t(...)
 %
 % where
 %
@@ -25,18 +27,24 @@
 % FILTER ('filter') is a real array, which gives the temporal 
 % weighting coefficients. Default 1.
 %
+% HOP, REFINE, FILL and EPSILON ('epsilon') are as in 
+% entropy_combination_t.
+%
+% M and E contain the measurements of the estimate and the 
+% relative error of its searches, as in entropy_combination_t.
+%
 % Type 'help tim' for more documentation.
 
 % Description: Temporal transfer entropy estimation
 % Documentation: transfer_entropy.txt
 
-function I = transfer_entropy_t(...
+function [I, varargout] = transfer_entropy_t(...
     X, Y, W, timeWindowRadius, varargin)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 4);
-concept_check(nargout, 'outputs', 0 : 1);
+concept_check(nargout, 'outputs', 0 : 3);
 
 % Optional input arguments
 k = 1;
@@ -44,8 +52,12 @@ xLag = 0;
 yLag = 0;
 wLag = 0;
 filter = 1;
+hop = 1;
+refine = Inf;
+fill = true;
+epsilon = 0;
 eval(process_options(...
-    {'k', 'xLag', 'yLag', 'wLag', 'filter'}, varargin));
+    {'k', 'xLag', 'yLag', 'wLag', 'filter', 'hop', 'refine', 'fill', 'epsilon'}, varargin));
 
 if isnumeric(X)
     X = {X};
@@ -67,10 +79,14 @@ if numel(X) ~= numel(Y) || numel(X) ~= numel(W)
     error('The number of trials in X, Y, and W differ.');
 end
 
-I = entropy_combination_t(...
+[I, varargout{1 : nargout - 1}] = entropy_combination_t(...
     [W(:)'; X(:)'; Y(:)'], ...
     [1, 2, 1; 2, 3, 1; 2, 2, -1], ...
     timeWindowRadius, ...
     'lagSet', {wLag, xLag, yLag}, ...
     'k', k, ...
-    'filter', filter);
+    'filter', filter, ...
+    'hop', hop, ...
+    'refine', refine, ...
+    'fill', fill, ...
+    'epsilon', epsilon);
@@ -4,6 +4,8 @@
 %
 % H = tsallis_entropy_lps(S)
 % H = tsallis_entropy_lps(S, 'key', value, ...)
+% [H, M] = tsallis_entropy_lps(...)
+% [H, M, E] = tsallis_entropy_lps(...)
 %
 % where
 %
@@ -11,6 +13,14 @@
 %
 % H is the estimated Tsallis entropy.
 %
+% M is a struct which contains the measurements of the estimate,
+% as in ENTROPY_COMBINATION_T. The estimate is measured only when
+% M is asked for.
+%
+% E is the relative error that the nearest neighbor searches actually
+% had. This is EPSILON, except that it is zero when the searches are 
+% exact anyway (one-dimensional points).
+%
 % Optional input arguments in 'key'-value pairs:
 %
 % Q ('q') is the power in the definition Renyi entropy.
@@ -26,23 +36,28 @@
 % is used. For accurate results one should choose 
 % kSuggestion >= 2 * ceil(q) - 1. Default: 0.
 %
+% EPSILON ('epsilon') is a non-negative real which denotes the allowed
+% relative error in the nearest neighbor distances. Larger values trade
+% accuracy for speed. Default 0, which gives exact searches.
+%
 % Type 'help tim' for more documentation.
 
 % Description: Tsallis entropy estimation
 % Detail: Leonenko-Pronzato-Savani nearest neighbor estimator
 % Documentation: tsallis_entropy_lps.txt
 
-function H = tsallis_entropy_lps(S, varargin)
+function [H, M, E] = tsallis_entropy_lps(S, varargin)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 1);
-concept_check(nargout, 'outputs', 0 : 1);
+concept_check(nargout, 'outputs', 0 : 3);
 
 % Optional input arguments
 q = 2;
 kSuggestion = 0;
-eval(process_options({'q', 'kSuggestion'}, varargin));
+epsilon = 0;
+eval(process_options({'q', 'kSuggestion', 'epsilon'}, varargin));
 
 if isnumeric(S)
     S = {S};
@@ -53,7 +68,17 @@ pastelmatlab.concept_check(...
 	q, 'real', ...
 	q, 'positive', ...
 	kSuggestion, 'integer', ...
-	kSuggestion, 'non_negative');
+	kSuggestion, 'non_negative', ...
+	epsilon, 'real', ...
+	epsilon, 'non_negative');
 
-H = tim_matlab('tsallis_entropy_lps', ...
-	S, q, kSuggestion);
+outputSet = cell(1, max(nargout, 1));
+[outputSet{:}] = tim_matlab('tsallis_entropy_lps', ...
+	S, q, kSuggestion, epsilon);
+H = outputSet{1};
+if nargout > 1
+    M = outputSet{2};
+end
+if nargout > 2
+    E = outputSet{3};
+end
@@ -4,11 +4,21 @@
 %
 % H = tsallis_entropy_lps_t(S, timeWindowRadius)
 % H = tsallis_entropy_lps_t(S, timeWindowRadius, 'key', value, ...)
+% [H, M] = tsallis_entropy_lps_t(...)
+% [H, M, E] = tsallis_entropy_lps_t(...)
 %
 % where
 %
 % S is a signal set.
 %
+% M is a struct which contains the measurements of the estimate,
+% as in ENTROPY_COMBINATION_T. The estimate is measured only when
+% M is asked for.
+%
+% E is the relative error that the nearest neighbor searches actually
+% had. This is EPSILON, except that it is zero when the searches are 
+% exact anyway (one-dimensional points).
+%
 % Optional input arguments in 'key'-value pairs:
 %
 % Q ('q') is the power in the definition Tsallis entropy.
@@ -25,24 +35,43 @@
 % FILTER ('filter') is a real array, which gives the temporal 
 % weighting coefficients. Default 1.
 %
+% HOP ('hop') is a positive integer. The estimate is evaluated only at 
+% every HOP:th time instant, and at the last time instant. Default 1.
+%
+% REFINE ('refine') is a non-negative real. Where two consecutive 
+% evaluated estimates differ by more than REFINE, the time instants 
+% between them are evaluated by bisection. Default Inf (no refinement).
+%
+% FILL ('fill') is a boolean which denotes whether the time instants 
+% which are not evaluated are filled by linear interpolation, or left 
+% as NaNs. Default true.
+%
+% EPSILON ('epsilon') is a non-negative real which denotes the allowed
+% relative error in the nearest neighbor distances. Larger values trade
+% accuracy for speed. Default 0, which gives exact searches.
+%
 % Type 'help tim' for more documentation.
 
 % Description: Temporal Tsallis entropy estimation
 % Detail: Leonenko-Pronzato-Savani nearest neighbor estimator
 % Documentation: tsallis_entropy_lps.txt
 
-function H = tsallis_entropy_lps_t(S, timeWindowRadius, varargin)
+function [H, M, E] = tsallis_entropy_lps_t(S, timeWindowRadius, varargin)
 
 import([tim_package, '.*']);
 
 concept_check(nargin, 'inputs', 2);
-concept_check(nargout, 'outputs', 0 : 1);
+concept_check(nargout, 'outputs', 0 : 3);
 
 % Optional input arguments
 q = 2;
 kSuggestion = 0;
 filter = 1;
-eval(process_options({'q', 'kSuggestion', 'filter'}, varargin));
+hop = 1;
+refine = Inf;
+fill = true;
+epsilon = 0;
+eval(process_options({'q', 'kSuggestion', 'filter', 'hop', 'refine', 'fill', 'epsilon'}, varargin));
 
 if isnumeric(S)
     S = {S};
@@ -56,8 +85,22 @@ pastelmatlab.concept_check(...
 	q, 'positive', ...
 	kSuggestion, 'integer', ...
 	kSuggestion, 'non_negative', ...
-	filter, tim_package('filter'));
+	filter, tim_package('filter'), ...
+	hop, 'integer', ...
+	hop, 'positive', ...
+	refine, 'non_negative', ...
+	epsilon, 'real', ...
+	epsilon, 'non_negative');
 
-H = tim_matlab('tsallis_entropy_lps_t', ...
+outputSet = cell(1, max(nargout, 1));
+[outputSet{:}] = tim_matlab('tsallis_entropy_lps_t', ...
     S, timeWindowRadius, ...
-    q, kSuggestion, filter);
+    q, kSuggestion, filter, ...
+    hop, refine, double(fill), epsilon);
+H = outputSet{1};
+if nargout > 1
+    M = outputSet{2};
+end
+if nargout > 2
+    E = outputSet{3};
+end
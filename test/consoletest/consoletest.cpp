@@ -0,0 +1,172 @@
+// Description: A smoke test of TIM Console
+// Detail: Runs the tim executable on a small job, and checks its outputs
+
+#include "tim/core/mapped_signals.h"
+#include "tim/core/entropy_combination.h"
+#include "tim/core/entropy_combination_t.h"
+#include "tim/core/signal_generate.h"
+
+#include <pastel/sys/array/array.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace Tim;
+
+namespace
+{
+
+	integer failures = 0;
+
+	void check(bool condition, const std::string& what)
+	{
+		if (!condition)
+		{
+			std::cerr << "FAILED: " << what << std::endl;
+			++failures;
+		}
+	}
+
+	// Writes a 1-dimensional signal as a CSV file.
+	void writeCsv(const std::string& fileName, const Signal& signal)
+	{
+		std::ofstream file(fileName);
+		file.precision(17);
+		for (integer t = 0;t < signal.samples();++t)
+		{
+			file << signal.data()(0, t) << std::endl;
+		}
+	}
+
+	// Writes a 1-dimensional signal as a .npy file of shape (samples, 1).
+	void writeNpy(const std::string& fileName, const Signal& signal)
+	{
+		std::string header =
+			"{'descr': '<f8', 'fortran_order': False, 'shape': (" +
+			std::to_string(signal.samples()) + ", 1), }";
+		header.append((64 - (10 + header.size() + 1) % 64) % 64, ' ');
+		header += '\n';
+
+		std::ofstream file(fileName, std::ios::binary);
+		file.write("\x93NUMPY\x01\x00", 8);
+		char length[2] = {
+			(char)(header.size() & 0xFF),
+			(char)(header.size() >> 8)};
+		file.write(length, 2);
+		file.write(header.data(), header.size());
+		file.write(
+			(const char*)signal.data().data(),
+			signal.samples() * sizeof(dreal));
+	}
+
+	// Runs the tim executable, and returns whether it succeeded.
+	bool runTim(const std::string& tim, const std::string& jobFile)
+	{
+		std::string command = "\"" + tim + "\" " + jobFile;
+		return std::system(command.c_str()) == 0;
+	}
+
+}
+
+int main(int argc, char* argv[])
+{
+	// The tim executable is given as an argument, or
+	// otherwise the one built with this test is used.
+	std::string tim = (argc > 1) ? argv[1] : TIM_CONSOLE_PATH;
+
+	integer samples = 500;
+
+	SignalData xData = generateGaussian(1, samples);
+	SignalData yData = generateGaussian(1, samples);
+	for (integer t = 0;t < samples;++t)
+	{
+		yData.data()(0, t) += xData.data()(0, t);
+	}
+
+	Array<Signal> signalSet(Vector2i(1, 2));
+	signalSet(0, 0) = (Signal)xData;
+	signalSet(0, 1) = (Signal)yData;
+
+	writeCsv("consoletest_x.csv", signalSet(0, 0));
+	writeNpy("consoletest_y.npy", signalSet(0, 1));
+
+	{
+		std::ofstream file("consoletest_job.txt");
+		file << "[job]" << std::endl;
+		file << "estimator = entropy_combination" << std::endl;
+		file << "signal = consoletest_x.csv" << std::endl;
+		file << "signal = consoletest_y.npy" << std::endl;
+		file << "ranges = 1 1 1; 2 2 1" << std::endl;
+		file << "k = 2" << std::endl;
+		file << "output = consoletest_mi.tim" << std::endl;
+		file << "[job]" << std::endl;
+		file << "estimator = entropy_combination_t" << std::endl;
+		file << "signal = consoletest_x.csv" << std::endl;
+		file << "signal = consoletest_y.npy" << std::endl;
+		file << "ranges = 1 1 1; 2 2 1" << std::endl;
+		file << "lags = 0 2" << std::endl;
+		file << "time_window_radius = 20" << std::endl;
+		file << "output = consoletest_mi_t.tim" << std::endl;
+	}
+
+	check(runTim(tim, "consoletest_job.txt"), "the job succeeds");
+
+	std::vector<Integer3> rangeSet = {Integer3(0, 1, 1), Integer3(1, 2, 1)};
+	{
+		dreal correct = entropyCombination(
+			signalSet, rangeSet, std::vector<integer>(2, 0), 2);
+
+		MappedSignals mapped("consoletest_mi.tim");
+		check(mapped.trials() == 1 &&
+			mapped.dimension() == 1 &&
+			mapped.samples() == 1,
+			"the mutual information is a single sample");
+		check(mapped.samples() == 1 &&
+			std::abs(mapped.signal(0).data()(0) - correct) <= 1e-12,
+			"the mutual information is that of entropyCombination()");
+	}
+	{
+		SignalData correct = temporalEntropyCombination(
+			signalSet, rangeSet, 20, std::vector<integer>{0, 2});
+		integer estimates = correct.dimension() * correct.samples();
+
+		MappedSignals mapped("consoletest_mi_t.tim");
+		check(mapped.trials() == 1 &&
+			mapped.dimension() == 1 &&
+			mapped.samples() == estimates &&
+			mapped.t() == correct.t(),
+			"the temporal mutual information is a 1-dimensional trial");
+
+		bool equal = (mapped.samples() == estimates);
+		for (integer t = 0;equal && t < estimates;++t)
+		{
+			equal = std::abs(mapped.signal(0).data()(t) - correct.data()(t)) <= 1e-12;
+		}
+		check(equal, "the temporal mutual information is that of temporalEntropyCombination()");
+	}
+
+	// A missing signal file fails the job, but not the run.
+	{
+		std::ofstream file("consoletest_missing.txt");
+		file << "[job]" << std::endl;
+		file << "estimator = differential_entropy_kl" << std::endl;
+		file << "signal = consoletest_missing.npy" << std::endl;
+		file << "output = consoletest_missing.tim" << std::endl;
+	}
+	check(!runTim(tim, "consoletest_missing.txt"), "a missing signal file fails the job");
+
+	for (const char* fileName : {
+		"consoletest_x.csv", "consoletest_y.npy", "consoletest_job.txt",
+		"consoletest_mi.tim", "consoletest_mi_t.tim", "consoletest_missing.txt"})
+	{
+		std::remove(fileName);
+	}
+
+	std::cout << "failures: " << failures << std::endl;
+	return (failures > 0) ? 1 : 0;
+}
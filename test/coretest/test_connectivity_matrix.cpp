@@ -0,0 +1,215 @@
+#include "estimation.h"
+
+#include "tim/core/connectivity_matrix.h"
+#include "tim/core/mutual_information.h"
+#include "tim/core/transfer_entropy.h"
+#include "tim/core/partial_mutual_information.h"
+#include "tim/core/signal_generate.h"
+
+#include <pastel/sys/array/array.h>
+
+using namespace Tim;
+
+namespace
+{
+
+	class ConnectivityMatrixTest
+		: public TestSuite
+	{
+	public:
+		ConnectivityMatrixTest()
+			: TestSuite(&timTestReport())
+		{
+		}
+
+		virtual void run()
+		{
+			integer trials = 2;
+			integer samples = 300;
+			std::vector<integer> dimensionSet = {1, 2, 1, 1};
+			integer n = dimensionSet.size();
+
+			Array<Signal> signalSet(Vector2i(trials, n));
+			Array<Signal> futureSet(Vector2i(trials, n));
+			Array<Signal> zSignalSet(Vector2i(trials, 1));
+			dataSet_.reserve(trials * (2 * n + 1));
+			for (integer x = 0;x < trials;++x)
+			{
+				for (integer i = 0;i < n;++i)
+				{
+					dataSet_.push_back(generateGaussian(dimensionSet[i], samples));
+					signalSet(x, i) = (Signal)dataSet_.back();
+
+					// The estimates do not depend on how the
+					// future is formed, so that any signal does.
+					dataSet_.push_back(generateGaussian(1, samples));
+					futureSet(x, i) = (Signal)dataSet_.back();
+				}
+
+				dataSet_.push_back(generateGaussian(2, samples));
+				zSignalSet(x, 0) = (Signal)dataSet_.back();
+			}
+
+			channelSet_.resize(n);
+			futureChannelSet_.resize(n);
+			for (integer i = 0;i < n;++i)
+			{
+				for (integer x = 0;x < trials;++x)
+				{
+					channelSet_[i].push_back(signalSet(x, i));
+					futureChannelSet_[i].push_back(futureSet(x, i));
+				}
+			}
+			for (integer x = 0;x < trials;++x)
+			{
+				zChannel_.push_back(zSignalSet(x, 0));
+			}
+
+			// The maximum memory of 700000 bytes fits the 
+			// shared marginal point sets, but allows only a
+			// few pairs to be estimated at a time.
+			for (integer maxMemory : {0, 700000})
+			{
+				for (bool symmetric : {true, false})
+				{
+					testMutualInformation(signalSet, 0, 0, 2, symmetric, maxMemory);
+					testMutualInformation(signalSet, 0, 3, 1, symmetric, maxMemory);
+					testPartialMutualInformation(
+						signalSet, zSignalSet, 0, 0, 1, 2, symmetric, maxMemory);
+					testPartialMutualInformation(
+						signalSet, zSignalSet, 2, 0, 0, 1, symmetric, maxMemory);
+				}
+
+				testTransferEntropy(signalSet, futureSet, 0, 0, 0, 1, maxMemory);
+				testTransferEntropy(signalSet, futureSet, 0, 2, 1, 3, maxMemory);
+			}
+		}
+
+		void testMutualInformation(
+			const Array<Signal>& signalSet,
+			integer xLag, integer yLag,
+			integer kNearest,
+			bool symmetric,
+			integer maxMemory)
+		{
+			integer n = channelSet_.size();
+
+			std::vector<dreal> matrix = mutualInformationMatrix(
+				signalSet, xLag, yLag, kNearest, symmetric, maxMemory);
+			TEST_ENSURE_OP(matrix.size(), ==, n * n);
+
+			for (integer i = 0;i < n;++i)
+			{
+				for (integer j = 0;j < n;++j)
+				{
+					if (i == j && xLag == yLag)
+					{
+						TEST_ENSURE(isNan(matrix[i * n + j]));
+						continue;
+					}
+
+					dreal correct = mutualInformation(
+						channelSet_[i], channelSet_[j],
+						xLag, yLag, kNearest);
+					TEST_ENSURE_OP(std::abs(matrix[i * n + j] - correct), <=, 1e-12);
+				}
+			}
+		}
+
+		void testTransferEntropy(
+			const Array<Signal>& signalSet,
+			const Array<Signal>& futureSet,
+			integer xLag, integer yLag, integer wLag,
+			integer kNearest,
+			integer maxMemory)
+		{
+			integer n = channelSet_.size();
+
+			std::vector<dreal> matrix = transferEntropyMatrix(
+				signalSet, futureSet, xLag, yLag, wLag, kNearest, maxMemory);
+			TEST_ENSURE_OP(matrix.size(), ==, n * n);
+
+			for (integer i = 0;i < n;++i)
+			{
+				for (integer j = 0;j < n;++j)
+				{
+					if (i == j)
+					{
+						TEST_ENSURE(isNan(matrix[i * n + j]));
+						continue;
+					}
+
+					// From the i:th channel to the j:th channel.
+					dreal correct = transferEntropy(
+						channelSet_[j], channelSet_[i], futureChannelSet_[j],
+						xLag, yLag, wLag, kNearest);
+					TEST_ENSURE_OP(std::abs(matrix[i * n + j] - correct), <=, 1e-12);
+				}
+			}
+		}
+
+		void testPartialMutualInformation(
+			const Array<Signal>& signalSet,
+			const Array<Signal>& zSignalSet,
+			integer xLag, integer yLag, integer zLag,
+			integer kNearest,
+			bool symmetric,
+			integer maxMemory)
+		{
+			integer n = channelSet_.size();
+
+			std::vector<dreal> matrix = partialMutualInformationMatrix(
+				signalSet, zSignalSet, xLag, yLag, zLag,
+				kNearest, symmetric, maxMemory);
+			TEST_ENSURE_OP(matrix.size(), ==, n * n);
+
+			for (integer i = 0;i < n;++i)
+			{
+				for (integer j = 0;j < n;++j)
+				{
+					if (i == j && xLag == yLag)
+					{
+						TEST_ENSURE(isNan(matrix[i * n + j]));
+						continue;
+					}
+
+					dreal correct = partialMutualInformation(
+						channelSet_[i], channelSet_[j], zChannel_,
+						xLag, yLag, zLag, kNearest);
+					TEST_ENSURE_OP(std::abs(matrix[i * n + j] - correct), <=, 1e-12);
+				}
+			}
+		}
+
+	private:
+		/*
+		dataSet_:
+		The data of the generated signals.
+
+		channelSet_, futureChannelSet_:
+		The trials of each channel, and of its future.
+
+		zChannel_:
+		The trials of the conditioning signal.
+		*/
+
+		std::vector<SignalData> dataSet_;
+		std::vector<std::vector<Signal>> channelSet_;
+		std::vector<std::vector<Signal>> futureChannelSet_;
+		std::vector<Signal> zChannel_;
+	};
+
+	void testConnectivityMatrix()
+	{
+		ConnectivityMatrixTest test;
+		test.run();
+	}
+
+	void addTest()
+	{
+		timTestList().add("ConnectivityMatrix", testConnectivityMatrix);
+	}
+
+	CallFunction run(addTest);
+
+}
@@ -12,6 +12,91 @@ using namespace Tim;
 namespace
 {
 
+	class DivergenceTest
+		: public TestSuite
+	{
+	public:
+		DivergenceTest()
+			: TestSuite(&timTestReport())
+		{
+		}
+
+		virtual void run()
+		{
+			testTrials();
+			testNormal();
+		}
+
+		void testTrials()
+		{
+			// The divergence between samples of the same 
+			// distribution is zero, however the samples
+			// are divided into trials. Counting only the 
+			// samples of one trial would offset the estimate 
+			// by the logarithm of the number of trials.
+
+			std::vector<SignalData> dataSet;
+			dataSet.reserve(5);
+			for (integer i = 0;i < 4;++i)
+			{
+				dataSet.push_back(generateGaussian(2, 1000));
+			}
+			dataSet.push_back(generateGaussian(2, 4000));
+
+			std::vector<Signal> splitSet;
+			for (integer i = 0;i < 4;++i)
+			{
+				splitSet.push_back((Signal)dataSet[i]);
+			}
+			std::vector<Signal> wholeSet(1, (Signal)dataSet.back());
+
+			TEST_ENSURE_OP(std::abs(divergenceWkv(wholeSet, splitSet)), <, 0.25);
+			TEST_ENSURE_OP(std::abs(divergenceWkv(splitSet, wholeSet)), <, 0.25);
+		}
+
+		void testNormal()
+		{
+			// The estimator does not depend on the norm in which 
+			// the nearest neighbors are searched; compare with 
+			// the analytic divergences of normal distributions.
+
+			testNormal(1, 2, 0);
+			testNormal(2, 1, 1);
+			testNormal(2, 2, 1);
+			testNormal(3, 1.5, 0.5);
+		}
+
+		void testNormal(
+			integer dimension, 
+			dreal deviation, 
+			dreal mean)
+		{
+			// X ~ N(0, I), Y ~ N(mean * 1, deviation^2 I).
+
+			integer samples = 10000;
+
+			SignalData xSignal = generateGaussian(dimension, samples);
+			SignalData ySignal = generateGaussian(dimension, samples);
+			for (integer t = 0;t < samples;++t)
+			{
+				for (integer j = 0;j < dimension;++j)
+				{
+					ySignal.data()(j, t) = 
+						ySignal.data()(j, t) * deviation + mean;
+				}
+			}
+
+			dreal variance = deviation * deviation;
+			dreal correct = 0.5 * dimension * 
+				(1 / variance - 1 + std::log(variance) + mean * mean / variance);
+
+			std::vector<Signal> xSignalSet(1, (Signal)xSignal);
+			std::vector<Signal> ySignalSet(1, (Signal)ySignal);
+
+			TEST_ENSURE_OP(std::abs(divergenceWkv(xSignalSet, ySignalSet) - correct), <, 0.1);
+		}
+	};
+
 	void testDivergence()
 	{
 		SignalData xSignal = generateGaussian(10, 10000);
@@ -19,6 +104,9 @@ namespace
 
 		const dreal div = divergenceWkv(xSignal, ySignal);
 		log() << "Divergence = " << div << logNewLine;
+
+		DivergenceTest test;
+		test.run();
 	}
 
 	void addTest()
@@ -0,0 +1,153 @@
+#include "estimation.h"
+
+#include "tim/core/estimation_plan.h"
+#include "tim/core/entropy_combination.h"
+#include "tim/core/mutual_information.h"
+#include "tim/core/transfer_entropy.h"
+#include "tim/core/partial_mutual_information.h"
+#include "tim/core/partial_transfer_entropy.h"
+#include "tim/core/signal_generate.h"
+
+#include <pastel/sys/array/array.h>
+
+using namespace Tim;
+
+namespace
+{
+
+	class EstimationPlanTest
+		: public TestSuite
+	{
+	public:
+		EstimationPlanTest()
+			: TestSuite(&timTestReport())
+		{
+		}
+
+		virtual void run()
+		{
+			testPlan();
+		}
+
+		void testPlan()
+		{
+			// The estimates of a plan must be those of
+			// separate calls, even when the estimates share
+			// point sets and searches with different k's.
+
+			integer trials = 2;
+			integer samples = 500;
+			std::vector<integer> dimensionSet = {1, 2, 1, 2};
+			integer signals = dimensionSet.size();
+
+			std::vector<SignalData> dataSet;
+			dataSet.reserve(trials * signals);
+			Array<Signal> signalSet(Vector2i(trials, signals));
+			for (integer x = 0;x < trials;++x)
+			{
+				for (integer i = 0;i < signals;++i)
+				{
+					dataSet.push_back(generateGaussian(dimensionSet[i], samples));
+					signalSet(x, i) = (Signal)dataSet.back();
+				}
+			}
+
+			std::vector<std::vector<Signal>> trialSet(signals);
+			for (integer i = 0;i < signals;++i)
+			{
+				for (integer x = 0;x < trials;++x)
+				{
+					trialSet[i].push_back(signalSet(x, i));
+				}
+			}
+
+			EstimationPlan plan(signalSet);
+			std::vector<integer> indexSet;
+			std::vector<dreal> correctSet;
+
+			// Mutual information with the same joint
+			// space, searched for two k's at once.
+			indexSet.push_back(plan.addMutualInformation(0, 1, 0, 0, 1));
+			correctSet.push_back(mutualInformation(
+				trialSet[0], trialSet[1], 0, 0, 1));
+
+			indexSet.push_back(plan.addMutualInformation(0, 1, 0, 0, 4));
+			correctSet.push_back(mutualInformation(
+				trialSet[0], trialSet[1], 0, 0, 4));
+
+			indexSet.push_back(plan.addMutualInformation(0, 1, 0, 3, 2));
+			correctSet.push_back(mutualInformation(
+				trialSet[0], trialSet[1], 0, 3, 2));
+
+			// Transfer entropies from X = 1 to Y = 0 and to
+			// Y = 3, both with W = 2, share the marginal (w, X).
+			indexSet.push_back(plan.addTransferEntropy(1, 0, 2, 1, 0, 2, 1));
+			correctSet.push_back(transferEntropy(
+				trialSet[1], trialSet[0], trialSet[2], 1, 0, 2, 1));
+
+			indexSet.push_back(plan.addTransferEntropy(1, 3, 2, 1, 0, 2, 3));
+			correctSet.push_back(transferEntropy(
+				trialSet[1], trialSet[3], trialSet[2], 1, 0, 2, 3));
+
+			indexSet.push_back(plan.addPartialMutualInformation(0, 1, 2, 0, 0, 0, 2));
+			correctSet.push_back(partialMutualInformation(
+				trialSet[0], trialSet[1], trialSet[2], 0, 0, 0, 2));
+
+			indexSet.push_back(plan.addPartialTransferEntropy(1, 0, 3, 2, 1, 0, 1, 2, 1));
+			correctSet.push_back(partialTransferEntropy(
+				trialSet[1], trialSet[0], trialSet[3], trialSet[2], 1, 0, 1, 2, 1));
+
+			// A general entropy combination, whose marginals
+			// are the joint space of the first mutual information.
+			{
+				Array<Signal> combinationSet(Vector2i(trials, 3));
+				for (integer x = 0;x < trials;++x)
+				{
+					combinationSet(x, 0) = signalSet(x, 0);
+					combinationSet(x, 1) = signalSet(x, 1);
+					combinationSet(x, 2) = signalSet(x, 3);
+				}
+
+				std::vector<Integer3> rangeSet =
+					{Integer3(0, 2, 1), Integer3(2, 3, 1)};
+				std::vector<integer> lagSet = {0, 0, 1};
+
+				indexSet.push_back(plan.add({0, 1, 3}, rangeSet, lagSet, 3));
+				correctSet.push_back(entropyCombination(
+					combinationSet, rangeSet, lagSet, 3));
+			}
+
+			TEST_ENSURE_OP(plan.estimates(), ==, indexSet.size());
+
+			// The shared point sets and searches are built once.
+			// The mutual informations with k = 1 and k = 4 share
+			// a search. Without sharing, the joint spaces and the
+			// marginals would make 28 point sets.
+			TEST_ENSURE_OP(plan.searches(), ==, plan.estimates() - 1);
+			TEST_ENSURE_OP(plan.pointSets(), <, 28);
+
+			std::vector<dreal> estimateSet = plan.estimate();
+			TEST_ENSURE_OP(estimateSet.size(), ==, indexSet.size());
+
+			for (integer i = 0;i < indexSet.size();++i)
+			{
+				TEST_ENSURE_OP(indexSet[i], ==, i);
+				TEST_ENSURE_OP(std::abs(estimateSet[i] - correctSet[i]), <=, 1e-12);
+			}
+		}
+	};
+
+	void testEstimationPlan()
+	{
+		EstimationPlanTest test;
+		test.run();
+	}
+
+	void addTest()
+	{
+		timTestList().add("EstimationPlan", testEstimationPlan);
+	}
+
+	CallFunction run(addTest);
+
+}
@@ -0,0 +1,255 @@
+#include "estimation.h"
+
+#include "tim/core/generic_entropies.h"
+#include "tim/core/differential_entropy_kl.h"
+#include "tim/core/renyi_entropy_lps.h"
+#include "tim/core/tsallis_entropy_lps.h"
+#include "tim/core/signal_generate.h"
+
+#include <cmath>
+
+using namespace Tim;
+
+namespace
+{
+
+	class GenericEntropiesTest
+		: public TestSuite
+	{
+	public:
+		GenericEntropiesTest()
+			: TestSuite(&timTestReport())
+			, dataSet_()
+			, signalSet_()
+		{
+			// The trials start at different times, so that
+			// the temporal estimates only use the shared
+			// time interval.
+
+			dataSet_.reserve(trials_);
+			for (integer x = 0;x < trials_;++x)
+			{
+				dataSet_.push_back(generateGaussian(2, samples_));
+				signalSet_.push_back(Signal(dataSet_.back().data(), 5 * x));
+			}
+		}
+
+		virtual void run()
+		{
+			testGeneric();
+			testDifferential();
+			testRenyi();
+			testTsallis();
+			testTemporal();
+		}
+
+		bool equal(dreal left, dreal right)
+		{
+			if (left == right)
+			{
+				return true;
+			}
+
+			if (isNan(left) || isNan(right))
+			{
+				return isNan(left) && isNan(right);
+			}
+
+			return std::abs(left - right) <=
+				1e-10 * std::max(std::abs(right), (dreal)1);
+		}
+
+		bool equal(const SignalData& left, const SignalData& right)
+		{
+			if (left.samples() != right.samples() ||
+				left.dimension() != right.dimension() ||
+				left.t() != right.t())
+			{
+				return false;
+			}
+
+			for (integer i = 0;i < left.samples() * left.dimension();++i)
+			{
+				if (!equal(left.data()(i), right.data()(i)))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		void testGeneric()
+		{
+			// The k's are not in order, and repeat.
+
+			std::vector<integer> kNearestSet = {3, 1, 6, 3, 2};
+
+			using EntropyAlgorithm =
+				KlDifferential_EntropyAlgorithm<Maximum_Norm<dreal>>;
+			std::vector<EntropyAlgorithm> entropyAlgorithmSet(
+				kNearestSet.size());
+
+			std::vector<dreal> estimateSet = genericEntropies(
+				signalSet_, entropyAlgorithmSet, kNearestSet);
+			TEST_ENSURE_OP(estimateSet.size(), ==, kNearestSet.size());
+
+			for (integer i = 0;i < kNearestSet.size();++i)
+			{
+				dreal correct = genericEntropy(
+					signalSet_, entropyAlgorithmSet[i], kNearestSet[i]);
+				TEST_ENSURE(equal(estimateSet[i], correct));
+			}
+		}
+
+		void testDifferential()
+		{
+			std::vector<integer> kNearestSet = {4, 1, 2};
+
+			std::vector<dreal> estimateSet =
+				differentialEntropiesKl(signalSet_, kNearestSet);
+			TEST_ENSURE_OP(estimateSet.size(), ==, kNearestSet.size());
+
+			for (integer i = 0;i < kNearestSet.size();++i)
+			{
+				dreal correct = differentialEntropyKl(
+					signalSet_, kNearestSet[i]);
+				TEST_ENSURE(equal(estimateSet[i], correct));
+			}
+
+			// A norm which SignalPointSet does not search with.
+
+			Euclidean_Norm<dreal> norm;
+			estimateSet = differentialEntropiesKl(
+				signalSet_, kNearestSet, norm);
+			TEST_ENSURE_OP(estimateSet.size(), ==, kNearestSet.size());
+
+			for (integer i = 0;i < kNearestSet.size();++i)
+			{
+				dreal correct = differentialEntropyKl(
+					signalSet_, kNearestSet[i], norm);
+				TEST_ENSURE(equal(estimateSet[i], correct));
+			}
+		}
+
+		// The grid contains q == 1, which falls back to
+		// differential entropy, and the suggestion 0, for
+		// which the k is decided from q.
+
+		std::vector<dreal> qSet()
+		{
+			return {2, 1, 3.5, 0.8};
+		}
+
+		std::vector<integer> kNearestSuggestionSet()
+		{
+			return {0, 1, 4};
+		}
+
+		void testRenyi()
+		{
+			std::vector<dreal> estimateSet = renyiEntropiesLps(
+				signalSet_, qSet(), kNearestSuggestionSet());
+			TEST_ENSURE_OP(estimateSet.size(), ==,
+				qSet().size() * kNearestSuggestionSet().size());
+
+			integer i = 0;
+			for (dreal q : qSet())
+			{
+				for (integer kNearest : kNearestSuggestionSet())
+				{
+					dreal correct = renyiEntropyLps(
+						signalSet_, q, kNearest);
+					TEST_ENSURE(equal(estimateSet[i], correct));
+					++i;
+				}
+			}
+		}
+
+		void testTsallis()
+		{
+			std::vector<dreal> estimateSet = tsallisEntropiesLps(
+				signalSet_, qSet(), kNearestSuggestionSet());
+			TEST_ENSURE_OP(estimateSet.size(), ==,
+				qSet().size() * kNearestSuggestionSet().size());
+
+			integer i = 0;
+			for (dreal q : qSet())
+			{
+				for (integer kNearest : kNearestSuggestionSet())
+				{
+					dreal correct = tsallisEntropyLps(
+						signalSet_, q, kNearest);
+					TEST_ENSURE(equal(estimateSet[i], correct));
+					++i;
+				}
+			}
+		}
+
+		void testTemporal()
+		{
+			std::vector<integer> kNearestSet = {2, 5, 1};
+			std::vector<dreal> filter = {1, 2, 1};
+
+			using EntropyAlgorithm =
+				KlDifferential_EntropyAlgorithm<Maximum_Norm<dreal>>;
+			std::vector<EntropyAlgorithm> entropyAlgorithmSet(
+				kNearestSet.size());
+
+			for (integer timeWindowRadius : {2, 10})
+			{
+				std::vector<SignalData> estimateSet =
+					temporalGenericEntropies(
+						signalSet_, entropyAlgorithmSet, kNearestSet,
+						timeWindowRadius, filter);
+				TEST_ENSURE_OP(estimateSet.size(), ==, kNearestSet.size());
+
+				for (integer i = 0;i < kNearestSet.size();++i)
+				{
+					SignalData correct = temporalGenericEntropy(
+						signalSet_, entropyAlgorithmSet[i],
+						timeWindowRadius, kNearestSet[i], filter);
+					TEST_ENSURE(equal(estimateSet[i], correct));
+				}
+			}
+
+			TemporalHop hop;
+			hop.hop = 3;
+
+			Euclidean_Norm<dreal> norm;
+			std::vector<SignalData> estimateSet =
+				temporalDifferentialEntropiesKl(
+					signalSet_, 10, kNearestSet, norm, filter, hop);
+			TEST_ENSURE_OP(estimateSet.size(), ==, kNearestSet.size());
+
+			for (integer i = 0;i < kNearestSet.size();++i)
+			{
+				SignalData correct = temporalDifferentialEntropyKl(
+					signalSet_, 10, kNearestSet[i], norm, filter, 0, nullptr,
+					SignalPointSet::Layout::Automatic, hop);
+				TEST_ENSURE(equal(estimateSet[i], correct));
+			}
+		}
+
+	private:
+		integer samples_ = 300;
+		integer trials_ = 3;
+
+		std::vector<SignalData> dataSet_;
+		std::vector<Signal> signalSet_;
+	};
+
+	void testGenericEntropies()
+	{
+		GenericEntropiesTest test;
+		test.run();
+	}
+
+	void addTest()
+	{
+		timTestList().add("GenericEntropies", testGenericEntropies);
+	}
+
+	CallFunction run(addTest);
+
+}
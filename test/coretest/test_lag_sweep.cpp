@@ -0,0 +1,230 @@
+#include "estimation.h"
+
+#include "tim/core/lag_sweep.h"
+#include "tim/core/mutual_information_ec.h"
+#include "tim/core/transfer_entropy.h"
+#include "tim/core/signal_generate.h"
+
+#include <cmath>
+
+using namespace Tim;
+
+namespace
+{
+
+	class LagSweepTest
+		: public TestSuite
+	{
+	public:
+		LagSweepTest()
+			: TestSuite(&timTestReport())
+		{
+		}
+
+		virtual void run()
+		{
+			testEntropyCombination();
+			testNoSharedSamples();
+			testMutualInformation();
+			testTransferEntropy();
+		}
+
+		// The lags of the swept signal. The large lags shrink
+		// the shared time interval of the signals, and the
+		// first one leaves no shared samples at all.
+		std::vector<integer> lagSet()
+		{
+			return {-400, -40, -5, 0, 3, 17, 60, 250, 290};
+		}
+
+		// Generates the trials of a signal, starting at
+		// different times.
+		std::vector<Signal> generate(
+			std::vector<SignalData>& dataSet,
+			integer dimension)
+		{
+			std::vector<Signal> signalSet;
+			for (integer x = 0;x < trials_;++x)
+			{
+				dataSet.push_back(generateGaussian(dimension, samples_));
+				signalSet.push_back(Signal(dataSet.back().data(), x));
+			}
+			return signalSet;
+		}
+
+		bool equal(dreal left, dreal right)
+		{
+			return std::abs(left - right) <=
+				1e-10 * std::max(std::abs(right), (dreal)1);
+		}
+
+		void testEntropyCombination()
+		{
+			std::vector<SignalData> dataSet;
+			dataSet.reserve(3 * trials_);
+
+			Array<Signal> signalSet(Vector2i(trials_, 3));
+			for (integer y = 0;y < 3;++y)
+			{
+				std::vector<Signal> trialSet = generate(dataSet, 2);
+				std::copy(trialSet.begin(), trialSet.end(),
+					signalSet.rowBegin(y));
+			}
+
+			std::vector<Integer3> rangeSet =
+			{
+				Integer3(0, 2, 1),
+				Integer3(1, 3, 1),
+				Integer3(1, 2, -1)
+			};
+
+			std::vector<integer> sweepSet = lagSet();
+			for (integer signal = 0;signal < 3;++signal)
+			{
+				std::vector<integer> baseLagSet = {2, 0, -3};
+
+				dreal maxRelativeError = 0.5;
+				dreal relativeError = -1;
+				std::vector<dreal> estimateSet =
+					entropyCombinationLagSweep(
+						signalSet, rangeSet, baseLagSet,
+						signal, sweepSet, kNearest_,
+						maxRelativeError, &relativeError);
+				TEST_ENSURE_OP(estimateSet.size(), ==, sweepSet.size());
+
+				for (integer i = 0;i < sweepSet.size();++i)
+				{
+					std::vector<integer> lagSet = baseLagSet;
+					lagSet[signal] = sweepSet[i];
+
+					dreal correctError = -1;
+					dreal correct = entropyCombination(
+						signalSet, rangeSet, lagSet, kNearest_,
+						maxRelativeError, &correctError);
+					TEST_ENSURE(equal(estimateSet[i], correct));
+
+					if (i > 0)
+					{
+						// The first lag has no samples; the relative
+						// error comes from the lags with samples.
+						TEST_ENSURE_OP(relativeError, ==, correctError);
+					}
+				}
+				TEST_ENSURE_OP(relativeError, ==, maxRelativeError);
+			}
+		}
+
+		void testNoSharedSamples()
+		{
+			std::vector<SignalData> dataSet;
+			dataSet.reserve(2 * trials_);
+
+			Array<Signal> signalSet(Vector2i(trials_, 2));
+			for (integer y = 0;y < 2;++y)
+			{
+				std::vector<Signal> trialSet = generate(dataSet, 1);
+				std::copy(trialSet.begin(), trialSet.end(),
+					signalSet.rowBegin(y));
+			}
+
+			std::vector<Integer3> rangeSet =
+			{
+				Integer3(0, 1, 1),
+				Integer3(1, 2, 1)
+			};
+
+			// Each trial keeps a single sample, but the trials
+			// start at different times, so that they share none.
+			std::vector<integer> sweepSet = 
+				{-(samples_ - 1), samples_ - 1};
+			std::vector<integer> baseLagSet = {0, 0};
+
+			std::vector<dreal> estimateSet =
+				entropyCombinationLagSweep(
+					signalSet, rangeSet, baseLagSet,
+					1, sweepSet, kNearest_);
+			TEST_ENSURE_OP(estimateSet.size(), ==, sweepSet.size());
+
+			for (integer i = 0;i < sweepSet.size();++i)
+			{
+				std::vector<integer> lagSet = {0, sweepSet[i]};
+
+				dreal correct = entropyCombination(
+					signalSet, rangeSet, lagSet, kNearest_);
+				TEST_ENSURE_OP(correct, ==, 0);
+				TEST_ENSURE_OP(estimateSet[i], ==, 0);
+			}
+		}
+
+		void testMutualInformation()
+		{
+			std::vector<SignalData> dataSet;
+			dataSet.reserve(2 * trials_);
+
+			std::vector<Signal> xSignalSet = generate(dataSet, 1);
+			std::vector<Signal> ySignalSet = generate(dataSet, 2);
+
+			std::vector<integer> sweepSet = lagSet();
+			for (integer xLag : {0, 4})
+			{
+				std::vector<dreal> estimateSet =
+					mutualInformationLagSweep(
+						xSignalSet, ySignalSet, sweepSet,
+						kNearest_, xLag);
+				TEST_ENSURE_OP(estimateSet.size(), ==, sweepSet.size());
+
+				for (integer i = 0;i < sweepSet.size();++i)
+				{
+					dreal correct = mutualInformation(
+						xSignalSet, ySignalSet,
+						xLag, sweepSet[i], kNearest_);
+					TEST_ENSURE(equal(estimateSet[i], correct));
+				}
+			}
+		}
+
+		void testTransferEntropy()
+		{
+			std::vector<SignalData> dataSet;
+			dataSet.reserve(3 * trials_);
+
+			std::vector<Signal> xSignalSet = generate(dataSet, 1);
+			std::vector<Signal> ySignalSet = generate(dataSet, 1);
+			std::vector<Signal> wSignalSet = generate(dataSet, 2);
+
+			std::vector<integer> sweepSet = lagSet();
+			std::vector<dreal> estimateSet =
+				transferEntropyLagSweep(
+					xSignalSet, ySignalSet, wSignalSet,
+					sweepSet, kNearest_, 1, -2);
+			TEST_ENSURE_OP(estimateSet.size(), ==, sweepSet.size());
+
+			for (integer i = 0;i < sweepSet.size();++i)
+			{
+				dreal correct = transferEntropy(
+					xSignalSet, ySignalSet, wSignalSet,
+					1, sweepSet[i], -2, kNearest_);
+				TEST_ENSURE(equal(estimateSet[i], correct));
+			}
+		}
+
+	private:
+		integer samples_ = 300;
+		integer trials_ = 3;
+		integer kNearest_ = 3;
+	};
+
+	void testLagSweep()
+	{
+		LagSweepTest test;
+		test.run();
+	}
+
+	void addTest()
+	{
+		timTestList().add("LagSweep", testLagSweep);
+	}
+
+	CallFunction run(addTest);
+
+}
@@ -0,0 +1,131 @@
+#include "estimation.h"
+
+#include "tim/core/leaf_scan.h"
+
+#include <pastel/sys/random.h>
+
+using namespace Tim;
+
+namespace
+{
+
+	class LeafScanTest
+		: public TestSuite
+	{
+	public:
+		LeafScanTest()
+			: TestSuite(&timTestReport())
+		{
+		}
+
+		virtual void run()
+		{
+			SimdLevel original = simdLevel();
+
+			// Block sizes around the SIMD widths, so that
+			// the partial blocks are covered.
+			integer countSet[] = {0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 64, 67};
+			integer nSet[] = {1, 2, 3, 5, 8};
+
+			for (integer n : nSet)
+			{
+				for (integer count : countSet)
+				{
+					testLeaf(count, n);
+				}
+			}
+
+			setSimdLevel(original);
+		}
+
+		void testLeaf(integer count, integer n)
+		{
+			std::vector<sreal> coordinateSet(count * n);
+			for (integer i = 0;i < count * n;++i)
+			{
+				coordinateSet[i] = (sreal)random<dreal>();
+			}
+
+			std::vector<char> visibleSet(count);
+			for (integer i = 0;i < count;++i)
+			{
+				visibleSet[i] = random<dreal>() < 0.75;
+			}
+
+			std::vector<dreal> query(n);
+			for (integer j = 0;j < n;++j)
+			{
+				query[j] = random<dreal>();
+			}
+
+			dreal boundSet[] = {(dreal)Infinity(), 0.5, 0.25, 0.05, 0};
+
+			for (dreal bound : boundSet)
+			{
+				setSimdLevel(SimdLevel::Scalar);
+				std::vector<dreal> distanceSet(count);
+				scanDistances(coordinateSet.data(), count, n, query.data(), bound, distanceSet.data());
+				std::vector<dreal> squaredSet(count);
+				scanSquaredDistances(coordinateSet.data(), count, n, query.data(), bound, squaredSet.data());
+				integer inside = scanCount(coordinateSet.data(), visibleSet.data(), count, n, query.data(), bound);
+
+				SimdLevel levelSet[] = {SimdLevel::Avx2, SimdLevel::Avx512};
+				for (SimdLevel level : levelSet)
+				{
+					if (setSimdLevel(level) != level)
+					{
+						// Not supported by the processor.
+						continue;
+					}
+
+					// The distances below the bound must be exact, 
+					// and the rest must be at least the bound.
+					std::vector<dreal> simdSet(count);
+					scanDistances(coordinateSet.data(), count, n, query.data(), bound, simdSet.data());
+					for (integer i = 0;i < count;++i)
+					{
+						if (distanceSet[i] < bound)
+						{
+							TEST_ENSURE_OP(simdSet[i], ==, distanceSet[i]);
+						}
+						else
+						{
+							TEST_ENSURE_OP(simdSet[i], >=, bound);
+						}
+					}
+
+					scanSquaredDistances(coordinateSet.data(), count, n, query.data(), bound, simdSet.data());
+					for (integer i = 0;i < count;++i)
+					{
+						if (squaredSet[i] < bound)
+						{
+							TEST_ENSURE_OP(simdSet[i], ==, squaredSet[i]);
+						}
+						else
+						{
+							TEST_ENSURE_OP(simdSet[i], >=, bound);
+						}
+					}
+
+					TEST_ENSURE_OP(
+						scanCount(coordinateSet.data(), visibleSet.data(), count, n, query.data(), bound), ==,
+						inside);
+				}
+			}
+		}
+	};
+
+	void testLeafScan()
+	{
+		LeafScanTest test;
+		test.run();
+	}
+
+	void addTest()
+	{
+		timTestList().add("LeafScan", testLeafScan);
+	}
+
+	CallFunction run(addTest);
+
+}
@@ -0,0 +1,164 @@
+#include "estimation.h"
+
+#include "tim/core/mapped_signals.h"
+#include "tim/core/signal_generate.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace Tim;
+
+namespace
+{
+
+	class MappedSignalsTest
+		: public TestSuite
+	{
+	public:
+		MappedSignalsTest()
+			: TestSuite(&timTestReport())
+		{
+		}
+
+		virtual void run()
+		{
+			testSignalFile();
+			testNpy();
+		}
+
+		void testSignalFile()
+		{
+			std::vector<SignalData> dataSet;
+			dataSet.reserve(3);
+			std::vector<Signal> trialSet;
+			for (integer i = 0;i < 3;++i)
+			{
+				dataSet.push_back(generateGaussian(2, 100));
+				trialSet.push_back(Signal(dataSet.back().data(), 5));
+			}
+
+			std::string fileName = "test_mapped_signals.tim";
+			writeSignalFile(fileName, trialSet);
+			{
+				MappedSignals mapped(fileName);
+				TEST_ENSURE_OP(mapped.t(), ==, 5);
+				TEST_ENSURE(equal(mapped, trialSet));
+			}
+			std::remove(fileName.c_str());
+		}
+
+		void testNpy()
+		{
+			std::vector<SignalData> dataSet;
+			dataSet.reserve(3);
+			std::vector<Signal> trialSet;
+			for (integer i = 0;i < 3;++i)
+			{
+				dataSet.push_back(generateGaussian(2, 100));
+				trialSet.push_back((Signal)dataSet.back());
+			}
+
+			// Both orders store the samples of a trial
+			// contiguously, with the dimension varying
+			// the fastest.
+
+			testNpy("False", "(3, 100, 2)", trialSet);
+			testNpy("True", "(2, 100, 3)", trialSet);
+			testNpy("False", "(100, 2)", {trialSet[0]});
+			testNpy("True", "(2, 100)", {trialSet[0]});
+
+			SignalData line = generateGaussian(1, 100);
+			testNpy("False", "(100,)", {(Signal)line});
+		}
+
+		void testNpy(
+			const std::string& fortranOrder,
+			const std::string& shape,
+			const std::vector<Signal>& trialSet)
+		{
+			std::string header =
+				"{'descr': '<f" + std::to_string(sizeof(dreal)) +
+				"', 'fortran_order': " + fortranOrder +
+				", 'shape': " + shape + ", }";
+
+			// The data begins at a multiple of 64 bytes.
+			integer headerSize = 10 + header.size() + 1;
+			header.append((64 - headerSize % 64) % 64, ' ');
+			header += '\n';
+
+			std::string fileName = "test_mapped_signals.npy";
+			{
+				std::ofstream file(fileName, std::ios::binary);
+				file.write("\x93NUMPY\x01\x00", 8);
+				char length[2] = {
+					(char)(header.size() & 0xFF),
+					(char)(header.size() >> 8)};
+				file.write(length, 2);
+				file.write(header.data(), header.size());
+				for (const Signal& signal : trialSet)
+				{
+					file.write(
+						(const char*)signal.data().data(),
+						signal.dimension() * signal.samples() * sizeof(dreal));
+				}
+			}
+			{
+				MappedSignals mapped(fileName);
+				TEST_ENSURE_OP(mapped.t(), ==, 0);
+				TEST_ENSURE(equal(mapped, trialSet));
+			}
+			std::remove(fileName.c_str());
+		}
+
+		bool equal(
+			const MappedSignals& mapped,
+			const std::vector<Signal>& trialSet)
+		{
+			if (mapped.trials() != trialSet.size() ||
+				mapped.signalSet().width() != trialSet.size() ||
+				mapped.dimension() != trialSet.front().dimension() ||
+				mapped.samples() != trialSet.front().samples())
+			{
+				return false;
+			}
+
+			for (integer i = 0;i < mapped.trials();++i)
+			{
+				const Signal& signal = mapped.signal(i);
+				if (signal.dimension() != mapped.dimension() ||
+					signal.samples() != mapped.samples() ||
+					signal.t() != mapped.t())
+				{
+					return false;
+				}
+
+				for (integer t = 0;t < signal.samples();++t)
+				{
+					for (integer j = 0;j < signal.dimension();++j)
+					{
+						if (signal.data()(j, t) != trialSet[i].data()(j, t))
+						{
+							return false;
+						}
+					}
+				}
+			}
+
+			return true;
+		}
+	};
+
+	void testMappedSignals()
+	{
+		MappedSignalsTest test;
+		test.run();
+	}
+
+	void addTest()
+	{
+		timTestList().add("MappedSignals", testMappedSignals);
+	}
+
+	CallFunction run(addTest);
+
+}
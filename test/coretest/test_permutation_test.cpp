@@ -0,0 +1,186 @@
+#include "estimation.h"
+
+#include "tim/core/permutation_test.h"
+#include "tim/core/signal_generate.h"
+
+#include <tbb/task_arena.h>
+
+#include <cmath>
+
+using namespace Tim;
+
+namespace
+{
+
+	class PermutationTestTest
+		: public TestSuite
+	{
+	public:
+		PermutationTestTest()
+			: TestSuite(&timTestReport())
+			, dataSet_()
+			, signalSet_(Vector2i(trials_, 3))
+		{
+			dataSet_.reserve(3 * trials_);
+			for (integer y = 0;y < 3;++y)
+			{
+				for (integer x = 0;x < trials_;++x)
+				{
+					dataSet_.push_back(generateGaussian(2, samples_));
+					signalSet_(x, y) = Signal(dataSet_.back().data(), x);
+				}
+			}
+		}
+
+		virtual void run()
+		{
+			testEstimate();
+			testThreads();
+			testSeed();
+			testSameGroup();
+		}
+
+		std::vector<Integer3> rangeSet()
+		{
+			return
+			{
+				Integer3(0, 2, 1),
+				Integer3(1, 3, 1),
+				Integer3(1, 2, -1)
+			};
+		}
+
+		std::vector<integer> lagSet()
+		{
+			return {2, 0, -3};
+		}
+
+		bool equal(dreal left, dreal right)
+		{
+			return std::abs(left - right) <=
+				1e-10 * std::max(std::abs(right), (dreal)1);
+		}
+
+		bool equal(
+			const std::vector<dreal>& left,
+			const std::vector<dreal>& right)
+		{
+			if (left.size() != right.size())
+			{
+				return false;
+			}
+			for (integer i = 0;i < left.size();++i)
+			{
+				if (!equal(left[i], right[i]))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		void testEstimate()
+		{
+			std::vector<integer> groupSet = {0, 1, 1};
+
+			PermutationTest result = permutationTest(
+				signalSet_, rangeSet(), lagSet(), groupSet,
+				permutations_, kNearest_);
+			TEST_ENSURE_OP(result.nullSet.size(), ==, permutations_);
+
+			dreal correct = entropyCombination(
+				signalSet_, rangeSet(), lagSet(), kNearest_);
+			TEST_ENSURE(equal(result.estimate, correct));
+		}
+
+		void testThreads()
+		{
+			// The null distribution must not depend on
+			// the number of threads. The estimates may only
+			// differ by the order of the parallel sums.
+
+			std::vector<integer> groupSet = {0, 1, 1};
+
+			std::vector<dreal> correctSet;
+			for (integer threads : {1, 2, 4})
+			{
+				tbb::task_arena arena(threads);
+
+				PermutationTest result;
+				arena.execute([&]()
+				{
+					result = permutationTest(
+						signalSet_, rangeSet(), lagSet(), groupSet,
+						permutations_, kNearest_, 7);
+				});
+
+				if (threads == 1)
+				{
+					correctSet = result.nullSet;
+				}
+
+				TEST_ENSURE(equal(result.nullSet, correctSet));
+			}
+		}
+
+		void testSeed()
+		{
+			// The seeds which differ only in their high
+			// 32 bits must give different permutations.
+
+			std::vector<integer> groupSet = {0, 1, 1};
+
+			integer seed = 7;
+			PermutationTest low = permutationTest(
+				signalSet_, rangeSet(), lagSet(), groupSet,
+				permutations_, kNearest_, seed);
+
+			PermutationTest high = permutationTest(
+				signalSet_, rangeSet(), lagSet(), groupSet,
+				permutations_, kNearest_, seed + ((integer)1 << 32));
+
+			TEST_ENSURE(!equal(low.nullSet, high.nullSet));
+		}
+
+		void testSameGroup()
+		{
+			// If all the signals are in the same group,
+			// nothing is permuted.
+
+			std::vector<integer> groupSet = {3, 3, 3};
+
+			PermutationTest result = permutationTest(
+				signalSet_, rangeSet(), lagSet(), groupSet,
+				permutations_, kNearest_);
+
+			for (dreal nullEstimate : result.nullSet)
+			{
+				TEST_ENSURE(equal(nullEstimate, result.estimate));
+			}
+			TEST_ENSURE_OP(result.pValue, ==, 1);
+		}
+
+	private:
+		integer samples_ = 200;
+		integer trials_ = 6;
+		integer permutations_ = 8;
+		integer kNearest_ = 3;
+
+		std::vector<SignalData> dataSet_;
+		Array<Signal> signalSet_;
+	};
+
+	void testPermutationTest()
+	{
+		PermutationTestTest test;
+		test.run();
+	}
+
+	void addTest()
+	{
+		timTestList().add("PermutationTest", testPermutationTest);
+	}
+
+	CallFunction run(addTest);
+
+}
@@ -0,0 +1,107 @@
+#include "estimation.h"
+
+#include "tim/core/prepared_signals.h"
+#include "tim/core/entropy_combination.h"
+#include "tim/core/signal_generate.h"
+
+#include <pastel/sys/array/array.h>
+
+using namespace Tim;
+
+namespace
+{
+
+	class PreparedSignalsTest
+		: public TestSuite
+	{
+	public:
+		PreparedSignalsTest()
+			: TestSuite(&timTestReport())
+		{
+		}
+
+		virtual void run()
+		{
+			// The cache size 1 drops the point sets of
+			// each combination of lags before the next.
+			testEntropyCombination(4);
+			testEntropyCombination(1);
+		}
+
+		void testEntropyCombination(integer cacheSize)
+		{
+			// The estimates of prepared signals must be
+			// those of the signals themselves, whether the
+			// point sets come from the cache or not.
+
+			integer trials = 2;
+			integer samples = 400;
+			std::vector<integer> dimensionSet = {1, 2, 1};
+			integer signals = dimensionSet.size();
+
+			std::vector<SignalData> dataSet;
+			dataSet.reserve(trials * signals);
+			Array<Signal> signalSet(Vector2i(trials, signals));
+			for (integer x = 0;x < trials;++x)
+			{
+				for (integer i = 0;i < signals;++i)
+				{
+					dataSet.push_back(generateGaussian(dimensionSet[i], samples));
+					signalSet(x, i) = (Signal)dataSet.back();
+				}
+			}
+
+			PreparedSignals prepared(signalSet, cacheSize);
+
+			std::vector<std::vector<integer>> lagSetSet =
+			{
+				{0, 0, 0},
+				{0, 2, 1},
+				{3, 0, 0}
+			};
+
+			std::vector<std::vector<Integer3>> rangeSetSet =
+			{
+				{Integer3(0, 1, 1), Integer3(1, 3, 1)},
+				{Integer3(0, 2, 1), Integer3(1, 3, 1), Integer3(1, 2, -1)},
+				{Integer3(0, 1, 1), Integer3(1, 2, 1), Integer3(2, 3, 1)}
+			};
+
+			// Each combination of lags is visited twice, so
+			// that the second visit either finds the point sets
+			// in the cache, or builds them again.
+			for (integer pass = 0;pass < 2;++pass)
+			{
+				for (const std::vector<integer>& lagSet : lagSetSet)
+				{
+					for (const std::vector<Integer3>& rangeSet : rangeSetSet)
+					{
+						for (integer kNearest : {1, 3})
+						{
+							dreal correct = entropyCombination(
+								signalSet, rangeSet, lagSet, kNearest);
+							dreal estimate = entropyCombination(
+								prepared, rangeSet, lagSet, kNearest);
+
+							TEST_ENSURE_OP(std::abs(estimate - correct), <=, 1e-12);
+						}
+					}
+				}
+			}
+		}
+	};
+
+	void testPreparedSignals()
+	{
+		PreparedSignalsTest test;
+		test.run();
+	}
+
+	void addTest()
+	{
+		timTestList().add("PreparedSignals", testPreparedSignals);
+	}
+
+	CallFunction run(addTest);
+
+}
@@ -0,0 +1,166 @@
+#include "estimation.h"
+
+#include "tim/core/signalpointset.h"
+
+#include <pastel/sys/random.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Tim;
+
+namespace
+{
+
+	class RangeCountTest
+		: public TestSuite
+	{
+	public:
+		RangeCountTest()
+			: TestSuite(&timTestReport())
+		{
+		}
+
+		virtual void run()
+		{
+			for (auto layout : 
+				{SignalPointSet::Layout::Pointer, SignalPointSet::Layout::Packed})
+			{
+				for (integer dimension : {1, 2, 3})
+				{
+					for (integer trials : {1, 3})
+					{
+						testWindows(layout, dimension, trials);
+					}
+				}
+			}
+		}
+
+		void testWindows(
+			SignalPointSet::Layout layout,
+			integer dimension, 
+			integer trials)
+		{
+			integer samples = 400;
+
+			// The coordinates are quantized, so that points
+			// fall on the boundaries of the balls and of the
+			// cells of the kd-tree.
+			std::vector<SignalData> dataSet;
+			dataSet.reserve(trials);
+			std::vector<Signal> signalSet;
+			for (integer x = 0;x < trials;++x)
+			{
+				dataSet.emplace_back(dimension, samples);
+				for (integer i = 0;i < dimension * samples;++i)
+				{
+					dataSet.back().data()(i) =
+						std::floor(random<dreal>() * 20) / 20;
+				}
+				signalSet.push_back((Signal)dataSet.back());
+			}
+
+			SignalPointSet pointSet(signalSet, layout);
+
+			// Windows which hide the points on either side,
+			// on both sides, and none or all of them.
+			Integer2 windowSet[] =
+			{
+				{0, samples},
+				{100, 300},
+				{0, 50},
+				{350, samples},
+				{120, 125},
+				{200, 200},
+				{-50, samples + 50},
+				{10, 390}
+			};
+
+			for (const Integer2& window : windowSet)
+			{
+				pointSet.setTimeWindow(window[0], window[1]);
+				testCounts(pointSet, dimension);
+			}
+		}
+
+		void testCounts(
+			const SignalPointSet& pointSet,
+			integer dimension)
+		{
+			// The queries are points of the whole point set,
+			// including those outside the time-window, and
+			// random points.
+			std::vector<std::vector<dreal>> querySet;
+			auto pointBegin = pointSet.sliceBegin(pointSet.timeBegin());
+			integer points = pointSet.samples() * pointSet.trials();
+			for (integer i = 0;i < points;i += 37)
+			{
+				const dreal* point = pointBegin[i];
+				querySet.emplace_back(point, point + dimension);
+			}
+			for (integer i = 0;i < 10;++i)
+			{
+				std::vector<dreal> query(dimension);
+				for (dreal& x : query)
+				{
+					x = random<dreal>() * 1.2 - 0.1;
+				}
+				querySet.push_back(query);
+			}
+
+			dreal radiusSet[] = {0, 0.05, 0.1, 0.15, 0.3, 1, (dreal)Infinity()};
+
+			integer failures = 0;
+			for (const std::vector<dreal>& query : querySet)
+			{
+				for (dreal radius : radiusSet)
+				{
+					integer correct = bruteForceCount(
+						pointSet, query.data(), radius);
+					// The Pointer layout counts over the kd-tree 
+					// with Tim::countRange(), the Packed layout
+					// with PackedKdTree::countRange(), or with 
+					// SortedLine::countRange() in 1-D.
+					integer count = pointSet.countRange(
+						query.data(), radius);
+					if (count != correct)
+					{
+						++failures;
+					}
+				}
+			}
+
+			TEST_ENSURE_OP(failures, ==, 0);
+		}
+
+		integer bruteForceCount(
+			const SignalPointSet& pointSet,
+			const dreal* query,
+			dreal radius)
+		{
+			integer result = 0;
+			for (auto iter = pointSet.begin();iter != pointSet.end();++iter)
+			{
+				if (pointSet.distance(query, *iter) < radius)
+				{
+					++result;
+				}
+			}
+			return result;
+		}
+	};
+
+	void testRangeCount()
+	{
+		RangeCountTest test;
+		test.run();
+	}
+
+	void addTest()
+	{
+		timTestList().add("RangeCount", testRangeCount);
+	}
+
+	CallFunction run(addTest);
+
+}
@@ -1,6 +1,9 @@
 #include "estimation.h"
 
 #include "tim/core/signalpointset.h"
+#include "tim/core/signal_generate.h"
+#include "tim/core/signal_merge.h"
+#include "tim/core/lagged_signal.h"
 #include "tim/core/signal_tools.h"
 #include "tim/core/delay_embed.h"
 
@@ -8,6 +11,8 @@
 #include <pastel/sys/random.h>
 #include <pastel/sys/string/string_algorithms.h>
 
+#include <algorithm>
+
 using namespace Tim;
 
 namespace
@@ -26,6 +31,9 @@ namespace
 		{
 			testBasic();
 			testBasic2();
+			testSearchAllNearest();
+			testBruteForce();
+			testLagSignals();
 		}
 
 		void testBasic()
@@ -59,9 +67,9 @@ namespace
 			TEST_ENSURE(changeTimeWindow(pointSet, 1, 2));
 			TEST_ENSURE(changeTimeWindow(pointSet, 1, 1));
 			TEST_ENSURE(changeTimeWindow(pointSet, 2, 2));
-			
+
 			TEST_ENSURE(changeTimeWindow(pointSet, 2, 5));
-			
+
 			TEST_ENSURE(changeTimeWindow(pointSet, 0, 5));
 			TEST_ENSURE(changeTimeWindow(pointSet, 0, 1));
 			TEST_ENSURE(changeTimeWindow(pointSet, 0, 10));
@@ -72,8 +80,8 @@ namespace
 			TEST_ENSURE(changeTimeWindow(pointSet, 1, 4));
 			TEST_ENSURE(changeTimeWindow(pointSet, 1, 4));
 
-			TEST_ENSURE((*pointSet.begin())->point() == &(xy->data()(3 * 1)));
-			TEST_ENSURE((*(pointSet.end() - 1))->point() == &(xy->data()(3 * 3)));
+			TEST_ENSURE(*pointSet.begin() == &(xy->data()(3 * 1)));
+			TEST_ENSURE(*(pointSet.end() - 1) == &(xy->data()(3 * 3)));
 
 			{
 				SignalPointSet pointSet(range(signalSet));
@@ -91,8 +99,8 @@ namespace
 				TEST_ENSURE_OP(pointSet.samples(), ==, xy->samples());
 				TEST_ENSURE_OP(pointSet.dimension(), ==, 1);
 
-				TEST_ENSURE((*pointSet.begin())->point() == &(xy->data()(3 * 0 + 1)));
-				TEST_ENSURE((*(pointSet.end() - 1))->point() == &(xy->data()(3 * 4 + 1)));
+				TEST_ENSURE(*pointSet.begin() == &(xy->data()(3 * 0 + 1)));
+				TEST_ENSURE(*(pointSet.end() - 1) == &(xy->data()(3 * 4 + 1)));
 			}
 		}
 
@@ -131,7 +139,7 @@ namespace
 			TEST_ENSURE(changeTimeWindow(pointSet, 0, 5));
 
 			TEST_ENSURE(changeTimeWindow(pointSet, 0, 1));
-			
+
 			TEST_ENSURE(changeTimeWindow(pointSet, 0, 10));
 			TEST_ENSURE(changeTimeWindow(pointSet, -10, 10));
 			TEST_ENSURE(changeTimeWindow(pointSet, -20, 10));
@@ -140,8 +148,637 @@ namespace
 			TEST_ENSURE(changeTimeWindow(pointSet, 1, 4));
 			TEST_ENSURE(changeTimeWindow(pointSet, 1, 4));
 
-			TEST_ENSURE((*pointSet.begin())->point() == &(xy->data()(3 * 0)));
-			TEST_ENSURE((*(pointSet.end() - 1))->point() == &(xy->data()(3 * 2)));
+			TEST_ENSURE(*pointSet.begin() == &(xy->data()(3 * 0)));
+			TEST_ENSURE(*(pointSet.end() - 1) == &(xy->data()(3 * 2)));
+		}
+
+		void testSearchAllNearest()
+		{
+			using Layout = SignalPointSet::Layout;
+
+			integer samples = 300;
+			integer trials = 2;
+
+			for (integer dimension : {1, 3})
+			{
+				std::vector<SignalData> dataSet;
+				std::vector<Signal> signalSet;
+				std::vector<Signal> querySignalSet;
+				for (integer i = 0;i < 2 * trials;++i)
+				{
+					dataSet.push_back(generateGaussian(dimension, samples));
+				}
+				for (integer i = 0;i < trials;++i)
+				{
+					signalSet.push_back((Signal)dataSet[i]);
+					querySignalSet.push_back((Signal)dataSet[trials + i]);
+				}
+
+				// The queries which are not points of the point set.
+				SignalPointSet queryPointSet(querySignalSet, Layout::Packed);
+				std::vector<const dreal*> querySet;
+				for (auto iter = queryPointSet.begin();iter != queryPointSet.end();++iter)
+				{
+					querySet.push_back(*iter);
+				}
+
+				Layout layoutSet[] = 
+				{
+					Layout::Pointer,
+					Layout::Packed,
+					Layout::Sorted,
+					Layout::VpTree,
+					Layout::BruteForce
+				};
+
+				for (Layout layout : layoutSet)
+				{
+					for (Metric metric : {Metric::Maximum, Metric::Euclidean})
+					{
+						if ((layout == Layout::Sorted && dimension != 1) ||
+							(layout == Layout::Pointer && metric != Metric::Maximum))
+						{
+							continue;
+						}
+
+						SignalPointSet pointSet(signalSet, layout, metric);
+
+						Integer2 windowSet[] = 
+						{
+							Integer2(0, samples),
+							Integer2(50, 120),
+							Integer2(140, 141),
+							Integer2(samples - 30, samples + 30)
+						};
+
+						for (const Integer2& window : windowSet)
+						{
+							pointSet.setTimeWindow(window[0], window[1]);
+							for (integer kNearest : {1, 3})
+							{
+								testSearchAllNearest(pointSet, kNearest, querySet);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		void testBruteForce()
+		{
+			using Layout = SignalPointSet::Layout;
+
+			integer samples = 600;
+			integer trials = 2;
+
+			for (integer dimension : {1, 2, 4})
+			{
+				std::vector<SignalData> dataSet;
+				dataSet.reserve(trials);
+				std::vector<Signal> signalSet;
+				for (integer i = 0;i < trials;++i)
+				{
+					dataSet.push_back(generateGaussian(dimension, samples));
+					signalSet.push_back((Signal)dataSet.back());
+				}
+
+				// The queries which are not points of the point set.
+				SignalData queryData = generateGaussian(dimension, 20);
+				std::vector<const dreal*> externalSet;
+				for (integer i = 0;i < queryData.samples();++i)
+				{
+					externalSet.push_back(&queryData.data()(0, i));
+				}
+
+				Layout layoutSet[] = 
+				{
+					Layout::Pointer,
+					Layout::Packed,
+					Layout::Sorted,
+					Layout::VpTree,
+					Layout::BruteForce
+				};
+
+				for (Layout layout : layoutSet)
+				{
+					for (Metric metric : {Metric::Maximum, Metric::Euclidean})
+					{
+						if ((layout == Layout::Sorted && dimension != 1) ||
+							(layout == Layout::Pointer && metric != Metric::Maximum))
+						{
+							continue;
+						}
+
+						SignalPointSet pointSet(signalSet, layout, metric);
+
+						// The windows hide and show points on either 
+						// side of the window, and shrink enough to 
+						// rebuild the search structure, and grow back.
+						Integer2 windowSet[] = 
+						{
+							Integer2(0, samples),
+							Integer2(100, 500),
+							Integer2(150, 550),
+							Integer2(50, 300),
+							Integer2(280, 300),
+							Integer2(270, 320),
+							Integer2(-50, samples + 50)
+						};
+
+						for (const Integer2& window : windowSet)
+						{
+							pointSet.setTimeWindow(window[0], window[1]);
+							testBruteForce(pointSet, externalSet);
+						}
+					}
+				}
+			}
+		}
+
+		void testLagSignals()
+		{
+			// The lagged views must give the same points
+			// as the merged copies.
+
+			integer samples = 100;
+			integer trials = 4;
+			integer dimensionSet[] = {1, 2, 3};
+
+			// The trials start at different times.
+
+			std::vector<SignalData> dataSet;
+			dataSet.reserve(3 * trials);
+			Array<Signal> ensembleSet(Vector2i(trials, 3));
+			for (integer y = 0;y < 3;++y)
+			{
+				for (integer x = 0;x < trials;++x)
+				{
+					dataSet.push_back(generateGaussian(dimensionSet[y], samples));
+					ensembleSet(x, y) = Signal(dataSet.back().data(), 3 * x - 2);
+				}
+			}
+
+			// The last lags leave no shared samples.
+			std::vector<integer> lagSetSet[] =
+			{
+				{0, 0, 0},
+				{-3, 5, 0},
+				{7, -7, 2},
+				{40, -40, 0},
+				{200, 0, 0}
+			};
+
+			// The dimensions of the marginals; some are 
+			// contained in a single signal, and some span 
+			// several signals.
+			Integer2 rangeSet[] =
+			{
+				Integer2(0, 6),
+				Integer2(0, 1),
+				Integer2(1, 3),
+				Integer2(2, 5),
+				Integer2(3, 6)
+			};
+
+			for (const std::vector<integer>& lagSet : lagSetSet)
+			{
+				std::vector<LaggedSignal> laggedSet;
+				lagSignals(ensembleSet, std::back_inserter(laggedSet), lagSet);
+
+				std::vector<SignalData> mergedDataSet;
+				merge(ensembleSet, std::back_inserter(mergedDataSet), lagSet);
+				std::vector<Signal> mergedSet(
+					mergedDataSet.begin(), mergedDataSet.end());
+
+				for (const Integer2& range : rangeSet)
+				{
+					TEST_ENSURE(equalPoints(
+						SignalPointSet(laggedSet, range[0], range[1]),
+						SignalPointSet(mergedSet, range[0], range[1])));
+				}
+
+				// Only some of the signals, in another order.
+
+				std::vector<integer> rowSet = {2, 0};
+				std::vector<integer> rowLagSet = {lagSet[2], lagSet[0]};
+
+				std::vector<LaggedSignal> rowLaggedSet;
+				lagSignals(ensembleSet, rowSet, 
+					std::back_inserter(rowLaggedSet), rowLagSet);
+
+				std::vector<SignalData> rowMergedDataSet;
+				for (integer x = 0;x < trials;++x)
+				{
+					std::vector<Signal> column = 
+						{ensembleSet(x, 2), ensembleSet(x, 0)};
+					rowMergedDataSet.push_back(merge(column, rowLagSet));
+				}
+				std::vector<Signal> rowMergedSet(
+					rowMergedDataSet.begin(), rowMergedDataSet.end());
+
+				TEST_ENSURE(equalPoints(
+					SignalPointSet(rowLaggedSet),
+					SignalPointSet(rowMergedSet)));
+			}
+		}
+
+		// Returns whether the point sets have the same
+		// points at the same time instants.
+		bool equalPoints(
+			const SignalPointSet& left,
+			const SignalPointSet& right)
+		{
+			if (left.dimension() != right.dimension() ||
+				left.trials() != right.trials() ||
+				left.timeBegin() != right.timeBegin() ||
+				left.timeEnd() != right.timeEnd() ||
+				left.end() - left.begin() != right.end() - right.begin())
+			{
+				return false;
+			}
+
+			for (integer t = left.timeBegin();t < left.timeEnd();++t)
+			{
+				for (integer x = 0;x < left.trials();++x)
+				{
+					const dreal* leftPoint = *(left.sliceBegin(t) + x);
+					const dreal* rightPoint = *(right.sliceBegin(t) + x);
+					if (!std::equal(
+						leftPoint, leftPoint + left.dimension(),
+						rightPoint))
+					{
+						return false;
+					}
+				}
+			}
+
+			return true;
+		}
+
+		// Compares the searches with a brute-force search.
+		/*
+		The approximate searches are checked against the
+		bound of searchNearest(): the i:th neighbor is at 
+		most 1 + maxRelativeError times farther than the 
+		true i:th nearest neighbor.
+		*/
+		void testBruteForce(
+			const SignalPointSet& pointSet,
+			const std::vector<const dreal*>& externalSet)
+		{
+			std::vector<const dreal*> windowSet(
+				pointSet.begin(), pointSet.end());
+			integer points = windowSet.size();
+
+			// Every 7th point of the time-window.
+			std::vector<integer> checkSet;
+			for (integer i = 0;i < points;i += 7)
+			{
+				checkSet.push_back(i);
+			}
+
+			integer failures = 0;
+			for (dreal maxRelativeError : {(dreal)0, (dreal)0.5})
+			{
+				for (integer kNearest : {1, 4})
+				{
+					// The queries one by one.
+					for (integer i : checkSet)
+					{
+						failures += checkNearest(pointSet, windowSet, 
+							windowSet[i], windowSet[i], kNearest, maxRelativeError);
+					}
+					for (const dreal* query : externalSet)
+					{
+						failures += checkNearest(pointSet, windowSet, 
+							query, nullptr, kNearest, maxRelativeError);
+					}
+
+					// The queries in batches.
+					{
+						std::vector<dreal> distanceSet(points);
+						std::vector<integer> neighborSet(points * kNearest);
+						pointSet.searchAllNearest(
+							kNearest, distanceSet.data(), neighborSet.data(),
+							maxRelativeError);
+
+						for (integer i : checkSet)
+						{
+							failures += checkBatch(pointSet, windowSet,
+								windowSet[i], windowSet[i], kNearest, maxRelativeError, 
+								distanceSet[i], neighborSet.data() + i * kNearest);
+						}
+					}
+					{
+						integer queries = externalSet.size();
+						std::vector<dreal> distanceSet(queries);
+						std::vector<integer> neighborSet(queries * kNearest);
+						pointSet.searchAllNearest(
+							externalSet, kNearest, 
+							distanceSet.data(), neighborSet.data(),
+							maxRelativeError);
+
+						for (integer i = 0;i < queries;++i)
+						{
+							failures += checkBatch(pointSet, windowSet,
+								externalSet[i], nullptr, kNearest, maxRelativeError, 
+								distanceSet[i], neighborSet.data() + i * kNearest);
+						}
+					}
+				}
+			}
+
+			// The large radii contain whole subtrees.
+			dreal radiusSet[] = {0, 0.1, 0.5, 1, 3, (dreal)Infinity()};
+			for (dreal radius : radiusSet)
+			{
+				for (integer i : checkSet)
+				{
+					if (pointSet.countRange(windowSet[i], radius) != 
+						bruteForceCount(pointSet, windowSet, windowSet[i], radius))
+					{
+						++failures;
+					}
+				}
+				for (const dreal* query : externalSet)
+				{
+					if (pointSet.countRange(query, radius) != 
+						bruteForceCount(pointSet, windowSet, query, radius))
+					{
+						++failures;
+					}
+				}
+			}
+
+			TEST_ENSURE_OP(failures, ==, 0);
+		}
+
+		// Returns the distances to the k nearest points
+		// of the time-window, in ascending order.
+		std::vector<dreal> bruteForceNearest(
+			const SignalPointSet& pointSet,
+			const std::vector<const dreal*>& windowSet,
+			const dreal* query,
+			const dreal* exclude,
+			integer kNearest)
+		{
+			std::vector<dreal> distanceSet;
+			for (const dreal* point : windowSet)
+			{
+				if (point != exclude)
+				{
+					distanceSet.push_back(pointSet.distance(query, point));
+				}
+			}
+
+			integer neighbors = std::min(kNearest, (integer)distanceSet.size());
+			std::partial_sort(distanceSet.begin(), 
+				distanceSet.begin() + neighbors, distanceSet.end());
+			distanceSet.resize(neighbors);
+			return distanceSet;
+		}
+
+		integer bruteForceCount(
+			const SignalPointSet& pointSet,
+			const std::vector<const dreal*>& windowSet,
+			const dreal* query,
+			dreal radius)
+		{
+			integer result = 0;
+			for (const dreal* point : windowSet)
+			{
+				if (pointSet.distance(query, point) < radius)
+				{
+					++result;
+				}
+			}
+			return result;
+		}
+
+		// Returns whether the distance to the i:th neighbor
+		// is within the bound of the true distance.
+		bool withinBound(
+			dreal distance,
+			dreal correct,
+			dreal maxRelativeError)
+		{
+			// The tolerance covers the differences in rounding.
+			const dreal tolerance = 1e-6;
+
+			return distance >= correct * (1 - tolerance) &&
+				distance <= correct * (1 + maxRelativeError) * (1 + tolerance);
+		}
+
+		// Returns the number of failures of searchNearest().
+		integer checkNearest(
+			const SignalPointSet& pointSet,
+			const std::vector<const dreal*>& windowSet,
+			const dreal* query,
+			const dreal* exclude,
+			integer kNearest,
+			dreal maxRelativeError)
+		{
+			std::vector<dreal> correctSet = bruteForceNearest(
+				pointSet, windowSet, query, exclude, kNearest);
+
+			std::vector<dreal> neighborSet;
+			dreal distance = pointSet.searchNearest(
+				query, kNearest, exclude,
+				[&](dreal distance, const dreal* point)
+				{
+					neighborSet.push_back(pointSet.distance(query, point));
+				},
+				maxRelativeError);
+			std::sort(neighborSet.begin(), neighborSet.end());
+
+			if (neighborSet.size() != correctSet.size())
+			{
+				return 1;
+			}
+
+			integer failures = 0;
+			for (integer j = 0;j < correctSet.size();++j)
+			{
+				if (!withinBound(neighborSet[j], correctSet[j], maxRelativeError))
+				{
+					++failures;
+				}
+			}
+
+			if (correctSet.size() < kNearest)
+			{
+				if (distance != infinity<dreal>())
+				{
+					++failures;
+				}
+			}
+			else if (!withinBound(distance, correctSet.back(), maxRelativeError))
+			{
+				++failures;
+			}
+
+			return failures;
+		}
+
+		// Returns the number of failures of searchAllNearest().
+		integer checkBatch(
+			const SignalPointSet& pointSet,
+			const std::vector<const dreal*>& windowSet,
+			const dreal* query,
+			const dreal* exclude,
+			integer kNearest,
+			dreal maxRelativeError,
+			dreal batchDistance,
+			const integer* batchNeighborSet)
+		{
+			std::vector<dreal> correctSet = bruteForceNearest(
+				pointSet, windowSet, query, exclude, kNearest);
+
+			integer failures = 0;
+			for (integer j = 0;j < kNearest;++j)
+			{
+				integer neighbor = batchNeighborSet[j];
+				if (j >= correctSet.size())
+				{
+					if (neighbor != -1)
+					{
+						++failures;
+					}
+					continue;
+				}
+
+				if (neighbor < 0 || neighbor >= windowSet.size() ||
+					windowSet[neighbor] == exclude ||
+					!withinBound(pointSet.distance(query, windowSet[neighbor]), 
+						correctSet[j], maxRelativeError))
+				{
+					++failures;
+				}
+			}
+
+			if (correctSet.size() < kNearest)
+			{
+				if (batchDistance != infinity<dreal>())
+				{
+					++failures;
+				}
+			}
+			else if (!withinBound(batchDistance, correctSet.back(), maxRelativeError))
+			{
+				++failures;
+			}
+
+			return failures;
+		}
+
+		void testSearchAllNearest(
+			const SignalPointSet& pointSet,
+			integer kNearest,
+			const std::vector<const dreal*>& externalSet)
+		{
+			integer points = pointSet.end() - pointSet.begin();
+
+			std::vector<const dreal*> windowSet;
+			for (auto iter = pointSet.begin();iter != pointSet.end();++iter)
+			{
+				windowSet.push_back(*iter);
+			}
+
+			// All the points of the time-window.
+			{
+				std::vector<dreal> distanceSet(points);
+				std::vector<integer> neighborSet(points * kNearest);
+				pointSet.searchAllNearest(
+					kNearest, distanceSet.data(), neighborSet.data());
+
+				for (integer i = 0;i < points;++i)
+				{
+					testQuery(pointSet, kNearest, windowSet, windowSet[i], true,
+						distanceSet[i], neighborSet.data() + i * kNearest);
+				}
+			}
+
+			// A range of the points of the time-window.
+			{
+				integer queryBegin = std::min(points, (integer)5);
+				integer queryEnd = std::max(points - 3, queryBegin);
+				integer queries = queryEnd - queryBegin;
+
+				std::vector<dreal> distanceSet(queries);
+				std::vector<integer> neighborSet(queries * kNearest);
+				pointSet.searchAllNearest(
+					kNearest, queryBegin, queryEnd,
+					distanceSet.data(), neighborSet.data());
+
+				for (integer i = 0;i < queries;++i)
+				{
+					testQuery(pointSet, kNearest, windowSet, windowSet[queryBegin + i], true,
+						distanceSet[i], neighborSet.data() + i * kNearest);
+				}
+			}
+
+			// Queries which are not points of the point set.
+			{
+				integer queries = externalSet.size();
+
+				std::vector<dreal> distanceSet(queries);
+				std::vector<integer> neighborSet(queries * kNearest);
+				pointSet.searchAllNearest(
+					externalSet, kNearest, 
+					distanceSet.data(), neighborSet.data());
+
+				for (integer i = 0;i < queries;++i)
+				{
+					testQuery(pointSet, kNearest, windowSet, externalSet[i], false,
+						distanceSet[i], neighborSet.data() + i * kNearest);
+				}
+			}
+		}
+
+		// Compares the result of a batch search with searchNearest().
+		void testQuery(
+			const SignalPointSet& pointSet,
+			integer kNearest,
+			const std::vector<const dreal*>& windowSet,
+			const dreal* query,
+			bool excludeQuery,
+			dreal batchDistance,
+			const integer* batchNeighborSet)
+		{
+			std::vector<std::pair<dreal, const dreal*>> neighborSet;
+			dreal distance = pointSet.searchNearest(
+				query, kNearest, excludeQuery ? query : nullptr,
+				[&](dreal distance, const dreal* point)
+				{
+					neighborSet.emplace_back(distance, point);
+				});
+			std::sort(neighborSet.begin(), neighborSet.end());
+
+			if (distance == infinity<dreal>())
+			{
+				TEST_ENSURE(batchDistance == infinity<dreal>());
+			}
+			else
+			{
+				TEST_ENSURE_OP(std::abs(batchDistance - distance), <=, 1e-12 * distance);
+			}
+
+			for (integer j = 0;j < kNearest;++j)
+			{
+				integer neighbor = batchNeighborSet[j];
+				if (j >= neighborSet.size())
+				{
+					TEST_ENSURE_OP(neighbor, ==, -1);
+					continue;
+				}
+
+				TEST_ENSURE_OP(neighbor, >=, 0);
+				TEST_ENSURE_OP(neighbor, <, (integer)windowSet.size());
+				if (neighbor >= 0 && neighbor < windowSet.size())
+				{
+					TEST_ENSURE(windowSet[neighbor] == neighborSet[j].second);
+				}
+			}
 		}
 
 		bool changeTimeWindow(SignalPointSet& pointSet, integer begin, integer end)
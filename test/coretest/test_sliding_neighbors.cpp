@@ -0,0 +1,306 @@
+#include "estimation.h"
+
+#include "tim/core/entropy_combination_t.h"
+#include "tim/core/signal_generate.h"
+
+#include <pastel/sys/array/array.h>
+
+using namespace Tim;
+
+namespace
+{
+
+	class SlidingNeighborsTest
+		: public TestSuite
+	{
+	public:
+		SlidingNeighborsTest()
+			: TestSuite(&timTestReport())
+		{
+		}
+
+		virtual void run()
+		{
+			testMutualInformation();
+			testTransferEntropy();
+			testApproximate();
+		}
+
+		void testMutualInformation()
+		{
+			std::vector<Integer3> rangeSet = 
+				{Integer3(0, 1, 1), Integer3(1, 2, 1)};
+			testCombination(2, 1, rangeSet);
+			testCombination(2, 3, rangeSet);
+		}
+
+		void testTransferEntropy()
+		{
+			std::vector<Integer3> rangeSet = 
+				{Integer3(0, 2, 1), Integer3(1, 3, 1), Integer3(1, 2, -1)};
+			testCombination(3, 2, rangeSet);
+		}
+
+		void testCombination(
+			integer signals, integer trials,
+			const std::vector<Integer3>& rangeSet)
+		{
+			integer samples = 150;
+
+			std::vector<SignalData> dataSet;
+			dataSet.reserve(signals * trials);
+			Array<Signal> signalSet(Vector2i(trials, signals));
+			for (integer y = 0;y < signals;++y)
+			{
+				for (integer x = 0;x < trials;++x)
+				{
+					dataSet.push_back(generateGaussian(2, samples));
+					signalSet(x, y) = (Signal)dataSet.back();
+				}
+			}
+
+			std::vector<integer> lagSet(signals, 0);
+
+			std::vector<std::vector<dreal>> filterSet = {
+				{1},
+				{1, 2, 1},
+				{1, 1, 1, 1, 1, 1, 1},
+				{0.5, 1, 2, 3, 2, 1, 0.5, 0.25, 0.125},
+				std::vector<dreal>(23, 1)};
+
+			integer radiusSet[] = {0, 1, 2, 5, 12, 30};
+			integer kSet[] = {1, 2, 4};
+
+			for (integer timeWindowRadius : radiusSet)
+			{
+				for (integer kNearest : kSet)
+				{
+					for (const std::vector<dreal>& filter : filterSet)
+					{
+						SignalData scratch = scratchEntropyCombination(
+							signalSet, rangeSet, timeWindowRadius, kNearest, filter);
+
+						// The chunks start their trackers at different
+						// time instants.
+						integer chunkSet[] = {1, 3};
+						for (integer timeChunks : chunkSet)
+						{
+							SignalData estimate = temporalEntropyCombination(
+								signalSet, rangeSet, timeWindowRadius, lagSet,
+								kNearest, filter, timeChunks);
+
+							TEST_ENSURE_OP(estimate.samples() * estimate.dimension(), ==, samples);
+							for (integer t = 0;t < samples;++t)
+							{
+								TEST_ENSURE_OP(std::abs(estimate.data()(t) - scratch.data()(t)), <=, 1e-12);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		void testApproximate()
+		{
+			using Layout = SignalPointSet::Layout;
+
+			integer samples = 150;
+			integer trials = 2;
+			integer kNearest = 3;
+			integer timeWindowRadius = 10;
+			dreal maxRelativeError = 0.5;
+
+			std::vector<SignalData> dataSet;
+			dataSet.reserve(2 * trials);
+			Array<Signal> signalSet(Vector2i(trials, 2));
+			for (integer y = 0;y < 2;++y)
+			{
+				for (integer x = 0;x < trials;++x)
+				{
+					dataSet.push_back(generateGaussian(2, samples));
+					signalSet(x, y) = (Signal)dataSet.back();
+				}
+			}
+
+			std::vector<LaggedSignal> jointSignalSet;
+			lagSignals(signalSet, std::back_inserter(jointSignalSet), 
+				std::vector<integer>(2, 0));
+
+			SignalPointSet jointPointSet(jointSignalSet, Layout::Packed);
+
+			std::vector<SignalPointSet> pointSet;
+			pointSet.reserve(2);
+			pointSet.emplace_back(jointPointSet, 0, 2, Layout::Packed);
+			pointSet.emplace_back(jointPointSet, 2, 4, Layout::Packed);
+
+			SlidingNeighbors neighbors(
+				jointPointSet, pointSet, kNearest, maxRelativeError);
+
+			// The incremental updates must keep the distances 
+			// of the approximate searches within the bound, and 
+			// the counts must be exact for those distances.
+
+			for (integer t = 0;t < samples;++t)
+			{
+				jointPointSet.setTimeWindow(
+					t - timeWindowRadius, t + timeWindowRadius + 1);
+				for (SignalPointSet& marginal : pointSet)
+				{
+					marginal.setTimeWindow(
+						t - timeWindowRadius, t + timeWindowRadius + 1);
+				}
+
+				integer filterBegin = std::max(t - 2, jointPointSet.windowBegin());
+				integer filterEnd = std::min(t + 3, jointPointSet.windowEnd());
+				neighbors.update(filterBegin, filterEnd);
+
+				for (integer i = 0;i < neighbors.points();++i)
+				{
+					integer s = filterBegin + i / trials;
+					integer j = i % trials;
+
+					const dreal* point = *(jointPointSet.sliceBegin(s) + j);
+					dreal exact = jointPointSet.searchNearest(
+						point, kNearest, point);
+					dreal distance = neighbors.distance(i);
+
+					TEST_ENSURE_OP(distance, >=, exact);
+					TEST_ENSURE_OP(distance, <=, (1 + maxRelativeError) * exact * (1 + 1e-6));
+
+					for (integer m = 0;m < 2;++m)
+					{
+						TEST_ENSURE_OP(neighbors.count(m, i), ==, 
+							pointSet[m].countRange(
+								*(pointSet[m].sliceBegin(s) + j), distance));
+					}
+				}
+			}
+
+			std::vector<Integer3> rangeSet = 
+				{Integer3(0, 1, 1), Integer3(1, 2, 1)};
+
+			dreal relativeError = -1;
+			SignalData estimate = temporalEntropyCombination(
+				signalSet, rangeSet, timeWindowRadius, 
+				std::vector<integer>(2, 0), kNearest, 
+				constantRange((dreal)1, 1), 1, TemporalHop(),
+				maxRelativeError, &relativeError);
+
+			TEST_ENSURE_OP(relativeError, ==, 
+				jointPointSet.relativeError(maxRelativeError));
+			TEST_ENSURE_OP(estimate.samples() * estimate.dimension(), ==, samples);
+		}
+
+		// Computes the temporal entropy combination by searching 
+		// the neighbors of every filtered point from scratch, at 
+		// every time instant. The sums are formed in the same order 
+		// as in the estimator, so that the results must be equal.
+		SignalData scratchEntropyCombination(
+			const Array<Signal>& signalSet,
+			const std::vector<Integer3>& rangeSet,
+			integer timeWindowRadius,
+			integer kNearest,
+			const std::vector<dreal>& filter)
+		{
+			using Layout = SignalPointSet::Layout;
+
+			integer signals = signalSet.height();
+			integer trials = signalSet.width();
+			integer samples = signalSet(0, 0).samples();
+			integer marginals = rangeSet.size();
+
+			std::vector<LaggedSignal> jointSignalSet;
+			lagSignals(signalSet, std::back_inserter(jointSignalSet), 
+				std::vector<integer>(signals, 0));
+
+			SignalPointSet jointPointSet(jointSignalSet, Layout::Packed);
+
+			std::vector<integer> offsetSet(1, 0);
+			for (integer i = 0;i < signals;++i)
+			{
+				offsetSet.push_back(offsetSet.back() + signalSet(0, i).dimension());
+			}
+
+			std::vector<SignalPointSet> pointSet;
+			dreal signalWeightSum = 0;
+			for (const Integer3& range : rangeSet)
+			{
+				pointSet.emplace_back(
+					jointPointSet, offsetSet[range[0]], offsetSet[range[1]],
+					Layout::Packed);
+				signalWeightSum += range[2];
+			}
+
+			integer filterRadius = filter.size() / 2;
+
+			SignalData result(samples, 1);
+			for (integer t = 0;t < samples;++t)
+			{
+				jointPointSet.setTimeWindow(
+					t - timeWindowRadius, t + timeWindowRadius + 1);
+				for (SignalPointSet& marginal : pointSet)
+				{
+					marginal.setTimeWindow(
+						t - timeWindowRadius, t + timeWindowRadius + 1);
+				}
+
+				integer tBegin = jointPointSet.windowBegin();
+				integer tEnd = jointPointSet.windowEnd();
+				integer filterBegin = std::max(t - filterRadius, tBegin);
+				integer filterEnd = std::min(t + filterRadius + 1, tEnd);
+
+				dreal estimate = 0;
+				for (integer i = 0;i < marginals;++i)
+				{
+					dreal signalEstimate = 0;
+					dreal weightSum = 0;
+					for (integer s = filterBegin;s < filterEnd;++s)
+					{
+						for (integer j = 0;j < trials;++j)
+						{
+							const dreal* point = 
+								*(jointPointSet.sliceBegin(s) + j);
+							dreal distance = jointPointSet.searchNearest(
+								point, kNearest, point);
+
+							integer k = pointSet[i].countRange(
+								*(pointSet[i].sliceBegin(s) + j), 
+								distance);
+							if (k > 0)
+							{
+								dreal weight = filter[s - (t - filterRadius)];
+								signalEstimate += weight * digamma<dreal>(k);
+								weightSum += weight;
+							}
+						}
+					}
+
+					TEST_ENSURE(weightSum != 0);
+					signalEstimate /= weightSum;
+					estimate -= signalEstimate * rangeSet[i][2];
+				}
+
+				estimate += digamma<dreal>(kNearest);
+				estimate += (signalWeightSum - 1) * digamma<dreal>((tEnd - tBegin) * trials);
+
+				result.data()(t) = estimate;
+			}
+
+			return result;
+		}
+	};
+
+	void testSlidingNeighbors()
+	{
+		SlidingNeighborsTest test;
+		test.run();
+	}
+
+	void addTest()
+	{
+		timTestList().add("SlidingNeighbors", testSlidingNeighbors);
+	}
+
+	CallFunction run(addTest);
+
+}
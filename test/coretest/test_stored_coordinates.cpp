@@ -0,0 +1,187 @@
+#include "estimation.h"
+
+#include "tim/core/differential_entropy_kl.h"
+#include "tim/core/generic_entropies.h"
+#include "tim/core/signal_generate.h"
+#include "tim/core/signalpointset.h"
+
+#include <pastel/math/normbijection/maximum_normbijection.h>
+#include <pastel/math/normbijection/euclidean_normbijection.h>
+
+#include <cmath>
+
+using namespace Tim;
+
+namespace
+{
+
+	class StoredCoordinatesTest
+		: public TestSuite
+	{
+	public:
+		StoredCoordinatesTest()
+			: TestSuite(&timTestReport())
+		{
+		}
+
+		virtual void run()
+		{
+			// The search structures store the coordinates as
+			// sreal, which is float with the SinglePrecisionSearch
+			// option; these hold in both cases.
+			testAccuracy();
+			testRangeCounts();
+			testNearestDistances();
+		}
+
+		void testAccuracy()
+		{
+			using Layout = SignalPointSet::Layout;
+
+			// The KL estimate with k = 4 in the maximum norm,
+			// for N(0, I) samples. The estimate from the stored
+			// coordinates must agree with the one from the
+			// double coordinates of the Pointer layout, and
+			// both with the analytic entropy.
+			integer samples = 20000;
+			integer kNearest = 4;
+			for (integer n : {1, 2, 4})
+			{
+				SignalData data = generateGaussian(n, samples);
+				Signal signal = (Signal)data;
+
+				dreal stored = differentialEntropyKl(
+					constantRange(signal), kNearest,
+					Maximum_Norm<dreal>(), 0, nullptr, Layout::Automatic);
+				dreal exact = differentialEntropyKl(
+					constantRange(signal), kNearest,
+					Maximum_Norm<dreal>(), 0, nullptr, Layout::Pointer);
+				dreal analytic = n * 0.5 * std::log(2 * constantPi<dreal>() * std::exp((dreal)1));
+
+				TEST_ENSURE_OP(std::abs(stored - exact), <=, 1e-5 * n);
+				TEST_ENSURE_OP(std::abs(stored - analytic), <=, 0.02 * n);
+			}
+		}
+
+		void testRangeCounts()
+		{
+			using Layout = SignalPointSet::Layout;
+
+			// The range count at the distance to the k:th
+			// nearest neighbor is k, the query included.
+			integer samples = 5000;
+			integer kNearest = 4;
+			for (integer n : {1, 3})
+			{
+				SignalData data = generateGaussian(n, samples);
+				Signal signal = (Signal)data;
+
+				for (Layout layout : {Layout::Packed, Layout::VpTree, Layout::BruteForce})
+				{
+					for (Metric metric : {Metric::Maximum, Metric::Euclidean})
+					{
+						if (layout == Layout::Packed && metric == Metric::Euclidean)
+						{
+							continue;
+						}
+
+						SignalPointSet pointSet(
+							constantRange(signal), layout, metric);
+
+						std::vector<dreal> distanceSet(samples);
+						pointSet.searchAllNearest(kNearest, distanceSet.data());
+
+						integer failures = 0;
+						for (integer i = 0;i < samples;++i)
+						{
+							if (pointSet.countRange(
+								*(pointSet.begin() + i), distanceSet[i]) != kNearest)
+							{
+								++failures;
+							}
+						}
+						TEST_ENSURE_OP(failures, ==, 0);
+					}
+				}
+			}
+		}
+
+		void testNearestDistances()
+		{
+			integer samples = 3000;
+			integer kNearest = 5;
+			for (integer n : {1, 2, 5})
+			{
+				SignalData data = generateGaussian(n, samples);
+				Signal signal = (Signal)data;
+
+				testNearestDistances(signal, kNearest, Maximum_Norm<dreal>());
+				testNearestDistances(signal, kNearest, Euclidean_Norm<dreal>());
+			}
+		}
+
+		template <typename Norm>
+		void testNearestDistances(
+			const Signal& signal,
+			integer kNearest,
+			const Norm& norm)
+		{
+			using Layout = SignalPointSet::Layout;
+
+			for (Layout layout : {Layout::Automatic, Layout::VpTree, Layout::BruteForce})
+			{
+				// The distances recomputed for all the k's must
+				// be ascending, and the k:th must be the one found
+				// by the search for the k:th neighbor only.
+				auto distances = nearestDistances(
+					constantRange(signal), kNearest, norm, layout);
+
+				SignalPointSet pointSet(
+					constantRange(signal), layout, NormMetric<Norm>::value);
+
+				integer points = distances.points;
+				TEST_ENSURE_OP(points, ==, pointSet.end() - pointSet.begin());
+
+				std::vector<dreal> distanceSet(points);
+				pointSet.searchAllNearest(kNearest, distanceSet.data());
+
+				integer unsorted = 0;
+				integer different = 0;
+				for (integer i = 0;i < points;++i)
+				{
+					for (integer k = 1;k < kNearest;++k)
+					{
+						if ((dreal)distances.distanceSet[i * kNearest + k] <
+							(dreal)distances.distanceSet[i * kNearest + k - 1])
+						{
+							++unsorted;
+						}
+					}
+
+					if ((dreal)distances.distanceSet[i * kNearest + kNearest - 1] !=
+						distanceSet[i])
+					{
+						++different;
+					}
+				}
+
+				TEST_ENSURE_OP(unsorted, ==, 0);
+				TEST_ENSURE_OP(different, ==, 0);
+			}
+		}
+	};
+
+	void testStoredCoordinates()
+	{
+		StoredCoordinatesTest test;
+		test.run();
+	}
+
+	void addTest()
+	{
+		timTestList().add("StoredCoordinates", testStoredCoordinates);
+	}
+
+	CallFunction run(addTest);
+
+}
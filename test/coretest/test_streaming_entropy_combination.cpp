@@ -0,0 +1,139 @@
+#include "estimation.h"
+
+#include "tim/core/streaming_entropy_combination.h"
+#include "tim/core/entropy_combination_t.h"
+#include "tim/core/signal_generate.h"
+
+#include <pastel/sys/array/array.h>
+
+using namespace Tim;
+
+namespace
+{
+
+	class StreamingEntropyCombinationTest
+		: public TestSuite
+	{
+	public:
+		StreamingEntropyCombinationTest()
+			: TestSuite(&timTestReport())
+		{
+		}
+
+		virtual void run()
+		{
+			// The time-window of radius 20 is covered by
+			// blocks of 6 time instants, so that the estimates
+			// mix the full blocks and the partial last block.
+			testStreaming({0, 0}, 20, 1, {1});
+			testStreaming({0, 0}, 20, 3, {1, 2, 1});
+			testStreaming({0, 2}, 20, 2, {1});
+			testStreaming({3, 1}, 7, 2, {1, 1, 1, 1, 1});
+
+			// Rounded samples have many equal distances, which
+			// tell apart the distances of stored coordinates.
+			testStreaming({0, 0}, 20, 2, {1}, 0.01);
+			testStreaming({0, 1}, 20, 4, {1, 2, 1}, 0.01);
+		}
+
+		void testStreaming(
+			const std::vector<integer>& lagSet,
+			integer timeWindowRadius,
+			integer kNearest,
+			const std::vector<dreal>& filter,
+			dreal quantum = 0)
+		{
+			// The estimates must be those of
+			// temporalEntropyCombination(), since the
+			// partial block measures the distances as the
+			// kd-trees of the full blocks.
+
+			integer samples = 200;
+			integer trials = 2;
+			std::vector<integer> dimensionSet = {1, 2};
+
+			std::vector<SignalData> dataSet;
+			dataSet.reserve(trials * 2);
+			Array<Signal> signalSet(Vector2i(trials, 2));
+			for (integer j = 0;j < trials;++j)
+			{
+				for (integer i = 0;i < 2;++i)
+				{
+					dataSet.push_back(generateGaussian(dimensionSet[i], samples));
+					if (quantum > 0)
+					{
+						MatrixView<dreal> data = dataSet.back().data();
+						for (integer k = 0;k < dimensionSet[i] * samples;++k)
+						{
+							data(k) = std::round(data(k) / quantum) * quantum;
+						}
+					}
+					signalSet(j, i) = (Signal)dataSet.back();
+				}
+			}
+
+			std::vector<Integer3> rangeSet =
+				{Integer3(0, 1, 1), Integer3(1, 2, 1)};
+
+			SignalData correct = temporalEntropyCombination(
+				signalSet, rangeSet, timeWindowRadius, lagSet,
+				kNearest, filter);
+
+			StreamingEntropyCombination streaming(
+				dimensionSet, trials, rangeSet, timeWindowRadius,
+				lagSet, kNearest, filter);
+
+			integer estimates = correct.dimension() * correct.samples();
+			std::vector<dreal> estimateSet(estimates, (dreal)Nan());
+			std::vector<dreal> sampleSet(trials * streaming.dimension());
+			for (integer t = 0;t < samples;++t)
+			{
+				for (integer j = 0;j < trials;++j)
+				{
+					for (integer i = 0;i < 2;++i)
+					{
+						for (integer d = 0;d < dimensionSet[i];++d)
+						{
+							sampleSet[j * streaming.dimension() +
+								streaming.offset(i) + d] =
+								signalSet(j, i).data()(d, t);
+						}
+					}
+				}
+
+				if (streaming.push(sampleSet.data()))
+				{
+					estimateSet[streaming.time() - correct.t()] =
+						streaming.estimate();
+				}
+			}
+
+			SignalData rest = streaming.finish();
+			for (integer t = 0;t < rest.dimension() * rest.samples();++t)
+			{
+				estimateSet[rest.t() + t - correct.t()] = rest.data()(t);
+			}
+
+			for (integer t = 0;t < estimates;++t)
+			{
+				TEST_ENSURE(!isNan(estimateSet[t]));
+				TEST_ENSURE_OP(
+					std::abs(estimateSet[t] - correct.data()(t)), <=, 1e-12);
+			}
+		}
+	};
+
+	void testStreamingEntropyCombination()
+	{
+		StreamingEntropyCombinationTest test;
+		test.run();
+	}
+
+	void addTest()
+	{
+		timTestList().add("StreamingEntropyCombination", testStreamingEntropyCombination);
+	}
+
+	CallFunction run(addTest);
+
+}
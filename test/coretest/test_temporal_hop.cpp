@@ -0,0 +1,229 @@
+#include "estimation.h"
+
+#include "tim/core/temporal_hop.h"
+#include "tim/core/differential_entropy_kl.h"
+#include "tim/core/entropy_combination_t.h"
+#include "tim/core/signal_generate.h"
+
+#include <pastel/sys/array/array.h>
+
+using namespace Tim;
+
+namespace
+{
+
+	class TemporalHopTest
+		: public TestSuite
+	{
+	public:
+		TemporalHopTest()
+			: TestSuite(&timTestReport())
+		{
+		}
+
+		virtual void run()
+		{
+			testUnitHop();
+			testHop();
+			testRefine();
+		}
+
+		void testUnitHop()
+		{
+			// A unit hop evaluates every time instant; the
+			// refinement and the fill have then nothing to
+			// do, and the estimates must be bit-identical
+			// to those without a hop.
+
+			integer samples = 500;
+
+			SignalData xSignal = generateGaussian(2, samples);
+			SignalData ySignal = generateGaussian(2, samples);
+
+			Array<Signal> signalSet(Vector2i(1, 2));
+			signalSet(0, 0) = (Signal)xSignal;
+			signalSet(0, 1) = (Signal)ySignal;
+
+			std::vector<Integer3> rangeSet =
+				{Integer3(0, 1, 1), Integer3(1, 2, 1)};
+			std::vector<integer> lagSet(2, 0);
+			std::vector<dreal> filter = {1, 2, 1};
+
+			TemporalHop hop;
+			hop.refineThreshold = 0.01;
+			hop.fill = false;
+
+			for (integer timeChunks : {1, 3})
+			{
+				SignalData correct = temporalEntropyCombination(
+					signalSet, rangeSet, 20, lagSet, 2, filter, timeChunks);
+				SignalData estimate = temporalEntropyCombination(
+					signalSet, rangeSet, 20, lagSet, 2, filter, timeChunks, hop);
+
+				TEST_ENSURE(equal(estimate, correct));
+			}
+
+			std::vector<Signal> xSignalSet(1, (Signal)xSignal);
+
+			SignalData correct = temporalDifferentialEntropyKl(
+				xSignalSet, 20, 2, Default_Norm(), filter);
+			SignalData estimate = temporalDifferentialEntropyKl(
+				xSignalSet, 20, 2, Default_Norm(), filter, 0, nullptr,
+				SignalPointSet::Layout::Automatic, hop);
+
+			TEST_ENSURE(equal(estimate, correct));
+		}
+
+		void testHop()
+		{
+			// The evaluated time instants have the same
+			// estimates as without a hop.
+
+			integer samples = 500;
+
+			SignalData xSignal = generateGaussian(2, samples);
+			std::vector<Signal> xSignalSet(1, (Signal)xSignal);
+
+			SignalData correct = temporalDifferentialEntropyKl(
+				xSignalSet, 20, 2);
+
+			for (integer step : {2, 7, 64})
+			{
+				TemporalHop hop;
+				hop.hop = step;
+				hop.fill = false;
+
+				SignalData estimate = temporalDifferentialEntropyKl(
+					xSignalSet, 20, 2, Default_Norm(),
+					constantRange((dreal)1, 1), 0, nullptr,
+					SignalPointSet::Layout::Automatic, hop);
+
+				for (integer t = 0;t < samples;++t)
+				{
+					bool evaluated = (t % step == 0 || t == samples - 1);
+					dreal value = estimate.data()(t);
+					if (evaluated)
+					{
+						TEST_ENSURE_OP(std::abs(value - correct.data()(t)), <=, 1e-12);
+					}
+					else
+					{
+						TEST_ENSURE(isNan(value));
+					}
+				}
+			}
+		}
+
+		void testRefine()
+		{
+			// The standard deviation steps from 1 to 10 at
+			// the time instant 1000, and so the entropy steps
+			// by log(10) around it. The refinement must evaluate
+			// the time instants around the step densely, and
+			// leave the rest to the hop.
+
+			integer samples = 2000;
+			integer step = 1000;
+			integer trials = 10;
+			integer timeWindowRadius = 50;
+			std::vector<dreal> filter(21, 1);
+
+			std::vector<SignalData> dataSet;
+			dataSet.reserve(trials);
+			std::vector<Signal> xSignalSet;
+			for (integer i = 0;i < trials;++i)
+			{
+				dataSet.push_back(generateGaussian(1, samples));
+				for (integer t = step;t < samples;++t)
+				{
+					dataSet.back().data()(0, t) *= 10;
+				}
+				xSignalSet.push_back((Signal)dataSet.back());
+			}
+
+			SignalData correct = temporalDifferentialEntropyKl(
+				xSignalSet, timeWindowRadius, 1, Default_Norm(), filter);
+
+			TemporalHop hop;
+			hop.hop = 64;
+			hop.refineThreshold = 0.5;
+			hop.fill = false;
+
+			SignalData estimate = temporalDifferentialEntropyKl(
+				xSignalSet, timeWindowRadius, 1, Default_Norm(),
+				filter, 0, nullptr,
+				SignalPointSet::Layout::Automatic, hop);
+
+			integer evaluated = 0;
+			integer stepEvaluated = 0;
+			integer previous = -1;
+			for (integer t = 0;t < samples;++t)
+			{
+				dreal value = estimate.data()(t);
+				if (isNan(value))
+				{
+					continue;
+				}
+
+				TEST_ENSURE_OP(std::abs(value - correct.data()(t)), <=, 1e-12);
+				++evaluated;
+				if (std::abs(t - step) <= timeWindowRadius)
+				{
+					++stepEvaluated;
+				}
+
+				if (previous >= 0)
+				{
+					// The gaps which are left must not
+					// hide a large change.
+					TEST_ENSURE(t - previous == 1 ||
+						std::abs(value - estimate.data()(previous)) <= hop.refineThreshold);
+				}
+				previous = t;
+			}
+
+			// The change of log(10) over the time-window
+			// around the step needs at least four evaluated
+			// time instants in steps of at most 0.5.
+			TEST_ENSURE_OP(stepEvaluated, >=, 4);
+
+			// Far from the step, mostly the hop is evaluated.
+			TEST_ENSURE_OP(evaluated, <, samples / 8);
+		}
+
+		bool equal(const SignalData& left, const SignalData& right)
+		{
+			if (left.samples() != right.samples() ||
+				left.dimension() != right.dimension())
+			{
+				return false;
+			}
+
+			for (integer i = 0;i < left.samples() * left.dimension();++i)
+			{
+				dreal a = left.data()(i);
+				dreal b = right.data()(i);
+				if (!(a == b || (isNan(a) && isNan(b))))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+	};
+
+	void testTemporalHop()
+	{
+		TemporalHopTest test;
+		test.run();
+	}
+
+	void addTest()
+	{
+		timTestList().add("TemporalHop", testTemporalHop);
+	}
+
+	CallFunction run(addTest);
+
+}
@@ -0,0 +1,591 @@
+// Description: Benchmarks of the TIM estimators
+// Detail: Sweeps the estimators over the problem sizes and thread counts, and reports JSON
+
+#include "tim/core/signal_generate.h"
+#include "tim/core/signalpointset.h"
+#include "tim/core/sliding_neighbors.h"
+#include "tim/core/entropy_combination.h"
+#include "tim/core/entropy_combination_t.h"
+#include "tim/core/lag_sweep.h"
+#include "tim/core/divergence_wkv.h"
+#include "tim/core/differential_entropy_kl.h"
+#include "tim/core/renyi_entropy_lps.h"
+#include "tim/core/tsallis_entropy_lps.h"
+
+#include <pastel/sys/array/array.h>
+
+#include <tbb/task_arena.h>
+
+#if (defined _WIN32 || defined _WIN64)
+#	define NOMINMAX
+#	include <windows.h>
+#	include <psapi.h>
+#else
+#	include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Tim;
+
+namespace
+{
+
+	//! The parameters of a benchmark run.
+	struct Parameters
+	{
+		integer samples = 0;
+		integer dimension = 0;
+		integer kNearest = 0;
+		integer trials = 0;
+		integer timeWindowRadius = 0;
+		integer filterWidth = 0;
+	};
+
+	//! The signals of a benchmark run.
+	/*!
+	The x and y signals are independent gaussian
+	signals, with the given trials.
+	*/
+	struct Input
+	{
+		explicit Input(const Parameters& parameters)
+			: dataSet()
+			, signalSet(Vector2i(parameters.trials, 2))
+		{
+			dataSet.reserve(2 * parameters.trials);
+			for (integer y = 0;y < 2;++y)
+			{
+				for (integer x = 0;x < parameters.trials;++x)
+				{
+					dataSet.push_back(generateGaussian(
+						parameters.dimension, parameters.samples));
+					signalSet(x, y) = (Signal)dataSet.back();
+				}
+			}
+		}
+
+		std::vector<Signal> trials(integer signal) const
+		{
+			std::vector<Signal> trialSet;
+			for (integer x = 0;x < signalSet.width();++x)
+			{
+				trialSet.push_back(signalSet(x, signal));
+			}
+			return trialSet;
+		}
+
+		std::vector<SignalData> dataSet;
+		Array<Signal> signalSet;
+	};
+
+	//! A benchmark case.
+	struct Case
+	{
+		//! The name of the case.
+		std::string name;
+
+		//! Whether the case depends on the time-window radius.
+		bool temporal;
+
+		//! Whether the case slides the neighbors of a time-window.
+		/*!
+		The sliding cases are run for the --sliding-trials
+		instead of the --trials.
+		*/
+		bool sliding;
+
+		//! Runs the measured part of the case.
+		/*!
+		The input is created before the call, and is
+		not measured. Returns the number of queries,
+		that is, the estimated points or time instants.
+		*/
+		std::function<integer(const Input&, const Parameters&)> run;
+	};
+
+	std::vector<Integer3> miRangeSet()
+	{
+		return {Integer3(0, 1, 1), Integer3(1, 2, 1)};
+	}
+
+	const std::vector<integer> zeroLagSet(2, 0);
+
+	//! Slides a time-window over the mutual information point sets.
+	/*!
+	The joint point set and the marginal point sets of the 
+	mutual information of x and y are built before sliding.
+	Then step(t, filterBegin, filterEnd, jointPointSet, marginalSet)
+	is called for each time instant t, after setting the 
+	time-windows, where [filterBegin, filterEnd[ is the filter 
+	window clipped to the time-window. Returns the number of 
+	time instants.
+	*/
+	template <typename Step>
+	integer slideWindow(
+		const Input& input, 
+		const Parameters& p,
+		Step&& step)
+	{
+		using Layout = SignalPointSet::Layout;
+
+		std::vector<LaggedSignal> jointSignalSet;
+		lagSignals(input.signalSet, std::back_inserter(jointSignalSet), zeroLagSet);
+
+		SignalPointSet jointPointSet(jointSignalSet, Layout::Packed);
+
+		std::vector<SignalPointSet> marginalSet;
+		marginalSet.emplace_back(jointPointSet, 0, p.dimension, Layout::Packed);
+		marginalSet.emplace_back(jointPointSet, p.dimension, 2 * p.dimension, Layout::Packed);
+
+		for (integer t = 0;t < p.samples;++t)
+		{
+			jointPointSet.setTimeWindow(
+				t - p.timeWindowRadius, t + p.timeWindowRadius + 1);
+			for (SignalPointSet& pointSet : marginalSet)
+			{
+				pointSet.setTimeWindow(
+					t - p.timeWindowRadius, t + p.timeWindowRadius + 1);
+			}
+			integer filterRadius = p.filterWidth / 2;
+			step(t, 
+				std::max(t - filterRadius, jointPointSet.windowBegin()),
+				std::min(t + filterRadius + 1, jointPointSet.windowEnd()),
+				jointPointSet, marginalSet);
+		}
+
+		return p.samples;
+	}
+
+	std::vector<Case> caseSet()
+	{
+		return {
+			{"point_set_build", false, false,
+				[](const Input& input, const Parameters& p)
+				{
+					SignalPointSet pointSet(
+						input.trials(0), SignalPointSet::Layout::Automatic);
+					return p.samples * p.trials;
+				}},
+			{"set_time_window", true, false,
+				[](const Input& input, const Parameters& p)
+				{
+					SignalPointSet pointSet(
+						input.trials(0), SignalPointSet::Layout::Automatic);
+					for (integer t = 0;t < p.samples;++t)
+					{
+						pointSet.setTimeWindow(
+							t - p.timeWindowRadius, t + p.timeWindowRadius + 1);
+					}
+					return p.samples;
+				}},
+			{"entropy_combination", false, false,
+				[](const Input& input, const Parameters& p)
+				{
+					entropyCombination(
+						input.signalSet, miRangeSet(), zeroLagSet, p.kNearest);
+					return p.samples * p.trials;
+				}},
+			{"entropy_combination_t", true, true,
+				[](const Input& input, const Parameters& p)
+				{
+					temporalEntropyCombination(
+						input.signalSet, miRangeSet(), p.timeWindowRadius,
+						zeroLagSet, p.kNearest, 
+						std::vector<dreal>(p.filterWidth, 1));
+					return p.samples;
+				}},
+			{"sliding_neighbors", true, true,
+				[](const Input& input, const Parameters& p)
+				{
+					// The neighbors of the filter window are
+					// updated incrementally.
+					std::unique_ptr<SlidingNeighbors> neighbors;
+					return slideWindow(input, p,
+						[&](integer t, 
+							integer filterBegin, integer filterEnd,
+							const SignalPointSet& jointPointSet,
+							const std::vector<SignalPointSet>& marginalSet)
+						{
+							if (!neighbors)
+							{
+								neighbors = std::make_unique<SlidingNeighbors>(
+									jointPointSet, marginalSet, p.kNearest);
+							}
+							neighbors->update(filterBegin, filterEnd);
+						});
+				}},
+			{"sliding_neighbors_recompute", true, true,
+				[](const Input& input, const Parameters& p)
+				{
+					// The neighbors of the filter window are
+					// searched from scratch at each time instant; 
+					// the baseline for sliding_neighbors.
+					return slideWindow(input, p,
+						[&](integer t, 
+							integer filterBegin, integer filterEnd,
+							const SignalPointSet& jointPointSet,
+							const std::vector<SignalPointSet>& marginalSet)
+						{
+							for (integer s = filterBegin;s < filterEnd;++s)
+							{
+								for (integer j = 0;j < p.trials;++j)
+								{
+									const dreal* point = 
+										*(jointPointSet.sliceBegin(s) + j);
+									dreal distance = jointPointSet.searchNearest(
+										point, p.kNearest, point);
+									for (const SignalPointSet& pointSet : marginalSet)
+									{
+										pointSet.countRange(
+											*(pointSet.sliceBegin(s) + j), 
+											distance);
+									}
+								}
+							}
+						});
+				}},
+			{"entropy_combination_lag_sweep", false, false,
+				[](const Input& input, const Parameters& p)
+				{
+					std::vector<integer> sweepSet = {0, 1, 2, 3};
+					entropyCombinationLagSweep(
+						input.signalSet, miRangeSet(), zeroLagSet,
+						1, sweepSet, p.kNearest);
+					return p.samples * p.trials * (integer)sweepSet.size();
+				}},
+			{"divergence_wkv", false, false,
+				[](const Input& input, const Parameters& p)
+				{
+					divergenceWkv(input.trials(0), input.trials(1));
+					return p.samples * p.trials;
+				}},
+			{"differential_entropy_kl", false, false,
+				[](const Input& input, const Parameters& p)
+				{
+					differentialEntropyKl(input.trials(0), p.kNearest);
+					return p.samples * p.trials;
+				}},
+			{"differential_entropy_kl_t", true, false,
+				[](const Input& input, const Parameters& p)
+				{
+					temporalDifferentialEntropyKl(
+						input.trials(0), p.timeWindowRadius, p.kNearest);
+					return p.samples;
+				}},
+			{"renyi_entropy_lps", false, false,
+				[](const Input& input, const Parameters& p)
+				{
+					renyiEntropyLps(input.trials(0), 2, p.kNearest);
+					return p.samples * p.trials;
+				}},
+			{"renyi_entropy_lps_t", true, false,
+				[](const Input& input, const Parameters& p)
+				{
+					temporalRenyiEntropyLps(
+						input.trials(0), p.timeWindowRadius, 2, p.kNearest);
+					return p.samples;
+				}},
+			{"tsallis_entropy_lps", false, false,
+				[](const Input& input, const Parameters& p)
+				{
+					tsallisEntropyLps(input.trials(0), 2, p.kNearest);
+					return p.samples * p.trials;
+				}},
+			{"tsallis_entropy_lps_t", true, false,
+				[](const Input& input, const Parameters& p)
+				{
+					temporalTsallisEntropyLps(
+						input.trials(0), p.timeWindowRadius, 2, p.kNearest);
+					return p.samples;
+				}},
+		};
+	}
+
+	//! Returns the peak resident set size of the process in bytes.
+	/*!
+	The peak is over the lifetime of the process, and so 
+	includes all the cases run before; it is not the memory
+	of the current case alone.
+	*/
+	integer processPeakRss()
+	{
+#if (defined _WIN32 || defined _WIN64)
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		{
+			return 0;
+		}
+		return counters.PeakWorkingSetSize;
+#else
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+		{
+			return 0;
+		}
+#	ifdef __APPLE__
+		// Bytes on Mac OS X.
+		return usage.ru_maxrss;
+#	else
+		// Kilobytes on Linux.
+		return (integer)usage.ru_maxrss * 1024;
+#	endif
+#endif
+	}
+
+	std::vector<integer> parseList(const std::string& text)
+	{
+		std::vector<integer> valueSet;
+		std::istringstream stream(text);
+		std::string item;
+		while (std::getline(stream, item, ','))
+		{
+			integer value = std::atoll(item.c_str());
+			if (value <= 0)
+			{
+				return std::vector<integer>();
+			}
+			valueSet.push_back(value);
+		}
+		return valueSet;
+	}
+
+	void printUsage()
+	{
+		std::cerr
+			<< "Usage: timbench [options]" << std::endl
+			<< std::endl
+			<< "Runs each case for every combination of the listed values," << std::endl
+			<< "and writes the results as JSON. The lists are comma-separated." << std::endl
+			<< std::endl
+			<< "  --case name,...       The cases to run (default: all)." << std::endl
+			<< "  --samples n,...       The samples of each trial (default: 1000,10000)." << std::endl
+			<< "  --dimension d,...     The dimension of each signal (default: 1,4)." << std::endl
+			<< "  --k k,...             The number of nearest neighbors (default: 1,4)." << std::endl
+			<< "  --trials t,...        The number of trials (default: 1)." << std::endl
+			<< "  --sliding-trials t,...  The number of trials of the sliding cases (default: 1,10,50)." << std::endl
+			<< "  --radius r,...        The time-window radius of the temporal cases (default: 25)." << std::endl
+			<< "  --filter w,...        The odd filter width of the temporal cases (default: 1)." << std::endl
+			<< "  --threads p,...       The numbers of threads (default: 1 and all)." << std::endl
+			<< "  --repeats n           The best of n runs is reported (default: 3)." << std::endl
+			<< "  --output file         The JSON file (default: the standard output)." << std::endl
+			<< std::endl
+			<< "The process_peak_rss_bytes of a result is the peak memory of the" << std::endl
+			<< "process so far, including the cases run before it; run a single" << std::endl
+			<< "case to measure its peak memory." << std::endl
+			<< std::endl
+			<< "The cases are:" << std::endl;
+		for (const Case& benchmark : caseSet())
+		{
+			std::cerr << "  " << benchmark.name << std::endl;
+		}
+	}
+
+}
+
+int main(int argc, char* argv[])
+{
+	std::map<std::string, std::vector<integer>> listSet = {
+		{"--samples", {1000, 10000}},
+		{"--dimension", {1, 4}},
+		{"--k", {1, 4}},
+		{"--trials", {1}},
+		{"--sliding-trials", {1, 10, 50}},
+		{"--radius", {25}},
+		{"--filter", {1}},
+		{"--threads", {1, tbb::this_task_arena::max_concurrency()}},
+	};
+	integer repeats = 3;
+	std::string outputName;
+	std::vector<std::string> caseNameSet;
+
+	for (integer i = 1;i < argc;++i)
+	{
+		std::string option = argv[i];
+		if (option == "--help" || option == "-h" || i + 1 >= argc)
+		{
+			printUsage();
+			return option == "--help" || option == "-h" ? 0 : 1;
+		}
+
+		std::string value = argv[++i];
+		if (listSet.count(option))
+		{
+			listSet[option] = parseList(value);
+			if (listSet[option].empty())
+			{
+				printUsage();
+				return 1;
+			}
+		}
+		else if (option == "--repeats")
+		{
+			repeats = std::max(std::atoll(value.c_str()), 1LL);
+		}
+		else if (option == "--output")
+		{
+			outputName = value;
+		}
+		else if (option == "--case")
+		{
+			std::istringstream stream(value);
+			std::string name;
+			while (std::getline(stream, name, ','))
+			{
+				caseNameSet.push_back(name);
+			}
+		}
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+
+	for (integer filterWidth : listSet["--filter"])
+	{
+		if (!odd(filterWidth))
+		{
+			printUsage();
+			return 1;
+		}
+	}
+
+	std::vector<integer>& threadSet = listSet["--threads"];
+	std::sort(threadSet.begin(), threadSet.end());
+	threadSet.erase(std::unique(threadSet.begin(), threadSet.end()), threadSet.end());
+
+	std::vector<Case> benchmarkSet;
+	for (const Case& benchmark : caseSet())
+	{
+		if (caseNameSet.empty() ||
+			std::find(caseNameSet.begin(), caseNameSet.end(), benchmark.name) != caseNameSet.end())
+		{
+			benchmarkSet.push_back(benchmark);
+		}
+	}
+
+	std::ofstream outputFile;
+	if (!outputName.empty())
+	{
+		outputFile.open(outputName);
+		if (!outputFile)
+		{
+			std::cerr << "Error: can not open " << outputName << "." << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& output = outputName.empty() ? std::cout : outputFile;
+
+	output << "{" << std::endl;
+	output << "\t\"benchmark\": \"timbench\"," << std::endl;
+	output << "\t\"repeats\": " << repeats << "," << std::endl;
+	output << "\t\"results\": [";
+
+	bool first = true;
+	for (const Case& benchmark : benchmarkSet)
+	{
+		// The time-window radius and the filter width only 
+		// affect the temporal cases.
+		std::vector<integer> radiusSet = benchmark.temporal ?
+			listSet["--radius"] : std::vector<integer>(1, 0);
+		std::vector<integer> filterSet = benchmark.temporal ?
+			listSet["--filter"] : std::vector<integer>(1, 1);
+
+		// The cost of the incremental updates grows with the 
+		// square of the trials, so that the sliding cases 
+		// sweep the trials separately.
+		const std::vector<integer>& trialSet = benchmark.sliding ?
+			listSet["--sliding-trials"] : listSet["--trials"];
+
+		for (integer samples : listSet["--samples"])
+		for (integer dimension : listSet["--dimension"])
+		for (integer kNearest : listSet["--k"])
+		for (integer trials : trialSet)
+		for (integer timeWindowRadius : radiusSet)
+		for (integer filterWidth : filterSet)
+		{
+			Parameters parameters;
+			parameters.samples = samples;
+			parameters.dimension = dimension;
+			parameters.kNearest = kNearest;
+			parameters.trials = trials;
+			parameters.timeWindowRadius = timeWindowRadius;
+			parameters.filterWidth = filterWidth;
+
+			std::cerr << benchmark.name
+				<< " n=" << samples << " d=" << dimension
+				<< " k=" << kNearest << " trials=" << trials;
+			if (benchmark.temporal)
+			{
+				std::cerr << " r=" << timeWindowRadius << " w=" << filterWidth;
+			}
+			std::cerr << std::endl;
+
+			Input input(parameters);
+
+			// The scaling efficiency is relative to the
+			// smallest number of threads.
+			dreal baseSeconds = 0;
+			integer baseThreads = threadSet.front();
+
+			for (integer threads : threadSet)
+			{
+				tbb::task_arena arena(threads);
+
+				dreal seconds = (dreal)Infinity();
+				integer queries = 0;
+				for (integer i = 0;i < repeats;++i)
+				{
+					arena.execute([&]()
+					{
+						auto begin = std::chrono::steady_clock::now();
+						queries = benchmark.run(input, parameters);
+						std::chrono::duration<double> elapsed =
+							std::chrono::steady_clock::now() - begin;
+						seconds = std::min(seconds, (dreal)elapsed.count());
+					});
+				}
+
+				if (threads == baseThreads)
+				{
+					baseSeconds = seconds;
+				}
+				dreal efficiency = (baseSeconds * baseThreads) / (seconds * threads);
+
+				output << (first ? "" : ",") << std::endl;
+				output << "\t\t{"
+					<< "\"case\": \"" << benchmark.name << "\", "
+					<< "\"samples\": " << samples << ", "
+					<< "\"dimension\": " << dimension << ", "
+					<< "\"k\": " << kNearest << ", "
+					<< "\"trials\": " << trials << ", "
+					<< "\"time_window_radius\": " << (benchmark.temporal ? timeWindowRadius : 0) << ", "
+					<< "\"filter_width\": " << filterWidth << ", "
+					<< "\"threads\": " << threads << ", "
+					<< "\"seconds\": " << seconds << ", "
+					<< "\"queries\": " << queries << ", "
+					<< "\"seconds_per_query\": " << seconds / std::max(queries, (integer)1) << ", "
+					<< "\"scaling_efficiency\": " << efficiency << ", "
+					<< "\"process_peak_rss_bytes\": " << processPeakRss()
+					<< "}";
+				output.flush();
+				first = false;
+			}
+		}
+	}
+
+	output << std::endl << "\t]" << std::endl << "}" << std::endl;
+
+	return 0;
+}
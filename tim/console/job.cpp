@@ -0,0 +1,632 @@
+#include "tim/console/job.h"
+
+#include "tim/core/mapped_signals.h"
+#include "tim/core/entropy_combination.h"
+#include "tim/core/entropy_combination_t.h"
+#include "tim/core/lag_sweep.h"
+#include "tim/core/divergence_wkv.h"
+#include "tim/core/differential_entropy_kl.h"
+#include "tim/core/renyi_entropy_lps.h"
+#include "tim/core/tsallis_entropy_lps.h"
+
+#include <pastel/sys/array/array.h>
+
+#include <algorithm>
+#include <fstream>
+#include <list>
+#include <sstream>
+
+namespace Tim
+{
+
+	namespace
+	{
+
+		SignalData asSignalData(dreal value)
+		{
+			SignalData result(1, 1);
+			result.data()(0) = value;
+			return result;
+		}
+
+		SignalData asSignalData(const std::vector<dreal>& valueSet)
+		{
+			integer n = valueSet.size();
+			SignalData result(1, n);
+			for (integer i = 0;i < n;++i)
+			{
+				result.data()(i) = valueSet[i];
+			}
+			return result;
+		}
+
+		// Returns the trials of a signal.
+		std::vector<Signal> trialsOf(
+			const Array<Signal>& signalSet, integer signal)
+		{
+			std::vector<Signal> trialSet;
+			trialSet.reserve(signalSet.width());
+			for (integer x = 0;x < signalSet.width();++x)
+			{
+				trialSet.push_back(signalSet(x, signal));
+			}
+			return trialSet;
+		}
+
+		//! An estimator which can be run from a job file.
+		struct Estimator
+		{
+			//! The name of the estimator in the job file.
+			const char* name;
+
+			//! The number of signals, or 0 for any positive number.
+			integer signals;
+
+			//! Whether the estimator needs the ranges.
+			bool ranges;
+
+			//! Whether the estimator needs the time-window radius.
+			bool temporal;
+
+			//! Whether the estimator needs the swept signal and lags.
+			bool sweep;
+
+			//! Computes the estimate.
+			SignalData (*estimate)(const Job& job, const Array<Signal>& signalSet);
+		};
+
+		const Estimator estimatorSet[] =
+		{
+			{"entropy_combination", 0, true, false, false,
+				[](const Job& job, const Array<Signal>& signalSet)
+				{
+					return asSignalData(entropyCombination(
+						signalSet, job.rangeSet, job.lagSet,
+						job.kNearest, job.maxRelativeError));
+				}},
+			{"entropy_combination_t", 0, true, true, false,
+				[](const Job& job, const Array<Signal>& signalSet)
+				{
+					return temporalEntropyCombination(
+						signalSet, job.rangeSet, job.timeWindowRadius,
+						job.lagSet, job.kNearest, job.filter, 1, job.hop,
+						job.maxRelativeError);
+				}},
+			{"entropy_combination_lag_sweep", 0, true, false, true,
+				[](const Job& job, const Array<Signal>& signalSet)
+				{
+					return asSignalData(entropyCombinationLagSweep(
+						signalSet, job.rangeSet, job.lagSet,
+						job.sweptSignal, job.sweepSet,
+						job.kNearest, job.maxRelativeError));
+				}},
+			{"divergence_wkv", 2, false, false, false,
+				[](const Job& job, const Array<Signal>& signalSet)
+				{
+					return asSignalData(divergenceWkv(
+						trialsOf(signalSet, 0), trialsOf(signalSet, 1),
+						job.maxRelativeError));
+				}},
+			{"differential_entropy_kl", 1, false, false, false,
+				[](const Job& job, const Array<Signal>& signalSet)
+				{
+					return asSignalData(differentialEntropyKl(
+						trialsOf(signalSet, 0), job.kNearest, Default_Norm(),
+						job.maxRelativeError));
+				}},
+			{"differential_entropy_kl_t", 1, false, true, false,
+				[](const Job& job, const Array<Signal>& signalSet)
+				{
+					return temporalDifferentialEntropyKl(
+						trialsOf(signalSet, 0), job.timeWindowRadius,
+						job.kNearest, Default_Norm(), job.filter,
+						job.maxRelativeError, nullptr,
+						SignalPointSet::Layout::Automatic, job.hop);
+				}},
+			{"renyi_entropy_lps", 1, false, false, false,
+				[](const Job& job, const Array<Signal>& signalSet)
+				{
+					return asSignalData(renyiEntropyLps(
+						trialsOf(signalSet, 0), job.q, job.kNearestSuggestion,
+						job.maxRelativeError));
+				}},
+			{"renyi_entropy_lps_t", 1, false, true, false,
+				[](const Job& job, const Array<Signal>& signalSet)
+				{
+					return temporalRenyiEntropyLps(
+						trialsOf(signalSet, 0), job.timeWindowRadius,
+						job.q, job.kNearestSuggestion, job.filter,
+						job.maxRelativeError, nullptr, job.hop);
+				}},
+			{"tsallis_entropy_lps", 1, false, false, false,
+				[](const Job& job, const Array<Signal>& signalSet)
+				{
+					return asSignalData(tsallisEntropyLps(
+						trialsOf(signalSet, 0), job.q, job.kNearestSuggestion,
+						job.maxRelativeError));
+				}},
+			{"tsallis_entropy_lps_t", 1, false, true, false,
+				[](const Job& job, const Array<Signal>& signalSet)
+				{
+					return temporalTsallisEntropyLps(
+						trialsOf(signalSet, 0), job.timeWindowRadius,
+						job.q, job.kNearestSuggestion, job.filter,
+						job.maxRelativeError, nullptr, job.hop);
+				}},
+		};
+
+		const Estimator* findEstimator(const std::string& name)
+		{
+			for (const Estimator& estimator : estimatorSet)
+			{
+				if (name == estimator.name)
+				{
+					return &estimator;
+				}
+			}
+			return nullptr;
+		}
+
+		// Removes the white-space from both ends.
+		std::string trim(const std::string& text)
+		{
+			std::string::size_type begin = text.find_first_not_of(" \t\r");
+			if (begin == std::string::npos)
+			{
+				return std::string();
+			}
+			std::string::size_type end = text.find_last_not_of(" \t\r");
+			return text.substr(begin, end - begin + 1);
+		}
+
+		// Reads the white-space separated values of a text,
+		// which must contain at least one value.
+		template <typename Type>
+		bool parseValues(const std::string& text, std::vector<Type>& valueSet)
+		{
+			std::istringstream stream(text);
+			std::vector<Type> result;
+			Type value;
+			while (stream >> value)
+			{
+				result.push_back(value);
+			}
+			if (!stream.eof() || result.empty())
+			{
+				return false;
+			}
+			valueSet.swap(result);
+			return true;
+		}
+
+		template <typename Type>
+		bool parseValue(const std::string& text, Type& value)
+		{
+			std::vector<Type> valueSet;
+			if (!parseValues(text, valueSet) || valueSet.size() != 1)
+			{
+				return false;
+			}
+			value = valueSet.front();
+			return true;
+		}
+
+		// Reads the ranges "a b w; c d v; ...", where [a, b] are
+		// the 1-based signals of a marginal, and w its weight.
+		bool parseRanges(const std::string& text, std::vector<Integer3>& rangeSet)
+		{
+			std::vector<Integer3> result;
+			std::istringstream stream(text);
+			std::string item;
+			while (std::getline(stream, item, ';'))
+			{
+				std::vector<integer> valueSet;
+				if (!parseValues(item, valueSet) || valueSet.size() != 3)
+				{
+					return false;
+				}
+				result.push_back(Integer3(valueSet[0] - 1, valueSet[1], valueSet[2]));
+			}
+			if (result.empty())
+			{
+				return false;
+			}
+			rangeSet.swap(result);
+			return true;
+		}
+
+		// Sets an option of a job; returns whether the key
+		// was known and the value valid.
+		bool setOption(
+			Job& job, const std::string& key, const std::string& value)
+		{
+			if (key == "estimator")
+			{
+				job.estimator = value;
+				return findEstimator(value) != nullptr;
+			}
+			if (key == "signal")
+			{
+				job.signalSet.emplace_back();
+				return parseValues(value, job.signalSet.back());
+			}
+			if (key == "output")
+			{
+				job.output = value;
+				return !value.empty();
+			}
+			if (key == "ranges")
+			{
+				return parseRanges(value, job.rangeSet);
+			}
+			if (key == "lags")
+			{
+				return parseValues(value, job.lagSet);
+			}
+			if (key == "k")
+			{
+				return parseValue(value, job.kNearest) && job.kNearest > 0;
+			}
+			if (key == "max_relative_error")
+			{
+				return parseValue(value, job.maxRelativeError) && job.maxRelativeError >= 0;
+			}
+			if (key == "time_window_radius")
+			{
+				return parseValue(value, job.timeWindowRadius) && job.timeWindowRadius >= 0;
+			}
+			if (key == "filter")
+			{
+				return parseValues(value, job.filter) && odd(job.filter.size());
+			}
+			if (key == "hop")
+			{
+				return parseValue(value, job.hop.hop) && job.hop.hop > 0;
+			}
+			if (key == "refine_threshold")
+			{
+				return parseValue(value, job.hop.refineThreshold) && job.hop.refineThreshold >= 0;
+			}
+			if (key == "fill")
+			{
+				integer fill = 0;
+				if (!parseValue(value, fill) || (fill != 0 && fill != 1))
+				{
+					return false;
+				}
+				job.hop.fill = (fill == 1);
+				return true;
+			}
+			if (key == "q")
+			{
+				return parseValue(value, job.q) && job.q > 0;
+			}
+			if (key == "k_suggestion")
+			{
+				return parseValue(value, job.kNearestSuggestion) && job.kNearestSuggestion >= 0;
+			}
+			if (key == "swept_signal")
+			{
+				// The signals are 1-based in the job file.
+				bool valid = parseValue(value, job.sweptSignal) && job.sweptSignal > 0;
+				--job.sweptSignal;
+				return valid;
+			}
+			if (key == "sweep")
+			{
+				return parseValues(value, job.sweepSet);
+			}
+			return false;
+		}
+
+		// Checks that a job has the options its estimator needs,
+		// and fills in the defaults which depend on the signals.
+		bool completeJob(Job& job, std::string& error)
+		{
+			const Estimator* estimator = findEstimator(job.estimator);
+			if (!estimator)
+			{
+				error = "the estimator is missing.";
+				return false;
+			}
+
+			integer signals = job.signalSet.size();
+			if (signals == 0 ||
+				(estimator->signals > 0 && signals != estimator->signals))
+			{
+				error = "the number of signals does not match the estimator.";
+				return false;
+			}
+
+			if (job.output.empty())
+			{
+				error = "the output is missing.";
+				return false;
+			}
+
+			if (job.lagSet.empty())
+			{
+				job.lagSet.assign(signals, 0);
+			}
+			if ((integer)job.lagSet.size() != signals)
+			{
+				error = "the number of lags does not match the number of signals.";
+				return false;
+			}
+
+			if (estimator->ranges)
+			{
+				if (job.rangeSet.empty())
+				{
+					error = "the ranges are missing.";
+					return false;
+				}
+				for (const Integer3& range : job.rangeSet)
+				{
+					if (range[0] < 0 || range[0] >= range[1] || range[1] > signals)
+					{
+						error = "a range is outside the signals.";
+						return false;
+					}
+				}
+			}
+
+			if (estimator->temporal && job.timeWindowRadius < 0)
+			{
+				error = "the time_window_radius is missing.";
+				return false;
+			}
+
+			if (estimator->sweep)
+			{
+				if (job.sweptSignal < 0 || job.sweptSignal >= signals ||
+					job.sweepSet.empty())
+				{
+					error = "the swept_signal or the sweep is missing.";
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		// Reads a CSV file, whose rows are the samples.
+		bool readCsv(
+			const std::string& fileName,
+			std::list<SignalData>& dataSet,
+			std::string& error)
+		{
+			std::ifstream file(fileName);
+			if (!file)
+			{
+				error = "can not open " + fileName + ".";
+				return false;
+			}
+
+			std::vector<dreal> valueSet;
+			integer dimension = 0;
+			integer samples = 0;
+			std::string line;
+			while (std::getline(file, line))
+			{
+				std::replace(line.begin(), line.end(), ',', ' ');
+				line = trim(line);
+				if (line.empty() || line[0] == '#')
+				{
+					continue;
+				}
+
+				std::vector<dreal> rowSet;
+				if (!parseValues(line, rowSet) ||
+					(samples > 0 && (integer)rowSet.size() != dimension))
+				{
+					error = fileName + ":" + std::to_string(samples + 1) +
+						": invalid sample.";
+					return false;
+				}
+				dimension = rowSet.size();
+				valueSet.insert(valueSet.end(), rowSet.begin(), rowSet.end());
+				++samples;
+			}
+
+			dataSet.emplace_back(dimension, samples);
+			std::copy(valueSet.begin(), valueSet.end(),
+				dataSet.back().data().data());
+			return true;
+		}
+
+		// Reads the signals of a job. The mapped files and the
+		// CSV data are stored in 'mappedSet' and 'dataSet', which
+		// must outlive the returned signals.
+		bool readSignals(
+			const Job& job,
+			std::list<MappedSignals>& mappedSet,
+			std::list<SignalData>& dataSet,
+			Array<Signal>& signalSet,
+			std::string& error)
+		{
+			integer signals = job.signalSet.size();
+
+			std::vector<std::vector<Signal>> trialSet(signals);
+			for (integer i = 0;i < signals;++i)
+			{
+				for (const std::string& fileName : job.signalSet[i])
+				{
+					bool csv = fileName.size() >= 4 &&
+						fileName.compare(fileName.size() - 4, 4, ".csv") == 0;
+					if (csv)
+					{
+						if (!readCsv(fileName, dataSet, error))
+						{
+							return false;
+						}
+						trialSet[i].push_back((Signal)dataSet.back());
+					}
+					else
+					{
+						// MappedSignals checks its file by ENSURE; an
+						// input which can not be opened is reported
+						// as an error of the job instead.
+						if (!std::ifstream(fileName))
+						{
+							error = "can not open " + fileName + ".";
+							return false;
+						}
+
+						mappedSet.emplace_back(fileName);
+						const MappedSignals& mapped = mappedSet.back();
+						for (integer j = 0;j < mapped.trials();++j)
+						{
+							trialSet[i].push_back(mapped.signal(j));
+						}
+					}
+				}
+
+				if (trialSet[i].size() != trialSet[0].size() ||
+					trialSet[i].empty())
+				{
+					error = "the signals have different numbers of trials.";
+					return false;
+				}
+			}
+
+			integer trials = trialSet[0].size();
+			signalSet = Array<Signal>(Vector2i(trials, signals));
+			for (integer y = 0;y < signals;++y)
+			{
+				for (integer x = 0;x < trials;++x)
+				{
+					signalSet(x, y) = trialSet[y][x];
+				}
+			}
+
+			return true;
+		}
+
+	}
+
+	bool readJobFile(
+		const std::string& fileName,
+		std::vector<Job>& jobSet,
+		std::string& error)
+	{
+		std::ifstream file(fileName);
+		if (!file)
+		{
+			error = "can not open " + fileName + ".";
+			return false;
+		}
+
+		std::vector<Job> result;
+		bool inJob = false;
+
+		auto endJob = [&]()
+		{
+			if (!inJob)
+			{
+				return true;
+			}
+			std::string jobError;
+			if (!completeJob(result.back(), jobError))
+			{
+				error = result.back().source + ": " + jobError;
+				return false;
+			}
+			return true;
+		};
+
+		std::string line;
+		integer lineNumber = 0;
+		while (std::getline(file, line))
+		{
+			++lineNumber;
+
+			std::string::size_type comment = line.find('#');
+			if (comment != std::string::npos)
+			{
+				line.erase(comment);
+			}
+			line = trim(line);
+			if (line.empty())
+			{
+				continue;
+			}
+
+			std::string source = fileName + ":" + std::to_string(lineNumber);
+
+			if (line == "[job]")
+			{
+				if (!endJob())
+				{
+					return false;
+				}
+				result.emplace_back();
+				result.back().source = source;
+				inJob = true;
+				continue;
+			}
+
+			std::string::size_type equals = line.find('=');
+			if (!inJob || equals == std::string::npos)
+			{
+				error = source + ": expected [job] or key = value.";
+				return false;
+			}
+
+			std::string key = trim(line.substr(0, equals));
+			std::string value = trim(line.substr(equals + 1));
+			if (!setOption(result.back(), key, value))
+			{
+				error = source + ": invalid " + key + ".";
+				return false;
+			}
+		}
+
+		if (!endJob())
+		{
+			return false;
+		}
+
+		jobSet.insert(jobSet.end(), result.begin(), result.end());
+		return true;
+	}
+
+	bool runJob(const Job& job, std::string& error)
+	{
+		const Estimator* estimator = findEstimator(job.estimator);
+		ENSURE(estimator);
+
+		std::list<MappedSignals> mappedSet;
+		std::list<SignalData> dataSet;
+		Array<Signal> signalSet;
+
+		if (!readSignals(job, mappedSet, dataSet, signalSet, error))
+		{
+			return false;
+		}
+
+		SignalData estimate = estimator->estimate(job, signalSet);
+
+		// The temporal estimators give their estimates as a
+		// column; all the estimates are written as one
+		// 1-dimensional trial.
+		Signal trial(
+			MatrixView<dreal>(estimate.data().data(), 1, 
+				estimate.dimension() * estimate.samples()),
+			estimate.t());
+
+		writeSignalFile(job.output, std::vector<Signal>(1, trial));
+		return true;
+	}
+
+	std::vector<std::string> estimatorNames()
+	{
+		std::vector<std::string> nameSet;
+		for (const Estimator& estimator : estimatorSet)
+		{
+			nameSet.push_back(estimator.name);
+		}
+		return nameSet;
+	}
+
+}
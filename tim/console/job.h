@@ -0,0 +1,76 @@
+// Description: Batch jobs of TIM Console
+// Detail: Reads job files, and runs the estimators they describe
+// Documentation: tim_console.txt
+
+#ifndef TIM_JOB_H
+#define TIM_JOB_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/temporal_hop.h"
+
+#include <string>
+#include <vector>
+
+namespace Tim
+{
+
+	//! An estimation described in a job file.
+	/*!
+	The signals, ranges and signal indices are those
+	of the job file converted to TIM Core; see
+	tim_console.txt for their form in the job file.
+	*/
+	struct Job
+	{
+		//! The position of the job, as "file:line".
+		std::string source;
+
+		//! The name of the estimator.
+		std::string estimator;
+
+		//! The files of the trials of each signal.
+		std::vector<std::vector<std::string>> signalSet;
+
+		//! The file to write the estimate to.
+		std::string output;
+
+		std::vector<Integer3> rangeSet;
+		std::vector<integer> lagSet;
+		integer kNearest = 1;
+		dreal maxRelativeError = 0;
+		integer timeWindowRadius = -1;
+		std::vector<dreal> filter = std::vector<dreal>(1, 1);
+		TemporalHop hop;
+		dreal q = 2;
+		integer kNearestSuggestion = 0;
+		integer sweptSignal = -1;
+		std::vector<integer> sweepSet;
+	};
+
+	//! Reads the jobs of a job file.
+	/*!
+	Returns:
+	Whether the file was read, and its jobs were valid.
+	The jobs are appended to 'jobSet'. Otherwise 'error'
+	describes the first problem, and 'jobSet' is left
+	unchanged.
+	*/
+	bool readJobFile(
+		const std::string& fileName,
+		std::vector<Job>& jobSet,
+		std::string& error);
+
+	//! Runs a job, and writes its estimate.
+	/*!
+	Returns:
+	Whether the signals were read, and the estimate was
+	written. Otherwise 'error' describes the problem.
+	*/
+	bool runJob(const Job& job, std::string& error);
+
+	//! Returns the names of the estimators.
+	std::vector<std::string> estimatorNames();
+
+}
+
+#endif
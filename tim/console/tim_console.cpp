@@ -0,0 +1,137 @@
+// Description: TIM Console
+// Detail: Runs the jobs of job files in parallel, without Matlab
+// Documentation: tim_console.txt
+
+#include "tim/console/job.h"
+
+#include <tbb/parallel_for_each.h>
+#include <tbb/task_arena.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace Tim;
+
+namespace
+{
+
+	void printUsage()
+	{
+		std::cerr << "Usage: tim [--threads n] job-file..." << std::endl;
+		std::cerr << std::endl;
+		std::cerr << "Runs the jobs of the job files in parallel. The estimators are:" << std::endl;
+		for (const std::string& name : estimatorNames())
+		{
+			std::cerr << "  " << name << std::endl;
+		}
+	}
+
+}
+
+int main(int argc, char* argv[])
+{
+	integer threads = tbb::task_arena::automatic;
+	std::vector<std::string> fileSet;
+
+	for (integer i = 1;i < argc;++i)
+	{
+		std::string argument = argv[i];
+		if (argument == "--threads" && i + 1 < argc)
+		{
+			threads = std::atoi(argv[++i]);
+			if (threads <= 0)
+			{
+				printUsage();
+				return 1;
+			}
+		}
+		else if (argument == "--help" || argument == "-h")
+		{
+			printUsage();
+			return 0;
+		}
+		else
+		{
+			fileSet.push_back(argument);
+		}
+	}
+
+	if (fileSet.empty())
+	{
+		printUsage();
+		return 1;
+	}
+
+	// All the job files are read before running any job,
+	// so that an error in one does not abort a long batch
+	// half-way.
+
+	std::vector<Job> jobSet;
+	for (const std::string& fileName : fileSet)
+	{
+		std::string error;
+		if (!readJobFile(fileName, jobSet, error))
+		{
+			std::cerr << "Error: " << error << std::endl;
+			return 1;
+		}
+	}
+
+	// The jobs, and the parallelism within each estimator,
+	// share the threads of one arena.
+
+	std::mutex outputMutex;
+	integer failed = 0;
+
+	auto run = [&](const Job& job)
+	{
+		auto begin = std::chrono::steady_clock::now();
+
+		// An exception, such as a failed precondition of an
+		// estimator, is an error of this job only; the other
+		// jobs still run.
+		std::string error;
+		bool succeeded = false;
+		try
+		{
+			succeeded = runJob(job, error);
+		}
+		catch (const std::exception& e)
+		{
+			error = e.what();
+		}
+		catch (...)
+		{
+			error = "unknown error.";
+		}
+
+		std::chrono::duration<double> seconds =
+			std::chrono::steady_clock::now() - begin;
+
+		std::lock_guard<std::mutex> lock(outputMutex);
+		if (succeeded)
+		{
+			std::cout << job.source << ": " << job.estimator
+				<< " -> " << job.output
+				<< " (" << seconds.count() << " s)" << std::endl;
+		}
+		else
+		{
+			std::cerr << "Error: " << job.source << ": " << error << std::endl;
+			++failed;
+		}
+	};
+
+	tbb::task_arena arena(threads);
+	arena.execute([&]()
+	{
+		tbb::parallel_for_each(jobSet.begin(), jobSet.end(), run);
+	});
+
+	return (failed > 0) ? 1 : 0;
+}
@@ -0,0 +1,402 @@
+#include "tim/core/brute_force_set.h"
+#include "tim/core/instrumentation.h"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Tim
+{
+
+	BruteForceSet::BruteForceSet()
+		: n_(0)
+		, metric_(Metric::Maximum)
+		, coordinateSet_()
+		, pointSet_()
+		, visibleSet_()
+		, blockVisibleSet_()
+		, visible_(0)
+		, instrumentation_(nullptr)
+	{
+	}
+
+	BruteForceSet::BruteForceSet(
+		const std::vector<const dreal*>& pointSet,
+		integer dimension,
+		Metric metric)
+		: n_(dimension)
+		, metric_(metric)
+		, coordinateSet_()
+		, pointSet_(pointSet)
+		, visibleSet_()
+		, blockVisibleSet_()
+		, visible_(0)
+		, instrumentation_(nullptr)
+	{
+		ENSURE_OP(dimension, >=, 0);
+
+		integer points = pointSet.size();
+
+		coordinateSet_.resize(points * n_);
+		for (integer begin = 0;begin < points;begin += BlockSize)
+		{
+			integer count = std::min(points - begin, BlockSize);
+			sreal* coordinate = coordinateSet_.data() + begin * n_;
+			for (integer i = 0;i < count;++i)
+			{
+				const dreal* point = pointSet[begin + i];
+				for (integer j = 0;j < n_;++j)
+				{
+					coordinate[j * count + i] = (sreal)point[j];
+				}
+			}
+		}
+
+		visibleSet_.assign(points, true);
+		blockVisibleSet_.resize((points + BlockSize - 1) / BlockSize);
+		show();
+	}
+
+	BruteForceSet::BruteForceSet(BruteForceSet&& that)
+		: BruteForceSet()
+	{
+		swap(that);
+	}
+
+	BruteForceSet& BruteForceSet::operator=(BruteForceSet that)
+	{
+		swap(that);
+		return *this;
+	}
+
+	void BruteForceSet::swap(BruteForceSet& that)
+	{
+		std::swap(n_, that.n_);
+		std::swap(metric_, that.metric_);
+		coordinateSet_.swap(that.coordinateSet_);
+		pointSet_.swap(that.pointSet_);
+		visibleSet_.swap(that.visibleSet_);
+		blockVisibleSet_.swap(that.blockVisibleSet_);
+		std::swap(visible_, that.visible_);
+	}
+
+	void BruteForceSet::setInstrumentation(Instrumentation* instrumentation)
+	{
+		instrumentation_ = instrumentation;
+	}
+
+	integer BruteForceSet::n() const
+	{
+		return n_;
+	}
+
+	Metric BruteForceSet::metric() const
+	{
+		return metric_;
+	}
+
+	integer BruteForceSet::points() const
+	{
+		return visible_;
+	}
+
+	integer BruteForceSet::size() const
+	{
+		return pointSet_.size();
+	}
+
+	void BruteForceSet::hide(integer i)
+	{
+		PENSURE_OP(i, >=, 0);
+		PENSURE_OP(i, <, size());
+
+		if (!visibleSet_[i])
+		{
+			return;
+		}
+
+		visibleSet_[i] = false;
+		--blockVisibleSet_[i / BlockSize];
+		--visible_;
+	}
+
+	void BruteForceSet::show(integer i)
+	{
+		PENSURE_OP(i, >=, 0);
+		PENSURE_OP(i, <, size());
+
+		if (visibleSet_[i])
+		{
+			return;
+		}
+
+		visibleSet_[i] = true;
+		++blockVisibleSet_[i / BlockSize];
+		++visible_;
+	}
+
+	void BruteForceSet::hide()
+	{
+		std::fill(visibleSet_.begin(), visibleSet_.end(), false);
+		std::fill(blockVisibleSet_.begin(), blockVisibleSet_.end(), (integer)0);
+		visible_ = 0;
+	}
+
+	void BruteForceSet::show()
+	{
+		std::fill(visibleSet_.begin(), visibleSet_.end(), true);
+
+		integer points = size();
+		for (integer b = 0;b < (integer)blockVisibleSet_.size();++b)
+		{
+			blockVisibleSet_[b] = std::min(points - b * BlockSize, BlockSize);
+		}
+		visible_ = points;
+	}
+
+	void BruteForceSet::hide(integer begin, integer end)
+	{
+		setVisible(begin, end, false);
+	}
+
+	void BruteForceSet::show(integer begin, integer end)
+	{
+		setVisible(begin, end, true);
+	}
+
+	integer BruteForceSet::countRange(
+		const dreal* query,
+		dreal maxDistance) const
+	{
+		PENSURE_OP(maxDistance, >=, 0);
+
+		integer points = size();
+		integer result = 0;
+
+		dreal distanceSet[BlockSize];
+		for (integer begin = 0;begin < points;begin += BlockSize)
+		{
+			if (blockVisibleSet_[begin / BlockSize] == 0)
+			{
+				continue;
+			}
+
+			integer count = std::min(points - begin, BlockSize);
+
+			// A block counts as a node.
+			TIM_COUNT(instrumentation_, nodesVisited, 1);
+			TIM_COUNT(instrumentation_, distances, count);
+
+			if (metric_ == Metric::Maximum)
+			{
+				result += scanCount(
+					coordinateSet_.data() + begin * n_,
+					visibleSet_.data() + begin,
+					count, n_, query, maxDistance);
+				continue;
+			}
+
+			// The square is rounded up, so that the distances
+			// are compared after taking the square root.
+			dreal bound = std::nextafter(
+				maxDistance * maxDistance, infinity<dreal>());
+			scan(begin, count, query, bound, distanceSet);
+			for (integer i = 0;i < count;++i)
+			{
+				result += (visibleSet_[begin + i] && 
+					distanceSet[i] < bound &&
+					std::sqrt(distanceSet[i]) < maxDistance);
+			}
+		}
+
+		return result;
+	}
+
+	dreal BruteForceSet::searchNearest(
+		const dreal* query,
+		integer kNearest,
+		const dreal* exclude) const
+	{
+		return searchNearest(query, kNearest, exclude,
+			[](dreal, const dreal*) {});
+	}
+
+	void BruteForceSet::searchAllNearest(
+		const std::vector<const dreal*>& querySet,
+		integer kNearest,
+		bool excludeQuery,
+		dreal* distanceSet,
+		integer* neighborSet) const
+	{
+		ENSURE_OP(kNearest, >, 0);
+
+		integer queries = querySet.size();
+
+		using Block = tbb::blocked_range<integer>;
+
+		auto search = [&](const Block& block)
+		{
+			std::vector<Neighbor> queryNeighborSet(kNearest);
+			for (integer i = block.begin();i < block.end();++i)
+			{
+				const dreal* query = querySet[i];
+				integer neighbors = searchIndices(
+					query, kNearest,
+					excludeQuery ? query : nullptr,
+					queryNeighborSet.data());
+
+				distanceSet[i] = (neighbors < kNearest) ?
+					infinity<dreal>() :
+					queryNeighborSet[kNearest - 1].distance;
+
+				if (neighborSet)
+				{
+					integer* neighborBegin = neighborSet + i * kNearest;
+					for (integer r = 0;r < kNearest;++r)
+					{
+						neighborBegin[r] = (r < neighbors) ?
+							queryNeighborSet[r].index : -1;
+					}
+				}
+			}
+		};
+
+		tbb::parallel_for(Block(0, queries), search);
+	}
+
+	// Private
+
+	integer BruteForceSet::searchIndices(
+		const dreal* query,
+		integer kNearest,
+		const dreal* exclude,
+		Neighbor* neighborSet) const
+	{
+		integer points = size();
+		integer neighbors = 0;
+
+		// The scan is cut short for the points which are
+		// not nearer than the current k:th neighbor.
+		dreal bound = infinity<dreal>();
+
+		dreal distanceSet[BlockSize];
+		for (integer begin = 0;begin < points;begin += BlockSize)
+		{
+			if (blockVisibleSet_[begin / BlockSize] == 0)
+			{
+				continue;
+			}
+
+			integer count = std::min(points - begin, BlockSize);
+			TIM_COUNT(instrumentation_, nodesVisited, 1);
+			TIM_COUNT(instrumentation_, distances, count);
+
+			scan(begin, count, query, bound, distanceSet);
+
+			for (integer i = 0;i < count;++i)
+			{
+				integer index = begin + i;
+				if (!(distanceSet[i] < bound) ||
+					!visibleSet_[index] ||
+					pointSet_[index] == exclude)
+				{
+					continue;
+				}
+
+				offer(neighborSet, neighbors, kNearest, distanceSet[i], index);
+				if (neighbors == kNearest)
+				{
+					bound = neighborSet[kNearest - 1].distance;
+				}
+			}
+		}
+
+		if (metric_ == Metric::Euclidean)
+		{
+			for (integer i = 0;i < neighbors;++i)
+			{
+				neighborSet[i].distance = std::sqrt(neighborSet[i].distance);
+			}
+		}
+
+		return neighbors;
+	}
+
+	void BruteForceSet::offer(
+		Neighbor* neighborSet,
+		integer& neighbors,
+		integer kNearest,
+		dreal distance,
+		integer index)
+	{
+		if (neighbors == kNearest)
+		{
+			if (distance >= neighborSet[kNearest - 1].distance)
+			{
+				return;
+			}
+			--neighbors;
+		}
+
+		// Insert in ascending order of distance.
+
+		integer j = neighbors;
+		while (j > 0 && neighborSet[j - 1].distance > distance)
+		{
+			neighborSet[j] = neighborSet[j - 1];
+			--j;
+		}
+		neighborSet[j] = Neighbor{distance, index};
+		++neighbors;
+	}
+
+	void BruteForceSet::scan(
+		integer begin,
+		integer count,
+		const dreal* query,
+		dreal bound,
+		dreal* distanceSet) const
+	{
+		const sreal* coordinateSet = coordinateSet_.data() + begin * n_;
+		if (metric_ == Metric::Euclidean)
+		{
+			scanSquaredDistances(coordinateSet, count, n_, query, bound, distanceSet);
+		}
+		else
+		{
+			scanDistances(coordinateSet, count, n_, query, bound, distanceSet);
+		}
+	}
+
+	void BruteForceSet::setVisible(integer begin, integer end, bool visible)
+	{
+		PENSURE_OP(begin, >=, 0);
+		PENSURE_OP(begin, <=, end);
+		PENSURE_OP(end, <=, size());
+
+		// Update the points a block at a time, so that each
+		// block counter, and the total, is updated once.
+
+		integer changed = 0;
+		for (integer i = begin;i < end;)
+		{
+			integer block = i / BlockSize;
+			integer blockEnd = std::min((block + 1) * BlockSize, end);
+
+			integer blockChanged = 0;
+			for (;i < blockEnd;++i)
+			{
+				blockChanged += (bool)visibleSet_[i] != visible;
+				visibleSet_[i] = visible;
+			}
+
+			blockVisibleSet_[block] += visible ? blockChanged : -blockChanged;
+			changed += blockChanged;
+		}
+
+		visible_ += visible ? changed : -changed;
+	}
+
+}
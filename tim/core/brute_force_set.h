@@ -0,0 +1,247 @@
+// Description: BruteForceSet class
+// Detail: A point set which is searched by scanning all of its points
+// Documentation: brute_force_set.txt
+
+#ifndef TIM_BRUTE_FORCE_SET_H
+#define TIM_BRUTE_FORCE_SET_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/instrumentation.h"
+#include "tim/core/leaf_scan.h"
+
+#include <vector>
+
+namespace Tim
+{
+
+	//! A point set searched by a linear scan
+	/*!
+	The coordinates of the points are copied into blocks
+	of BlockSize points, each in structure-of-arrays form,
+	so that every query is a linear sweep over memory by the
+	kernels of leaf_scan.h. In high dimensions, where spatial
+	subdivision no longer prunes, this is the fastest way to
+	search; it has the same interface as PackedKdTree.
+
+	The points can be hidden and shown individually, or as
+	a range in one pass over the range. Each block
+	maintains its number of visible points, so that
+	blocks without visible points are skipped. The 
+	coordinates are stored as sreal; the distances are
+	those of the stored coordinates.
+	*/
+	class TIM BruteForceSet
+	{
+	public:
+		//! The number of points in a block.
+		static constexpr integer BlockSize = 64;
+
+		//! Constructs an empty set.
+		BruteForceSet();
+
+		//! Constructs a set over the given points.
+		/*!
+		Preconditions:
+		dimension >= 0
+
+		pointSet:
+		Pointers to the coordinates of the points. Each
+		pointer identifies its point; the queries report
+		the neighbors by these pointers. The i:th point
+		is referred to by the index i in hide() and show().
+
+		dimension:
+		The number of coordinates to copy from each point.
+
+		metric:
+		The norm in which the distances are measured.
+
+		Initially all points are visible.
+		*/
+		BruteForceSet(
+			const std::vector<const dreal*>& pointSet,
+			integer dimension,
+			Metric metric = Metric::Maximum);
+
+		BruteForceSet(const BruteForceSet& that) = default;
+		BruteForceSet(BruteForceSet&& that);
+		BruteForceSet& operator=(BruteForceSet that);
+
+		//! Swaps two sets.
+		void swap(BruteForceSet& that);
+
+		//! Sets the instrumentation which counts the searches.
+		/*!
+		The instrumentation can be null, which counts nothing.
+		*/
+		void setInstrumentation(Instrumentation* instrumentation);
+
+		//! Returns the dimension of the points.
+		integer n() const;
+
+		//! Returns the norm in which the distances are measured.
+		Metric metric() const;
+
+		//! Returns the number of visible points.
+		integer points() const;
+
+		//! Returns the number of points, visible or hidden.
+		integer size() const;
+
+		//! Hides the i:th point.
+		void hide(integer i);
+
+		//! Shows the i:th point.
+		void show(integer i);
+
+		//! Hides all points.
+		void hide();
+
+		//! Shows all points.
+		void show();
+
+		//! Hides the points [begin, end[.
+		/*!
+		Preconditions:
+		0 <= begin <= end <= size()
+		*/
+		void hide(integer begin, integer end);
+
+		//! Shows the points [begin, end[.
+		/*!
+		Preconditions:
+		0 <= begin <= end <= size()
+		*/
+		void show(integer begin, integer end);
+
+		//! Counts the visible points inside an open ball.
+		/*!
+		Preconditions:
+		maxDistance >= 0
+
+		Returns:
+		The number of visible points whose distance
+		to the query is less than maxDistance.
+		*/
+		integer countRange(
+			const dreal* query,
+			dreal maxDistance) const;
+
+		//! Finds the k nearest visible points.
+		/*!
+		Preconditions:
+		kNearest > 0
+
+		See PackedKdTree::searchNearest(). The search
+		is always exact.
+		*/
+		template <typename Report>
+		dreal searchNearest(
+			const dreal* query,
+			integer kNearest,
+			const dreal* exclude,
+			Report&& report) const;
+
+		//! Finds the distance to the k:th nearest visible point.
+		dreal searchNearest(
+			const dreal* query,
+			integer kNearest,
+			const dreal* exclude = nullptr) const;
+
+		//! Finds the k nearest visible points of a set of queries.
+		/*!
+		Preconditions:
+		kNearest > 0
+
+		See PackedKdTree::searchAllNearest(). The queries
+		are searched in parallel.
+		*/
+		void searchAllNearest(
+			const std::vector<const dreal*>& querySet,
+			integer kNearest,
+			bool excludeQuery,
+			dreal* distanceSet,
+			integer* neighborSet = nullptr) const;
+
+	private:
+		struct Neighbor
+		{
+			dreal distance;
+			integer index;
+		};
+
+		// Finds the k nearest visible points, and stores them
+		// in ascending order of distance into neighborSet,
+		// which has room for kNearest neighbors. Returns the
+		// number of neighbors found.
+		integer searchIndices(
+			const dreal* query,
+			integer kNearest,
+			const dreal* exclude,
+			Neighbor* neighborSet) const;
+
+		// Sets the visibility of the points [begin, end[.
+		void setVisible(integer begin, integer end, bool visible);
+
+		// Offers a neighbor candidate to a query, whose
+		// neighbors are kept in ascending order of distance.
+		static void offer(
+			Neighbor* neighborSet,
+			integer& neighbors,
+			integer kNearest,
+			dreal distance,
+			integer index);
+
+		// Computes the distances from the query to the
+		// points of a block, in the units compared in the
+		// scan: squared for the Euclidean metric.
+		void scan(
+			integer begin,
+			integer count,
+			const dreal* query,
+			dreal bound,
+			dreal* distanceSet) const;
+
+		/*
+		n_:
+		The dimension of the points.
+
+		metric_:
+		The norm in which the distances are measured.
+
+		coordinateSet_:
+		The coordinates of the points. The j:th coordinate
+		of the point begin + i of the block [begin, end[ is
+		stored at coordinateSet_[begin * n_ + j * (end - begin) + i].
+
+		pointSet_:
+		The identifying pointer of each point.
+
+		visibleSet_:
+		Whether each point is visible.
+
+		blockVisibleSet_:
+		The number of visible points in each block.
+
+		visible_:
+		The number of visible points.
+
+		instrumentation_:
+		The instrumentation which counts the searches, or null.
+		*/
+
+		integer n_;
+		Metric metric_;
+		std::vector<sreal> coordinateSet_;
+		std::vector<const dreal*> pointSet_;
+		std::vector<char> visibleSet_;
+		std::vector<integer> blockVisibleSet_;
+		integer visible_;
+		Instrumentation* instrumentation_;
+	};
+
+}
+
+#include "tim/core/brute_force_set.hpp"
+
+#endif
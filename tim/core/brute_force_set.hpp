@@ -0,0 +1,37 @@
+#ifndef TIM_BRUTE_FORCE_SET_HPP
+#define TIM_BRUTE_FORCE_SET_HPP
+
+#include "tim/core/brute_force_set.h"
+
+namespace Tim
+{
+
+	template <typename Report>
+	dreal BruteForceSet::searchNearest(
+		const dreal* query,
+		integer kNearest,
+		const dreal* exclude,
+		Report&& report) const
+	{
+		PENSURE_OP(kNearest, >, 0);
+
+		std::vector<Neighbor> neighborSet(kNearest);
+		integer neighbors = searchIndices(
+			query, kNearest, exclude, neighborSet.data());
+
+		for (integer i = 0;i < neighbors;++i)
+		{
+			report(neighborSet[i].distance, pointSet_[neighborSet[i].index]);
+		}
+
+		if (neighbors < kNearest)
+		{
+			return infinity<dreal>();
+		}
+
+		return neighborSet[kNearest - 1].distance;
+	}
+
+}
+
+#endif
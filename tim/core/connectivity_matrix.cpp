@@ -0,0 +1,740 @@
+#include "tim/core/connectivity_matrix.h"
+#include "tim/core/entropy_combination.h"
+#include "tim/core/entropy_combination_t.h"
+#include "tim/core/lagged_signal.h"
+#include "tim/core/signalpointset.h"
+
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_pipeline.h>
+#include <tbb/task_arena.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <utility>
+
+namespace Tim
+{
+
+	namespace
+	{
+
+		// A signal, by its row in the ensemble, with its lag.
+		using Component = std::pair<integer, integer>;
+
+		// A time interval [tBegin, tEnd[.
+		using Interval = std::pair<integer, integer>;
+
+		// An approximation of the bytes which a point set
+		// uses for each point, besides its coordinates.
+		const integer PointBytes = 64;
+
+		// An entry of a connectivity matrix.
+		struct Job
+		{
+			// The index of the entry in the matrix.
+			integer entry;
+
+			// The lagged signals, in the order of their
+			// dimensions in the joint signal.
+			std::vector<Component> componentSet;
+		};
+
+		// Returns the time interval on which all the lagged
+		// signals of all the trials are defined.
+		Interval timeInterval(
+			const Array<Signal>& signalSet,
+			const std::vector<Component>& componentSet)
+		{
+			Integer2 interval = sharedTimeInterval(signalSet,
+				ranges::views::keys(componentSet),
+				ranges::views::values(componentSet));
+			return Interval(interval[0], interval[1]);
+		}
+
+		// Returns the lagged signals of each trial.
+		std::vector<LaggedSignal> lagged(
+			const Array<Signal>& signalSet,
+			const std::vector<Component>& componentSet)
+		{
+			std::vector<LaggedSignal> result;
+			result.reserve(signalSet.width());
+			lagSignals(signalSet,
+				ranges::views::keys(componentSet),
+				std::back_inserter(result),
+				ranges::views::values(componentSet));
+			return result;
+		}
+
+		// Returns the dimension of the lagged signals.
+		integer dimension(
+			const Array<Signal>& signalSet,
+			const std::vector<Component>& componentSet)
+		{
+			integer result = 0;
+			for (const Component& component : componentSet)
+			{
+				result += signalSet(0, component.first).dimension();
+			}
+			return result;
+		}
+
+		// Returns an approximation of the bytes used by
+		// a packed point set with gathered coordinates,
+		// and the coordinate cache of its search structure.
+		integer pointSetBytes(integer points, integer dimension)
+		{
+			return points * (dimension *
+				(integer)(sizeof(dreal) + sizeof(sreal)) + PointBytes);
+		}
+
+		// Returns the number of jobs to run at the same time,
+		// when each uses 'jobBytes' and 'sharedBytes' are used
+		// by all of them.
+		integer concurrentJobs(
+			integer jobBytes,
+			integer sharedBytes,
+			integer maxMemory)
+		{
+			integer result = tbb::this_task_arena::max_concurrency();
+			if (maxMemory > 0 && jobBytes > 0)
+			{
+				result = std::min(result,
+					(maxMemory - sharedBytes) / jobBytes);
+			}
+			return std::max(result, (integer)1);
+		}
+
+		// Runs 'work' for each job, in parallel, so that at
+		// most 'tokens' jobs are in progress at the same time.
+		// The parallelism inside the jobs is stolen by the
+		// threads which wait for a token.
+		template <typename Work>
+		void runJobs(integer jobs, integer tokens, Work&& work)
+		{
+			integer next = 0;
+			tbb::parallel_pipeline(tokens,
+				tbb::make_filter<void, integer>(
+					tbb::filter_mode::serial_in_order,
+					[&](tbb::flow_control& control) -> integer
+					{
+						if (next == jobs)
+						{
+							control.stop();
+							return 0;
+						}
+						return next++;
+					}) &
+				tbb::make_filter<integer, void>(
+					tbb::filter_mode::parallel,
+					[&](integer i)
+					{
+						work(i);
+					}));
+		}
+
+		// Estimates entropy combinations which share their
+		// marginal point sets.
+		/*
+		jobSet:
+		The entries to estimate. The other entries are NaN.
+
+		rangeSet:
+		The marginals of each job, as in entropyCombination().
+
+		instrumentation:
+		Measures the phases and the searches of all the
+		jobs, or null.
+		*/
+		std::vector<dreal> estimateJobs(
+			const Array<Signal>& signalSet,
+			const std::vector<Job>& jobSet,
+			const std::vector<Integer3>& rangeSet,
+			integer kNearest,
+			integer maxMemory,
+			integer entries,
+			Instrumentation* instrumentation)
+		{
+			using Layout = SignalPointSet::Layout;
+			using Key = std::pair<std::vector<Component>, Interval>;
+
+			integer trials = signalSet.width();
+			integer jobs = jobSet.size();
+			integer marginals = rangeSet.size();
+
+			std::vector<dreal> result(entries, (dreal)Nan());
+
+			// Identify the distinct marginal point sets,
+			// by their lagged signals and by the time
+			// interval of their joint signal.
+
+			std::vector<Key> keySet;
+			std::map<Key, integer> keyIndex;
+			std::vector<integer> useSet;
+			std::vector<integer> keyBytesSet;
+			std::vector<Interval> intervalSet(jobs);
+			std::vector<std::vector<integer>> jobMarginalSet(jobs);
+			std::vector<std::vector<integer>> offsetSet(jobs);
+			integer jobBytes = 0;
+
+			for (integer i = 0;i < jobs;++i)
+			{
+				const std::vector<Component>& componentSet =
+					jobSet[i].componentSet;
+
+				intervalSet[i] = timeInterval(signalSet, componentSet);
+				const Interval& interval = intervalSet[i];
+				if (interval.first == interval.second)
+				{
+					// An entropy combination without
+					// samples is zero.
+					result[jobSet[i].entry] = 0;
+					continue;
+				}
+
+				std::vector<integer> dimensionSet(1, 0);
+				for (const Component& component : componentSet)
+				{
+					dimensionSet.push_back(dimensionSet.back() +
+						signalSet(0, component.first).dimension());
+				}
+
+				for (const Integer3& range : rangeSet)
+				{
+					Key key(
+						std::vector<Component>(
+							componentSet.begin() + range[0],
+							componentSet.begin() + range[1]),
+						interval);
+
+					auto iter = keyIndex.find(key);
+					if (iter == keyIndex.end())
+					{
+						keySet.push_back(key);
+						useSet.push_back(0);
+						keyBytesSet.push_back(pointSetBytes(
+							(interval.second - interval.first) * trials,
+							dimensionSet[range[1]] - dimensionSet[range[0]]));
+						iter = keyIndex.emplace(key, keySet.size() - 1).first;
+					}
+
+					++useSet[iter->second];
+					jobMarginalSet[i].push_back(iter->second);
+					offsetSet[i].push_back(dimensionSet[range[0]]);
+				}
+			}
+
+			// A marginal point set which is used by a single
+			// job is built by that job, and lives only while 
+			// the job runs. The others are shared by the jobs.
+
+			integer keys = keySet.size();
+			integer sharedBytes = 0;
+			for (integer i = 0;i < keys;++i)
+			{
+				if (useSet[i] > 1)
+				{
+					sharedBytes += keyBytesSet[i];
+				}
+			}
+
+			if (maxMemory > 0)
+			{
+				ENSURE_OP(sharedBytes, <=, maxMemory);
+			}
+
+			for (integer i = 0;i < jobs;++i)
+			{
+				const Interval& interval = intervalSet[i];
+				if (interval.first == interval.second)
+				{
+					continue;
+				}
+
+				integer bytes = pointSetBytes(
+					(interval.second - interval.first) * trials,
+					dimension(signalSet, jobSet[i].componentSet));
+				for (integer marginal : jobMarginalSet[i])
+				{
+					if (useSet[marginal] == 1)
+					{
+						bytes += keyBytesSet[marginal];
+					}
+				}
+
+				jobBytes = std::max(jobBytes, bytes);
+			}
+
+			// A marginal point set is built from its own lagged
+			// signals, and then restricted to the time interval
+			// of its joint signal; it then contains the same 
+			// points as the marginal of the joint point set.
+
+			auto buildMarginal = [&](integer i)
+			{
+				const Key& key = keySet[i];
+				SignalPointSet result(
+					lagged(signalSet, key.first),
+					Layout::Packed, Metric::Maximum,
+					instrumentation);
+				result.setTimeWindow(
+					key.second.first, key.second.second);
+				return result;
+			};
+
+			// Build the shared marginal point sets in parallel.
+
+			std::vector<SignalPointSet> marginalSet(keys);
+			tbb::parallel_for((integer)0, keys,
+				[&](integer i)
+				{
+					if (useSet[i] > 1)
+					{
+						marginalSet[i] = buildMarginal(i);
+					}
+				});
+
+			std::vector<integer> weightSet;
+			for (const Integer3& range : rangeSet)
+			{
+				weightSet.push_back(range[2]);
+			}
+
+			// Estimate the entries. The joint point set of an
+			// entry, and its own marginal point sets, only live 
+			// while the entry is estimated.
+
+			runJobs(jobs, concurrentJobs(jobBytes, sharedBytes, maxMemory),
+				[&](integer i)
+				{
+					const Interval& interval = intervalSet[i];
+					if (interval.first == interval.second)
+					{
+						return;
+					}
+
+					SignalPointSet jointPointSet(
+						lagged(signalSet, jobSet[i].componentSet),
+						Layout::Packed, Metric::Maximum,
+						instrumentation);
+
+					integer n = jointPointSet.end() - jointPointSet.begin();
+					std::vector<dreal> distanceSet(n);
+					{
+						TIM_PHASE(instrumentation, JointSearch);
+						jointPointSet.searchAllNearest(
+							kNearest, distanceSet.data());
+					}
+
+					std::vector<SignalPointSet> ownSet;
+					ownSet.reserve(marginals);
+
+					std::vector<const SignalPointSet*> pointSet;
+					pointSet.reserve(marginals);
+					for (integer marginal : jobMarginalSet[i])
+					{
+						if (useSet[marginal] > 1)
+						{
+							pointSet.push_back(&marginalSet[marginal]);
+						}
+						else
+						{
+							ownSet.push_back(buildMarginal(marginal));
+							pointSet.push_back(&ownSet.back());
+						}
+					}
+
+					result[jobSet[i].entry] =
+						Detail_EntropyCombination::combine(
+							jointPointSet, pointSet, offsetSet[i],
+							weightSet, distanceSet, kNearest);
+				});
+
+			return result;
+		}
+
+		// Estimates temporal entropy combinations.
+		/*
+		The entries which are not estimated are empty.
+		Otherwise as estimateJobs().
+		*/
+		std::vector<SignalData> estimateTemporalJobs(
+			const Array<Signal>& signalSet,
+			const std::vector<Job>& jobSet,
+			const std::vector<Integer3>& rangeSet,
+			integer timeWindowRadius,
+			integer kNearest,
+			const std::vector<dreal>& filter,
+			const TemporalHop& hop,
+			integer maxMemory,
+			integer entries,
+			Instrumentation* instrumentation)
+		{
+			integer trials = signalSet.width();
+			integer jobs = jobSet.size();
+
+			std::vector<SignalData> result(entries);
+			if (trials == 0)
+			{
+				return result;
+			}
+
+			// The joint point set is copied by each marginal
+			// as it slides in time.
+
+			integer jobBytes = 0;
+			for (const Job& job : jobSet)
+			{
+				Interval interval = timeInterval(signalSet, job.componentSet);
+				jobBytes = std::max(jobBytes,
+					pointSetBytes(
+						(interval.second - interval.first) * trials,
+						dimension(signalSet, job.componentSet)) *
+					(integer)(rangeSet.size() + 1));
+			}
+
+			runJobs(jobs, concurrentJobs(jobBytes, 0, maxMemory),
+				[&](integer i)
+				{
+					const Job& job = jobSet[i];
+					integer signals = job.componentSet.size();
+
+					Array<Signal> jointSet(Vector2i(trials, signals));
+					std::vector<integer> lagSet(signals);
+					for (integer y = 0;y < signals;++y)
+					{
+						for (integer x = 0;x < trials;++x)
+						{
+							jointSet(x, y) = signalSet(x, job.componentSet[y].first);
+						}
+						lagSet[y] = job.componentSet[y].second;
+					}
+
+					result[job.entry] = temporalEntropyCombination(
+						jointSet, rangeSet, timeWindowRadius,
+						lagSet, kNearest, filter, 1, hop,
+						0, nullptr, instrumentation);
+				});
+
+			return result;
+		}
+
+		// Returns the ensemble with the rows of 'bottomSet'
+		// appended to the rows of 'topSet'.
+		Array<Signal> stack(
+			const Array<Signal>& topSet,
+			const Array<Signal>& bottomSet)
+		{
+			ENSURE_OP(bottomSet.width(), ==, topSet.width());
+
+			integer trials = topSet.width();
+			integer tops = topSet.height();
+			integer bottoms = bottomSet.height();
+
+			Array<Signal> result(Vector2i(trials, tops + bottoms));
+			for (integer x = 0;x < trials;++x)
+			{
+				for (integer y = 0;y < tops;++y)
+				{
+					result(x, y) = topSet(x, y);
+				}
+				for (integer y = 0;y < bottoms;++y)
+				{
+					result(x, tops + y) = bottomSet(x, y);
+				}
+			}
+
+			return result;
+		}
+
+		// Lists the entries of mutual information.
+		std::vector<Job> mutualInformationJobs(
+			integer n,
+			integer xLag, integer yLag,
+			bool symmetric)
+		{
+			symmetric = symmetric && (xLag == yLag);
+
+			std::vector<Job> jobSet;
+			for (integer i = 0;i < n;++i)
+			{
+				for (integer j = symmetric ? i : 0;j < n;++j)
+				{
+					if (i == j && xLag == yLag)
+					{
+						continue;
+					}
+
+					jobSet.push_back(Job{i * n + j,
+						{Component(i, xLag), Component(j, yLag)}});
+				}
+			}
+
+			return jobSet;
+		}
+
+		// Lists the entries of transfer entropy; the
+		// futures are at rows [n, 2n[.
+		std::vector<Job> transferEntropyJobs(
+			integer n,
+			integer xLag, integer yLag, integer wLag)
+		{
+			// The signals are in wXY order; see transferEntropy().
+
+			std::vector<Job> jobSet;
+			for (integer i = 0;i < n;++i)
+			{
+				for (integer j = 0;j < n;++j)
+				{
+					if (i == j)
+					{
+						continue;
+					}
+
+					jobSet.push_back(Job{i * n + j,
+						{Component(n + j, wLag), Component(j, xLag),
+						Component(i, yLag)}});
+				}
+			}
+
+			return jobSet;
+		}
+
+		// Lists the entries of partial mutual information;
+		// Z is at row n.
+		std::vector<Job> partialMutualInformationJobs(
+			integer n,
+			integer xLag, integer yLag, integer zLag,
+			bool symmetric)
+		{
+			// The signals are in XZY order; see
+			// partialMutualInformation().
+
+			symmetric = symmetric && (xLag == yLag);
+
+			std::vector<Job> jobSet;
+			for (integer i = 0;i < n;++i)
+			{
+				for (integer j = symmetric ? i : 0;j < n;++j)
+				{
+					if (i == j && xLag == yLag)
+					{
+						continue;
+					}
+
+					jobSet.push_back(Job{i * n + j,
+						{Component(i, xLag), Component(n, zLag),
+						Component(j, yLag)}});
+				}
+			}
+
+			return jobSet;
+		}
+
+		// Copies the estimates (i, j) to (j, i), for i < j.
+		template <typename Type>
+		void mirror(std::vector<Type>& result, integer n)
+		{
+			for (integer i = 0;i < n;++i)
+			{
+				for (integer j = i + 1;j < n;++j)
+				{
+					result[j * n + i] = result[i * n + j];
+				}
+			}
+		}
+
+		const std::vector<Integer3> MutualInformationRangeSet =
+		{
+			Integer3(0, 1, 1),
+			Integer3(1, 2, 1)
+		};
+
+		const std::vector<Integer3> ConditionalRangeSet =
+		{
+			Integer3(0, 2, 1),
+			Integer3(1, 3, 1),
+			Integer3(1, 2, -1)
+		};
+
+	}
+
+	std::vector<dreal> mutualInformationMatrix(
+		const Array<Signal>& signalSet,
+		integer xLag, integer yLag,
+		integer kNearest,
+		bool symmetric,
+		integer maxMemory,
+		Instrumentation* instrumentation)
+	{
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE_OP(maxMemory, >=, 0);
+
+		integer n = signalSet.height();
+
+		std::vector<dreal> result = estimateJobs(
+			signalSet,
+			mutualInformationJobs(n, xLag, yLag, symmetric),
+			MutualInformationRangeSet,
+			kNearest, maxMemory, n * n,
+			instrumentation);
+
+		if (symmetric && xLag == yLag)
+		{
+			mirror(result, n);
+		}
+
+		return result;
+	}
+
+	std::vector<dreal> transferEntropyMatrix(
+		const Array<Signal>& signalSet,
+		const Array<Signal>& futureSet,
+		integer xLag, integer yLag, integer wLag,
+		integer kNearest,
+		integer maxMemory,
+		Instrumentation* instrumentation)
+	{
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE_OP(maxMemory, >=, 0);
+		ENSURE_OP(futureSet.height(), ==, signalSet.height());
+
+		integer n = signalSet.height();
+
+		return estimateJobs(
+			stack(signalSet, futureSet),
+			transferEntropyJobs(n, xLag, yLag, wLag),
+			ConditionalRangeSet,
+			kNearest, maxMemory, n * n,
+			instrumentation);
+	}
+
+	std::vector<dreal> partialMutualInformationMatrix(
+		const Array<Signal>& signalSet,
+		const Array<Signal>& zSignalSet,
+		integer xLag, integer yLag, integer zLag,
+		integer kNearest,
+		bool symmetric,
+		integer maxMemory,
+		Instrumentation* instrumentation)
+	{
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE_OP(maxMemory, >=, 0);
+		ENSURE_OP(zSignalSet.height(), ==, 1);
+
+		integer n = signalSet.height();
+
+		std::vector<dreal> result = estimateJobs(
+			stack(signalSet, zSignalSet),
+			partialMutualInformationJobs(n, xLag, yLag, zLag, symmetric),
+			ConditionalRangeSet,
+			kNearest, maxMemory, n * n,
+			instrumentation);
+
+		if (symmetric && xLag == yLag)
+		{
+			mirror(result, n);
+		}
+
+		return result;
+	}
+
+	std::vector<SignalData> temporalMutualInformationMatrix(
+		const Array<Signal>& signalSet,
+		integer timeWindowRadius,
+		integer xLag, integer yLag,
+		integer kNearest,
+		const std::vector<dreal>& filter,
+		bool symmetric,
+		integer maxMemory,
+		const TemporalHop& hop,
+		Instrumentation* instrumentation)
+	{
+		ENSURE_OP(timeWindowRadius, >=, 0);
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE(odd(filter.size()));
+		ENSURE_OP(maxMemory, >=, 0);
+
+		integer n = signalSet.height();
+
+		std::vector<SignalData> result = estimateTemporalJobs(
+			signalSet,
+			mutualInformationJobs(n, xLag, yLag, symmetric),
+			MutualInformationRangeSet,
+			timeWindowRadius, kNearest, filter, hop,
+			maxMemory, n * n,
+			instrumentation);
+
+		if (symmetric && xLag == yLag)
+		{
+			mirror(result, n);
+		}
+
+		return result;
+	}
+
+	std::vector<SignalData> temporalTransferEntropyMatrix(
+		const Array<Signal>& signalSet,
+		const Array<Signal>& futureSet,
+		integer timeWindowRadius,
+		integer xLag, integer yLag, integer wLag,
+		integer kNearest,
+		const std::vector<dreal>& filter,
+		integer maxMemory,
+		const TemporalHop& hop,
+		Instrumentation* instrumentation)
+	{
+		ENSURE_OP(timeWindowRadius, >=, 0);
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE(odd(filter.size()));
+		ENSURE_OP(maxMemory, >=, 0);
+		ENSURE_OP(futureSet.height(), ==, signalSet.height());
+
+		integer n = signalSet.height();
+
+		return estimateTemporalJobs(
+			stack(signalSet, futureSet),
+			transferEntropyJobs(n, xLag, yLag, wLag),
+			ConditionalRangeSet,
+			timeWindowRadius, kNearest, filter, hop,
+			maxMemory, n * n,
+			instrumentation);
+	}
+
+	std::vector<SignalData> temporalPartialMutualInformationMatrix(
+		const Array<Signal>& signalSet,
+		const Array<Signal>& zSignalSet,
+		integer timeWindowRadius,
+		integer xLag, integer yLag, integer zLag,
+		integer kNearest,
+		const std::vector<dreal>& filter,
+		bool symmetric,
+		integer maxMemory,
+		const TemporalHop& hop,
+		Instrumentation* instrumentation)
+	{
+		ENSURE_OP(timeWindowRadius, >=, 0);
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE(odd(filter.size()));
+		ENSURE_OP(maxMemory, >=, 0);
+		ENSURE_OP(zSignalSet.height(), ==, 1);
+
+		integer n = signalSet.height();
+
+		std::vector<SignalData> result = estimateTemporalJobs(
+			stack(signalSet, zSignalSet),
+			partialMutualInformationJobs(n, xLag, yLag, zLag, symmetric),
+			ConditionalRangeSet,
+			timeWindowRadius, kNearest, filter, hop,
+			maxMemory, n * n,
+			instrumentation);
+
+		if (symmetric && xLag == yLag)
+		{
+			mirror(result, n);
+		}
+
+		return result;
+	}
+
+}
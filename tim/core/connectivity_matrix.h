@@ -0,0 +1,216 @@
+// Description: Connectivity matrices
+// Detail: All-pairs mutual information, transfer entropy and partial mutual information
+// Documentation: connectivity_matrix.txt
+
+#ifndef TIM_CONNECTIVITY_MATRIX_H
+#define TIM_CONNECTIVITY_MATRIX_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/signal.h"
+#include "tim/core/temporal_hop.h"
+#include "tim/core/instrumentation.h"
+
+#include <pastel/sys/array/array.h>
+
+#include <vector>
+
+namespace Tim
+{
+
+	//! Computes mutual information between all pairs of signals.
+	/*!
+	Preconditions:
+	kNearest > 0
+	maxMemory >= 0
+
+	signalSet:
+	An ensemble of signals representing trials of the
+	same experiment, as in entropyCombination(); the
+	y:th row contains the trials of the y:th channel.
+
+	xLag, yLag:
+	The lags of the first and the second signal of
+	each pair.
+
+	kNearest:
+	The k:th nearest neighbor to use in the estimation.
+
+	symmetric:
+	Whether to compute only one of the estimates (i, j)
+	and (j, i), and copy it to the other. This is done
+	only when xLag == yLag, in which case the estimates
+	are equal.
+
+	maxMemory:
+	An approximate bound, in bytes, for the memory used
+	by the shared marginal point sets, together with the
+	point sets of the pairs being estimated at the same 
+	time. The shared point sets must fit in the bound.
+	At least one pair is always estimated. Zero means no 
+	bound.
+
+	instrumentation:
+	If not null, measures the phases and the searches
+	of all the pairs. See instrumentation.txt.
+
+	Returns:
+	An n x n matrix in row-major order, where n is the
+	number of channels. The element i * n + j is the mutual
+	information between the i:th channel lagged by xLag and
+	the j:th channel lagged by yLag. The diagonal is NaN
+	when xLag == yLag.
+
+	The marginal point set of each lagged channel is built
+	only once, and shared by all the pairs. The joint point
+	set of each pair is built when the pair is estimated,
+	and freed when it is done. The pairs are estimated in
+	parallel, as many at a time as 'maxMemory' allows.
+	*/
+	TIM std::vector<dreal> mutualInformationMatrix(
+		const Array<Signal>& signalSet,
+		integer xLag = 0, integer yLag = 0,
+		integer kNearest = 1,
+		bool symmetric = true,
+		integer maxMemory = 0,
+		Instrumentation* instrumentation = nullptr);
+
+	//! Computes transfer entropy between all pairs of signals.
+	/*!
+	Preconditions:
+	kNearest > 0
+	maxMemory >= 0
+	futureSet.width() == signalSet.width()
+	futureSet.height() == signalSet.height()
+
+	futureSet:
+	The future of each signal in 'signalSet', such as
+	given by delayEmbedFuture().
+
+	xLag, yLag, wLag:
+	The lags of the target, the source, and the future
+	of the target, respectively; see transferEntropy().
+
+	Returns:
+	An n x n matrix in row-major order. The element
+	i * n + j is the transfer entropy from the i:th
+	channel to the j:th channel; that is, transferEntropy()
+	with X the j:th channel, Y the i:th channel, and W the
+	future of the j:th channel. The diagonal is NaN.
+
+	The marginal point sets (w, X) and X of each channel
+	are built only once, and shared by all the pairs. The
+	marginal point set (X, Y) of a pair is built with its
+	joint point set. Otherwise as mutualInformationMatrix().
+	*/
+	TIM std::vector<dreal> transferEntropyMatrix(
+		const Array<Signal>& signalSet,
+		const Array<Signal>& futureSet,
+		integer xLag = 0, integer yLag = 0, integer wLag = 0,
+		integer kNearest = 1,
+		integer maxMemory = 0,
+		Instrumentation* instrumentation = nullptr);
+
+	//! Computes partial mutual information between all pairs of signals.
+	/*!
+	Preconditions:
+	kNearest > 0
+	maxMemory >= 0
+	zSignalSet.width() == signalSet.width()
+	zSignalSet.height() == 1
+
+	zSignalSet:
+	The trials of the signal Z on which the mutual
+	information is conditioned.
+
+	xLag, yLag, zLag:
+	The lags of the first and the second signal of each
+	pair, and of Z, respectively.
+
+	Returns:
+	An n x n matrix in row-major order. The element
+	i * n + j is partialMutualInformation() with X the
+	i:th channel, Y the j:th channel, and Z the given
+	signal. The diagonal is NaN when xLag == yLag.
+
+	The marginal point sets (X, Z) and (Z, Y) of each
+	channel, and Z, are built only once, and shared by
+	all the pairs. Otherwise as mutualInformationMatrix().
+	*/
+	TIM std::vector<dreal> partialMutualInformationMatrix(
+		const Array<Signal>& signalSet,
+		const Array<Signal>& zSignalSet,
+		integer xLag = 0, integer yLag = 0, integer zLag = 0,
+		integer kNearest = 1,
+		bool symmetric = true,
+		integer maxMemory = 0,
+		Instrumentation* instrumentation = nullptr);
+
+	//! Computes temporal mutual information between all pairs of signals.
+	/*!
+	Preconditions:
+	timeWindowRadius >= 0
+	kNearest > 0
+	odd(filter.size())
+	maxMemory >= 0
+
+	timeWindowRadius, filter, hop, instrumentation:
+	See temporalEntropyCombination().
+
+	Returns:
+	n x n temporal estimates in row-major order, as in
+	mutualInformationMatrix(). The estimates which are
+	not computed are empty signals.
+
+	Each pair is estimated by temporalEntropyCombination().
+	The marginal point sets are not shared between the pairs,
+	since each estimate moves their time-windows. The pairs
+	are estimated in parallel, as many at a time as 'maxMemory'
+	allows.
+	*/
+	TIM std::vector<SignalData> temporalMutualInformationMatrix(
+		const Array<Signal>& signalSet,
+		integer timeWindowRadius,
+		integer xLag = 0, integer yLag = 0,
+		integer kNearest = 1,
+		const std::vector<dreal>& filter = std::vector<dreal>(1, 1),
+		bool symmetric = true,
+		integer maxMemory = 0,
+		const TemporalHop& hop = TemporalHop(),
+		Instrumentation* instrumentation = nullptr);
+
+	//! Computes temporal transfer entropy between all pairs of signals.
+	/*!
+	This is as transferEntropyMatrix(), with the temporal
+	estimates as in temporalMutualInformationMatrix().
+	*/
+	TIM std::vector<SignalData> temporalTransferEntropyMatrix(
+		const Array<Signal>& signalSet,
+		const Array<Signal>& futureSet,
+		integer timeWindowRadius,
+		integer xLag = 0, integer yLag = 0, integer wLag = 0,
+		integer kNearest = 1,
+		const std::vector<dreal>& filter = std::vector<dreal>(1, 1),
+		integer maxMemory = 0,
+		const TemporalHop& hop = TemporalHop(),
+		Instrumentation* instrumentation = nullptr);
+
+	//! Computes temporal partial mutual information between all pairs of signals.
+	/*!
+	This is as partialMutualInformationMatrix(), with the
+	temporal estimates as in temporalMutualInformationMatrix().
+	*/
+	TIM std::vector<SignalData> temporalPartialMutualInformationMatrix(
+		const Array<Signal>& signalSet,
+		const Array<Signal>& zSignalSet,
+		integer timeWindowRadius,
+		integer xLag = 0, integer yLag = 0, integer zLag = 0,
+		integer kNearest = 1,
+		const std::vector<dreal>& filter = std::vector<dreal>(1, 1),
+		bool symmetric = true,
+		integer maxMemory = 0,
+		const TemporalHop& hop = TemporalHop(),
+		Instrumentation* instrumentation = nullptr);
+
+}
+
+#endif
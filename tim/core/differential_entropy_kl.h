@@ -7,6 +7,8 @@
 #include "tim/core/signal.h"
 #include "tim/core/generic_entropy.h"
 #include "tim/core/generic_entropy_t.h"
+#include "tim/core/generic_entropies.h"
+#include "tim/core/prepared_signals.h"
 
 #include <pastel/sys/range.h>
 
@@ -90,6 +92,10 @@ namespace Tim
 
 	norm:
 	The norm to use.
+
+	maxRelativeError, relativeError, layout, hop,
+	instrumentation:
+	See temporalGenericEntropy().
 	*/
 	template <
 		ranges::forward_range Signal_Range, 
@@ -100,7 +106,12 @@ namespace Tim
 		integer timeWindowRadius,
 		integer kNearest = 1,
 		const Norm& norm = Norm(),
-		const Real_Range& filter = constantRange((dreal)1, 1))
+		const Real_Range& filter = constantRange((dreal)1, 1),
+		dreal maxRelativeError = 0,
+		dreal* relativeError = nullptr,
+		SignalPointSet::Layout layout = SignalPointSet::Layout::Automatic,
+		const TemporalHop& hop = TemporalHop(),
+		Instrumentation* instrumentation = nullptr)
 	{
 		ENSURE_OP(timeWindowRadius, >=, 0);
 		ENSURE_OP(kNearest, >, 0);
@@ -113,7 +124,12 @@ namespace Tim
 			entropyAlgorithm,
 			timeWindowRadius,
 			kNearest,
-			filter);
+			filter,
+			maxRelativeError,
+			relativeError,
+			layout,
+			hop,
+			instrumentation);
 	}
 
 	//! Differential entropy of a signal.
@@ -133,6 +149,9 @@ namespace Tim
 	norm:
 	The norm to use.
 
+	maxRelativeError, relativeError, layout, instrumentation:
+	See genericEntropy().
+
 	Returns:
 	A differential entropy estimate if successful,
 	NaN otherwise. The estimation may fail only
@@ -145,12 +164,157 @@ namespace Tim
 	dreal differentialEntropyKl(
 		const Signal_Range& signalSet,
 		integer kNearest = 1,
-		const Norm& norm = Norm())
+		const Norm& norm = Norm(),
+		dreal maxRelativeError = 0,
+		dreal* relativeError = nullptr,
+		SignalPointSet::Layout layout = SignalPointSet::Layout::Automatic,
+		Instrumentation* instrumentation = nullptr)
 	{
 		ENSURE_OP(kNearest, >, 0);
 
 		KlDifferential_EntropyAlgorithm<Norm> entropyAlgorithm(norm);
-		return genericEntropy(signalSet, entropyAlgorithm, kNearest);
+		return genericEntropy(signalSet, entropyAlgorithm, kNearest,
+			maxRelativeError, relativeError, layout, instrumentation);
+	}
+
+	//! Differential entropy of prepared signals.
+	/*!
+	Preconditions:
+	kNearest > 0
+	maxRelativeError >= 0
+	0 <= signalBegin < signalEnd <= prepared.signals()
+
+	signalBegin, signalEnd:
+	The signals [signalBegin, signalEnd[ of 'prepared',
+	without lags, whose joint signal is estimated. The
+	samples are those on the time interval shared by all
+	the signals of 'prepared'.
+
+	Otherwise as differentialEntropyKl() above, in the
+	maximum norm. The point set is taken from 'prepared',
+	and kept there for later estimates. The point sets of
+	'prepared' are given the 'instrumentation'.
+	*/
+	inline dreal differentialEntropyKl(
+		PreparedSignals& prepared,
+		integer signalBegin,
+		integer signalEnd,
+		integer kNearest = 1,
+		dreal maxRelativeError = 0,
+		dreal* relativeError = nullptr,
+		Instrumentation* instrumentation = nullptr)
+	{
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE_OP(signalBegin, >=, 0);
+		ENSURE_OP(signalBegin, <, signalEnd);
+		ENSURE_OP(signalEnd, <=, prepared.signals());
+
+		if (relativeError)
+		{
+			*relativeError = 0;
+		}
+
+		if (prepared.trials() == 0)
+		{
+			return (dreal)Nan();
+		}
+
+		prepared.setInstrumentation(instrumentation);
+
+		std::vector<integer> lagSet(prepared.signals(), 0);
+		if (prepared.points(lagSet) == 0)
+		{
+			return (dreal)Nan();
+		}
+
+		const SignalPointSet* pointSet = prepared.marginalPointSets(
+			lagSet, {Integer2(signalBegin, signalEnd)}).front();
+
+		KlDifferential_EntropyAlgorithm<Maximum_Norm<dreal>> entropyAlgorithm;
+		return genericEntropy(*pointSet, entropyAlgorithm, kNearest,
+			maxRelativeError, relativeError);
+	}
+
+	//! Differential entropies of a signal for many k.
+	/*!
+	Preconditions:
+	Each k in kNearestSet is positive.
+
+	kNearestSet:
+	The k:th nearest neighbors to estimate with.
+
+	instrumentation:
+	See genericEntropy().
+
+	Returns:
+	The i:th element is differentialEntropyKl(signalSet,
+	kNearestSet[i], norm).
+
+	The nearest neighbors are searched only once, for the
+	maximum k. See genericEntropies().
+	*/
+	template <
+		ranges::forward_range Signal_Range, 
+		ranges::forward_range Integer_Range,
+		typename Norm = Default_Norm>
+	std::vector<dreal> differentialEntropiesKl(
+		const Signal_Range& signalSet,
+		const Integer_Range& kNearestSet,
+		const Norm& norm = Norm(),
+		Instrumentation* instrumentation = nullptr)
+	{
+		std::vector<KlDifferential_EntropyAlgorithm<Norm>> entropyAlgorithmSet(
+			ranges::size(kNearestSet), 
+			KlDifferential_EntropyAlgorithm<Norm>(norm));
+
+		return genericEntropies(signalSet, entropyAlgorithmSet, kNearestSet,
+			SignalPointSet::Layout::Automatic, instrumentation);
+	}
+
+	//! Temporal differential entropies of a signal for many k.
+	/*!
+	Preconditions:
+	timeWindowRadius >= 0
+	Each k in kNearestSet is positive.
+
+	kNearestSet:
+	The k:th nearest neighbors to estimate with.
+
+	instrumentation:
+	See temporalGenericEntropy().
+
+	Returns:
+	The i:th element is temporalDifferentialEntropyKl(signalSet,
+	timeWindowRadius, kNearestSet[i], norm, filter, 0, nullptr,
+	SignalPointSet::Layout::Automatic, hop).
+
+	At each time instant, the nearest neighbors are searched
+	only once, for the maximum k. See temporalGenericEntropies().
+	*/
+	template <
+		ranges::forward_range Signal_Range, 
+		ranges::forward_range Integer_Range,
+		typename Norm = Default_Norm,
+		typename Real_Range = decltype(constantRange((dreal)1, 1))>
+	std::vector<SignalData> temporalDifferentialEntropiesKl(
+		const Signal_Range& signalSet,
+		integer timeWindowRadius,
+		const Integer_Range& kNearestSet,
+		const Norm& norm = Norm(),
+		const Real_Range& filter = constantRange((dreal)1, 1),
+		const TemporalHop& hop = TemporalHop(),
+		Instrumentation* instrumentation = nullptr)
+	{
+		ENSURE_OP(timeWindowRadius, >=, 0);
+
+		std::vector<KlDifferential_EntropyAlgorithm<Norm>> entropyAlgorithmSet(
+			ranges::size(kNearestSet), 
+			KlDifferential_EntropyAlgorithm<Norm>(norm));
+
+		return temporalGenericEntropies(
+			signalSet, entropyAlgorithmSet, kNearestSet,
+			timeWindowRadius, filter,
+			SignalPointSet::Layout::Automatic, hop, instrumentation);
 	}
 
 }
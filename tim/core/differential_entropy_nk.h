@@ -6,6 +6,7 @@
 
 #include "tim/core/mytypes.h"
 #include "tim/core/signal_tools.h"
+#include "tim/core/instrumentation.h"
 
 #include <pastel/sys/range.h>
 #include <pastel/sys/sequence/sequence_algorithms.h>
@@ -26,13 +27,20 @@
 namespace Tim
 {
 
+	//! Differential entropy of a signal.
+	/*!
+	instrumentation:
+	If not null, measures the building of the kd-tree
+	and the searches. See instrumentation.txt.
+	*/
 	template <
 		ranges::forward_range Signal_Range, 
 		typename Norm>
 	dreal differentialEntropyNk(
 		const Signal_Range& signalSet,
 		const Norm& norm,
-		integer* outIntrinsicDimension = 0)
+		integer* outIntrinsicDimension = 0,
+		Instrumentation* instrumentation = nullptr)
 	{
 		//const integer kNearest = 1;
 
@@ -83,8 +91,11 @@ namespace Tim
 
 		KdTree kdTree(locator);
 
-		kdTree.insertSet(pointSet);
-		kdTree.refine(SplitRule());
+		{
+			TIM_PHASE(instrumentation, Build);
+			kdTree.insertSet(pointSet);
+			kdTree.refine(SplitRule());
+		}
 
 		// For each m, compute average log-distance alpha_m to the nearest 
 		// codebook point for all points _not_ in the codebook 
@@ -102,9 +113,12 @@ namespace Tim
 				pointSet.begin(), pointSet.end(),
 				subsetSize);
 
-			kdTree.erase();
-			kdTree.insertSet(
-				range(pointSet.begin(), pointSet.begin() + subsetSize));
+			{
+				TIM_PHASE(instrumentation, Build);
+				kdTree.erase();
+				kdTree.insertSet(
+					range(pointSet.begin(), pointSet.begin() + subsetSize));
+			}
 
 			using Block = tbb::blocked_range<integer>;
 			using Pair = std::pair<dreal, integer>;
@@ -122,10 +136,14 @@ namespace Tim
 						ofDimension(dimension),
 						withAliasing((dreal*)pointSet[i]));
 
+					TIM_COUNT(instrumentation, nearestQueries, 1);
+
 					auto distance =
 						searchNearest(
 							kdTreeNearestSet(kdTree),
 							queryPoint,
+							PASTEL_TAG(accept), countingIndicator(instrumentation,
+								[](const Point_ConstIterator&) {return true;}),
 							PASTEL_TAG(norm), norm
 						).first;
 
@@ -156,6 +174,8 @@ namespace Tim
 			dreal alpha = 0;
 			integer acceptedSamples = 0;
 
+			TIM_PHASE(instrumentation, JointSearch);
+
 			std::tie(alpha, acceptedSamples) = 
 				tbb::parallel_reduce(
 					Block(subsetSize, estimateSamples),
@@ -9,13 +9,14 @@
 #include "tim/core/signalpointset.h"
 
 #include <pastel/sys/range.h>
-#include <pastel/sys/indicator/predicate_indicator.h>
-#include <pastel/geometry/search_nearest.h>
-#include <pastel/geometry/nearestset/kdtree_nearestset.h>
 
+#include <tbb/parallel_invoke.h>
 #include <tbb/parallel_reduce.h>
 #include <tbb/blocked_range.h>
 
+#include <cmath>
+#include <vector>
+
 namespace Tim
 {
 
@@ -38,6 +39,19 @@ namespace Tim
 	ySignalSet:
 	A set of signals representing trials for X.
 
+	maxRelativeError:
+	The allowed relative error in the distances to the
+	nearest neighbors. See SignalPointSet::searchNearest().
+
+	relativeError:
+	If not null, the relative error that the searches
+	actually had is stored here. See 
+	SignalPointSet::relativeError().
+
+	instrumentation:
+	If not null, measures the phases and the searches
+	of the estimate. See instrumentation.txt.
+
 	returns:
 	The Kullback-Leibler divergence between the signals.
 	If the estimate is undefined, a NaN is returned.
@@ -47,7 +61,10 @@ namespace Tim
 		typename Y_Signal_Range>
 	dreal divergenceWkv(
 		const X_Signal_Range& xSignalSet,
-		const Y_Signal_Range& ySignalSet)
+		const Y_Signal_Range& ySignalSet,
+		dreal maxRelativeError = 0,
+		dreal* relativeError = nullptr,
+		Instrumentation* instrumentation = nullptr)
 	{
 		// "A Nearest-Neighbor Approach to Estimating
 		// Divergence between Continuous Random Vectors"
@@ -55,6 +72,13 @@ namespace Tim
 		// IEEE International Symposium on Information Theory (ISIT), 
 		// 2006.
 
+		ENSURE_OP(maxRelativeError, >=, 0);
+
+		if (relativeError)
+		{
+			*relativeError = 0;
+		}
+
 		if (xSignalSet.empty() || ySignalSet.empty())
 		{
 			return 0;
@@ -65,15 +89,60 @@ namespace Tim
 
 		ENSURE_OP(xDimension, ==, yDimension);
 
-		typedef SignalPointSet::Point_ConstIterator Point_ConstIterator;
-
 		// Construct point-sets.
 
-		SignalPointSet xPointSet(xSignalSet);
-		SignalPointSet yPointSet(ySignalSet);
+		using Layout = SignalPointSet::Layout;
 
-		integer xSamples = xPointSet.samples();
-		integer ySamples = yPointSet.samples();
+		SignalPointSet xPointSet;
+		SignalPointSet yPointSet;
+
+		// The point sets are independent, and are built
+		// concurrently.
+		tbb::parallel_invoke(
+			[&]() 
+			{
+				xPointSet = SignalPointSet(
+					xSignalSet, Layout::Automatic, Metric::Euclidean,
+					instrumentation);
+			},
+			[&]() 
+			{
+				yPointSet = SignalPointSet(
+					ySignalSet, Layout::Automatic, Metric::Euclidean,
+					instrumentation);
+			});
+
+		if (relativeError)
+		{
+			*relativeError = xPointSet.relativeError(maxRelativeError);
+		}
+
+		// The trials are pooled into a single sample.
+		integer xSamples = xPointSet.end() - xPointSet.begin();
+		integer ySamples = yPointSet.end() - yPointSet.begin();
+
+		// Find out the nearest neighbor in X for the points in X.
+
+		TIM_PHASE(instrumentation, JointSearch);
+
+		std::vector<dreal> xxDistanceSet(xSamples);
+		xPointSet.searchAllNearest(
+			1, xxDistanceSet.data(), 
+			nullptr, maxRelativeError);
+
+		// Find out the nearest neighbor in Y for the points in X.
+
+		std::vector<const dreal*> querySet;
+		querySet.reserve(xSamples);
+		for (auto iter = xPointSet.begin();iter != xPointSet.end();++iter)
+		{
+			querySet.push_back(*iter);
+		}
+
+		std::vector<dreal> xyDistanceSet(xSamples);
+		yPointSet.searchAllNearest(
+			querySet, 1, xyDistanceSet.data(), 
+			nullptr, maxRelativeError);
 
 		using Block = tbb::blocked_range<integer>;
 		using Pair = std::pair<dreal, integer>;
@@ -86,35 +155,16 @@ namespace Tim
 			integer acceptedSamples = start.second;
 			for (integer i = block.begin(); i < block.end(); ++i)
 			{
-				// Find out the nearest neighbor in X for a point in X.
-
-				Point_ConstIterator query =
-					*(xPointSet.begin() + i);
-
-				Vector<dreal> queryPoint(
-					ofDimension(xDimension),
-					withAliasing((dreal*)(query->point())));
-
-				dreal xxDistance2 =
-					(dreal)searchNearest(
-						kdTreeNearestSet(xPointSet.kdTree()), 
-						queryPoint,
-						PASTEL_TAG(accept), predicateIndicator(query, NotEqualTo())
-					).first;
+				dreal xxDistance = xxDistanceSet[i];
+				dreal xyDistance = xyDistanceSet[i];
 
-				if (xxDistance2 > 0 && xxDistance2 < infinity<dreal>())
+				if (xxDistance > 0 && xxDistance < infinity<dreal>() &&
+					xyDistance > 0 && xyDistance < infinity<dreal>())
 				{
-					// Find out the nearest neighbor in Y for a point in X.
-
-					dreal xyDistance2 =
-						(dreal)searchNearest(kdTreeNearestSet(yPointSet.kdTree()), 
-							queryPoint).first;
-					
-					if (xyDistance2 > 0 && xyDistance2 < infinity<dreal>())
-					{
-						estimate += std::log(xyDistance2 / xxDistance2);
-						++acceptedSamples;
-					}
+					estimate += std::log(
+						(xyDistance * xyDistance) / 
+						(xxDistance * xxDistance));
+					++acceptedSamples;
 				}
 			}
 
@@ -141,8 +191,8 @@ namespace Tim
 		if (acceptedSamples > 0)
 		{
 			// The factor 2 in the denominator is because 
-			// 'xyDistance' and 'xxDistance' are squared distances
-			// and thus need to be taken a square root. However,
+			// the logarithm is taken of squared distances,
+			// which need to be taken a square root. However,
 			// this can be taken outside the logarithm with a 
 			// division by 2.
 			estimate *= (dreal)xDimension / (2 * acceptedSamples);
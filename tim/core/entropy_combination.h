@@ -6,21 +6,16 @@
 #include "tim/core/mytypes.h"
 #include "tim/core/signal.h"
 #include "tim/core/signal_tools.h"
+#include "tim/core/lagged_signal.h"
 #include "tim/core/signalpointset.h"
+#include "tim/core/prepared_signals.h"
 #include "tim/core/reconstruction.h"
-
-#include <pastel/geometry/pointkdtree/pointkdtree.h>
-#include <pastel/geometry/count_nearest.h>
-#include <pastel/geometry/search_nearest.h>
-#include <pastel/geometry/nearestset/kdtree_nearestset.h>
-
-#include <pastel/math/normbijection/maximum_normbijection.h>
+#include "tim/core/instrumentation.h"
 
 #include <pastel/sys/array/array.h>
 #include <pastel/sys/range.h>
 #include <pastel/sys/math/eps.h>
 #include <pastel/sys/sequence/copy_n.h>
-#include <pastel/sys/indicator/predicate_indicator.h>
 
 #include <numeric>
 #include <iterator>
@@ -28,15 +23,128 @@
 
 #include <tbb/blocked_range.h>
 #include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
 #include <tbb/parallel_reduce.h>
 
 namespace Tim
 {
 
+	namespace Detail_EntropyCombination
+	{
+
+		//! Combines the marginal neighbor counts into an estimate.
+		/*!
+		jointPointSet:
+		The joint point set. The queries are the points in
+		its time-window.
+
+		pointSet:
+		The marginal point sets. The points in the time-window
+		of each marginal must be the projections of the points 
+		in the time-window of the joint point set, in any order.
+
+		offsetSet:
+		The offset of the first dimension of each marginal 
+		in the joint points.
+
+		weightSet:
+		The weight of each marginal.
+
+		distanceSet:
+		The distance from the j:th joint point to its k:th 
+		nearest neighbor in the joint space.
+		*/
+		inline dreal combine(
+			const SignalPointSet& jointPointSet,
+			const std::vector<const SignalPointSet*>& pointSet,
+			const std::vector<integer>& offsetSet,
+			const std::vector<integer>& weightSet,
+			const std::vector<dreal>& distanceSet,
+			integer kNearest)
+		{
+			TIM_PHASE(jointPointSet.instrumentation(), MarginalCount);
+
+			integer n = distanceSet.size();
+			integer marginals = pointSet.size();
+
+			const dreal signalWeightSum = 
+				std::accumulate(weightSet.begin(), weightSet.end(), (dreal)0);
+
+			dreal estimate = 0;
+			for (integer i = 0;i < marginals;++i)
+			{
+				using Block = tbb::blocked_range<integer>;
+				using Pair = std::pair<dreal, integer>;
+			
+				auto compute = [&](
+					const Block& block,
+					const Pair& start)
+				{
+					dreal signalEstimate = start.first;
+					integer acceptedSamples = start.second;
+					for (integer j = block.begin();j < block.end();++j) 
+					{
+						const dreal* query = *(jointPointSet.begin() + j);
+
+						integer k = pointSet[i]->countRange(
+							query + offsetSet[i],
+							distanceSet[j]);
+
+						// A neighbor count of zero can happen when the distance
+						// to the k:th neighbor is zero because of using an
+						// open search ball. These points are ignored.
+						if (k > 0)
+						{
+							signalEstimate += digamma<dreal>(k);
+							++acceptedSamples;
+						}
+					}
+				
+					return Pair(signalEstimate, acceptedSamples);
+				};
+			
+				auto reduce = [](const Pair& left, const Pair& right)
+				{
+					return Pair(
+						left.first + right.first, 
+						left.second + right.second);
+				};
+
+				dreal signalEstimate = 0;
+				integer acceptedSamples = 0;
+
+				// The deterministic reduction guarantees that
+				// the estimates do not depend on the scheduling
+				// of the threads.
+
+				std::tie(signalEstimate, acceptedSamples) = 
+					tbb::parallel_deterministic_reduce(
+						Block(0, n, 256),
+						Pair(0, 0),
+						compute,
+						reduce);
+
+				if (acceptedSamples > 0)
+				{
+					signalEstimate /= acceptedSamples;
+				}
+
+				estimate -= signalEstimate * weightSet[i];
+			}
+
+			estimate += digamma<dreal>(kNearest);
+			estimate += (signalWeightSum - 1) * digamma<dreal>(n);
+
+			return estimate;
+		}
+
+	}
+
 	//! Computes an entropy combination of signals.
 	/*!
 	Preconditions:
 	kNearest > 0
+	maxRelativeError >= 0
 
 	signalSet:
 	An ensemble of joint signals representing trials
@@ -60,6 +168,21 @@ namespace Tim
 	The k:th nearest neighbor that is used to
 	estimate entropy combination.
 
+	maxRelativeError:
+	The allowed relative error in the distances to the
+	k:th nearest neighbors in the joint signal. The
+	marginal counts are exact given these distances.
+	See SignalPointSet::searchNearest().
+
+	relativeError:
+	If not null, the relative error that the search in
+	the joint signal actually had is stored here. See
+	SignalPointSet::relativeError().
+
+	instrumentation:
+	If not null, measures the phases and the searches
+	of the estimate. See instrumentation.txt.
+
 	Returns:
 	An estimate of the entropy combination of the signals.
 	*/
@@ -70,34 +193,36 @@ namespace Tim
 		const Array<Signal>& signalSet,
 		const Integer3_Range& rangeSet,
 		const Lag_Range& lagSet,
-		integer kNearest = 1)
+		integer kNearest = 1,
+		dreal maxRelativeError = 0,
+		dreal* relativeError = nullptr,
+		Instrumentation* instrumentation = nullptr)
 	{
 		ENSURE_OP(kNearest, >, 0);
 		ENSURE_OP(ranges::size(lagSet), ==, signalSet.height());
+		ENSURE_OP(maxRelativeError, >=, 0);
 
-		typedef typename SignalPointSet::Point_ConstIterator
-			Point_ConstIterator;
+		if (relativeError)
+		{
+			*relativeError = 0;
+		}
 
 		if (ranges::empty(signalSet) || rangeSet.empty())
 		{
 			return 0;
 		}
 
-		// Construct the joint signal.
+		// Construct the joint signal. The joint signal
+		// is a view of the lagged signals; its points are
+		// gathered only once, into the joint point set.
 
 		integer trials = signalSet.width();
 
-		std::vector<SignalData> jointSignalSet;
+		std::vector<LaggedSignal> jointSignalSet;
 		jointSignalSet.reserve(trials);
-		merge(signalSet, 
+		lagSignals(signalSet, 
 			std::back_inserter(jointSignalSet), lagSet);
 
-		integer samples = std::begin(jointSignalSet)->samples();
-		if (samples == 0)
-		{
-			return 0;
-		}
-
 		integer signals = signalSet.height();
 
 		// Find out the dimension ranges of the marginal
@@ -112,135 +237,187 @@ namespace Tim
 		}
 
 
-		const integer n = samples * trials;
 		integer marginals = ranges::size(rangeSet);
 
-		// Construct point sets
+		// Construct point sets. The point sets are static, 
+		// so the packed layout is used for faster scans.
+		// The marginal point sets refer to the coordinates
+		// of the joint point set.
+
+		using Layout = SignalPointSet::Layout;
 
-		SignalPointSet jointPointSet(jointSignalSet);
+		SignalPointSet jointPointSet(
+			jointSignalSet, Layout::Packed,
+			Metric::Maximum, instrumentation);
+
+		// The joint point set contains only the time interval 
+		// on which all the trials are defined.
+		const integer n = jointPointSet.end() - jointPointSet.begin();
+		if (n == 0)
+		{
+			return 0;
+		}
+
+		if (relativeError)
+		{
+			*relativeError = jointPointSet.relativeError(maxRelativeError);
+		}
 	
 		std::vector<integer> weightSet;
 		weightSet.reserve(marginals);
 
-		auto iter = std::begin(rangeSet);
-		std::vector<SignalPointSet> pointSet;
-		pointSet.reserve(marginals);
-		for (integer i = 0;i < marginals;++i)
+		std::vector<integer> marginalOffsetSet;
+		marginalOffsetSet.reserve(marginals);
+
+		for (const Integer3& range : rangeSet)
 		{
-			const Integer3& range = *iter;
-			pointSet.emplace_back(
-				jointSignalSet,
-				offsetSet[range[0]], offsetSet[range[1]]);
 			weightSet.push_back(range[2]);
-			++iter;
+			marginalOffsetSet.push_back(offsetSet[range[0]]);
 		}
 
-		// It is essential that the used norm is the
-		// maximum norm.
+		std::vector<Integer3> copyRangeSet(
+			std::begin(rangeSet), std::end(rangeSet));
+
+		std::vector<SignalPointSet> pointSet(marginals);
+		std::vector<dreal> distanceSet(n);
 
-		Maximum_Norm<dreal> norm;
+		// The marginal point sets are built concurrently with
+		// each other, and with the search in the joint point 
+		// set; all of them only read the joint point set.
+
+		tbb::parallel_invoke(
+			[&]()
+			{
+				// Find the distances to the k:th nearest neighbors.
+				// It is essential that the used norm is the maximum
+				// norm, which is what SignalPointSet searches with.
+
+				TIM_PHASE(instrumentation, JointSearch);
+				jointPointSet.searchAllNearest(
+					kNearest, distanceSet.data(), 
+					nullptr, maxRelativeError);
+			},
+			[&]()
+			{
+				tbb::parallel_for((integer)0, marginals,
+					[&](integer i)
+					{
+						const Integer3& range = copyRangeSet[i];
+						pointSet[i] = SignalPointSet(
+							jointPointSet,
+							offsetSet[range[0]], offsetSet[range[1]],
+							Layout::Packed, Metric::Maximum,
+							instrumentation);
+					});
+			});
+
+		std::vector<const SignalPointSet*> marginalSet;
+		marginalSet.reserve(marginals);
+		for (const SignalPointSet& marginal : pointSet)
+		{
+			marginalSet.push_back(&marginal);
+		}
 
-		// Find the distances to the k:th nearest neighbors.
+		return Detail_EntropyCombination::combine(
+			jointPointSet, marginalSet, marginalOffsetSet,
+			weightSet, distanceSet, kNearest);
+	}
 
-		Array<dreal> distanceArray(Vector2i(1, n));
+	//! Computes an entropy combination of prepared signals.
+	/*!
+	Preconditions:
+	kNearest > 0
+	maxRelativeError >= 0
+	ranges::size(lagSet) == prepared.signals()
+
+	This is as entropyCombination() above, for the signals
+	of 'prepared', except that the point sets are taken from
+	'prepared', and kept there for later estimates. Another 
+	estimate with the same lags, but with another 'rangeSet', 
+	'kNearest' or 'maxRelativeError', then only builds the 
+	marginal point sets which it has not yet used, and 
+	searches the point sets. The point sets of 'prepared'
+	are given the 'instrumentation'.
+	*/
+	template <
+		ranges::forward_range Integer3_Range,
+		ranges::forward_range Lag_Range>
+	dreal entropyCombination(
+		PreparedSignals& prepared,
+		const Integer3_Range& rangeSet,
+		const Lag_Range& lagSet,
+		integer kNearest = 1,
+		dreal maxRelativeError = 0,
+		dreal* relativeError = nullptr,
+		Instrumentation* instrumentation = nullptr)
+	{
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE_OP(ranges::size(lagSet), ==, prepared.signals());
+		ENSURE_OP(maxRelativeError, >=, 0);
 
-		using Block = tbb::blocked_range<integer>;
+		if (relativeError)
+		{
+			*relativeError = 0;
+		}
 
-		auto search = [&](const Block& block)
+		if (prepared.trials() == 0 || ranges::empty(rangeSet))
 		{
-			for (integer i = block.begin(); i < block.end(); ++i)
-			{
-				auto query = *(jointPointSet.begin() + i);
-
-				Vector<dreal> queryPoint(
-					ofDimension(jointPointSet.dimension()),
-					withAliasing((dreal*)(query->point())));
-
-				distanceArray(i) =
-					(dreal)searchNearest(
-						kdTreeNearestSet(jointPointSet.kdTree()),
-						queryPoint,
-						PASTEL_TAG(accept), predicateIndicator(query, NotEqualTo()),
-						PASTEL_TAG(norm), norm,
-						PASTEL_TAG(kNearest), kNearest
-					).first;
-			}
-		};
+			return 0;
+		}
 
-		tbb::parallel_for(Block(0, n), search);
+		prepared.setInstrumentation(instrumentation);
 
-		const dreal signalWeightSum = 
-			std::accumulate(weightSet.begin(), weightSet.end(), (dreal)0);
+		std::vector<integer> copyLagSet(
+			std::begin(lagSet), std::end(lagSet));
 
-		dreal estimate = 0;
-		for (integer i = 0;i < marginals;++i)
+		const integer n = prepared.points(copyLagSet);
+		if (n == 0)
 		{
-			using Block = tbb::blocked_range<integer>;
-			using Pair = std::pair<dreal, integer>;
-			
-			auto compute = [&](
-				const Block& block,
-				const Pair& start)
-			{
-				dreal signalEstimate = start.first;
-				integer acceptedSamples = start.second;
-				for (integer j = block.begin();j < block.end();++j) 
-				{
-					auto query = *(pointSet[i].begin() + j);
-
-					Vector<dreal> queryPoint(
-						ofDimension(pointSet[i].dimension()),
-						withAliasing((dreal*)(query->point())));
-
-					integer k = countNearest(
-						kdTreeNearestSet(pointSet[i].kdTree()),
-						queryPoint,
-						PASTEL_TAG(norm), norm,
-						PASTEL_TAG(maxDistance2), norm(distanceArray(j))
-					);
-
-					// A neighbor count of zero can happen when the distance
-					// to the k:th neighbor is zero because of using an
-					// open search ball. These points are ignored.
-					if (k > 0)
-					{
-						signalEstimate += digamma<dreal>(k);
-						++acceptedSamples;
-					}
-				}
-				
-				return Pair(signalEstimate, acceptedSamples);
-			};
-			
-			auto reduce = [](const Pair& left, const Pair& right)
-			{
-				return Pair(
-					left.first + right.first, 
-					left.second + right.second);
-			};
-
-			dreal signalEstimate = 0;
-			integer acceptedSamples = 0;
-
-			std::tie(signalEstimate, acceptedSamples) = 
-				tbb::parallel_reduce(
-					Block(0, n),
-					Pair(0, 0),
-					compute,
-					reduce);
-
-			if (acceptedSamples > 0)
-			{
-				signalEstimate /= acceptedSamples;
-			}
+			return 0;
+		}
 
-			estimate -= signalEstimate * weightSet[i];
+		std::vector<integer> weightSet;
+		std::vector<integer> marginalOffsetSet;
+		std::vector<Integer2> signalRangeSet;
+		for (const Integer3& range : rangeSet)
+		{
+			weightSet.push_back(range[2]);
+			marginalOffsetSet.push_back(prepared.offset(range[0]));
+			signalRangeSet.push_back(Integer2(range[0], range[1]));
 		}
 
-		estimate += digamma<dreal>(kNearest);
-		estimate += (signalWeightSum - 1) * digamma<dreal>(n);
+		const SignalPointSet& jointPointSet = 
+			prepared.jointPointSet(copyLagSet);
+
+		if (relativeError)
+		{
+			*relativeError = jointPointSet.relativeError(maxRelativeError);
+		}
+
+		std::vector<dreal> distanceSet(n);
+		std::vector<const SignalPointSet*> marginalSet;
+
+		// The missing marginal point sets are built 
+		// concurrently with the search in the joint 
+		// point set.
+
+		tbb::parallel_invoke(
+			[&]()
+			{
+				TIM_PHASE(instrumentation, JointSearch);
+				jointPointSet.searchAllNearest(
+					kNearest, distanceSet.data(), 
+					nullptr, maxRelativeError);
+			},
+			[&]()
+			{
+				marginalSet = prepared.marginalPointSets(
+					copyLagSet, signalRangeSet);
+			});
 
-		return estimate;
+		return Detail_EntropyCombination::combine(
+			jointPointSet, marginalSet, marginalOffsetSet,
+			weightSet, distanceSet, kNearest);
 	}
 
 	//! Computes an entropy combination of signals.
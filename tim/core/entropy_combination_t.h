@@ -6,23 +6,20 @@
 #include "tim/core/mytypes.h"
 #include "tim/core/signal.h"
 #include "tim/core/signal_tools.h"
+#include "tim/core/lagged_signal.h"
 #include "tim/core/signalpointset.h"
+#include "tim/core/sliding_neighbors.h"
 #include "tim/core/reconstruction.h"
+#include "tim/core/temporal_hop.h"
 
 #include <pastel/sys/range.h>
 #include <pastel/sys/array/array.h>
 #include <pastel/sys/math/eps.h>
 #include <pastel/sys/sequence/copy_n.h>
-#include <pastel/sys/indicator/predicate_indicator.h>
-
-#include <pastel/geometry/pointkdtree/pointkdtree.h>
-#include <pastel/geometry/search_nearest.h>
-#include <pastel/geometry/nearestset/kdtree_nearestset.h>
-
-#include <pastel/math/normbijection/maximum_normbijection.h>
 
 #include <tbb/blocked_range.h>
 #include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
 
 #include <numeric>
 #include <iterator>
@@ -39,6 +36,7 @@ namespace Tim
 	timeWindowRadius >= 0
 	kNearest > 0
 	odd(ranges::size(filter))
+	maxRelativeError >= 0
 
 	signalSet:
 	An ensemble of joint signals representing trials
@@ -70,12 +68,37 @@ namespace Tim
 	in the time-window. The center of the array corresponds 
 	to the current time instant. The width of the array can 
 	be arbitrary but must be odd. The coefficients must sum
-	to a non-zero value.
+	to a non-zero value. The neighbors of the points in the 
+	filter window are maintained incrementally as the 
+	time-window slides; this saves searches only when the 
+	width is greater than 1. See SlidingNeighbors.
 
 	kNearest:
 	The k:th nearest neighbor that is used to
 	estimate entropy combination.
 
+	timeChunks:
+	The number of contiguous time intervals which are
+	estimated in parallel. Each interval builds its own 
+	copies of the point sets, so that the memory use grows 
+	linearly with this number. With maxRelativeError = 0 
+	the estimates do not depend on this number. Otherwise 
+	the approximate neighbors, and so the estimates, depend
+	on where the chunks split the time instants.
+
+	maxRelativeError, relativeError:
+	See entropyCombination(). The incrementally maintained
+	neighbors keep the bound; see SlidingNeighbors.
+
+	hop:
+	The time instants at which to evaluate the estimate;
+	see TemporalHop. By default, every time instant. With
+	refinement, each refinement pass builds the point sets
+	of its chunks again.
+
+	instrumentation:
+	See entropyCombination().
+
 	Returns:
 	The temporal estimates in a 1d-signal.
 	*/
@@ -89,15 +112,25 @@ namespace Tim
 		integer timeWindowRadius,
 		const Lag_Range& lagSet,
 		integer kNearest,
-		const Filter_Range& filter)
+		const Filter_Range& filter,
+		integer timeChunks = 1,
+		const TemporalHop& hop = TemporalHop(),
+		dreal maxRelativeError = 0,
+		dreal* relativeError = nullptr,
+		Instrumentation* instrumentation = nullptr)
 	{
 		ENSURE_OP(timeWindowRadius, >=, 0);
 		ENSURE_OP(kNearest, >, 0);
 		ENSURE_OP(ranges::size(lagSet), ==, signalSet.height());
 		ENSURE(odd(ranges::size(filter)));
+		ENSURE_OP(timeChunks, >, 0);
+		ENSURE_OP(hop.hop, >, 0);
+		ENSURE_OP(maxRelativeError, >=, 0);
 
-		typedef typename SignalPointSet::Point_ConstIterator
-			Point_ConstIterator;
+		if (relativeError)
+		{
+			*relativeError = 0;
+		}
 
 		if (ranges::empty(signalSet) || rangeSet.empty() || ranges::empty(filter))
 		{
@@ -132,11 +165,23 @@ namespace Tim
 			return SignalData();
 		}
 		
-		// Construct the joint signal.
+		// Construct the joint signal. The joint signal
+		// is a view of the lagged signals; its points are
+		// gathered once, into a joint point set whose 
+		// coordinates are shared by all the chunks.
 
-		std::vector<SignalData> jointSignalSet;
+		std::vector<LaggedSignal> jointSignalSet;
 		jointSignalSet.reserve(trials);
-		merge(signalSet, std::back_inserter(jointSignalSet), lagSet);
+		lagSignals(signalSet, std::back_inserter(jointSignalSet), lagSet);
+
+		const SignalPointSet sourcePointSet(
+			jointSignalSet, SignalPointSet::Layout::Packed,
+			Metric::Maximum, instrumentation);
+
+		if (relativeError)
+		{
+			*relativeError = sourcePointSet.relativeError(maxRelativeError);
+		}
 
 		integer marginals = rangeSet.size();
 
@@ -152,11 +197,8 @@ namespace Tim
 			offsetSet.push_back(offsetSet[i - 1] + marginalDimension);
 		}
 
-		// It is essential that the used norm is the
-		// maximum norm.
-
-		Maximum_Norm<dreal> norm;
-		integer missingValues = 0;
+		// Note: SlidingNeighbors uses the maximum norm, 
+		// which is essential for the estimator.
 
 		// This is where the estimates are stored at.
 		
@@ -170,8 +212,10 @@ namespace Tim
 
 		integer filterWidth = ranges::size(filter);
 		integer filterRadius = filterWidth / 2;
-		integer maxLocalFilterWidth = 
-			std::min(filterWidth, estimates);
+
+		// The grain size fixes the association order of
+		// the reduction over the filter window.
+		integer reduceGrainSize = 256;
 
 		std::vector<dreal> copyFilter;
 
@@ -188,150 +232,167 @@ namespace Tim
 			}
 		}
 
-		{
-		// Compute SignalPointSets.
-
-		SignalPointSet jointPointSet(jointSignalSet);
-
-		std::vector<SignalPointSet> pointSet;
-		pointSet.reserve(marginals);
-
 		dreal signalWeightSum = 0;
-
 		for (integer i = 0;i < marginals;++i)
 		{
-			const Integer3& range = copyRangeSet[i];
-			
-			pointSet.emplace_back(
-				jointSignalSet,
-				offsetSet[range[0]], offsetSet[range[1]]);
-
-			signalWeightSum += range[2];
+			signalWeightSum += copyRangeSet[i][2];
 		}
 
+		using Block = tbb::blocked_range<integer>;
+		using Pair = std::pair<dreal, dreal>;
 
-		Array<dreal> distanceArray(Vector2i(1, maxLocalFilterWidth * trials), infinity<dreal>());
-		
-		for (integer t = estimateBegin;t < estimateEnd;++t)
+		auto reduce = [](const Pair& left, const Pair& right)
 		{
-			jointPointSet.setTimeWindow(
-				t - timeWindowRadius, 
-				t + timeWindowRadius + 1);
-			
-			integer tBegin = jointPointSet.windowBegin();
-			integer tEnd = jointPointSet.windowEnd();
-			integer tWidth = tEnd - tBegin;
-			integer tLocalFilterBegin = std::max(t - filterRadius, tBegin) - tBegin;
-			integer tLocalFilterEnd = std::min(t + filterRadius + 1, tEnd) - tBegin;
-			integer tFilterDelta = tBegin - (t - filterRadius);
-			integer tFilterOffset = std::max(tFilterDelta, (integer)0);
-
-			const integer windowSamples = (tLocalFilterEnd - tLocalFilterBegin) * trials;
-
-			using Block = tbb::blocked_range<integer>;
-
-			integer searchBegin = tLocalFilterBegin * trials;
-			integer searchEnd = tLocalFilterEnd * trials;
-
-			auto search = [&](const Block& block)
-			{
-				for (integer i = block.begin(); i < block.end(); ++i)
-				{
-					auto query = *(jointPointSet.begin() + i);
-
-					Vector<dreal> queryPoint(
-						ofDimension(jointPointSet.dimension()),
-						withAliasing((dreal*)(query->point())));
-
-					distanceArray(i - searchBegin) =
-						(dreal)searchNearest(
-							kdTreeNearestSet(jointPointSet.kdTree()),
-							queryPoint,
-							PASTEL_TAG(accept), predicateIndicator(query, NotEqualTo()),
-							PASTEL_TAG(norm), norm,
-							PASTEL_TAG(kNearest), kNearest
-						).first;
-				}
-			};
+			return Pair(
+				left.first + right.first, 
+				left.second + right.second);
+		};
+
+		// Estimates the given time instants, in ascending order.
+		auto estimateChunk = [&](
+			const integer* tSetBegin, const integer* tSetEnd)
+		{
+			// Each chunk has to create its own copy of the 
+			// signal point sets, since the call to 
+			// SignalPointSet::setTimeWindow() is mutating.
+			// The copies refer to the coordinates of the
+			// shared joint point set.
+
+			using Layout = SignalPointSet::Layout;
+
+			SignalPointSet jointPointSet(
+				sourcePointSet, 0, sourcePointSet.dimension(), 
+				Layout::Packed, Metric::Maximum, instrumentation);
 
-			tbb::parallel_for(
-				Block(searchBegin, searchEnd),
-				search);
+			std::vector<SignalPointSet> pointSet;
+			pointSet.reserve(marginals);
 
-			dreal estimate = 0;
 			for (integer i = 0;i < marginals;++i)
 			{
-				pointSet[i].setTimeWindow(
+				const Integer3& range = copyRangeSet[i];
+				
+				pointSet.emplace_back(
+					sourcePointSet,
+					offsetSet[range[0]], offsetSet[range[1]],
+					Layout::Packed, Metric::Maximum, instrumentation);
+			}
+
+			// The k-nearest neighbors and the marginal range counts
+			// are maintained incrementally as the time-window slides.
+
+			SlidingNeighbors neighbors(
+				jointPointSet, pointSet, kNearest, maxRelativeError);
+
+			for (const integer* tIter = tSetBegin;tIter != tSetEnd;++tIter)
+			{
+				integer t = *tIter;
+
+				jointPointSet.setTimeWindow(
 					t - timeWindowRadius, 
 					t + timeWindowRadius + 1);
 
-				dreal signalEstimate = 0;
-				dreal weightSum = 0;
-				integer filterOffset = tFilterOffset * trials;
-
-				for (integer j = 0;j < windowSamples;++j)
+				for (integer i = 0;i < marginals;++i)
 				{
-					Point_ConstIterator query =
-						*(pointSet[i].begin() + searchBegin + j);
-
-					Vector<dreal> queryPoint(
-						ofDimension(pointSet[i].dimension()),
-						withAliasing((dreal*)(query->point())));
-
-					integer k = 0;
-					searchNearest(
-						kdTreeNearestSet(pointSet[i].kdTree()),
-						queryPoint,
-						PASTEL_TAG(kNearest), (integer)Infinity(),
-						PASTEL_TAG(report), [&](auto, auto) {++k;},
-						PASTEL_TAG(norm), norm,
-						PASTEL_TAG(maxDistance2), norm(distanceArray(j))
-					);
-
-					// Note: k = 0 is possible: a range count of zero 
-					// can happen when the distance to the k:th neighbor is 
-					// zero because of using an open search ball. 
-									
-					// These singular cases must be taken into account and
-					// gracefully ignored, as is done here.
-
-					if (k > 0)
-					{
-						dreal weight = copyFilter[j + filterOffset];
-						signalEstimate += weight * digamma<dreal>(k);
-						weightSum += weight;
-					}
+					pointSet[i].setTimeWindow(
+						t - timeWindowRadius, 
+						t + timeWindowRadius + 1);
 				}
-				if (weightSum != 0)
+				
+				integer tBegin = jointPointSet.windowBegin();
+				integer tEnd = jointPointSet.windowEnd();
+				integer tWidth = tEnd - tBegin;
+				integer tLocalFilterBegin = std::max(t - filterRadius, tBegin) - tBegin;
+				integer tLocalFilterEnd = std::min(t + filterRadius + 1, tEnd) - tBegin;
+				integer tFilterDelta = tBegin - (t - filterRadius);
+				integer tFilterOffset = std::max(tFilterDelta, (integer)0);
+
+				const integer windowSamples = (tLocalFilterEnd - tLocalFilterBegin) * trials;
+				const integer filterOffset = tFilterOffset * trials;
+
+				neighbors.update(
+					tBegin + tLocalFilterBegin,
+					tBegin + tLocalFilterEnd);
+
+				dreal estimate = 0;
+				for (integer i = 0;i < marginals;++i)
 				{
-					signalEstimate /= weightSum;
-					estimate -= signalEstimate * copyRangeSet[i][2];
-				}
-				else
-				{
-					// The estimate is undefined, mark
-					// it with NaN. This value will
-					// probably be reconstructed later.
-					estimate = (dreal)Nan();
-					++missingValues;
-					
-					// Skip to the next time instant.
-					break;
+					auto compute = [&](
+						const Block& block,
+						const Pair& start)
+					{
+						dreal signalEstimate = start.first;
+						dreal weightSum = start.second;
+						for (integer j = block.begin();j < block.end();++j)
+						{
+							integer k = neighbors.count(i, j);
+
+							// Note: k = 0 is possible: a range count of zero 
+							// can happen when the distance to the k:th neighbor is 
+							// zero because of using an open search ball. 
+											
+							// These singular cases must be taken into account and
+							// gracefully ignored, as is done here.
+
+							if (k > 0)
+							{
+								dreal weight = copyFilter[j + filterOffset];
+								signalEstimate += weight * digamma<dreal>(k);
+								weightSum += weight;
+							}
+						}
+
+						return Pair(signalEstimate, weightSum);
+					};
+
+					// The deterministic reduction guarantees that 
+					// the estimates do not depend on the scheduling
+					// of the threads.
+
+					dreal signalEstimate = 0;
+					dreal weightSum = 0;
+
+					std::tie(signalEstimate, weightSum) = 
+						tbb::parallel_deterministic_reduce(
+							Block(0, windowSamples, reduceGrainSize),
+							Pair(0, 0),
+							compute,
+							reduce);
+
+					if (weightSum != 0)
+					{
+						signalEstimate /= weightSum;
+						estimate -= signalEstimate * copyRangeSet[i][2];
+					}
+					else
+					{
+						// The estimate is undefined, mark
+						// it with NaN. This value will
+						// probably be reconstructed later.
+						estimate = (dreal)Nan();
+						
+						// Skip to the next time instant.
+						break;
+					}
 				}
-			}
 
-			const integer estimateSamples = tWidth * trials;
+				const integer estimateSamples = tWidth * trials;
 
-			estimate += digamma<dreal>(kNearest);
-			estimate += (signalWeightSum - 1) * digamma<dreal>(estimateSamples);
+				estimate += digamma<dreal>(kNearest);
+				estimate += (signalWeightSum - 1) * digamma<dreal>(estimateSamples);
 
-			result.data()(t - estimateBegin) = estimate;
-		}
-		}
+				result.data()(t - estimateBegin) = estimate;
+			}
+		};
 
-		// Reconstruct the NaN's in the estimates.
+		// The time instants of the hop are divided into 
+		// contiguous chunks, which are estimated in parallel.
+		// Then the NaN's in the estimates are reconstructed.
 
-		reconstruct(range(result.data().range().begin(), result.data().range().begin() + estimates));
+		estimateHops(
+			estimateBegin, estimateEnd, hop, timeChunks,
+			{result.data().data()},
+			estimateChunk,
+			instrumentation);
 
 		return result;
 	}
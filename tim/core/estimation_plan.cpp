@@ -0,0 +1,400 @@
+#include "tim/core/estimation_plan.h"
+#include "tim/core/entropy_combination.h"
+#include "tim/core/lagged_signal.h"
+#include "tim/core/leaf_scan.h"
+#include "tim/core/signalpointset.h"
+
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace Tim
+{
+
+	EstimationPlan::EstimationPlan()
+		: signalSet_()
+		, spaceSet_()
+		, spaceIndex_()
+		, searchSet_()
+		, requestSet_()
+	{
+	}
+
+	EstimationPlan::EstimationPlan(const Array<Signal>& signalSet)
+		: signalSet_(signalSet)
+		, spaceSet_()
+		, spaceIndex_()
+		, searchSet_()
+		, requestSet_()
+	{
+	}
+
+	integer EstimationPlan::add(
+		const std::vector<integer>& signalSet,
+		const std::vector<Integer3>& rangeSet,
+		const std::vector<integer>& lagSet,
+		integer kNearest,
+		dreal maxRelativeError)
+	{
+		ENSURE(!signalSet.empty());
+		ENSURE_OP(lagSet.size(), ==, signalSet.size());
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE_OP(maxRelativeError, >=, 0);
+
+		integer trials = signalSet_.width();
+		integer signals = signalSet.size();
+
+		std::vector<Component> componentSet;
+		std::vector<integer> offsetSet(1, 0);
+		for (integer i = 0;i < signals;++i)
+		{
+			ENSURE_OP(signalSet[i], >=, 0);
+			ENSURE_OP(signalSet[i], <, this->signals());
+
+			componentSet.emplace_back(signalSet[i], lagSet[i]);
+			offsetSet.push_back(offsetSet.back() +
+				(trials > 0 ? signalSet_(0, signalSet[i]).dimension() : 0));
+		}
+
+		Integer2 interval = sharedTimeInterval(
+			signalSet_, signalSet, lagSet);
+		integer tBegin = interval[0];
+		integer tEnd = interval[1];
+
+		Request request;
+		request.joint = space(
+			componentSet, tBegin, tEnd,
+			-1, 0, offsetSet.back());
+
+		for (const Integer3& range : rangeSet)
+		{
+			ENSURE_OP(range[0], >=, 0);
+			ENSURE_OP(range[0], <, range[1]);
+			ENSURE_OP(range[1], <=, signals);
+
+			std::vector<Component> marginalSet(
+				componentSet.begin() + range[0],
+				componentSet.begin() + range[1]);
+
+			request.marginalSet.push_back(space(
+				marginalSet, tBegin, tEnd,
+				request.joint,
+				offsetSet[range[0]], offsetSet[range[1]]));
+			request.offsetSet.push_back(offsetSet[range[0]]);
+			request.weightSet.push_back(range[2]);
+		}
+
+		request.search = search(
+			request.joint, kNearest, maxRelativeError);
+		request.kNearest = kNearest;
+
+		requestSet_.push_back(request);
+		return requestSet_.size() - 1;
+	}
+
+	integer EstimationPlan::addMutualInformation(
+		integer x, integer y,
+		integer xLag, integer yLag,
+		integer kNearest)
+	{
+		return add(
+			{x, y},
+			{Integer3(0, 1, 1), Integer3(1, 2, 1)},
+			{xLag, yLag},
+			kNearest);
+	}
+
+	integer EstimationPlan::addTransferEntropy(
+		integer x, integer y, integer w,
+		integer xLag, integer yLag, integer wLag,
+		integer kNearest)
+	{
+		// The signals are in wXY order; see transferEntropy().
+		return add(
+			{w, x, y},
+			{Integer3(0, 2, 1), Integer3(1, 3, 1), Integer3(1, 2, -1)},
+			{wLag, xLag, yLag},
+			kNearest);
+	}
+
+	integer EstimationPlan::addPartialMutualInformation(
+		integer x, integer y, integer z,
+		integer xLag, integer yLag, integer zLag,
+		integer kNearest)
+	{
+		// The signals are in XZY order; see
+		// partialMutualInformation().
+		return add(
+			{x, z, y},
+			{Integer3(0, 2, 1), Integer3(1, 3, 1), Integer3(1, 2, -1)},
+			{xLag, zLag, yLag},
+			kNearest);
+	}
+
+	integer EstimationPlan::addPartialTransferEntropy(
+		integer x, integer y, integer z, integer w,
+		integer xLag, integer yLag, integer zLag, integer wLag,
+		integer kNearest)
+	{
+		// The signals are in wXZY order; see
+		// partialTransferEntropy().
+		return add(
+			{w, x, z, y},
+			{Integer3(0, 3, 1), Integer3(1, 4, 1), Integer3(1, 3, -1)},
+			{wLag, xLag, zLag, yLag},
+			kNearest);
+	}
+
+	integer EstimationPlan::signals() const
+	{
+		return signalSet_.height();
+	}
+
+	integer EstimationPlan::estimates() const
+	{
+		return requestSet_.size();
+	}
+
+	integer EstimationPlan::pointSets() const
+	{
+		return spaceSet_.size();
+	}
+
+	integer EstimationPlan::searches() const
+	{
+		return searchSet_.size();
+	}
+
+	std::vector<dreal> EstimationPlan::estimate() const
+	{
+		using Layout = SignalPointSet::Layout;
+
+		integer trials = signalSet_.width();
+		integer spaces = spaceSet_.size();
+		integer searches = searchSet_.size();
+		integer requests = requestSet_.size();
+
+		auto empty = [&](integer i)
+		{
+			return spaceSet_[i].tBegin == spaceSet_[i].tEnd;
+		};
+
+		// Build the joint point sets.
+
+		std::vector<std::vector<LaggedSignal>> laggedSet(spaces);
+		std::vector<SignalPointSet> pointSet(spaces);
+
+		tbb::parallel_for((integer)0, spaces,
+			[&](integer i)
+			{
+				const Space& space = spaceSet_[i];
+				if (space.source >= 0 || empty(i))
+				{
+					return;
+				}
+
+				laggedSet[i].reserve(trials);
+				lagSignals(signalSet_,
+					ranges::views::keys(space.componentSet),
+					std::back_inserter(laggedSet[i]),
+					ranges::views::values(space.componentSet));
+
+				pointSet[i] = SignalPointSet(laggedSet[i], Layout::Packed);
+			});
+
+		// Search the joint point sets, and build the marginal
+		// point sets, in parallel. The marginal point sets
+		// only read the joint point sets.
+
+		// The distances to the k:th nearest neighbors of each
+		// search, for each of its k's.
+		std::vector<std::vector<std::vector<dreal>>> distanceSet(searches);
+
+		auto searchJoint = [&](integer i)
+		{
+			const Search& search = searchSet_[i];
+			if (empty(search.space))
+			{
+				return;
+			}
+
+			const SignalPointSet& joint = pointSet[search.space];
+			integer n = joint.end() - joint.begin();
+			integer kNearest = search.kNearestSet.back();
+			integer kSearches = search.kNearestSet.size();
+
+			distanceSet[i].assign(kSearches, std::vector<dreal>(n));
+			if (kSearches == 1)
+			{
+				joint.searchAllNearest(
+					kNearest, distanceSet[i][0].data(),
+					nullptr, search.maxRelativeError);
+				return;
+			}
+
+			// The searches are exact. The neighbors are found
+			// for the maximum k, and the distances to the
+			// nearer neighbors are computed from them.
+
+			std::vector<integer> neighborSet(n * kNearest);
+			joint.searchAllNearest(
+				kNearest, distanceSet[i].back().data(),
+				neighborSet.data());
+
+			tbb::parallel_for((integer)0, n,
+				[&](integer j)
+				{
+					const dreal* query = *(joint.begin() + j);
+					for (integer r = 0;r < kSearches - 1;++r)
+					{
+						integer neighbor =
+							neighborSet[j * kNearest + search.kNearestSet[r] - 1];
+
+						distanceSet[i][r][j] = (neighbor < 0) ?
+							infinity<dreal>() :
+							storedDistance(query,
+								*(joint.begin() + neighbor),
+								joint.dimension());
+					}
+				});
+		};
+
+		auto buildMarginal = [&](integer i)
+		{
+			const Space& space = spaceSet_[i];
+			if (space.source < 0 || empty(i))
+			{
+				return;
+			}
+
+			pointSet[i] = SignalPointSet(
+				pointSet[space.source],
+				space.dimensionBegin, space.dimensionEnd,
+				Layout::Packed);
+		};
+
+		tbb::parallel_invoke(
+			[&]()
+			{
+				tbb::parallel_for((integer)0, searches, searchJoint);
+			},
+			[&]()
+			{
+				tbb::parallel_for((integer)0, spaces, buildMarginal);
+			});
+
+		// Combine the estimates.
+
+		std::vector<dreal> result(requests, 0);
+
+		tbb::parallel_for((integer)0, requests,
+			[&](integer i)
+			{
+				const Request& request = requestSet_[i];
+				if (empty(request.joint) || request.marginalSet.empty())
+				{
+					return;
+				}
+
+				const Search& search = searchSet_[request.search];
+				integer k = std::lower_bound(
+					search.kNearestSet.begin(), search.kNearestSet.end(),
+					request.kNearest) - search.kNearestSet.begin();
+
+				std::vector<const SignalPointSet*> marginalSet;
+				marginalSet.reserve(request.marginalSet.size());
+				for (integer marginal : request.marginalSet)
+				{
+					marginalSet.push_back(&pointSet[marginal]);
+				}
+
+				result[i] = Detail_EntropyCombination::combine(
+					pointSet[request.joint], marginalSet,
+					request.offsetSet, request.weightSet,
+					distanceSet[request.search][k], request.kNearest);
+			});
+
+		return result;
+	}
+
+	// Private
+
+	integer EstimationPlan::space(
+		const std::vector<Component>& componentSet,
+		integer tBegin, integer tEnd,
+		integer source,
+		integer dimensionBegin, integer dimensionEnd)
+	{
+		Key key(componentSet, std::make_pair(tBegin, tEnd));
+
+		auto iter = spaceIndex_.find(key);
+		if (iter != spaceIndex_.end())
+		{
+			// A space which was a marginal becomes a
+			// joint space, when it is asked as one.
+			if (source < 0)
+			{
+				Space& space = spaceSet_[iter->second];
+				space.source = -1;
+				space.dimensionBegin = dimensionBegin;
+				space.dimensionEnd = dimensionEnd;
+			}
+			return iter->second;
+		}
+
+		Space space;
+		space.componentSet = componentSet;
+		space.tBegin = tBegin;
+		space.tEnd = tEnd;
+		space.source = source;
+		space.dimensionBegin = dimensionBegin;
+		space.dimensionEnd = dimensionEnd;
+
+		spaceSet_.push_back(space);
+		spaceIndex_.emplace(key, spaceSet_.size() - 1);
+		return spaceSet_.size() - 1;
+	}
+
+	integer EstimationPlan::search(
+		integer joint,
+		integer kNearest,
+		dreal maxRelativeError)
+	{
+		// The exact searches of a joint space are shared
+		// by all k's. An approximate search is shared only
+		// with the same k, since the error bound is relative
+		// to the k:th neighbor.
+
+		auto iter = std::find_if(searchSet_.begin(), searchSet_.end(),
+			[&](const Search& search)
+			{
+				return search.space == joint &&
+					search.maxRelativeError == maxRelativeError &&
+					(maxRelativeError == 0 ||
+					search.kNearestSet.front() == kNearest);
+			});
+
+		if (iter == searchSet_.end())
+		{
+			Search search;
+			search.space = joint;
+			search.maxRelativeError = maxRelativeError;
+			searchSet_.push_back(search);
+			iter = searchSet_.end() - 1;
+		}
+
+		std::vector<integer>& kNearestSet = iter->kNearestSet;
+		auto position = std::lower_bound(
+			kNearestSet.begin(), kNearestSet.end(), kNearest);
+		if (position == kNearestSet.end() || *position != kNearest)
+		{
+			kNearestSet.insert(position, kNearest);
+		}
+
+		return iter - searchSet_.begin();
+	}
+
+}
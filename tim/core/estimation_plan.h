@@ -0,0 +1,243 @@
+// Description: EstimationPlan class
+// Detail: Estimates a batch of entropy combinations with shared point sets
+// Documentation: estimation_plan.txt
+
+#ifndef TIM_ESTIMATION_PLAN_H
+#define TIM_ESTIMATION_PLAN_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/signal.h"
+
+#include <pastel/sys/array/array.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace Tim
+{
+
+	//! Estimates a batch of entropy combinations with shared point sets
+	/*!
+	The plan is over an ensemble of signals, from which each
+	estimate picks its own signals, lags, marginals and k.
+	Mutual information, transfer entropy, and their partial
+	versions, are entropy combinations whose marginals often
+	coincide; for example, the transfer entropies from X to
+	Y and from X to Z, with the same lags, both have the
+	marginal (w, X). The plan identifies a point set by its
+	lagged signals and its time interval, builds each such
+	point set once, and searches each joint point set only
+	once for all the k's with exact searches.
+
+	The estimate() function then builds all the point sets,
+	carries out all the searches and combines the estimates,
+	in parallel. The estimates are the same as those of
+	separate entropyCombination() calls.
+	*/
+	class TIM EstimationPlan
+	{
+	public:
+		//! Constructs an empty plan.
+		EstimationPlan();
+
+		//! Constructs a plan over an ensemble of signals.
+		/*!
+		signalSet:
+		An ensemble of signals representing trials of the
+		same experiment, as in entropyCombination(). The
+		signals are not copied, and must outlive the calls
+		to estimate().
+		*/
+		explicit EstimationPlan(const Array<Signal>& signalSet);
+
+		//! Adds an entropy combination to the plan.
+		/*!
+		Preconditions:
+		!signalSet.empty()
+		lagSet.size() == signalSet.size()
+		0 <= signalSet[i] < signals()
+		0 <= range[0] < range[1] <= signalSet.size(), for each range.
+		kNearest > 0
+		maxRelativeError >= 0
+
+		signalSet:
+		The signals, in the order of their dimensions in
+		the joint signal.
+
+		rangeSet, lagSet, kNearest, maxRelativeError:
+		See entropyCombination(). The ranges refer to the
+		positions in 'signalSet'.
+
+		Returns:
+		The index of the estimate in the result of estimate().
+		*/
+		integer add(
+			const std::vector<integer>& signalSet,
+			const std::vector<Integer3>& rangeSet,
+			const std::vector<integer>& lagSet,
+			integer kNearest = 1,
+			dreal maxRelativeError = 0);
+
+		//! Adds mutual information to the plan.
+		/*!
+		This is as mutualInformation(); the arguments are
+		the indices of the signals X and Y in the ensemble.
+		*/
+		integer addMutualInformation(
+			integer x, integer y,
+			integer xLag = 0, integer yLag = 0,
+			integer kNearest = 1);
+
+		//! Adds transfer entropy to the plan.
+		/*!
+		This is as transferEntropy(); the arguments are
+		the indices of the signals X, Y and W in the ensemble.
+		*/
+		integer addTransferEntropy(
+			integer x, integer y, integer w,
+			integer xLag = 0, integer yLag = 0, integer wLag = 0,
+			integer kNearest = 1);
+
+		//! Adds partial mutual information to the plan.
+		/*!
+		This is as partialMutualInformation(); the arguments
+		are the indices of the signals X, Y and Z in the ensemble.
+		*/
+		integer addPartialMutualInformation(
+			integer x, integer y, integer z,
+			integer xLag = 0, integer yLag = 0, integer zLag = 0,
+			integer kNearest = 1);
+
+		//! Adds partial transfer entropy to the plan.
+		/*!
+		This is as partialTransferEntropy(); the arguments
+		are the indices of the signals X, Y, Z and W in the
+		ensemble.
+		*/
+		integer addPartialTransferEntropy(
+			integer x, integer y, integer z, integer w,
+			integer xLag = 0, integer yLag = 0, integer zLag = 0,
+			integer wLag = 0,
+			integer kNearest = 1);
+
+		//! Returns the number of signals in the ensemble.
+		integer signals() const;
+
+		//! Returns the number of estimates in the plan.
+		integer estimates() const;
+
+		//! Returns the number of distinct point sets in the plan.
+		integer pointSets() const;
+
+		//! Returns the number of distinct joint searches in the plan.
+		integer searches() const;
+
+		//! Computes the estimates.
+		/*!
+		Returns:
+		The i:th element is the i:th added estimate.
+		*/
+		std::vector<dreal> estimate() const;
+
+	private:
+		// A signal with its lag.
+		using Component = std::pair<integer, integer>;
+
+		// A point set is identified by its lagged signals,
+		// and by the time interval on which it is defined.
+		using Key = std::pair<std::vector<Component>, std::pair<integer, integer>>;
+
+		struct Space
+		{
+			// The lagged signals.
+			std::vector<Component> componentSet;
+
+			// The time interval [tBegin, tEnd[ of the points.
+			integer tBegin;
+			integer tEnd;
+
+			// The joint space from which this space is
+			// projected, or -1 if this is a joint space.
+			integer source;
+
+			// The dimensions of this space in the source.
+			integer dimensionBegin;
+			integer dimensionEnd;
+		};
+
+		struct Search
+		{
+			// The joint space to search.
+			integer space;
+
+			// The allowed relative error.
+			dreal maxRelativeError;
+
+			// The distinct k's, in ascending order.
+			std::vector<integer> kNearestSet;
+		};
+
+		struct Request
+		{
+			// The joint space.
+			integer joint;
+
+			// The marginal spaces.
+			std::vector<integer> marginalSet;
+
+			// The offset of each marginal in the joint space.
+			std::vector<integer> offsetSet;
+
+			// The weight of each marginal.
+			std::vector<integer> weightSet;
+
+			// The search of the joint space.
+			integer search;
+
+			// The k:th nearest neighbor to use.
+			integer kNearest;
+		};
+
+		// Returns the index of the space, adding it if
+		// necessary.
+		integer space(
+			const std::vector<Component>& componentSet,
+			integer tBegin, integer tEnd,
+			integer source,
+			integer dimensionBegin, integer dimensionEnd);
+
+		// Returns the index of the search, adding it if
+		// necessary.
+		integer search(
+			integer joint,
+			integer kNearest,
+			dreal maxRelativeError);
+
+		/*
+		signalSet_:
+		The ensemble of signals.
+
+		spaceSet_:
+		The distinct point sets.
+
+		spaceIndex_:
+		The index of each point set in 'spaceSet_'.
+
+		searchSet_:
+		The distinct searches of the joint spaces.
+
+		requestSet_:
+		The estimates.
+		*/
+
+		Array<Signal> signalSet_;
+		std::vector<Space> spaceSet_;
+		std::map<Key, integer> spaceIndex_;
+		std::vector<Search> searchSet_;
+		std::vector<Request> requestSet_;
+	};
+
+}
+
+#endif
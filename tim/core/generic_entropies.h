@@ -0,0 +1,644 @@
+// Description: Multi-output generic entropy estimation
+// Detail: Evaluates many entropy algorithms from a single k-nn search
+// Documentation: generic_entropy.txt
+
+#ifndef TIM_GENERIC_ENTROPIES_H
+#define TIM_GENERIC_ENTROPIES_H
+
+#include "tim/core/signal.h"
+#include "tim/core/signal_tools.h"
+#include "tim/core/signalpointset.h"
+#include "tim/core/reconstruction.h"
+#include "tim/core/temporal_hop.h"
+
+#include <pastel/sys/range.h>
+
+#include <pastel/geometry/search_nearest.h>
+#include <pastel/geometry/nearestset/kdtree_nearestset.h>
+
+#include <pastel/math/normbijection/maximum_normbijection.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+
+namespace Tim
+{
+
+	//! The distances to the k nearest neighbors of points.
+	template <typename Distance>
+	struct NearestDistances
+	{
+		//! The number of neighbors stored for each point.
+		integer kNearest = 0;
+
+		//! The dimension of the points.
+		integer dimension = 0;
+
+		//! The number of points.
+		integer points = 0;
+
+		//! The distances, kNearest for each point.
+		/*!
+		The distance from the i:th point to its k:th nearest
+		neighbor, k >= 1, is distanceSet[i * kNearest + k - 1].
+		The distance is infinity if there is no such neighbor.
+		*/
+		std::vector<Distance> distanceSet;
+	};
+
+	namespace Detail_GenericEntropies
+	{
+
+		//! Finds the distances to the k nearest neighbors.
+		/*!
+		The queries are the points [pointSet.begin() + queryBegin,
+		pointSet.begin() + queryEnd[. The distances of the i:th
+		query are stored in ascending order in
+		[distanceSet + i * kNearest, distanceSet + (i + 1) * kNearest[.
+		With a norm supported by the point set, see NormMetric,
+		the search is a batch search in the search structure of
+		the point set. The search is measured by the
+		instrumentation of the point set.
+		*/
+		template <typename Norm, typename Distance>
+		void searchDistances(
+			const SignalPointSet& pointSet,
+			const Norm& norm,
+			integer kNearest,
+			integer queryBegin,
+			integer queryEnd,
+			Distance* distanceSet)
+		{
+			constexpr bool batchNorm = NormMetric<Norm>::exists;
+
+			using Block = tbb::blocked_range<integer>;
+
+			integer queries = queryEnd - queryBegin;
+			integer dimension = pointSet.dimension();
+
+			Instrumentation* instrumentation = pointSet.instrumentation();
+			TIM_PHASE(instrumentation, JointSearch);
+
+			if constexpr (batchNorm)
+			{
+				// The batch search gives the neighbors; their
+				// distances are recomputed from the coordinates,
+				// as the search structure measures them, so that
+				// they agree with the batch search, and stay in
+				// ascending order.
+
+				std::vector<dreal> kthSet(queries);
+				std::vector<integer> neighborSet(queries * kNearest);
+				pointSet.searchAllNearest(
+					kNearest, queryBegin, queryEnd,
+					kthSet.data(), neighborSet.data());
+
+				tbb::parallel_for(Block(0, queries),
+					[&](const Block& block)
+					{
+						for (integer i = block.begin();i < block.end();++i)
+						{
+							const dreal* query =
+								*(pointSet.begin() + queryBegin + i);
+
+							for (integer r = 0;r < kNearest;++r)
+							{
+								integer j = neighborSet[i * kNearest + r];
+								if (j < 0)
+								{
+									distanceSet[i * kNearest + r] = norm(infinity<dreal>());
+									continue;
+								}
+
+								const dreal* point = *(pointSet.begin() + j);
+
+								distanceSet[i * kNearest + r] = 
+									norm(pointSet.distance(query, point));
+							}
+						}
+					});
+			}
+			else
+			{
+				tbb::parallel_for(Block(0, queries),
+					[&](const Block& block)
+					{
+						std::vector<Distance> neighborSet;
+						for (integer i = block.begin();i < block.end();++i)
+						{
+							const dreal* query = *(pointSet.begin() + queryBegin + i);
+
+							Vector<dreal> queryPoint(
+								ofDimension(dimension),
+								withAliasing((dreal*)query));
+
+							TIM_COUNT(instrumentation, nearestQueries, 1);
+
+							neighborSet.clear();
+							searchNearest(
+								kdTreeNearestSet(pointSet.kdTree()),
+								queryPoint,
+								PASTEL_TAG(accept), countingIndicator(instrumentation,
+									[query](const SignalPointSet::Point_ConstIterator& point)
+									{
+										return point->point() != query;
+									}),
+								PASTEL_TAG(norm), norm,
+								PASTEL_TAG(kNearest), kNearest,
+								PASTEL_TAG(report), [&](auto distance, auto point)
+								{
+									neighborSet.push_back(distance);
+								});
+
+							std::sort(neighborSet.begin(), neighborSet.end(),
+								[](const Distance& left, const Distance& right)
+								{
+									return (dreal)left < (dreal)right;
+								});
+
+							Distance* output = distanceSet + i * kNearest;
+							std::copy(neighborSet.begin(), neighborSet.end(), output);
+							std::fill(output + neighborSet.size(), output + kNearest,
+								norm(infinity<dreal>()));
+						}
+					});
+			}
+		}
+
+		//! Sums the terms of an entropy algorithm over points.
+		/*!
+		Returns:
+		The weighted sum of entropyAlgorithm.sumTerm() over
+		the distances to the k:th nearest neighbors of the points
+		[0, points[, and the sum of the weights. The points whose
+		distance is zero are not taken in. The i:th point has the
+		weight weight(i).
+		*/
+		template <
+			typename Distance,
+			typename EntropyAlgorithm,
+			typename Weight>
+		std::pair<dreal, dreal> sumTerms(
+			const Distance* distanceSet,
+			integer distanceStride,
+			integer points,
+			const EntropyAlgorithm& entropyAlgorithm,
+			integer kNearest,
+			const Weight& weight)
+		{
+			using Block = tbb::blocked_range<integer>;
+			using Pair = std::pair<dreal, dreal>;
+
+			auto compute = [&](
+				const Block& block,
+				const Pair& start)
+			{
+				dreal estimate = start.first;
+				dreal weightSum = start.second;
+
+				for (integer i = block.begin();i < block.end();++i)
+				{
+					const Distance& distance =
+						distanceSet[i * distanceStride + kNearest - 1];
+
+					// Points that are at identical positions do not
+					// provide any information. Such samples are
+					// not taken in the estimate.
+					if ((dreal)distance > 0)
+					{
+						dreal w = weight(i);
+						estimate += w * entropyAlgorithm.sumTerm(distance);
+						weightSum += w;
+					}
+				}
+
+				return Pair(estimate, weightSum);
+			};
+
+			auto reduce = [](const Pair& left, const Pair& right)
+			{
+				return Pair(
+					left.first + right.first,
+					left.second + right.second);
+			};
+
+			// The deterministic reduction guarantees that
+			// the estimates do not depend on the scheduling
+			// of the threads.
+
+			return tbb::parallel_deterministic_reduce(
+				Block(0, points, 256),
+				Pair(0, 0),
+				compute,
+				reduce);
+		}
+
+	}
+
+	//! Finds the distances to the k nearest neighbors of all points.
+	/*!
+	Preconditions:
+	kNearest > 0
+
+	signalSet:
+	An ensemble of signals representing trials
+	of the same experiment.
+
+	kNearest:
+	The number of nearest neighbors to find for each point.
+
+	norm:
+	The norm to use.
+
+	layout:
+	The search structure to use, when the norm is supported
+	by SignalPointSet; see NormMetric. Otherwise the Pointer
+	layout is used.
+
+	instrumentation:
+	If not null, measures the phases and the searches.
+	See instrumentation.txt.
+
+	Returns:
+	The distances to the k nearest neighbors of each point,
+	from which genericEntropy() can be evaluated for any
+	entropy algorithm with the same norm, and any k not
+	greater than kNearest.
+	*/
+	template <
+		ranges::forward_range Signal_Range,
+		typename Norm>
+	auto nearestDistances(
+		const Signal_Range& signalSet,
+		integer kNearest,
+		const Norm& norm,
+		SignalPointSet::Layout layout = SignalPointSet::Layout::Automatic,
+		Instrumentation* instrumentation = nullptr)
+	-> NearestDistances<decltype(norm())>
+	{
+		ENSURE_OP(kNearest, >, 0);
+
+		using Distance = decltype(norm());
+		constexpr bool batchNorm = NormMetric<Norm>::exists;
+
+		NearestDistances<Distance> result;
+		result.kNearest = kNearest;
+
+		if (ranges::empty(signalSet))
+		{
+			return result;
+		}
+
+		SignalPointSet pointSet(signalSet,
+			batchNorm ?
+			layout :
+			SignalPointSet::Layout::Pointer,
+			NormMetric<Norm>::value,
+			instrumentation);
+
+		integer points = pointSet.end() - pointSet.begin();
+
+		result.dimension = pointSet.dimension();
+		result.points = points;
+		result.distanceSet.resize(points * kNearest);
+
+		Detail_GenericEntropies::searchDistances(
+			pointSet, norm, kNearest, 0, points,
+			result.distanceSet.data());
+
+		return result;
+	}
+
+	//! Generic entropy from precomputed distances.
+	/*!
+	Preconditions:
+	0 < kNearest <= distances.kNearest
+
+	distances:
+	The distances to the nearest neighbors, as computed by
+	nearestDistances() with the norm of the entropy algorithm.
+
+	This gives the same estimate as genericEntropy() for the
+	signals, but without searching.
+	*/
+	template <
+		typename Distance,
+		typename EntropyAlgorithm>
+	dreal genericEntropy(
+		const NearestDistances<Distance>& distances,
+		const EntropyAlgorithm& entropyAlgorithm,
+		integer kNearest)
+	{
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE_OP(kNearest, <=, distances.kNearest);
+
+		if (distances.points == 0)
+		{
+			return (dreal)Nan();
+		}
+
+		dreal estimate = 0;
+		dreal acceptedSamples = 0;
+
+		std::tie(estimate, acceptedSamples) =
+			Detail_GenericEntropies::sumTerms(
+				distances.distanceSet.data(),
+				distances.kNearest,
+				distances.points,
+				entropyAlgorithm,
+				kNearest,
+				[](integer) {return (dreal)1;});
+
+		if (acceptedSamples == 0)
+		{
+			// If all distances were zero, we can't say
+			// anything about generic entropy. This is
+			// marked with a NaN.
+			return (dreal)Nan();
+		}
+
+		return entropyAlgorithm.finishEstimate(
+			estimate / acceptedSamples, distances.dimension,
+			kNearest, distances.points);
+	}
+
+	//! Computes generic entropies for many entropy algorithms at once.
+	/*!
+	Preconditions:
+	ranges::size(kNearestSet) == ranges::size(entropyAlgorithmSet)
+	Each k in kNearestSet is positive.
+
+	entropyAlgorithmSet:
+	The entropy algorithms, all of which use the same norm.
+
+	kNearestSet:
+	The k:th nearest neighbor to use for each entropy algorithm.
+
+	layout, instrumentation:
+	See nearestDistances().
+
+	Returns:
+	The i:th element is genericEntropy(signalSet,
+	entropyAlgorithmSet[i], kNearestSet[i]).
+
+	The distances to the K nearest neighbors, where K is the
+	maximum of kNearestSet, are searched only once. Each estimate
+	is then evaluated from these distances.
+	*/
+	template <
+		ranges::forward_range Signal_Range,
+		ranges::forward_range EntropyAlgorithm_Range,
+		ranges::forward_range Integer_Range>
+	std::vector<dreal> genericEntropies(
+		const Signal_Range& signalSet,
+		const EntropyAlgorithm_Range& entropyAlgorithmSet,
+		const Integer_Range& kNearestSet,
+		SignalPointSet::Layout layout = SignalPointSet::Layout::Automatic,
+		Instrumentation* instrumentation = nullptr)
+	{
+		ENSURE_OP(ranges::size(kNearestSet), ==, ranges::size(entropyAlgorithmSet));
+
+		integer estimates = ranges::size(entropyAlgorithmSet);
+
+		std::vector<dreal> result;
+		result.reserve(estimates);
+
+		if (estimates == 0)
+		{
+			return result;
+		}
+
+		integer maxNearest = 0;
+		for (integer kNearest : kNearestSet)
+		{
+			ENSURE_OP(kNearest, >, 0);
+			maxNearest = std::max(maxNearest, kNearest);
+		}
+
+		auto distances = nearestDistances(
+			signalSet, maxNearest,
+			std::begin(entropyAlgorithmSet)->norm(),
+			layout, instrumentation);
+
+		auto kIter = std::begin(kNearestSet);
+		for (auto&& entropyAlgorithm : entropyAlgorithmSet)
+		{
+			result.push_back(
+				genericEntropy(distances, entropyAlgorithm, *kIter));
+			++kIter;
+		}
+
+		return result;
+	}
+
+	//! Computes temporal generic entropies for many entropy algorithms at once.
+	/*!
+	Preconditions:
+	timeWindowRadius >= 0
+	ranges::size(kNearestSet) == ranges::size(entropyAlgorithmSet)
+	Each k in kNearestSet is positive.
+
+	entropyAlgorithmSet, kNearestSet:
+	See genericEntropies().
+
+	timeWindowRadius, filter, hop:
+	See temporalGenericEntropy().
+
+	layout, instrumentation:
+	See nearestDistances().
+
+	Returns:
+	The i:th element is temporalGenericEntropy(signalSet,
+	entropyAlgorithmSet[i], timeWindowRadius, kNearestSet[i],
+	filter).
+
+	At each time instant, the distances to the K nearest
+	neighbors, where K is the maximum of kNearestSet, are
+	searched only once, and shared by all the estimates.
+	*/
+	template <
+		ranges::forward_range Signal_Range,
+		ranges::forward_range EntropyAlgorithm_Range,
+		ranges::forward_range Integer_Range,
+		ranges::forward_range Filter_Range>
+	std::vector<SignalData> temporalGenericEntropies(
+		const Signal_Range& signalSet,
+		const EntropyAlgorithm_Range& entropyAlgorithmSet,
+		const Integer_Range& kNearestSet,
+		integer timeWindowRadius,
+		const Filter_Range& filter,
+		SignalPointSet::Layout layout = SignalPointSet::Layout::Automatic,
+		const TemporalHop& hop = TemporalHop(),
+		Instrumentation* instrumentation = nullptr)
+	{
+		ENSURE_OP(timeWindowRadius, >=, 0);
+		ENSURE_OP(ranges::size(kNearestSet), ==, ranges::size(entropyAlgorithmSet));
+		ENSURE(odd(ranges::size(filter)));
+		ENSURE_OP(hop.hop, >, 0);
+
+		integer estimates = ranges::size(entropyAlgorithmSet);
+
+		if (ranges::empty(signalSet) || estimates == 0)
+		{
+			return std::vector<SignalData>(estimates);
+		}
+
+		std::vector<integer> copyNearestSet(
+			std::begin(kNearestSet), std::end(kNearestSet));
+
+		integer maxNearest = 0;
+		for (integer kNearest : copyNearestSet)
+		{
+			ENSURE_OP(kNearest, >, 0);
+			maxNearest = std::max(maxNearest, kNearest);
+		}
+
+		auto norm = std::begin(entropyAlgorithmSet)->norm();
+		using Norm = decltype(norm);
+		using Distance = decltype(norm());
+
+		constexpr bool batchNorm = NormMetric<Norm>::exists;
+
+		Integer2 sharedTime = sharedTimeInterval(signalSet);
+		integer estimateBegin = sharedTime[0];
+		integer estimateEnd = sharedTime[1];
+		integer samples = estimateEnd - estimateBegin;
+
+		integer trials = ranges::size(signalSet);
+		integer dimension = std::begin(signalSet)->dimension();
+
+		ENSURE_OP(maxNearest, <, samples * trials);
+
+		// Copy the filter and replicate
+		// the values to each trial.
+
+		integer filterWidth = ranges::size(filter);
+		integer filterRadius = filterWidth / 2;
+		integer maxLocalFilterWidth =
+			std::min(filterWidth, samples);
+
+		std::vector<dreal> copyFilter;
+		copyFilter.reserve(filterWidth * trials);
+		for (dreal weight : filter)
+		{
+			std::fill_n(
+				std::back_inserter(copyFilter), trials, weight);
+		}
+
+		std::vector<SignalData> result;
+		result.reserve(estimates);
+		for (integer i = 0;i < estimates;++i)
+		{
+			result.emplace_back(1, samples, estimateBegin);
+		}
+
+		std::vector<Distance> distanceSet(
+			maxLocalFilterWidth * trials * maxNearest);
+
+		SignalPointSet pointSet(signalSet,
+			batchNorm ?
+			layout :
+			SignalPointSet::Layout::Pointer,
+			NormMetric<Norm>::value,
+			instrumentation);
+
+		// Estimates the given time instants, in ascending order.
+		auto estimateInstants = [&](
+			const integer* tSetBegin, const integer* tSetEnd)
+		{
+			for (const integer* tIter = tSetBegin;tIter != tSetEnd;++tIter)
+			{
+				integer t = *tIter;
+
+				// Update the position of the time-window.
+
+				pointSet.setTimeWindow(
+					t - timeWindowRadius,
+					t + timeWindowRadius + 1);
+
+				integer tBegin = pointSet.windowBegin();
+				integer tEnd = pointSet.windowEnd();
+				integer tWidth = tEnd - tBegin;
+				integer tLocalFilterBegin = std::max(t - filterRadius, tBegin) - tBegin;
+				integer tLocalFilterEnd = std::min(t + filterRadius + 1, tEnd) - tBegin;
+				integer tFilterDelta = tBegin - (t - filterRadius);
+				integer tFilterOffset = std::max(tFilterDelta, (integer)0);
+
+				const integer windowSamples = (tLocalFilterEnd - tLocalFilterBegin) * trials;
+				const integer filterOffset = tFilterOffset * trials;
+
+				// Search the distances once for all the estimates.
+
+				Detail_GenericEntropies::searchDistances(
+					pointSet, norm, maxNearest,
+					tLocalFilterBegin * trials,
+					tLocalFilterEnd * trials,
+					distanceSet.data());
+
+				auto kIter = copyNearestSet.begin();
+				auto resultIter = result.begin();
+				for (auto&& entropyAlgorithm : entropyAlgorithmSet)
+				{
+					dreal estimate = 0;
+					dreal weightSum = 0;
+
+					std::tie(estimate, weightSum) =
+						Detail_GenericEntropies::sumTerms(
+							distanceSet.data(),
+							maxNearest,
+							windowSamples,
+							entropyAlgorithm,
+							*kIter,
+							[&](integer i) {return copyFilter[i + filterOffset];});
+
+					if (weightSum != 0)
+					{
+						resultIter->data()(t - estimateBegin) =
+							entropyAlgorithm.finishEstimate(
+							estimate / weightSum, dimension,
+							*kIter, tWidth * trials);
+					}
+					else
+					{
+						// If all distances were zero, we can't say
+						// anything about generic entropy. This is
+						// marked with a NaN. We will later attempt
+						// to reconstruct these values.
+						resultIter->data()(t - estimateBegin) = (dreal)Nan();
+					}
+
+					++kIter;
+					++resultIter;
+				}
+			}
+		};
+
+		// Evaluate the time instants of the hop, and
+		// reconstruct the NaN's. The refinement compares
+		// all of the estimates.
+
+		std::vector<dreal*> estimateSet;
+		for (SignalData& estimate : result)
+		{
+			estimateSet.push_back(estimate.data().data());
+		}
+
+		estimateHops(
+			estimateBegin, estimateEnd, hop, 1,
+			estimateSet,
+			estimateInstants,
+			instrumentation);
+
+		return result;
+	}
+
+}
+
+#endif
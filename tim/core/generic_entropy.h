@@ -16,8 +16,11 @@
 #include <pastel/geometry/search_nearest.h>
 #include <pastel/geometry/nearestset/kdtree_nearestset.h>
 
+#include <pastel/math/normbijection/maximum_normbijection.h>
+
 #include <algorithm>
 #include <numeric>
+#include <type_traits>
 
 #include <tbb/parallel_reduce.h>
 #include <tbb/blocked_range.h>
@@ -29,6 +32,7 @@ namespace Tim
 	/*!
 	Preconditions:
 	kNearest > 0
+	maxRelativeError >= 0
 
 	signalSet:
 	An ensemble of signals representing trials
@@ -42,6 +46,26 @@ namespace Tim
 	The k:th nearest neighbor that is used to
 	estimate generic entropy.
 
+	maxRelativeError:
+	The allowed relative error in the distances to the
+	k:th nearest neighbors. Zero gives exact searches;
+	larger values trade accuracy for speed. See
+	SignalPointSet::searchNearest().
+
+	relativeError:
+	If not null, the relative error that the searches 
+	actually had is stored here. See 
+	SignalPointSet::relativeError().
+
+	layout:
+	The search structure to use, when the norm of the
+	entropy algorithm is supported by SignalPointSet; see 
+	NormMetric. Otherwise the Pointer layout is used.
+
+	instrumentation:
+	If not null, measures the phases and the searches
+	of the estimate. See instrumentation.txt.
+
 	Returns:
 	A generic entropy estimate if successful,
 	NaN otherwise. The estimation may fail only
@@ -54,9 +78,19 @@ namespace Tim
 	dreal genericEntropy(
 		const Signal_Range& signalSet,
 		const EntropyAlgorithm& entropyAlgorithm,
-		integer kNearest = 1)
+		integer kNearest = 1,
+		dreal maxRelativeError = 0,
+		dreal* relativeError = nullptr,
+		SignalPointSet::Layout layout = SignalPointSet::Layout::Automatic,
+		Instrumentation* instrumentation = nullptr)
 	{
 		ENSURE_OP(kNearest, >, 0);
+		ENSURE_OP(maxRelativeError, >=, 0);
+
+		if (relativeError)
+		{
+			*relativeError = 0;
+		}
 
 		typedef typename SignalPointSet::Point_ConstIterator
 			Point_ConstIterator;
@@ -67,13 +101,29 @@ namespace Tim
 		}
 
 		auto norm = entropyAlgorithm.norm();
+		using Norm = decltype(norm);
 		using Distance = decltype(norm());
 
+		// With a norm supported by the point set, the 
+		// distances are found by a batch search in the
+		// chosen search structure.
+		constexpr bool batchNorm = NormMetric<Norm>::exists;
+
 		// This function encapsulates the common
 		// properties of the entropy estimation 
 		// algorithms based on k-nearest neighbors.
 
-		SignalPointSet pointSet(signalSet);
+		SignalPointSet pointSet(signalSet, 
+			batchNorm ? 
+			layout : 
+			SignalPointSet::Layout::Pointer,
+			NormMetric<Norm>::value,
+			instrumentation);
+
+		if (relativeError)
+		{
+			*relativeError = pointSet.relativeError(maxRelativeError);
+		}
 
 		integer trials = ranges::size(signalSet);
 		integer samples = pointSet.samples();
@@ -81,15 +131,60 @@ namespace Tim
 
 		const integer estimateSamples = samples * trials;
 
+		TIM_PHASE(instrumentation, JointSearch);
+
 		// Store the point-iterators into an array
-		// for random-access for parallel_for.
+		// for random-access for parallel_for. Only
+		// the Pointer layout has a kd-tree.
 		std::vector<Point_ConstIterator> indexedPointSet;
-		indexedPointSet.reserve(pointSet.kdTree().points());
-		for (auto i = pointSet.kdTree().begin(); i != pointSet.kdTree().end(); ++i)
+		if constexpr (!batchNorm)
 		{
-			indexedPointSet.emplace_back(i);
+			indexedPointSet.reserve(pointSet.kdTree().points());
+			for (auto i = pointSet.kdTree().begin(); i != pointSet.kdTree().end(); ++i)
+			{
+				indexedPointSet.emplace_back(i);
+			}
+		}
+
+		std::vector<dreal> batchDistanceSet;
+		if constexpr (batchNorm)
+		{
+			batchDistanceSet.resize(estimateSamples);
+			pointSet.searchAllNearest(
+				kNearest, batchDistanceSet.data(), 
+				nullptr, maxRelativeError);
 		}
 
+		// Returns the distance to the k:th nearest 
+		// neighbor of the i:th point.
+		auto nearestDistance = [&](integer i) -> Distance
+		{
+			if constexpr (batchNorm)
+			{
+				return norm(batchDistanceSet[i]);
+			}
+			else
+			{
+				auto query = indexedPointSet[i];
+
+				TIM_COUNT(instrumentation, nearestQueries, 1);
+
+				Vector<dreal> queryPoint(
+					ofDimension(pointSet.dimension()),
+					withAliasing((dreal*)(query->point())));
+
+				return searchNearest(
+					kdTreeNearestSet(pointSet.kdTree()),
+					queryPoint,
+					PASTEL_TAG(accept), countingIndicator(
+						instrumentation, predicateIndicator(query, NotEqualTo())),
+					PASTEL_TAG(norm), entropyAlgorithm.norm(),
+					PASTEL_TAG(kNearest), kNearest,
+					PASTEL_TAG(maxRelativeError), maxRelativeError
+				).first;
+			}
+		};
+
 		using Block = tbb::blocked_range<integer>;
 		using Pair = std::pair<dreal, integer>;
 		
@@ -102,21 +197,8 @@ namespace Tim
 
 			for (integer i = block.begin();i < block.end();++i)
 			{
-				auto query = indexedPointSet[i];
-
-				Vector<dreal> queryPoint(
-					ofDimension(pointSet.dimension()),
-					withAliasing((dreal*)(query->point())));
-
 				// Find the distance to the k:th nearest neighbor.
-				Distance distance2 =
-					searchNearest(
-						kdTreeNearestSet(pointSet.kdTree()),
-						queryPoint,
-						PASTEL_TAG(accept), predicateIndicator(query, NotEqualTo()),
-						PASTEL_TAG(norm), entropyAlgorithm.norm(),
-						PASTEL_TAG(kNearest), kNearest
-					).first;
+				Distance distance2 = nearestDistance(i);
 
 				// Points that are at identical positions do not
 				// provide any information. Such samples are
@@ -165,6 +247,110 @@ namespace Tim
 		return estimate;
 	}
 
+	//! Generic entropy of the points of a point set.
+	/*!
+	Preconditions:
+	kNearest > 0
+	maxRelativeError >= 0
+	NormMetric<Norm>::exists, where Norm is the norm 
+	of the entropy algorithm.
+	NormMetric<Norm>::value == pointSet.metric()
+
+	This is as genericEntropy() above, except that the
+	points are those in the time-window of an existing
+	point set, so that the point set can be reused 
+	between estimates. The searches are measured by
+	the instrumentation of the point set.
+	*/
+	template <typename EntropyAlgorithm>
+	dreal genericEntropy(
+		const SignalPointSet& pointSet,
+		const EntropyAlgorithm& entropyAlgorithm,
+		integer kNearest = 1,
+		dreal maxRelativeError = 0,
+		dreal* relativeError = nullptr)
+	{
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE_OP(maxRelativeError, >=, 0);
+
+		auto norm = entropyAlgorithm.norm();
+		using Norm = decltype(norm);
+		using Distance = decltype(norm());
+
+		static_assert(NormMetric<Norm>::exists,
+			"The norm must be supported by SignalPointSet.");
+		ENSURE(NormMetric<Norm>::value == pointSet.metric());
+
+		if (relativeError)
+		{
+			*relativeError = pointSet.relativeError(maxRelativeError);
+		}
+
+		const integer estimateSamples = pointSet.end() - pointSet.begin();
+		if (estimateSamples == 0)
+		{
+			return (dreal)Nan();
+		}
+
+		TIM_PHASE(pointSet.instrumentation(), JointSearch);
+
+		std::vector<dreal> distanceSet(estimateSamples);
+		pointSet.searchAllNearest(
+			kNearest, distanceSet.data(), 
+			nullptr, maxRelativeError);
+
+		using Block = tbb::blocked_range<integer>;
+		using Pair = std::pair<dreal, integer>;
+		
+		auto compute = [&](
+			const Block& block,
+			const Pair& start)
+		{
+			dreal estimate = start.first;
+			integer acceptedSamples = start.second;
+
+			for (integer i = block.begin();i < block.end();++i)
+			{
+				Distance distance2 = norm(distanceSet[i]);
+
+				// As in genericEntropy() above.
+				if ((dreal)distance2 > 0)
+				{
+					estimate += entropyAlgorithm.sumTerm(distance2);
+					++acceptedSamples;
+				}
+			}
+
+			return Pair(estimate, acceptedSamples);
+		};
+
+		auto reduce = [](const Pair& left, const Pair& right)
+		{
+			return Pair(
+				left.first + right.first, 
+				left.second + right.second);
+		};
+
+		dreal estimate = 0;
+		integer acceptedSamples = 0;
+
+		std::tie(estimate, acceptedSamples) = 
+			tbb::parallel_reduce(
+				Block(0, estimateSamples),
+				Pair(0, 0),
+				compute,
+				reduce);
+
+		if (acceptedSamples == 0)
+		{
+			return (dreal)Nan();
+		}
+
+		return entropyAlgorithm.finishEstimate(
+			estimate / acceptedSamples, pointSet.dimension(), 
+			kNearest, estimateSamples);
+	}
+
 }
 
 #endif
@@ -11,15 +11,19 @@
 #include <pastel/geometry/search_nearest.h>
 #include <pastel/geometry/nearestset/kdtree_nearestset.h>
 
+#include <pastel/math/normbijection/maximum_normbijection.h>
+
 #include "tim/core/signal_tools.h"
 #include "tim/core/signalpointset.h"
 #include "tim/core/reconstruction.h"
+#include "tim/core/temporal_hop.h"
 
 #include <tbb/blocked_range.h>
 #include <tbb/parallel_for.h>
 
 #include <algorithm>
 #include <numeric>
+#include <type_traits>
 
 namespace Tim
 {
@@ -29,6 +33,7 @@ namespace Tim
 	Preconditions:
 	timeWindowRadius >= 0
 	kNearest > 0
+	maxRelativeError >= 0
 
 	signalSet:
 	An ensemble of signals representing trials
@@ -53,6 +58,30 @@ namespace Tim
 	to the current time instant. The width of the array can 
 	be arbitrary but must be odd. The coefficients must sum
 	to a non-zero value.
+
+	maxRelativeError:
+	The allowed relative error in the distances to the
+	k:th nearest neighbors. Zero gives exact searches;
+	larger values trade accuracy for speed. See
+	SignalPointSet::searchNearest().
+
+	relativeError:
+	If not null, the relative error that the searches 
+	actually had is stored here. See 
+	SignalPointSet::relativeError().
+
+	layout:
+	The search structure to use, when the norm of the
+	entropy algorithm is supported by SignalPointSet; see 
+	NormMetric. Otherwise the Pointer layout is used.
+
+	hop:
+	The time instants at which to evaluate the estimate;
+	see TemporalHop. By default, every time instant.
+
+	instrumentation:
+	If not null, measures the phases and the searches
+	of the estimate. See instrumentation.txt.
 	*/
 	template <
 		ranges::forward_range Signal_Range, 
@@ -63,11 +92,23 @@ namespace Tim
 		const EntropyAlgorithm& entropyAlgorithm,
 		integer timeWindowRadius,
 		integer kNearest,
-		const Filter_Range& filter)
+		const Filter_Range& filter,
+		dreal maxRelativeError = 0,
+		dreal* relativeError = nullptr,
+		SignalPointSet::Layout layout = SignalPointSet::Layout::Automatic,
+		const TemporalHop& hop = TemporalHop(),
+		Instrumentation* instrumentation = nullptr)
 	{
 		ENSURE_OP(timeWindowRadius, >=, 0);
 		ENSURE_OP(kNearest, >, 0);
 		ENSURE(odd(ranges::size(filter)));
+		ENSURE_OP(maxRelativeError, >=, 0);
+		ENSURE_OP(hop.hop, >, 0);
+
+		if (relativeError)
+		{
+			*relativeError = 0;
+		}
 
 		typedef typename SignalPointSet::Point_ConstIterator
 			Point_ConstIterator;
@@ -82,8 +123,14 @@ namespace Tim
 		}
 
 		auto norm = entropyAlgorithm.norm();
+		using Norm = decltype(norm);
 		using Distance = decltype(norm());
 
+		// With a norm supported by the point set, the 
+		// distances are found by a batch search in the
+		// chosen search structure.
+		constexpr bool batchNorm = NormMetric<Norm>::exists;
+
 		Integer2 sharedTime = sharedTimeInterval(signalSet);
 		integer estimateBegin = sharedTime[0];
 		integer estimateEnd = sharedTime[1];
@@ -130,111 +177,158 @@ namespace Tim
 		// know how else this could be done.
 
 		Array<Distance> distanceArray(Vector2i(1, maxLocalFilterWidth * trials));
+		std::vector<dreal> batchDistanceSet(maxLocalFilterWidth * trials);
 
-		SignalPointSet pointSet(signalSet);
+		SignalPointSet pointSet(signalSet, 
+			batchNorm ? 
+			layout : 
+			SignalPointSet::Layout::Pointer,
+			NormMetric<Norm>::value,
+			instrumentation);
 
-		for (integer t = estimateBegin;t < estimateEnd;++t)
+		if (relativeError)
 		{
-			// Update the position of the time-window.
+			*relativeError = pointSet.relativeError(maxRelativeError);
+		}
 
-			pointSet.setTimeWindow(
-				t - timeWindowRadius, 
-				t + timeWindowRadius + 1);
+		// Estimates the given time instants, in ascending order.
+		auto estimateInstants = [&](
+			const integer* tSetBegin, const integer* tSetEnd)
+		{
+			for (const integer* tIter = tSetBegin;tIter != tSetEnd;++tIter)
+			{
+				integer t = *tIter;
+
+				// Update the position of the time-window.
 
-			integer tBegin = pointSet.windowBegin();
-			integer tEnd = pointSet.windowEnd();
-			integer tWidth = tEnd - tBegin;
-			integer tLocalFilterBegin = std::max(t - filterRadius, tBegin) - tBegin;
-			integer tLocalFilterEnd = std::min(t + filterRadius + 1, tEnd) - tBegin;
-			integer tFilterDelta = tBegin - (t - filterRadius);
-			integer tFilterOffset = std::max(tFilterDelta, (integer)0);
+				pointSet.setTimeWindow(
+					t - timeWindowRadius, 
+					t + timeWindowRadius + 1);
 
-			const integer windowSamples = (tLocalFilterEnd - tLocalFilterBegin) * trials;
+				integer tBegin = pointSet.windowBegin();
+				integer tEnd = pointSet.windowEnd();
+				integer tWidth = tEnd - tBegin;
+				integer tLocalFilterBegin = std::max(t - filterRadius, tBegin) - tBegin;
+				integer tLocalFilterEnd = std::min(t + filterRadius + 1, tEnd) - tBegin;
+				integer tFilterDelta = tBegin - (t - filterRadius);
+				integer tFilterOffset = std::max(tFilterDelta, (integer)0);
+
+				const integer windowSamples = (tLocalFilterEnd - tLocalFilterBegin) * trials;
 			
-			// For each point at the current time instant in all
-			// ensemble signals, find the distance to the k:th nearest 
-			// neighbor. Note that the SignalPointSet stores the
-			// point iterators interleaved so that for a given time instant
-			// the samples of ensemble signals are listed sequentially.
-			// I.e. if the ensemble signals are A, B and C, then
-			// SignalPointSet stores point iterators to 
-			// A(1), B(1), C(1), A(2), B(2), C(2), etc.
-			// That is, the distance between subsequent samples of a
-			// specific signal are 'trials' samples away.
-
-			using Block = tbb::blocked_range<integer>;
-
-			integer searchBegin = tLocalFilterBegin * trials;
-			integer searchEnd = tLocalFilterEnd * trials;
-
-			auto search = [&](const Block& block)
-			{
-				for (integer i = block.begin(); i < block.end(); ++i)
+				// For each point at the current time instant in all
+				// ensemble signals, find the distance to the k:th nearest 
+				// neighbor. Note that the SignalPointSet stores the
+				// point iterators interleaved so that for a given time instant
+				// the samples of ensemble signals are listed sequentially.
+				// I.e. if the ensemble signals are A, B and C, then
+				// SignalPointSet stores point iterators to 
+				// A(1), B(1), C(1), A(2), B(2), C(2), etc.
+				// That is, the distance between subsequent samples of a
+				// specific signal are 'trials' samples away.
+
+				using Block = tbb::blocked_range<integer>;
+
+				integer searchBegin = tLocalFilterBegin * trials;
+				integer searchEnd = tLocalFilterEnd * trials;
+
+				auto search = [&](const Block& block)
 				{
-					auto query = *(pointSet.begin() + i);
-
-					Vector<dreal> queryPoint(
-						ofDimension(pointSet.dimension()),
-						withAliasing((dreal*)(query->point())));
-
-					distanceArray(i - searchBegin) =
-						searchNearest(
-							kdTreeNearestSet(pointSet.kdTree()),
-							queryPoint,
-							PASTEL_TAG(accept), predicateIndicator(query, NotEqualTo()),
-							PASTEL_TAG(norm), entropyAlgorithm.norm(),
-							PASTEL_TAG(kNearest), kNearest
-						).first;
+					for (integer i = block.begin(); i < block.end(); ++i)
+					{
+						const dreal* query = *(pointSet.begin() + i);
+
+						TIM_COUNT(instrumentation, nearestQueries, 1);
+
+						Vector<dreal> queryPoint(
+							ofDimension(pointSet.dimension()),
+							withAliasing((dreal*)query));
+
+						distanceArray(i - searchBegin) =
+							searchNearest(
+								kdTreeNearestSet(pointSet.kdTree()),
+								queryPoint,
+								PASTEL_TAG(accept), countingIndicator(instrumentation,
+									[query](const Point_ConstIterator& point)
+									{
+										return point->point() != query;
+									}),
+								PASTEL_TAG(norm), entropyAlgorithm.norm(),
+								PASTEL_TAG(kNearest), kNearest,
+								PASTEL_TAG(maxRelativeError), maxRelativeError
+							).first;
+					}
+				};
+
+				TIM_PHASE(instrumentation, JointSearch);
+
+				if constexpr (batchNorm)
+				{
+					pointSet.searchAllNearest(
+						kNearest, searchBegin, searchEnd, 
+						batchDistanceSet.data(), nullptr, 
+						maxRelativeError);
+
+					for (integer i = 0;i < windowSamples;++i)
+					{
+						distanceArray(i) = norm(batchDistanceSet[i]);
+					}
+				}
+				else
+				{
+					tbb::parallel_for(
+						Block(searchBegin, searchEnd),
+						search);
 				}
-			};
-
-			tbb::parallel_for(
-				Block(searchBegin, searchEnd),
-				search);
 
-			// After we have found the distances, we simply evaluate
-			// the generic entropy estimator over the samples of
-			// the current time instant.
+				// After we have found the distances, we simply evaluate
+				// the generic entropy estimator over the samples of
+				// the current time instant.
 
-			dreal weightSum = 0;
-			const integer filterOffset = tFilterOffset * trials;
-			dreal estimate = 0;
-			for (integer i = 0;i < windowSamples;++i)
-			{
-				// Points that are at identical positions do not
-				// provide any information. Such samples are
-				// not taken in the estimate.
-				if ((dreal)distanceArray(i) > 0)
+				dreal weightSum = 0;
+				const integer filterOffset = tFilterOffset * trials;
+				dreal estimate = 0;
+				for (integer i = 0;i < windowSamples;++i)
 				{
-					dreal weight = copyFilter[i + filterOffset];
-
-					estimate += weight * entropyAlgorithm.sumTerm(distanceArray(i));
-					weightSum += weight;
+					// Points that are at identical positions do not
+					// provide any information. Such samples are
+					// not taken in the estimate.
+					if ((dreal)distanceArray(i) > 0)
+					{
+						dreal weight = copyFilter[i + filterOffset];
+
+						estimate += weight * entropyAlgorithm.sumTerm(distanceArray(i));
+						weightSum += weight;
+					}
 				}
-			}
-			if (weightSum != 0)
-			{
-				result.data()(t - estimateBegin) = 
-					entropyAlgorithm.finishEstimate(
-					estimate / weightSum, dimension, 
-					kNearest, tWidth * trials);
-			}
-			else
-			{
-				// If all distances were zero, we can't say
-				// anything about generic entropy. This is
-				// marked with a NaN. We will later attempt
-				// to reconstruct these values.
+				if (weightSum != 0)
+				{
+					result.data()(t - estimateBegin) = 
+						entropyAlgorithm.finishEstimate(
+						estimate / weightSum, dimension, 
+						kNearest, tWidth * trials);
+				}
+				else
+				{
+					// If all distances were zero, we can't say
+					// anything about generic entropy. This is
+					// marked with a NaN. We will later attempt
+					// to reconstruct these values.
 
-				result.data()(t - estimateBegin) = (dreal)Nan();
-				++missingValues;
+					result.data()(t - estimateBegin) = (dreal)Nan();
+					++missingValues;
+				}
 			}
-		}
-		}
+		};
 
-		// Reconstruct the NaN's.
+		// Evaluate the time instants of the hop, and
+		// reconstruct the NaN's.
 
-		reconstruct(result.data().range());
+		estimateHops(
+			estimateBegin, estimateEnd, hop, 1,
+			{result.data().data()},
+			estimateInstants,
+			instrumentation);
+		}
 
 		return result;
 	}
@@ -0,0 +1,146 @@
+#include "tim/core/instrumentation.h"
+
+#include <atomic>
+
+namespace Tim
+{
+
+	namespace
+	{
+
+		// The numbers which identify the instrumentations.
+		std::atomic<integer> ids(0);
+
+		// The measurements of the calling thread, and the
+		// instrumentation they belong to.
+		thread_local InstrumentationReport* cachedReport = nullptr;
+		thread_local integer cachedId = -1;
+
+		// The running timer of the calling thread.
+		thread_local PhaseTimer* runningTimer = nullptr;
+
+	}
+
+	const char* phaseName(Phase phase)
+	{
+		switch (phase)
+		{
+		case Phase::Merge:
+			return "merge";
+		case Phase::Build:
+			return "build";
+		case Phase::TimeWindow:
+			return "time_window";
+		case Phase::JointSearch:
+			return "joint_search";
+		case Phase::MarginalCount:
+			return "marginal_count";
+		case Phase::Reconstruct:
+			return "reconstruct";
+		}
+		return "";
+	}
+
+	InstrumentationReport& InstrumentationReport::operator+=(
+		const InstrumentationReport& that)
+	{
+		for (integer i = 0;i < Phases;++i)
+		{
+			secondsSet[i] += that.secondsSet[i];
+		}
+		nearestQueries += that.nearestQueries;
+		rangeQueries += that.rangeQueries;
+		nodesVisited += that.nodesVisited;
+		distances += that.distances;
+		pointsHidden += that.pointsHidden;
+		pointsShown += that.pointsShown;
+		return *this;
+	}
+
+	Instrumentation::Instrumentation()
+		: localSet_()
+		, id_(ids++)
+	{
+	}
+
+	InstrumentationReport Instrumentation::report() const
+	{
+		InstrumentationReport result;
+		for (const InstrumentationReport& local : localSet_)
+		{
+			result += local;
+		}
+		return result;
+	}
+
+	void Instrumentation::clear()
+	{
+		localSet_.clear();
+
+		// The cached pointers to the cleared measurements
+		// must not be used.
+		id_ = ids++;
+	}
+
+	InstrumentationReport* Instrumentation::local()
+	{
+		// The measurements are cached by a number which 
+		// no other instrumentation has, so that a cached
+		// pointer is never used for another instrumentation,
+		// even if it has the same address.
+		if (cachedId != id_)
+		{
+			cachedReport = &localSet_.local();
+			cachedId = id_;
+		}
+
+		return cachedReport;
+	}
+
+	PhaseTimer::PhaseTimer(
+		Instrumentation* instrumentation,
+		Phase phase)
+		: report_(instrumentation ? instrumentation->local() : nullptr)
+		, phase_(phase)
+		, outer_(nullptr)
+		, begin_()
+	{
+		if (!report_)
+		{
+			return;
+		}
+
+		begin_ = Clock::now();
+		outer_ = runningTimer;
+		if (outer_)
+		{
+			outer_->account(begin_);
+		}
+		runningTimer = this;
+	}
+
+	PhaseTimer::~PhaseTimer()
+	{
+		if (!report_)
+		{
+			return;
+		}
+
+		Clock::time_point now = Clock::now();
+		account(now);
+
+		runningTimer = outer_;
+		if (outer_)
+		{
+			outer_->begin_ = now;
+		}
+	}
+
+	void PhaseTimer::account(Clock::time_point now)
+	{
+		std::chrono::duration<double> elapsed = now - begin_;
+		report_->secondsSet[(integer)phase_] += elapsed.count();
+		begin_ = now;
+	}
+
+}
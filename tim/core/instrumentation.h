@@ -0,0 +1,220 @@
+// Description: Instrumentation of the estimators
+// Detail: Per-phase times and search counts, when built with TIM_INSTRUMENTATION
+// Documentation: instrumentation.txt
+
+#ifndef TIM_INSTRUMENTATION_H
+#define TIM_INSTRUMENTATION_H
+
+#include "tim/core/mytypes.h"
+
+#include <tbb/enumerable_thread_specific.h>
+
+#include <array>
+#include <chrono>
+
+// The instrumentation points. The first argument is an
+// Instrumentation pointer, which may be null.
+#ifdef TIM_INSTRUMENTATION
+#	define TIM_PHASE(instrumentation, phase) \
+		Tim::PhaseTimer timPhaseTimer((instrumentation), Tim::Phase::phase)
+#	define TIM_COUNT(instrumentation, counter, amount) \
+		do \
+		{ \
+			if (Tim::Instrumentation* timInstrumentation = (instrumentation)) \
+			{ \
+				timInstrumentation->local()->counter += (amount); \
+			} \
+		} \
+		while (false)
+#else
+#	define TIM_PHASE(instrumentation, phase) ((void)0)
+#	define TIM_COUNT(instrumentation, counter, amount) ((void)0)
+#endif
+
+namespace Tim
+{
+
+	//! The phases of an estimate.
+	enum class Phase
+	{
+		//! Gathering the lagged signals into joint points.
+		Merge,
+		//! Building the search structures.
+		Build,
+		//! Moving the time-windows of the point sets.
+		TimeWindow,
+		//! Searching the k nearest neighbors in the joint space.
+		JointSearch,
+		//! Counting the points in the marginal spaces.
+		MarginalCount,
+		//! Reconstructing the undefined estimates.
+		Reconstruct
+	};
+
+	//! The number of phases.
+	const integer Phases = 6;
+
+	//! Returns the name of a phase.
+	TIM const char* phaseName(Phase phase);
+
+	//! The measurements of instrumented estimates.
+	struct TIM InstrumentationReport
+	{
+		//! The seconds spent in each phase, indexed by Phase.
+		/*!
+		A phase does not include the time of the phases
+		entered from within it. The time is summed over
+		the threads which enter the phase; the phases of
+		the parallel parts are entered by one thread.
+		*/
+		std::array<dreal, Phases> secondsSet = {};
+
+		//! The number of k-nearest neighbor queries.
+		integer nearestQueries = 0;
+
+		//! The number of range counting queries.
+		integer rangeQueries = 0;
+
+		//! The number of search structure nodes visited by the queries.
+		integer nodesVisited = 0;
+
+		//! The number of distances computed by the queries.
+		integer distances = 0;
+
+		//! The number of points which left the time-windows.
+		integer pointsHidden = 0;
+
+		//! The number of points which entered the time-windows.
+		integer pointsShown = 0;
+
+		InstrumentationReport& operator+=(const InstrumentationReport& that);
+	};
+
+	//! Collects the measurements of estimates.
+	/*!
+	The estimators take the instrumentation as an argument,
+	and pass it on to their point sets. The measurements are 
+	collected only if TIM is built with TIM_INSTRUMENTATION
+	defined; otherwise the instrumentation points compile
+	to nothing, and the report stays zero.
+
+	The nodes visited and the distances computed are counted
+	by the search structures of every layout of SignalPointSet;
+	see instrumentation.txt.
+	*/
+	class TIM Instrumentation
+	{
+	public:
+		Instrumentation();
+
+		Instrumentation(const Instrumentation& that) = delete;
+		Instrumentation& operator=(const Instrumentation& that) = delete;
+
+		//! Returns whether TIM was built with instrumentation.
+		static constexpr bool enabled()
+		{
+#ifdef TIM_INSTRUMENTATION
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		//! Returns the measurements collected so far.
+		/*!
+		Must not be called while an instrumented estimate
+		is running.
+		*/
+		InstrumentationReport report() const;
+
+		//! Clears the measurements.
+		void clear();
+
+		//! Returns the measurements of the calling thread.
+		InstrumentationReport* local();
+
+	private:
+		/*
+		localSet_:
+		The measurements of each thread.
+
+		id_:
+		A number which identifies this instrumentation
+		since it was last cleared; the threads cache 
+		their measurements by it.
+		*/
+
+		tbb::enumerable_thread_specific<InstrumentationReport> localSet_;
+		integer id_;
+	};
+
+	//! Measures the time of a phase during its lifetime.
+	/*!
+	A timer started while another timer of the same thread
+	is running pauses the other timer until it ends. A null
+	instrumentation measures nothing.
+	*/
+	class TIM PhaseTimer
+	{
+	public:
+		PhaseTimer(Instrumentation* instrumentation, Phase phase);
+		~PhaseTimer();
+
+		PhaseTimer(const PhaseTimer& that) = delete;
+		PhaseTimer& operator=(const PhaseTimer& that) = delete;
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		// Adds the time since 'begin_' to the phase.
+		void account(Clock::time_point now);
+
+		/*
+		report_:
+		The measurements of the calling thread,
+		or null if the instrumentation is null.
+
+		phase_:
+		The measured phase.
+
+		outer_:
+		The timer which this timer paused, or null.
+
+		begin_:
+		The time when the timer was last started.
+		*/
+
+		InstrumentationReport* report_;
+		Phase phase_;
+		PhaseTimer* outer_;
+		Clock::time_point begin_;
+	};
+
+	//! Counts the points considered by a search of Pastel.
+	/*!
+	Returns an indicator which counts each point it is asked 
+	about as a computed distance, and then asks 'accept'. 
+	Pastel's searches ask their accept indicator about each
+	point whose distance they consider. The nodes visited by
+	Pastel's searches are not visible, and are not counted.
+	*/
+	template <typename Indicator>
+	auto countingIndicator(
+		Instrumentation* instrumentation,
+		Indicator accept)
+	{
+#ifdef TIM_INSTRUMENTATION
+		return [instrumentation, accept](const auto& point)
+		{
+			TIM_COUNT(instrumentation, distances, 1);
+			return accept(point);
+		};
+#else
+		(void)instrumentation;
+		return accept;
+#endif
+	}
+
+}
+
+#endif
@@ -0,0 +1,442 @@
+// Description: Lag sweeps of entropy combinations
+// Detail: Estimates an entropy combination for many lags of one signal
+// Documentation: lag_sweep.txt
+
+#ifndef TIM_LAG_SWEEP_H
+#define TIM_LAG_SWEEP_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/signal.h"
+#include "tim/core/lagged_signal.h"
+#include "tim/core/signalpointset.h"
+#include "tim/core/entropy_combination.h"
+
+#include <pastel/sys/array/array.h>
+#include <pastel/sys/range.h>
+
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include <tbb/blocked_range.h>
+#include <tbb/concurrent_queue.h>
+#include <tbb/parallel_for.h>
+
+namespace Tim
+{
+
+	//! Computes an entropy combination for a range of lags.
+	/*!
+	Preconditions:
+	kNearest > 0
+	maxRelativeError >= 0
+	ranges::size(lagSet) == signalSet.height()
+	0 <= signal < signalSet.height()
+
+	signalSet, rangeSet, lagSet, kNearest,
+	maxRelativeError, relativeError, instrumentation:
+	See entropyCombination().
+
+	signal:
+	The row of 'signalSet' whose lag is swept.
+
+	lagRange:
+	The lags to use for the swept signal, in place of
+	its lag in 'lagSet'.
+
+	Returns:
+	The i:th element is the estimate
+	entropyCombination(signalSet, rangeSet, lagSet', kNearest),
+	where lagSet' is 'lagSet' with the lag of the swept
+	signal replaced by the i:th element of 'lagRange'.
+
+	The marginals which do not contain the swept signal
+	are the same for every lag, up to the time-window.
+	Their point sets are built once, and reused for
+	all lags by moving the time-window. Only the joint
+	point set, and the marginals containing the swept
+	signal, are rebuilt for each lag. The lags are
+	estimated in parallel.
+	*/
+	template <
+		ranges::forward_range Integer3_Range,
+		ranges::forward_range Lag_Range,
+		ranges::forward_range Sweep_Range>
+	std::vector<dreal> entropyCombinationLagSweep(
+		const Array<Signal>& signalSet,
+		const Integer3_Range& rangeSet,
+		const Lag_Range& lagSet,
+		integer signal,
+		const Sweep_Range& lagRange,
+		integer kNearest = 1,
+		dreal maxRelativeError = 0,
+		dreal* relativeError = nullptr,
+		Instrumentation* instrumentation = nullptr)
+	{
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE_OP(maxRelativeError, >=, 0);
+		ENSURE_OP(ranges::size(lagSet), ==, signalSet.height());
+		ENSURE_OP(signal, >=, 0);
+		ENSURE_OP(signal, <, signalSet.height());
+
+		if (relativeError)
+		{
+			*relativeError = 0;
+		}
+
+		std::vector<integer> sweepSet(
+			std::begin(lagRange), std::end(lagRange));
+		integer lags = sweepSet.size();
+
+		std::vector<dreal> result(lags, 0);
+		if (ranges::empty(signalSet) || ranges::empty(rangeSet))
+		{
+			return result;
+		}
+
+		integer trials = signalSet.width();
+		integer signals = signalSet.height();
+		integer marginals = ranges::size(rangeSet);
+
+		std::vector<integer> baseLagSet(
+			std::begin(lagSet), std::end(lagSet));
+
+		// Find out the dimension ranges of the marginal
+		// signals.
+
+		std::vector<integer> offsetSet;
+		offsetSet.reserve(signals + 1);
+		offsetSet.push_back(0);
+		for (integer i = 1;i < signals + 1;++i)
+		{
+			offsetSet.push_back(offsetSet[i - 1] + signalSet(0, i - 1).dimension());
+		}
+
+		std::vector<Integer3> marginalSet(
+			std::begin(rangeSet), std::end(rangeSet));
+
+		std::vector<integer> weightSet;
+		weightSet.reserve(marginals);
+
+		std::vector<integer> marginalOffsetSet;
+		marginalOffsetSet.reserve(marginals);
+		for (const Integer3& marginal : marginalSet)
+		{
+			weightSet.push_back(marginal[2]);
+			marginalOffsetSet.push_back(offsetSet[marginal[0]]);
+		}
+
+		auto isSwept = [&](const Integer3& marginal)
+		{
+			return marginal[0] <= signal && signal < marginal[1];
+		};
+
+		// Form the lagged signals of the unchanged marginals
+		// once. These are shared by all the lags.
+
+		std::vector<std::vector<LaggedSignal>> fixedSignalSet(marginals);
+		for (integer i = 0;i < marginals;++i)
+		{
+			const Integer3& marginal = marginalSet[i];
+			if (isSwept(marginal))
+			{
+				continue;
+			}
+
+			integer height = marginal[1] - marginal[0];
+			Array<Signal> marginalSignalSet(Vector2i(trials, height));
+			for (integer y = 0;y < height;++y)
+			{
+				for (integer x = 0;x < trials;++x)
+				{
+					marginalSignalSet(x, y) = signalSet(x, marginal[0] + y);
+				}
+			}
+
+			fixedSignalSet[i].reserve(trials);
+			lagSignals(marginalSignalSet,
+				std::back_inserter(fixedSignalSet[i]),
+				range(baseLagSet.begin() + marginal[0],
+				baseLagSet.begin() + marginal[1]));
+		}
+
+		// The point sets of the unchanged marginals are
+		// modified by moving their time-windows, so each
+		// concurrent task needs its own copy. The copies
+		// are pooled, so that there are no more of them
+		// than there are tasks running at the same time.
+
+		using Layout = SignalPointSet::Layout;
+		using FixedSet = std::vector<SignalPointSet>;
+
+		tbb::concurrent_queue<std::shared_ptr<FixedSet>> poolSet;
+
+		auto acquire = [&]()
+		{
+			std::shared_ptr<FixedSet> fixedSet;
+			if (poolSet.try_pop(fixedSet))
+			{
+				return fixedSet;
+			}
+
+			fixedSet = std::make_shared<FixedSet>();
+			fixedSet->reserve(marginals);
+			for (integer i = 0;i < marginals;++i)
+			{
+				if (isSwept(marginalSet[i]))
+				{
+					// Rebuilt for each lag instead.
+					fixedSet->emplace_back();
+					continue;
+				}
+
+				fixedSet->emplace_back(
+					fixedSignalSet[i], Layout::Packed,
+					Metric::Maximum, instrumentation);
+			}
+
+			return fixedSet;
+		};
+
+		// The relative error of the search in the joint point
+		// set for each lag, or -1 if the lag has no samples.
+		std::vector<dreal> errorSet(lags, -1);
+
+		auto estimate = [&](integer i, FixedSet& fixedSet)
+		{
+			std::vector<integer> jointLagSet = baseLagSet;
+			jointLagSet[signal] = sweepSet[i];
+
+			std::vector<LaggedSignal> jointSignalSet;
+			jointSignalSet.reserve(trials);
+			lagSignals(signalSet,
+				std::back_inserter(jointSignalSet), jointLagSet);
+
+			SignalPointSet jointPointSet(
+				jointSignalSet, Layout::Packed,
+				Metric::Maximum, instrumentation);
+
+			// The joint point set contains only the time interval 
+			// on which all the trials are defined.
+			if (jointPointSet.begin() == jointPointSet.end())
+			{
+				return (dreal)0;
+			}
+
+			integer n = jointPointSet.end() - jointPointSet.begin();
+
+			errorSet[i] = jointPointSet.relativeError(maxRelativeError);
+
+			std::vector<SignalPointSet> sweptSet;
+			sweptSet.reserve(marginals);
+
+			std::vector<const SignalPointSet*> pointSet;
+			pointSet.reserve(marginals);
+			for (integer j = 0;j < marginals;++j)
+			{
+				const Integer3& marginal = marginalSet[j];
+				if (isSwept(marginal))
+				{
+					sweptSet.emplace_back(
+						jointPointSet,
+						offsetSet[marginal[0]], offsetSet[marginal[1]],
+						Layout::Packed, Metric::Maximum,
+						instrumentation);
+					pointSet.push_back(&sweptSet.back());
+				}
+				else
+				{
+					fixedSet[j].setTimeWindow(
+						jointPointSet.windowBegin(),
+						jointPointSet.windowEnd());
+					pointSet.push_back(&fixedSet[j]);
+				}
+			}
+
+			std::vector<dreal> distanceSet(n);
+			{
+				TIM_PHASE(instrumentation, JointSearch);
+				jointPointSet.searchAllNearest(
+					kNearest, distanceSet.data(), 
+					nullptr, maxRelativeError);
+			}
+
+			return Detail_EntropyCombination::combine(
+				jointPointSet, pointSet, marginalOffsetSet,
+				weightSet, distanceSet, kNearest);
+		};
+
+		// Consecutive lags are estimated by the same task,
+		// so that the time-windows of the unchanged marginals
+		// only slide a little between the lags.
+
+		using Block = tbb::blocked_range<integer>;
+
+		tbb::parallel_for(Block(0, lags),
+			[&](const Block& block)
+			{
+				std::shared_ptr<FixedSet> fixedSet = acquire();
+				for (integer i = block.begin();i < block.end();++i)
+				{
+					result[i] = estimate(i, *fixedSet);
+				}
+				poolSet.push(fixedSet);
+			});
+
+		if (relativeError)
+		{
+			// The layout of the joint point set is the same for
+			// all the lags with samples; take the first of them.
+			for (dreal error : errorSet)
+			{
+				if (error >= 0)
+				{
+					*relativeError = error;
+					break;
+				}
+			}
+		}
+
+		return result;
+	}
+
+	//! Computes mutual information for a range of lags.
+	/*!
+	Preconditions:
+	kNearest > 0
+	ranges::size(ySignalSet) == ranges::size(xSignalSet)
+
+	lagRange:
+	The lags to apply to the signal Y.
+
+	Returns:
+	The i:th element is the estimate
+	mutualInformation(xSignalSet, ySignalSet, xLag, yLag, kNearest),
+	where yLag is the i:th element of 'lagRange'.
+
+	instrumentation:
+	See entropyCombination().
+
+	See entropyCombinationLagSweep().
+	*/
+	template <
+		typename X_Signal_Range,
+		typename Y_Signal_Range,
+		ranges::forward_range Sweep_Range>
+	std::vector<dreal> mutualInformationLagSweep(
+		const X_Signal_Range& xSignalSet,
+		const Y_Signal_Range& ySignalSet,
+		const Sweep_Range& lagRange,
+		integer kNearest = 1,
+		integer xLag = 0,
+		Instrumentation* instrumentation = nullptr)
+	{
+		ENSURE_OP(kNearest, >, 0);
+		PENSURE_OP(ranges::size(xSignalSet), ==, ranges::size(ySignalSet));
+
+		integer trials = ranges::size(xSignalSet);
+
+		Array<Signal> signalSet(Vector2i(trials, 2));
+		std::copy(std::begin(xSignalSet), std::end(xSignalSet),
+			signalSet.rowBegin(0));
+		std::copy(std::begin(ySignalSet), std::end(ySignalSet),
+			signalSet.rowBegin(1));
+
+		Integer3 rangeSet[] =
+		{
+			Integer3(0, 1, 1),
+			Integer3(1, 2, 1)
+		};
+
+		integer lagSet[] = {xLag, 0};
+
+		return entropyCombinationLagSweep(
+			signalSet,
+			range(rangeSet),
+			range(lagSet),
+			1,
+			lagRange,
+			kNearest,
+			0,
+			nullptr,
+			instrumentation);
+	}
+
+	//! Computes transfer entropy for a range of lags.
+	/*!
+	Preconditions:
+	kNearest > 0
+	ranges::size(ySignalSet) == ranges::size(xSignalSet)
+	ranges::size(wSignalSet) == ranges::size(xSignalSet)
+
+	lagRange:
+	The lags to apply to the signal Y.
+
+	Returns:
+	The i:th element is the estimate
+	transferEntropy(xSignalSet, ySignalSet, wSignalSet,
+	xLag, yLag, wLag, kNearest), where yLag is the i:th
+	element of 'lagRange'.
+
+	instrumentation:
+	See entropyCombination().
+
+	Only the marginal (X, Y) and the joint signal depend
+	on the lag of Y; the marginals (W, X) and X are reused
+	between the lags. See entropyCombinationLagSweep().
+	*/
+	template <
+		typename X_Signal_Range,
+		typename Y_Signal_Range,
+		typename W_Signal_Range,
+		ranges::forward_range Sweep_Range>
+	std::vector<dreal> transferEntropyLagSweep(
+		const X_Signal_Range& xSignalSet,
+		const Y_Signal_Range& ySignalSet,
+		const W_Signal_Range& wSignalSet,
+		const Sweep_Range& lagRange,
+		integer kNearest = 1,
+		integer xLag = 0, integer wLag = 0,
+		Instrumentation* instrumentation = nullptr)
+	{
+		ENSURE_OP(kNearest, >, 0);
+		PENSURE_OP(ranges::size(xSignalSet), ==, ranges::size(ySignalSet));
+		PENSURE_OP(ranges::size(xSignalSet), ==, ranges::size(wSignalSet));
+
+		integer trials = ranges::size(xSignalSet);
+
+		// The signals are merged in wXY order,
+		// as in transferEntropy().
+
+		Array<Signal> signalSet(Vector2i(trials, 3));
+		std::copy(std::begin(wSignalSet), std::end(wSignalSet),
+			signalSet.rowBegin(0));
+		std::copy(std::begin(xSignalSet), std::end(xSignalSet),
+			signalSet.rowBegin(1));
+		std::copy(std::begin(ySignalSet), std::end(ySignalSet),
+			signalSet.rowBegin(2));
+
+		Integer3 rangeSet[] =
+		{
+			Integer3(0, 2, 1),
+			Integer3(1, 3, 1),
+			Integer3(1, 2, -1)
+		};
+
+		integer lagSet[] = {wLag, xLag, 0};
+
+		return entropyCombinationLagSweep(
+			signalSet,
+			range(rangeSet),
+			range(lagSet),
+			2,
+			lagRange,
+			kNearest,
+			0,
+			nullptr,
+			instrumentation);
+	}
+
+}
+
+#endif
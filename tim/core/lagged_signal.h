@@ -0,0 +1,348 @@
+// Description: LaggedSignal class
+// Detail: A view of lagged signals as a higher-dimensional signal
+// Documentation: lagged_signal.txt
+
+#ifndef TIM_LAGGED_SIGNAL_H
+#define TIM_LAGGED_SIGNAL_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/signal.h"
+#include "tim/core/signal_properties.h"
+
+#include <pastel/sys/range.h>
+#include <pastel/sys/array/array.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace Tim
+{
+
+	//! A view of lagged signals as a higher-dimensional signal
+	/*!
+	This is what merge() would produce, but without copying
+	the signals: each component signal is referred to by its
+	Signal, which aliases the caller's data, together with its
+	lag. The joint signal is defined on the time interval on
+	which all the lagged component signals are defined.
+	*/
+	class LaggedSignal
+	{
+	public:
+		//! Constructs an empty signal.
+		LaggedSignal() = default;
+
+		//! Constructs a view of lagged signals.
+		/*!
+		Preconditions:
+		ranges::size(signalSet) == ranges::size(lagSet)
+
+		The dimensions of the joint signal are those of the
+		signals in 'signalSet', in order. The signals must
+		outlive the view.
+		*/
+		template <
+			ranges::forward_range Signal_Range,
+			ranges::forward_range Lag_Range>
+		LaggedSignal(
+			const Signal_Range& signalSet,
+			const Lag_Range& lagSet)
+			: signalSet_()
+			, lagSet_()
+			, offsetSet_(1, 0)
+			, t_(0)
+			, samples_(0)
+		{
+			ENSURE_OP(ranges::size(signalSet), ==, ranges::size(lagSet));
+
+			for (auto&& signal : signalSet)
+			{
+				signalSet_.push_back((Signal)signal);
+				offsetSet_.push_back(offsetSet_.back() + signalSet_.back().dimension());
+			}
+
+			lagSet_.assign(std::begin(lagSet), std::end(lagSet));
+
+			if (!signalSet_.empty())
+			{
+				Integer2 sharedTime = sharedTimeInterval(signalSet_, lagSet_);
+				t_ = sharedTime[0];
+				samples_ = sharedTime[1] - sharedTime[0];
+			}
+		}
+
+		//! Returns the dimension of the joint signal.
+		integer dimension() const
+		{
+			return offsetSet_.back();
+		}
+
+		//! Returns the number of samples in the joint signal.
+		integer samples() const
+		{
+			return samples_;
+		}
+
+		//! Returns the time position of the first sample.
+		integer t() const
+		{
+			return t_;
+		}
+
+		//! Returns the number of component signals.
+		integer components() const
+		{
+			return signalSet_.size();
+		}
+
+		//! Returns the first dimension of a component in the joint signal.
+		integer dimensionBegin(integer component) const
+		{
+			PENSURE_OP(component, >=, 0);
+			PENSURE_OP(component, <=, components());
+
+			return offsetSet_[component];
+		}
+
+		//! Returns the component which contains the given dimensions.
+		/*!
+		Preconditions:
+		0 <= dimensionBegin < dimensionEnd <= dimension()
+
+		Returns:
+		The component which contains all the dimensions in
+		[dimensionBegin, dimensionEnd[, or -1 if there is
+		no such component.
+		*/
+		integer componentOf(
+			integer dimensionBegin,
+			integer dimensionEnd) const
+		{
+			PENSURE_OP(dimensionBegin, >=, 0);
+			PENSURE_OP(dimensionBegin, <, dimensionEnd);
+			PENSURE_OP(dimensionEnd, <=, dimension());
+
+			integer component =
+				std::upper_bound(offsetSet_.begin(), offsetSet_.end(), dimensionBegin) -
+				offsetSet_.begin() - 1;
+
+			if (dimensionEnd > offsetSet_[component + 1])
+			{
+				return -1;
+			}
+
+			return component;
+		}
+
+		//! Returns the sample of a component at a given time.
+		/*!
+		Preconditions:
+		0 <= component < components()
+		t() <= t < t() + samples()
+
+		Returns:
+		A pointer to the coordinates of the sample, which
+		are contiguous in memory.
+		*/
+		const dreal* point(integer component, integer t) const
+		{
+			PENSURE_OP(component, >=, 0);
+			PENSURE_OP(component, <, components());
+			PENSURE_OP(t, >=, t_);
+			PENSURE_OP(t, <, t_ + samples_);
+
+			const Signal& signal = signalSet_[component];
+			return std::begin(signal.pointRange())[
+				t - (signal.t() + lagSet_[component])];
+		}
+
+		//! Copies the coordinates of a joint sample.
+		/*!
+		Preconditions:
+		0 <= dimensionBegin <= dimensionEnd <= dimension()
+		t() <= t < t() + samples()
+
+		The coordinates [dimensionBegin, dimensionEnd[ of
+		the joint sample at time t are copied to 'result'.
+		*/
+		void copyPoint(
+			integer t,
+			integer dimensionBegin,
+			integer dimensionEnd,
+			dreal* result) const
+		{
+			integer n = components();
+			for (integer i = 0;i < n;++i)
+			{
+				integer begin = std::max(dimensionBegin, offsetSet_[i]);
+				integer end = std::min(dimensionEnd, offsetSet_[i + 1]);
+				if (begin >= end)
+				{
+					continue;
+				}
+
+				const dreal* coordinate = point(i, t) - offsetSet_[i];
+				std::copy(coordinate + begin, coordinate + end, result);
+				result += end - begin;
+			}
+		}
+
+	private:
+		/*
+		signalSet_:
+		The component signals.
+
+		lagSet_:
+		The lag of each component signal.
+
+		offsetSet_:
+		The dimensions of the i:th component are
+		[offsetSet_[i], offsetSet_[i + 1][ in the joint signal.
+
+		t_, samples_:
+		The joint signal is defined on the time
+		interval [t_, t_ + samples_[.
+		*/
+
+		std::vector<Signal> signalSet_;
+		std::vector<integer> lagSet_;
+		std::vector<integer> offsetSet_;
+		integer t_ = 0;
+		integer samples_ = 0;
+	};
+
+	//! Forms lagged views of the trials of signals.
+	/*!
+	Preconditions:
+	ranges::size(lagSet) == ensembleSet.height()
+
+	This is as merge(ensembleSet, result, lagSet), except
+	that the joint signals are views of the signals in
+	'ensembleSet', rather than copies.
+	*/
+	template <
+		typename LaggedSignal_OutputIterator,
+		typename Lag_Range>
+	void lagSignals(
+		const Array<Signal>& ensembleSet,
+		LaggedSignal_OutputIterator result,
+		const Lag_Range& lagSet)
+	{
+		ENSURE_OP(ranges::size(lagSet), ==, ensembleSet.height());
+
+		std::vector<Signal> column(ensembleSet.height());
+
+		integer trials = ensembleSet.width();
+		for (integer i = 0;i < trials;++i)
+		{
+			for (integer j = 0;j < ensembleSet.height();++j)
+			{
+				column[j] = (Signal)ensembleSet(i, j);
+			}
+
+			*result = LaggedSignal(column, lagSet);
+			++result;
+		}
+	}
+
+	//! Forms lagged views of some signals of the trials.
+	/*!
+	Preconditions:
+	ranges::size(rowSet) == ranges::size(lagSet)
+
+	rowSet:
+	The signals, by their rows in 'ensembleSet'.
+
+	This is as lagSignals(ensembleSet, result, lagSet), except
+	that only the signals in 'rowSet' are used, in that order.
+	*/
+	template <
+		ranges::forward_range Row_Range,
+		typename LaggedSignal_OutputIterator,
+		ranges::forward_range Lag_Range>
+	void lagSignals(
+		const Array<Signal>& ensembleSet,
+		const Row_Range& rowSet,
+		LaggedSignal_OutputIterator result,
+		const Lag_Range& lagSet)
+	{
+		ENSURE_OP(ranges::size(rowSet), ==, ranges::size(lagSet));
+
+		std::vector<integer> lags(std::begin(lagSet), std::end(lagSet));
+		std::vector<Signal> column(lags.size());
+
+		integer trials = ensembleSet.width();
+		for (integer i = 0;i < trials;++i)
+		{
+			integer j = 0;
+			for (integer row : rowSet)
+			{
+				column[j] = (Signal)ensembleSet(i, row);
+				++j;
+			}
+
+			*result = LaggedSignal(column, lags);
+			++result;
+		}
+	}
+
+	//! Returns the time interval of lagged signals in all trials.
+	/*!
+	Preconditions:
+	ranges::size(rowSet) == ranges::size(lagSet)
+
+	rowSet:
+	The signals, by their rows in 'ensembleSet'.
+
+	Returns:
+	The largest time interval on which the lagged signals of
+	every trial are defined, or [0, 0[ if there is none. This
+	is the time interval of a SignalPointSet built from 
+	lagSignals(ensembleSet, rowSet, result, lagSet).
+	*/
+	template <
+		ranges::forward_range Row_Range,
+		ranges::forward_range Lag_Range>
+	Integer2 sharedTimeInterval(
+		const Array<Signal>& ensembleSet,
+		const Row_Range& rowSet,
+		const Lag_Range& lagSet)
+	{
+		ENSURE_OP(ranges::size(rowSet), ==, ranges::size(lagSet));
+
+		integer tBegin = 0;
+		integer tEnd = 0;
+		bool first = true;
+
+		integer trials = ensembleSet.width();
+		for (integer i = 0;i < trials;++i)
+		{
+			auto lagIter = std::begin(lagSet);
+			for (integer row : rowSet)
+			{
+				const Signal& signal = ensembleSet(i, row);
+				integer tLeft = signal.t() + *lagIter;
+				integer tRight = tLeft + signal.samples();
+				if (first)
+				{
+					tBegin = tLeft;
+					tEnd = tRight;
+					first = false;
+				}
+				tBegin = std::max(tBegin, tLeft);
+				tEnd = std::min(tEnd, tRight);
+				++lagIter;
+			}
+		}
+
+		if (tEnd < tBegin)
+		{
+			return Integer2(0, 0);
+		}
+
+		return Integer2(tBegin, tEnd);
+	}
+
+}
+
+#endif
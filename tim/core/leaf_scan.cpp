@@ -0,0 +1,713 @@
+#include "tim/core/leaf_scan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#	define TIM_LEAF_SCAN_X86
+#	include <immintrin.h>
+#	if defined(_MSC_VER) && !defined(__clang__)
+#		include <intrin.h>
+		// Visual Studio allows the intrinsics of any
+		// instruction set without extra flags.
+#		define TIM_TARGET(instructionSet)
+#	else
+		// Compile the kernel for the given instruction set,
+		// regardless of the flags of the translation unit.
+#		define TIM_TARGET(instructionSet) __attribute__((target(instructionSet)))
+#	endif
+#endif
+
+// The squared distances must be summed without fused multiply-adds,
+// so that all the kernels round the same way. This file is compiled 
+// with floating-point contraction disabled; see CMakeLists.txt.
+
+namespace Tim
+{
+
+	namespace
+	{
+
+		// The number of distances computed at a time
+		// by the scalar count kernel.
+		static constexpr integer ScalarChunk = 64;
+
+		template <typename Storage>
+		void scanDistancesScalar(
+			const Storage* coordinateSet,
+			integer count,
+			integer n,
+			const dreal* query,
+			dreal* distanceSet)
+		{
+			std::fill(distanceSet, distanceSet + count, (dreal)0);
+			for (integer j = 0;j < n;++j)
+			{
+				// The j:th coordinates of the points are
+				// contiguous in memory.
+				dreal q = query[j];
+				const Storage* x = coordinateSet + j * count;
+				for (integer i = 0;i < count;++i)
+				{
+					distanceSet[i] = std::max(distanceSet[i], std::abs(x[i] - q));
+				}
+			}
+		}
+
+		template <typename Storage>
+		void scanSquaredDistancesScalar(
+			const Storage* coordinateSet,
+			integer count,
+			integer n,
+			const dreal* query,
+			dreal* distanceSet)
+		{
+			std::fill(distanceSet, distanceSet + count, (dreal)0);
+			for (integer j = 0;j < n;++j)
+			{
+				dreal q = query[j];
+				const Storage* x = coordinateSet + j * count;
+				for (integer i = 0;i < count;++i)
+				{
+					dreal delta = x[i] - q;
+					distanceSet[i] += delta * delta;
+				}
+			}
+		}
+
+		template <typename Storage>
+		integer scanCountScalar(
+			const Storage* coordinateSet,
+			const char* visibleSet,
+			integer count,
+			integer n,
+			const dreal* query,
+			dreal maxDistance)
+		{
+			dreal distanceSet[ScalarChunk];
+
+			integer result = 0;
+			for (integer begin = 0;begin < count;begin += ScalarChunk)
+			{
+				integer chunk = std::min(count - begin, ScalarChunk);
+				std::fill(distanceSet, distanceSet + chunk, (dreal)0);
+				for (integer j = 0;j < n;++j)
+				{
+					dreal q = query[j];
+					const Storage* x = coordinateSet + j * count + begin;
+					for (integer i = 0;i < chunk;++i)
+					{
+						distanceSet[i] = std::max(distanceSet[i], std::abs(x[i] - q));
+					}
+				}
+
+				for (integer i = 0;i < chunk;++i)
+				{
+					result += (visibleSet[begin + i] && distanceSet[i] < maxDistance);
+				}
+			}
+
+			return result;
+		}
+
+#ifdef TIM_LEAF_SCAN_X86
+
+		// The SIMD kernels process the points in blocks of
+		// 4 (AVX2) or 8 (AVX-512) lanes. The coordinates are
+		// visited one dimension at a time; the visit stops early
+		// when the distances of all the lanes have reached the
+		// bound.
+		//
+		// The coordinates are stored in either double or single
+		// precision; the distances are computed in double precision.
+		//
+		// The AVX-512 operations are masked, so that their
+		// pass-through operands are defined; the unmasked forms
+		// of _mm512_max_pd, _mm512_cvtps_pd and the 512-to-256-bit
+		// casts pass an undefined vector, which GCC reports as
+		// possibly uninitialized.
+
+		TIM_TARGET("avx2")
+		inline __m256d load4(const double* coordinate)
+		{
+			return _mm256_loadu_pd(coordinate);
+		}
+
+		TIM_TARGET("avx2")
+		inline __m256d load4(const float* coordinate)
+		{
+			return _mm256_cvtps_pd(_mm_loadu_ps(coordinate));
+		}
+
+		TIM_TARGET("avx512f")
+		inline __m512d maskLoad8(__mmask8 lanes, const double* coordinate)
+		{
+			return _mm512_maskz_loadu_pd(lanes, coordinate);
+		}
+
+		TIM_TARGET("avx512f")
+		inline __m512d maskLoad8(__mmask8 lanes, const float* coordinate)
+		{
+			// The masked lanes are not read. The lower half is
+			// extracted with a zeroing mask, for the same reason
+			// as with the maxima below.
+			__m512 x = _mm512_maskz_loadu_ps((__mmask16)lanes, coordinate);
+			__m256 lower = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(
+				(__mmask8)0xF, _mm512_castps_pd(x), 0));
+			return _mm512_maskz_cvtps_pd(lanes, lower);
+		}
+
+		template <typename Storage>
+		TIM_TARGET("avx2")
+		void scanDistancesAvx2(
+			const Storage* coordinateSet,
+			integer count,
+			integer n,
+			const double* query,
+			double bound,
+			double* distanceSet)
+		{
+			const __m256d signMask = _mm256_set1_pd(-0.0);
+			const __m256d boundLanes = _mm256_set1_pd(bound);
+
+			integer i = 0;
+			for (;i + 4 <= count;i += 4)
+			{
+				__m256d distance = _mm256_setzero_pd();
+				for (integer j = 0;j < n;++j)
+				{
+					__m256d x = load4(coordinateSet + j * count + i);
+					__m256d delta = _mm256_andnot_pd(signMask,
+						_mm256_sub_pd(x, _mm256_set1_pd(query[j])));
+					distance = _mm256_max_pd(delta, distance);
+
+					if (_mm256_movemask_pd(
+						_mm256_cmp_pd(distance, boundLanes, _CMP_GE_OQ)) == 0xF)
+					{
+						break;
+					}
+				}
+				_mm256_storeu_pd(distanceSet + i, distance);
+			}
+
+			for (;i < count;++i)
+			{
+				double distance = 0;
+				for (integer j = 0;j < n;++j)
+				{
+					distance = std::max(distance,
+						std::abs(coordinateSet[j * count + i] - query[j]));
+				}
+				distanceSet[i] = distance;
+			}
+		}
+
+		template <typename Storage>
+		TIM_TARGET("avx2")
+		void scanSquaredDistancesAvx2(
+			const Storage* coordinateSet,
+			integer count,
+			integer n,
+			const double* query,
+			double bound,
+			double* distanceSet)
+		{
+			const __m256d boundLanes = _mm256_set1_pd(bound);
+
+			integer i = 0;
+			for (;i + 4 <= count;i += 4)
+			{
+				__m256d distance = _mm256_setzero_pd();
+				for (integer j = 0;j < n;++j)
+				{
+					__m256d x = load4(coordinateSet + j * count + i);
+					__m256d delta = _mm256_sub_pd(x, _mm256_set1_pd(query[j]));
+					distance = _mm256_add_pd(_mm256_mul_pd(delta, delta), distance);
+
+					if (_mm256_movemask_pd(
+						_mm256_cmp_pd(distance, boundLanes, _CMP_GE_OQ)) == 0xF)
+					{
+						break;
+					}
+				}
+				_mm256_storeu_pd(distanceSet + i, distance);
+			}
+
+			for (;i < count;++i)
+			{
+				double distance = 0;
+				for (integer j = 0;j < n;++j)
+				{
+					double delta = coordinateSet[j * count + i] - query[j];
+					distance += delta * delta;
+				}
+				distanceSet[i] = distance;
+			}
+		}
+
+		template <typename Storage>
+		TIM_TARGET("avx2")
+		integer scanCountAvx2(
+			const Storage* coordinateSet,
+			const char* visibleSet,
+			integer count,
+			integer n,
+			const double* query,
+			double maxDistance)
+		{
+			const __m256d signMask = _mm256_set1_pd(-0.0);
+			const __m256d radius = _mm256_set1_pd(maxDistance);
+
+			integer result = 0;
+			integer i = 0;
+			for (;i + 4 <= count;i += 4)
+			{
+				__m256d distance = _mm256_setzero_pd();
+				integer j = 0;
+				for (;j < n;++j)
+				{
+					__m256d x = load4(coordinateSet + j * count + i);
+					__m256d delta = _mm256_andnot_pd(signMask,
+						_mm256_sub_pd(x, _mm256_set1_pd(query[j])));
+					distance = _mm256_max_pd(delta, distance);
+
+					if (_mm256_movemask_pd(
+						_mm256_cmp_pd(distance, radius, _CMP_GE_OQ)) == 0xF)
+					{
+						break;
+					}
+				}
+
+				if (j < n)
+				{
+					// All the lanes are outside the ball.
+					continue;
+				}
+
+				unsigned int inside = _mm256_movemask_pd(
+					_mm256_cmp_pd(distance, radius, _CMP_LT_OQ));
+				unsigned int visible =
+					(visibleSet[i] != 0) |
+					((visibleSet[i + 1] != 0) << 1) |
+					((visibleSet[i + 2] != 0) << 2) |
+					((visibleSet[i + 3] != 0) << 3);
+
+				result += std::popcount(inside & visible);
+			}
+
+			for (;i < count;++i)
+			{
+				double distance = 0;
+				for (integer j = 0;j < n;++j)
+				{
+					distance = std::max(distance,
+						std::abs(coordinateSet[j * count + i] - query[j]));
+				}
+				result += (visibleSet[i] && distance < maxDistance);
+			}
+
+			return result;
+		}
+
+		template <typename Storage>
+		TIM_TARGET("avx512f")
+		void scanDistancesAvx512(
+			const Storage* coordinateSet,
+			integer count,
+			integer n,
+			const double* query,
+			double bound,
+			double* distanceSet)
+		{
+			const __m512d boundLanes = _mm512_set1_pd(bound);
+
+			for (integer i = 0;i < count;i += 8)
+			{
+				// The last block is partial; its missing
+				// lanes are masked out.
+				__mmask8 lanes = (count - i >= 8) ?
+					(__mmask8)0xFF :
+					(__mmask8)((1u << (count - i)) - 1);
+
+				__m512d distance = _mm512_setzero_pd();
+				for (integer j = 0;j < n;++j)
+				{
+					__m512d x = maskLoad8(lanes, coordinateSet + j * count + i);
+					__m512d delta = _mm512_abs_pd(
+						_mm512_sub_pd(x, _mm512_set1_pd(query[j])));
+					distance = _mm512_mask_max_pd(distance, lanes, delta, distance);
+
+					__mmask8 reached = _mm512_cmp_pd_mask(distance, boundLanes, _CMP_GE_OQ);
+					if ((reached & lanes) == lanes)
+					{
+						break;
+					}
+				}
+				_mm512_mask_storeu_pd(distanceSet + i, lanes, distance);
+			}
+		}
+
+		template <typename Storage>
+		TIM_TARGET("avx512f")
+		void scanSquaredDistancesAvx512(
+			const Storage* coordinateSet,
+			integer count,
+			integer n,
+			const double* query,
+			double bound,
+			double* distanceSet)
+		{
+			const __m512d boundLanes = _mm512_set1_pd(bound);
+
+			for (integer i = 0;i < count;i += 8)
+			{
+				__mmask8 lanes = (count - i >= 8) ?
+					(__mmask8)0xFF :
+					(__mmask8)((1u << (count - i)) - 1);
+
+				__m512d distance = _mm512_setzero_pd();
+				for (integer j = 0;j < n;++j)
+				{
+					__m512d x = maskLoad8(lanes, coordinateSet + j * count + i);
+					__m512d delta = _mm512_sub_pd(x, _mm512_set1_pd(query[j]));
+					distance = _mm512_add_pd(_mm512_mul_pd(delta, delta), distance);
+
+					__mmask8 reached = _mm512_cmp_pd_mask(distance, boundLanes, _CMP_GE_OQ);
+					if ((reached & lanes) == lanes)
+					{
+						break;
+					}
+				}
+				_mm512_mask_storeu_pd(distanceSet + i, lanes, distance);
+			}
+		}
+
+		template <typename Storage>
+		TIM_TARGET("avx512f")
+		integer scanCountAvx512(
+			const Storage* coordinateSet,
+			const char* visibleSet,
+			integer count,
+			integer n,
+			const double* query,
+			double maxDistance)
+		{
+			const __m512d radius = _mm512_set1_pd(maxDistance);
+
+			integer result = 0;
+			for (integer i = 0;i < count;i += 8)
+			{
+				integer width = std::min(count - i, (integer)8);
+				__mmask8 lanes = (width == 8) ?
+					(__mmask8)0xFF :
+					(__mmask8)((1u << width) - 1);
+
+				unsigned int visible = 0;
+				for (integer k = 0;k < width;++k)
+				{
+					visible |= (unsigned int)(visibleSet[i + k] != 0) << k;
+				}
+				lanes &= (__mmask8)visible;
+				if (lanes == 0)
+				{
+					continue;
+				}
+
+				__m512d distance = _mm512_setzero_pd();
+				__mmask8 inside = _mm512_mask_cmp_pd_mask(lanes, distance, radius, _CMP_LT_OQ);
+				for (integer j = 0;j < n;++j)
+				{
+					__m512d x = maskLoad8(lanes, coordinateSet + j * count + i);
+					__m512d delta = _mm512_abs_pd(
+						_mm512_sub_pd(x, _mm512_set1_pd(query[j])));
+					distance = _mm512_mask_max_pd(distance, lanes, delta, distance);
+
+					inside = _mm512_mask_cmp_pd_mask(lanes, distance, radius, _CMP_LT_OQ);
+					if (inside == 0)
+					{
+						break;
+					}
+				}
+
+				result += std::popcount((unsigned int)inside);
+			}
+
+			return result;
+		}
+
+		bool detectAvx2()
+		{
+#if defined(_MSC_VER) && !defined(__clang__)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+			{
+				return false;
+			}
+
+			// The processor supports AVX, and the operating
+			// system saves the AVX registers.
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+			if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+			{
+				return false;
+			}
+
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2");
+#endif
+		}
+
+		bool detectAvx512()
+		{
+#if defined(_MSC_VER) && !defined(__clang__)
+			if (!detectAvx2())
+			{
+				return false;
+			}
+
+			// The operating system saves the AVX-512 registers.
+			if ((_xgetbv(0) & 0xE6) != 0xE6)
+			{
+				return false;
+			}
+
+			int info[4];
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 16)) != 0;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx512f");
+#endif
+		}
+
+#endif
+
+		SimdLevel detectSimdLevel()
+		{
+#ifdef TIM_LEAF_SCAN_X86
+			// The kernels are written for double precision.
+			if (std::is_same<dreal, double>::value)
+			{
+				if (detectAvx512())
+				{
+					return SimdLevel::Avx512;
+				}
+				if (detectAvx2())
+				{
+					return SimdLevel::Avx2;
+				}
+			}
+#endif
+			return SimdLevel::Scalar;
+		}
+
+		std::atomic<SimdLevel>& activeSimdLevel()
+		{
+			static std::atomic<SimdLevel> level(supportedSimdLevel());
+			return level;
+		}
+
+		// The dispatch is a template so that the SIMD branches
+		// are discarded when dreal is not double.
+
+		template <typename Storage, typename Real>
+		void dispatchDistances(
+			const Storage* coordinateSet,
+			integer count,
+			integer n,
+			const Real* query,
+			Real bound,
+			Real* distanceSet)
+		{
+#ifdef TIM_LEAF_SCAN_X86
+			if constexpr (std::is_same<Real, double>::value)
+			{
+				switch (simdLevel())
+				{
+				case SimdLevel::Avx512:
+					scanDistancesAvx512(coordinateSet, count, n, query, bound, distanceSet);
+					return;
+				case SimdLevel::Avx2:
+					scanDistancesAvx2(coordinateSet, count, n, query, bound, distanceSet);
+					return;
+				default:
+					break;
+				}
+			}
+#endif
+
+			scanDistancesScalar(coordinateSet, count, n, query, distanceSet);
+		}
+
+		template <typename Storage, typename Real>
+		void dispatchSquaredDistances(
+			const Storage* coordinateSet,
+			integer count,
+			integer n,
+			const Real* query,
+			Real bound,
+			Real* distanceSet)
+		{
+#ifdef TIM_LEAF_SCAN_X86
+			if constexpr (std::is_same<Real, double>::value)
+			{
+				switch (simdLevel())
+				{
+				case SimdLevel::Avx512:
+					scanSquaredDistancesAvx512(coordinateSet, count, n, query, bound, distanceSet);
+					return;
+				case SimdLevel::Avx2:
+					scanSquaredDistancesAvx2(coordinateSet, count, n, query, bound, distanceSet);
+					return;
+				default:
+					break;
+				}
+			}
+#endif
+
+			scanSquaredDistancesScalar(coordinateSet, count, n, query, distanceSet);
+		}
+
+		template <typename Storage, typename Real>
+		integer dispatchCount(
+			const Storage* coordinateSet,
+			const char* visibleSet,
+			integer count,
+			integer n,
+			const Real* query,
+			Real maxDistance)
+		{
+#ifdef TIM_LEAF_SCAN_X86
+			if constexpr (std::is_same<Real, double>::value)
+			{
+				switch (simdLevel())
+				{
+				case SimdLevel::Avx512:
+					return scanCountAvx512(coordinateSet, visibleSet, count, n, query, maxDistance);
+				case SimdLevel::Avx2:
+					return scanCountAvx2(coordinateSet, visibleSet, count, n, query, maxDistance);
+				default:
+					break;
+				}
+			}
+#endif
+
+			return scanCountScalar(coordinateSet, visibleSet, count, n, query, maxDistance);
+		}
+
+	}
+
+	TIM std::vector<const dreal*> storedPoints(
+		const std::vector<const dreal*>& pointSet,
+		integer dimension,
+		std::vector<dreal>& roundedSet)
+	{
+		ENSURE_OP(dimension, >=, 0);
+
+		if constexpr (std::is_same<sreal, dreal>::value)
+		{
+			return pointSet;
+		}
+
+		integer points = pointSet.size();
+		roundedSet.resize(points * dimension);
+
+		std::vector<const dreal*> result(points);
+		for (integer i = 0;i < points;++i)
+		{
+			dreal* rounded = roundedSet.data() + i * dimension;
+			for (integer j = 0;j < dimension;++j)
+			{
+				rounded[j] = (sreal)pointSet[i][j];
+			}
+			result[i] = rounded;
+		}
+
+		return result;
+	}
+
+	TIM dreal storedEuclideanDistance(
+		const dreal* query,
+		const dreal* point,
+		integer dimension)
+	{
+		dreal result = 0;
+		for (integer j = 0;j < dimension;++j)
+		{
+			dreal delta = (dreal)(sreal)point[j] - query[j];
+			result += delta * delta;
+		}
+		return std::sqrt(result);
+	}
+
+	TIM SimdLevel supportedSimdLevel()
+	{
+		static const SimdLevel level = detectSimdLevel();
+		return level;
+	}
+
+	TIM SimdLevel simdLevel()
+	{
+		return activeSimdLevel().load(std::memory_order_relaxed);
+	}
+
+	TIM SimdLevel setSimdLevel(SimdLevel level)
+	{
+		level = std::min(level, supportedSimdLevel());
+		activeSimdLevel().store(level, std::memory_order_relaxed);
+		return level;
+	}
+
+	TIM void scanDistances(
+		const sreal* coordinateSet,
+		integer count,
+		integer n,
+		const dreal* query,
+		dreal bound,
+		dreal* distanceSet)
+	{
+		PENSURE_OP(count, >=, 0);
+		PENSURE_OP(n, >=, 0);
+
+		dispatchDistances(coordinateSet, count, n, query, bound, distanceSet);
+	}
+
+	TIM void scanSquaredDistances(
+		const sreal* coordinateSet,
+		integer count,
+		integer n,
+		const dreal* query,
+		dreal bound,
+		dreal* distanceSet)
+	{
+		PENSURE_OP(count, >=, 0);
+		PENSURE_OP(n, >=, 0);
+
+		dispatchSquaredDistances(coordinateSet, count, n, query, bound, distanceSet);
+	}
+
+	TIM integer scanCount(
+		const sreal* coordinateSet,
+		const char* visibleSet,
+		integer count,
+		integer n,
+		const dreal* query,
+		dreal maxDistance)
+	{
+		PENSURE_OP(count, >=, 0);
+		PENSURE_OP(n, >=, 0);
+		PENSURE_OP(maxDistance, >=, 0);
+
+		return dispatchCount(coordinateSet, visibleSet, count, n, query, maxDistance);
+	}
+
+}
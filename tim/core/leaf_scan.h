@@ -0,0 +1,179 @@
+// Description: Leaf-scan kernels
+// Detail: Distances from a query to a packed leaf, with SIMD dispatch
+// Documentation: leaf_scan.txt
+
+#ifndef TIM_LEAF_SCAN_H
+#define TIM_LEAF_SCAN_H
+
+#include "tim/core/mytypes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace Tim
+{
+
+	//! The instruction set used by the leaf-scan kernels.
+	enum class SimdLevel
+	{
+		Scalar,
+		Avx2,
+		Avx512
+	};
+
+	//! Returns the best instruction set supported by the processor.
+	TIM SimdLevel supportedSimdLevel();
+
+	//! Returns the instruction set used by the leaf-scan kernels.
+	/*!
+	By default, this is supportedSimdLevel().
+	*/
+	TIM SimdLevel simdLevel();
+
+	//! Sets the instruction set used by the leaf-scan kernels.
+	/*!
+	The level is clamped to supportedSimdLevel(). This is
+	useful for benchmarking and for testing the kernels
+	against each other.
+
+	Returns:
+	The level which was set.
+	*/
+	TIM SimdLevel setSimdLevel(SimdLevel level);
+
+	//! Returns the points as the search structures store them.
+	/*!
+	Preconditions:
+	dimension >= 0
+
+	roundedSet:
+	Storage for the rounded coordinates.
+
+	Returns:
+	If sreal is dreal, pointSet. Otherwise pointers to 
+	copies of the points, rounded to sreal, and stored in 
+	roundedSet. The search structures are built from these,
+	so that their bounds hold for the stored coordinates.
+	*/
+	TIM std::vector<const dreal*> storedPoints(
+		const std::vector<const dreal*>& pointSet,
+		integer dimension,
+		std::vector<dreal>& roundedSet);
+
+	//! Returns the Euclidean distance to a stored point.
+	/*!
+	Preconditions:
+	dimension >= 0
+
+	This is as storedDistance(), except in the Euclidean norm.
+	The squares are summed as in scanSquaredDistances(), 
+	without contraction, so that the distance is the one 
+	reported by the searches.
+	*/
+	TIM dreal storedEuclideanDistance(
+		const dreal* query,
+		const dreal* point,
+		integer dimension);
+
+	//! Returns the maximum-norm distance to a stored point.
+	/*!
+	Preconditions:
+	dimension >= 0
+
+	The coordinates of the point are rounded to sreal, as the
+	search structures store them, and the distance is computed 
+	in dreal. This is the distance the searches and the counts 
+	report; see scanDistances().
+	*/
+	inline dreal storedDistance(
+		const dreal* query,
+		const dreal* point,
+		integer dimension)
+	{
+		dreal result = 0;
+		for (integer j = 0;j < dimension;++j)
+		{
+			result = std::max(result,
+				std::abs(query[j] - (dreal)(sreal)point[j]));
+		}
+		return result;
+	}
+
+	//! Computes maximum-norm distances from a query to a leaf.
+	/*!
+	Preconditions:
+	count >= 0
+	n >= 0
+
+	coordinateSet:
+	The coordinates of the points of a leaf, in
+	structure-of-arrays form: the j:th coordinate of the
+	i:th point is at coordinateSet[j * count + i]. The 
+	distances are computed in dreal.
+
+	bound:
+	An upper bound for the interesting distances. The
+	computation of a distance may be cut short once
+	it is known to be at least the bound. Use infinity
+	to compute all the distances exactly.
+
+	distanceSet:
+	The output, with count elements. The distance of the
+	i:th point is stored in distanceSet[i] if it is less
+	than the bound; otherwise distanceSet[i] >= bound.
+	*/
+	TIM void scanDistances(
+		const sreal* coordinateSet,
+		integer count,
+		integer n,
+		const dreal* query,
+		dreal bound,
+		dreal* distanceSet);
+
+	//! Computes squared Euclidean distances from a query to a leaf.
+	/*!
+	Preconditions:
+	count >= 0
+	n >= 0
+
+	This is as scanDistances(), except that the distances are
+	squared Euclidean distances, and the bound is compared
+	against the squared distances.
+	*/
+	TIM void scanSquaredDistances(
+		const sreal* coordinateSet,
+		integer count,
+		integer n,
+		const dreal* query,
+		dreal bound,
+		dreal* distanceSet);
+
+	//! Counts the points of a leaf inside an open maximum-norm ball.
+	/*!
+	Preconditions:
+	count >= 0
+	n >= 0
+	maxDistance >= 0
+
+	coordinateSet:
+	As in scanDistances().
+
+	visibleSet:
+	For each point of the leaf, whether it should be counted.
+
+	Returns:
+	The number of visible points p for which
+	max_j |p_j - query_j| < maxDistance.
+	*/
+	TIM integer scanCount(
+		const sreal* coordinateSet,
+		const char* visibleSet,
+		integer count,
+		integer n,
+		const dreal* query,
+		dreal maxDistance);
+
+}
+
+#endif
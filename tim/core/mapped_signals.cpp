@@ -0,0 +1,415 @@
+#include "tim/core/mapped_signals.h"
+
+#if (defined _WIN32 || defined _WIN64)
+#	define NOMINMAX
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+namespace Tim
+{
+
+	namespace
+	{
+
+		const char SignalMagic[] = "TIMSIGNL";
+		const integer SignalMagicSize = 8;
+		const integer SignalHeaderSize = 64;
+		const integer SignalVersion = 1;
+
+		const char NpyMagic[] = "\x93NUMPY";
+		const integer NpyMagicSize = 6;
+
+		bool littleEndian()
+		{
+			const std::uint32_t one = 1;
+			unsigned char first = 0;
+			std::memcpy(&first, &one, 1);
+			return first == 1;
+		}
+
+		// Reads a little-endian integer of the given number of bytes.
+		integer readInteger(const char* data, integer bytes)
+		{
+			std::uint64_t result = 0;
+			for (integer i = bytes - 1;i >= 0;--i)
+			{
+				result = (result << 8) | (unsigned char)data[i];
+			}
+			return (integer)(std::int64_t)result;
+		}
+
+		// Writes a little-endian integer of the given number of bytes.
+		void writeInteger(char* data, integer value, integer bytes)
+		{
+			std::uint64_t bits = (std::uint64_t)(std::int64_t)value;
+			for (integer i = 0;i < bytes;++i)
+			{
+				data[i] = (char)(bits & 0xFF);
+				bits >>= 8;
+			}
+		}
+
+		// Returns the position after the value of a key in
+		// a .npy header, or npos if the key is missing.
+		std::string::size_type findValue(
+			const std::string& header, const std::string& key)
+		{
+			std::string::size_type at = header.find("'" + key + "'");
+			if (at == std::string::npos)
+			{
+				return at;
+			}
+			at = header.find(':', at);
+			if (at == std::string::npos)
+			{
+				return at;
+			}
+			return header.find_first_not_of(" ", at + 1);
+		}
+
+	}
+
+	MappedSignals::MappedSignals()
+		: data_(nullptr)
+		, bytes_(0)
+		, handle_(nullptr)
+		, dimension_(0)
+		, samples_(0)
+		, t_(0)
+		, trials_(0)
+		, signalSet_()
+	{
+	}
+
+	MappedSignals::MappedSignals(const std::string& fileName)
+		: MappedSignals()
+	{
+		ENSURE(littleEndian());
+
+		const char* data = map(fileName);
+
+		integer offset = 0;
+		if (bytes_ >= NpyMagicSize &&
+			std::memcmp(data, NpyMagic, NpyMagicSize) == 0)
+		{
+			readNpyHeader(&offset);
+		}
+		else
+		{
+			readSignalHeader(&offset);
+		}
+
+		ENSURE_OP(dimension_, >=, 0);
+		ENSURE_OP(samples_, >=, 0);
+		ENSURE_OP(trials_, >=, 0);
+		ENSURE_OP(offset % (integer)sizeof(dreal), ==, 0);
+		ENSURE_OP(offset, <=, bytes_);
+
+		// The extents come from the file, so that their product
+		// may overflow; each factor is checked against the reals
+		// in the file instead.
+		integer reals = (bytes_ - offset) / (integer)sizeof(dreal);
+		if (dimension_ > 0)
+		{
+			ENSURE_OP(samples_, <=, reals / dimension_);
+		}
+
+		integer trialSize = dimension_ * samples_;
+		if (trialSize > 0)
+		{
+			ENSURE_OP(trials_, <=, reals / trialSize);
+		}
+
+		dreal* sampleSet = (dreal*)(data_ + offset);
+
+		signalSet_ = Array<Signal>(Vector2i(trials_, 1));
+		for (integer i = 0;i < trials_;++i)
+		{
+			signalSet_(i, 0) = Signal(
+				MatrixView<dreal>(sampleSet + i * trialSize, dimension_, samples_),
+				t_);
+		}
+	}
+
+	MappedSignals::MappedSignals(MappedSignals&& that)
+		: MappedSignals()
+	{
+		swap(that);
+	}
+
+	MappedSignals& MappedSignals::operator=(MappedSignals&& that)
+	{
+		MappedSignals moved(std::move(that));
+		swap(moved);
+		return *this;
+	}
+
+	MappedSignals::~MappedSignals()
+	{
+		unmap();
+	}
+
+	void MappedSignals::swap(MappedSignals& that)
+	{
+		std::swap(data_, that.data_);
+		std::swap(bytes_, that.bytes_);
+		std::swap(handle_, that.handle_);
+		std::swap(dimension_, that.dimension_);
+		std::swap(samples_, that.samples_);
+		std::swap(t_, that.t_);
+		std::swap(trials_, that.trials_);
+		signalSet_.swap(that.signalSet_);
+	}
+
+	integer MappedSignals::trials() const
+	{
+		return trials_;
+	}
+
+	integer MappedSignals::dimension() const
+	{
+		return dimension_;
+	}
+
+	integer MappedSignals::samples() const
+	{
+		return samples_;
+	}
+
+	integer MappedSignals::t() const
+	{
+		return t_;
+	}
+
+	const Signal& MappedSignals::signal(integer trial) const
+	{
+		PENSURE_OP(trial, >=, 0);
+		PENSURE_OP(trial, <, trials_);
+
+		return signalSet_(trial, 0);
+	}
+
+	const Array<Signal>& MappedSignals::signalSet() const
+	{
+		return signalSet_;
+	}
+
+	const char* MappedSignals::map(const std::string& fileName)
+	{
+#if (defined _WIN32 || defined _WIN64)
+		HANDLE file = CreateFileA(
+			fileName.c_str(), GENERIC_READ, FILE_SHARE_READ,
+			nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		ENSURE1(file != INVALID_HANDLE_VALUE, fileName);
+
+		LARGE_INTEGER size;
+		bool sized = (GetFileSizeEx(file, &size) != 0);
+		if (!sized || size.QuadPart == 0)
+		{
+			CloseHandle(file);
+		}
+		ENSURE1(sized, fileName);
+		ENSURE1(size.QuadPart > 0, fileName);
+
+		// The mapping keeps the file open.
+		HANDLE mapping = CreateFileMappingA(
+			file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+		CloseHandle(file);
+		ENSURE1(mapping != nullptr, fileName);
+
+		void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+		if (!data)
+		{
+			CloseHandle(mapping);
+		}
+		ENSURE1(data != nullptr, fileName);
+
+		handle_ = mapping;
+		bytes_ = size.QuadPart;
+#else
+		int file = ::open(fileName.c_str(), O_RDONLY);
+		ENSURE1(file != -1, fileName);
+
+		struct stat status;
+		bool sized = (::fstat(file, &status) == 0);
+		if (!sized || status.st_size == 0)
+		{
+			::close(file);
+		}
+		ENSURE1(sized, fileName);
+		ENSURE1(status.st_size > 0, fileName);
+
+		// The mapping keeps the file open.
+		void* data = ::mmap(
+			nullptr, status.st_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE, file, 0);
+		::close(file);
+		ENSURE1(data != MAP_FAILED, fileName);
+
+		bytes_ = status.st_size;
+#endif
+		data_ = (char*)data;
+		return data_;
+	}
+
+	void MappedSignals::unmap()
+	{
+		if (!data_)
+		{
+			return;
+		}
+
+#if (defined _WIN32 || defined _WIN64)
+		UnmapViewOfFile(data_);
+		CloseHandle((HANDLE)handle_);
+#else
+		::munmap(data_, bytes_);
+#endif
+
+		data_ = nullptr;
+		bytes_ = 0;
+		handle_ = nullptr;
+	}
+
+	void MappedSignals::readSignalHeader(integer* offset)
+	{
+		ENSURE_OP(bytes_, >=, SignalHeaderSize);
+		ENSURE(std::memcmp(data_, SignalMagic, SignalMagicSize) == 0);
+		ENSURE_OP(readInteger(data_ + 8, 4), ==, SignalVersion);
+		ENSURE_OP(readInteger(data_ + 12, 4), ==, (integer)sizeof(dreal));
+
+		dimension_ = readInteger(data_ + 16, 8);
+		samples_ = readInteger(data_ + 24, 8);
+		t_ = readInteger(data_ + 32, 8);
+		trials_ = readInteger(data_ + 40, 8);
+
+		*offset = SignalHeaderSize;
+	}
+
+	void MappedSignals::readNpyHeader(integer* offset)
+	{
+		// The version 1 header has a 16-bit length,
+		// and the later ones a 32-bit length.
+
+		ENSURE_OP(bytes_, >=, NpyMagicSize + 4);
+		integer major = (unsigned char)data_[NpyMagicSize];
+		integer lengthSize = (major == 1) ? 2 : 4;
+		ENSURE_OP(major, >=, 1);
+		ENSURE_OP(major, <=, 3);
+
+		integer begin = NpyMagicSize + 2 + lengthSize;
+		ENSURE_OP(bytes_, >=, begin);
+		integer length = readInteger(data_ + NpyMagicSize + 2, lengthSize);
+		ENSURE_OP(bytes_, >=, begin + length);
+
+		std::string header(data_ + begin, length);
+		*offset = begin + length;
+
+		// The header is a Python dictionary literal, such as
+		// {'descr': '<f8', 'fortran_order': False, 'shape': (1000, 3), }
+
+		std::string::size_type at = findValue(header, "descr");
+		ENSURE(at != std::string::npos);
+		std::string::size_type end = header.find(header[at], at + 1);
+		ENSURE(end != std::string::npos);
+		std::string descr = header.substr(at + 1, end - at - 1);
+		ENSURE(descr == "<f" + std::to_string(sizeof(dreal)));
+
+		at = findValue(header, "fortran_order");
+		ENSURE(at != std::string::npos);
+		bool fortranOrder = (header.compare(at, 4, "True") == 0);
+
+		at = findValue(header, "shape");
+		ENSURE(at != std::string::npos);
+		ENSURE(header[at] == '(');
+		end = header.find(')', at);
+		ENSURE(end != std::string::npos);
+
+		std::vector<integer> shape;
+		for (std::string::size_type i = at + 1;i < end;)
+		{
+			i = header.find_first_of("0123456789", i);
+			if (i == std::string::npos || i >= end)
+			{
+				break;
+			}
+			std::string::size_type j = header.find_first_not_of("0123456789", i);
+			shape.push_back(std::stoll(header.substr(i, j - i)));
+			i = j;
+		}
+		ENSURE_OP((integer)shape.size(), >=, 1);
+		ENSURE_OP((integer)shape.size(), <=, 3);
+
+		// Both orders keep the samples contiguous; the shape
+		// of the Fortran order is that of the C order reversed.
+
+		if (fortranOrder)
+		{
+			std::reverse(shape.begin(), shape.end());
+		}
+
+		trials_ = 1;
+		dimension_ = 1;
+		if (shape.size() == 3)
+		{
+			trials_ = shape[0];
+			shape.erase(shape.begin());
+		}
+		samples_ = shape[0];
+		if (shape.size() == 2)
+		{
+			dimension_ = shape[1];
+		}
+		t_ = 0;
+	}
+
+	void writeSignalFile(
+		const std::string& fileName,
+		const std::vector<Signal>& trialSet)
+	{
+		ENSURE(littleEndian());
+		ENSURE(!trialSet.empty());
+
+		const Signal& first = trialSet.front();
+		for (const Signal& signal : trialSet)
+		{
+			ENSURE_OP(signal.dimension(), ==, first.dimension());
+			ENSURE_OP(signal.samples(), ==, first.samples());
+			ENSURE_OP(signal.t(), ==, first.t());
+		}
+
+		char header[SignalHeaderSize] = {};
+		std::memcpy(header, SignalMagic, SignalMagicSize);
+		writeInteger(header + 8, SignalVersion, 4);
+		writeInteger(header + 12, sizeof(dreal), 4);
+		writeInteger(header + 16, first.dimension(), 8);
+		writeInteger(header + 24, first.samples(), 8);
+		writeInteger(header + 32, first.t(), 8);
+		writeInteger(header + 40, trialSet.size(), 8);
+
+		std::ofstream file(fileName, std::ios::binary);
+		ENSURE1(file.good(), fileName);
+
+		file.write(header, SignalHeaderSize);
+		for (const Signal& signal : trialSet)
+		{
+			file.write(
+				(const char*)signal.data().data(),
+				signal.dimension() * signal.samples() * sizeof(dreal));
+		}
+
+		file.close();
+		ENSURE1(file.good(), fileName);
+	}
+
+}
@@ -0,0 +1,155 @@
+// Description: MappedSignals class
+// Detail: Trials of a signal memory-mapped from a file, without copying
+// Documentation: mapped_signals.txt
+
+#ifndef TIM_MAPPED_SIGNALS_H
+#define TIM_MAPPED_SIGNALS_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/signal.h"
+
+#include <pastel/sys/array/array.h>
+
+#include <string>
+#include <vector>
+
+namespace Tim
+{
+
+	//! Trials of a signal memory-mapped from a file
+	/*!
+	The file is either a TIM signal file, written by
+	writeSignalFile(), or a NumPy .npy file; the format
+	is recognized from the contents. The signals are views
+	to the mapped pages, so that opening a file does not
+	read or copy its samples; the pages are read when the
+	samples are first accessed.
+
+	The mapping is private: modifying the samples does not
+	modify the file, but copies the modified pages.
+
+	The signals must not be used after this object has
+	been destructed.
+	*/
+	class TIM MappedSignals
+	{
+	public:
+		//! Constructs an empty set of signals.
+		MappedSignals();
+
+		//! Maps the signals of a file.
+		/*!
+		A .npy file must contain little-endian reals of the
+		size of dreal. Its shape is interpreted as follows,
+		where the samples are always contiguous:
+
+		(samples): a 1-dimensional signal.
+
+		(samples, dimension), C order, or
+		(dimension, samples), Fortran order: a signal.
+
+		(trials, samples, dimension), C order, or
+		(dimension, samples, trials), Fortran order:
+		the trials of a signal.
+
+		The signals of a .npy file begin at time instant 0.
+		*/
+		explicit MappedSignals(const std::string& fileName);
+
+		MappedSignals(MappedSignals&& that);
+		MappedSignals& operator=(MappedSignals&& that);
+
+		MappedSignals(const MappedSignals& that) = delete;
+		MappedSignals& operator=(const MappedSignals& that) = delete;
+
+		~MappedSignals();
+
+		//! Swaps two mappings.
+		void swap(MappedSignals& that);
+
+		//! Returns the number of trials.
+		integer trials() const;
+
+		//! Returns the dimension of the signals.
+		integer dimension() const;
+
+		//! Returns the number of samples in each trial.
+		integer samples() const;
+
+		//! Returns the time instant of the first sample.
+		integer t() const;
+
+		//! Returns the signal of a trial.
+		/*!
+		Preconditions:
+		0 <= trial < trials()
+		*/
+		const Signal& signal(integer trial) const;
+
+		//! Returns the trials as an ensemble of one signal.
+		/*!
+		The ensemble has width trials() and height 1,
+		as in entropyCombination().
+		*/
+		const Array<Signal>& signalSet() const;
+
+	private:
+		// Maps the file, and returns the mapped bytes.
+		const char* map(const std::string& fileName);
+
+		// Unmaps the file.
+		void unmap();
+
+		// Interprets the header of a TIM signal file.
+		void readSignalHeader(integer* offset);
+
+		// Interprets the header of a .npy file.
+		void readNpyHeader(integer* offset);
+
+		/*
+		data_, bytes_:
+		The mapped bytes of the file, and their number.
+
+		handle_:
+		The handle of the mapping, on Windows.
+
+		dimension_, samples_, t_, trials_:
+		The extents of the signals.
+
+		signalSet_:
+		The views of the trials to the mapped bytes.
+		*/
+
+		char* data_;
+		integer bytes_;
+		void* handle_;
+		integer dimension_;
+		integer samples_;
+		integer t_;
+		integer trials_;
+		Array<Signal> signalSet_;
+	};
+
+	//! Writes the trials of a signal to a TIM signal file.
+	/*!
+	Preconditions:
+	!trialSet.empty()
+	The trials have the same dimension, number of
+	samples, and time instant of the first sample.
+
+	The file consists of a 64-byte header, followed by the
+	samples of each trial in the layout of Signal. The header
+	holds, in little-endian order, the 8 bytes "TIMSIGNL",
+	the format version 1 as a 32-bit integer, the size of a
+	real in bytes as a 32-bit integer, and the dimension, the
+	number of samples, the time instant of the first sample,
+	and the number of trials, each as a 64-bit integer. The
+	rest of the header is zeros.
+	*/
+	TIM void writeSignalFile(
+		const std::string& fileName,
+		const std::vector<Signal>& trialSet);
+
+}
+
+#endif
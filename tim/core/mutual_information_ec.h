@@ -31,7 +31,8 @@ namespace Tim
 			SignalData* result,
 			integer xLag, integer yLag,
 			integer kNearest,
-			const Filter_Range& filter)
+			const Filter_Range& filter,
+			Instrumentation* instrumentation)
 		{
 			ENSURE_OP(timeWindowRadius, >=, 0);
 			ENSURE_OP(kNearest, >, 0);
@@ -76,7 +77,12 @@ namespace Tim
 					timeWindowRadius,
 					range(lagSet),
 					kNearest,
-					filter);
+					filter,
+					1,
+					TemporalHop(),
+					0,
+					nullptr,
+					instrumentation);
 				
 				return 0;
 			}
@@ -85,7 +91,10 @@ namespace Tim
 				signalSet,
 				range(rangeSet),
 				range(lagSet),
-				kNearest);
+				kNearest,
+				0,
+				nullptr,
+				instrumentation);
 		}
 
 	}
@@ -115,6 +124,9 @@ namespace Tim
 	kNearest:
 	The number of nearest neighbors to use in the estimation.
 
+	instrumentation:
+	See entropyCombination().
+
 	If the number of samples varies between trials, 
 	then the minimum number of samples among the trials
 	is used.
@@ -129,7 +141,8 @@ namespace Tim
 		integer timeWindowRadius,
 		integer xLag, integer yLag,
 		integer kNearest,
-		const Filter_Range& filter)
+		const Filter_Range& filter,
+		Instrumentation* instrumentation = nullptr)
 	{
 		SignalData result;
 		Tim::Detail_MutualInformation::mutualInformation(
@@ -138,7 +151,8 @@ namespace Tim
 			&result,
 			xLag, yLag,
 			kNearest,
-			filter);
+			filter,
+			instrumentation);
 		return result;
 	}
 
@@ -192,6 +206,9 @@ namespace Tim
 	kNearest:
 	The number of nearest neighbors to use in the estimation.
 
+	instrumentation:
+	See entropyCombination().
+
 	If the number of samples varies between trials, 
 	then the minimum number of samples among the trials
 	is used.
@@ -203,7 +220,8 @@ namespace Tim
 		const X_Signal_Range& xSignalSet,
 		const Y_Signal_Range& ySignalSet,
 		integer xLag = 0, integer yLag = 0,
-		integer kNearest = 1)
+		integer kNearest = 1,
+		Instrumentation* instrumentation = nullptr)
 	{
 		return Tim::Detail_MutualInformation::mutualInformation(
 			xSignalSet, ySignalSet,
@@ -211,7 +229,8 @@ namespace Tim
 			0,
 			xLag, yLag,
 			kNearest,
-			constantRange((dreal)1, 1));
+			constantRange((dreal)1, 1),
+			instrumentation);
 	}
 
 }
@@ -25,6 +25,27 @@ namespace Tim
 	typedef Maximum_Norm<dreal> Default_Norm;
 	typedef SlidingMidpoint_SplitRule SplitRule;
 
+	//! The type of the coordinate cache of the search structures.
+	/*!
+	The search structures keep a cache of the coordinates of 
+	the points. Defining TIM_SINGLE_PRECISION_SEARCH keeps this
+	cache in single precision, for the whole build. The signals 
+	stay in dreal, in addition to the cache, and the distances 
+	are still computed in dreal, from the rounded coordinates.
+	*/
+#ifdef TIM_SINGLE_PRECISION_SEARCH
+	typedef float sreal;
+#else
+	typedef dreal sreal;
+#endif
+
+	//! The norms in which the search structures measure distances.
+	enum class Metric
+	{
+		Maximum,
+		Euclidean
+	};
+
 }
 
 #endif
@@ -0,0 +1,946 @@
+#include "tim/core/packed_kdtree.h"
+#include "tim/core/leaf_scan.h"
+#include "tim/core/instrumentation.h"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+#include <tbb/parallel_reduce.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <queue>
+#include <utility>
+
+namespace Tim
+{
+
+	struct PackedKdTree::Batch
+	{
+		// The queries of the batch.
+		const dreal* const* querySet;
+		integer queries;
+
+		// Whether a query rejects itself as a neighbor.
+		bool excludeQuery;
+
+		// The search radii are multiplied by this factor
+		// when deciding whether to visit a node; 
+		// 1 / (1 + maxRelativeError).
+		dreal shrink;
+
+		// The neighbors of the i:th query are stored in
+		// [i * kNearest, i * kNearest + neighborsSet[i][.
+		integer kNearest;
+		std::vector<Neighbor> neighborSet;
+		std::vector<integer> neighborsSet;
+
+		// The bounding box of the queries; the minimum
+		// is followed by the maximum.
+		std::vector<dreal> boundSet;
+
+		// Scratch space for the distances to a leaf.
+		std::vector<dreal> distanceSet;
+
+		// Returns the distance to the k:th neighbor of the
+		// i:th query, or infinity if there is no such yet.
+		dreal bound(integer i) const
+		{
+			if (neighborsSet[i] < kNearest)
+			{
+				return infinity<dreal>();
+			}
+			return neighborSet[i * kNearest + kNearest - 1].distance;
+		}
+
+		// Returns the radius within which a node must be
+		// for the i:th query to visit it.
+		dreal searchBound(integer i) const
+		{
+			if (neighborsSet[i] < kNearest)
+			{
+				return infinity<dreal>();
+			}
+			return bound(i) * shrink;
+		}
+
+		// Returns the largest search radius over the queries.
+		dreal maxBound() const
+		{
+			dreal result = 0;
+			for (integer i = 0;i < queries;++i)
+			{
+				result = std::max(result, searchBound(i));
+			}
+			return result;
+		}
+	};
+
+	PackedKdTree::PackedKdTree()
+		: n_(0)
+		, bucketSize_(16)
+		, maxLeafSize_(0)
+		, nodeSet_()
+		, boundSet_()
+		, coordinateSet_()
+		, pointSet_()
+		, indexSet_()
+		, positionSet_()
+		, leafSet_()
+		, visibleSet_()
+		, instrumentation_(nullptr)
+	{
+	}
+
+	PackedKdTree::PackedKdTree(
+		const std::vector<const dreal*>& pointSet,
+		integer dimension,
+		integer bucketSize)
+		: n_(dimension)
+		, bucketSize_(bucketSize)
+		, maxLeafSize_(0)
+		, nodeSet_()
+		, boundSet_()
+		, coordinateSet_()
+		, pointSet_()
+		, indexSet_()
+		, positionSet_()
+		, leafSet_()
+		, visibleSet_()
+		, instrumentation_(nullptr)
+	{
+		ENSURE_OP(dimension, >=, 0);
+		ENSURE_OP(bucketSize, >, 0);
+
+		integer points = pointSet.size();
+		if (points == 0)
+		{
+			return;
+		}
+
+		std::vector<integer> orderSet(points);
+		std::iota(orderSet.begin(), orderSet.end(), (integer)0);
+
+		// The tree is built over the coordinates as they
+		// are stored, so that the bounding boxes hold for
+		// the stored coordinates.
+		std::vector<dreal> roundedSet;
+		std::vector<const dreal*> buildSet = 
+			storedPoints(pointSet, n_, roundedSet);
+
+		nodeSet_.reserve(4 * (points / bucketSize_) + 1);
+		build(orderSet, buildSet, 0, points, -1, nodeSet_, boundSet_);
+
+		integer nodes = nodeSet_.size();
+		for (const Node& leaf : nodeSet_)
+		{
+			if (leaf.left < 0)
+			{
+				maxLeafSize_ = std::max(maxLeafSize_, leaf.end - leaf.begin);
+			}
+		}
+
+		// Copy the coordinates of the points into the
+		// leaves, in tree order. The leaves are disjoint,
+		// and are copied in parallel.
+
+		coordinateSet_.resize(points * n_);
+		pointSet_.resize(points);
+		indexSet_.resize(points);
+		positionSet_.resize(points);
+		leafSet_.resize(points);
+		visibleSet_.assign(points, true);
+
+		using Block = tbb::blocked_range<integer>;
+
+		tbb::parallel_for(Block(0, nodes),
+			[&](const Block& block)
+			{
+				for (integer node = block.begin();node < block.end();++node)
+				{
+					const Node& leaf = nodeSet_[node];
+					if (leaf.left >= 0)
+					{
+						continue;
+					}
+
+					integer count = leaf.end - leaf.begin;
+					sreal* coordinate = coordinateSet_.data() + leaf.begin * n_;
+					for (integer i = 0;i < count;++i)
+					{
+						integer position = leaf.begin + i;
+						const dreal* point = pointSet[orderSet[position]];
+						for (integer j = 0;j < n_;++j)
+						{
+							coordinate[j * count + i] = (sreal)point[j];
+						}
+
+						pointSet_[position] = point;
+						indexSet_[position] = orderSet[position];
+						positionSet_[orderSet[position]] = position;
+						leafSet_[position] = node;
+					}
+				}
+			});
+	}
+
+	PackedKdTree::PackedKdTree(PackedKdTree&& that)
+		: PackedKdTree()
+	{
+		swap(that);
+	}
+
+	PackedKdTree& PackedKdTree::operator=(PackedKdTree that)
+	{
+		swap(that);
+		return *this;
+	}
+
+	void PackedKdTree::swap(PackedKdTree& that)
+	{
+		std::swap(n_, that.n_);
+		std::swap(bucketSize_, that.bucketSize_);
+		std::swap(maxLeafSize_, that.maxLeafSize_);
+		nodeSet_.swap(that.nodeSet_);
+		boundSet_.swap(that.boundSet_);
+		coordinateSet_.swap(that.coordinateSet_);
+		pointSet_.swap(that.pointSet_);
+		indexSet_.swap(that.indexSet_);
+		positionSet_.swap(that.positionSet_);
+		leafSet_.swap(that.leafSet_);
+		visibleSet_.swap(that.visibleSet_);
+	}
+
+	void PackedKdTree::setInstrumentation(Instrumentation* instrumentation)
+	{
+		instrumentation_ = instrumentation;
+	}
+
+	integer PackedKdTree::n() const
+	{
+		return n_;
+	}
+
+	integer PackedKdTree::points() const
+	{
+		if (nodeSet_.empty())
+		{
+			return 0;
+		}
+
+		return nodeSet_[0].visible;
+	}
+
+	integer PackedKdTree::size() const
+	{
+		return pointSet_.size();
+	}
+
+	void PackedKdTree::hide(integer i)
+	{
+		PENSURE_OP(i, >=, 0);
+		PENSURE_OP(i, <, size());
+
+		integer position = positionSet_[i];
+		if (!visibleSet_[position])
+		{
+			return;
+		}
+
+		visibleSet_[position] = false;
+		for (integer node = leafSet_[position];node >= 0;node = nodeSet_[node].parent)
+		{
+			--nodeSet_[node].visible;
+		}
+	}
+
+	void PackedKdTree::show(integer i)
+	{
+		PENSURE_OP(i, >=, 0);
+		PENSURE_OP(i, <, size());
+
+		integer position = positionSet_[i];
+		if (visibleSet_[position])
+		{
+			return;
+		}
+
+		visibleSet_[position] = true;
+		for (integer node = leafSet_[position];node >= 0;node = nodeSet_[node].parent)
+		{
+			++nodeSet_[node].visible;
+		}
+	}
+
+	void PackedKdTree::hide()
+	{
+		std::fill(visibleSet_.begin(), visibleSet_.end(), false);
+		for (Node& node : nodeSet_)
+		{
+			node.visible = 0;
+		}
+	}
+
+	void PackedKdTree::show()
+	{
+		std::fill(visibleSet_.begin(), visibleSet_.end(), true);
+		for (Node& node : nodeSet_)
+		{
+			node.visible = node.end - node.begin;
+		}
+	}
+
+	void PackedKdTree::hide(integer begin, integer end)
+	{
+		setVisible(begin, end, false);
+	}
+
+	void PackedKdTree::show(integer begin, integer end)
+	{
+		setVisible(begin, end, true);
+	}
+
+	integer PackedKdTree::countRange(
+		const dreal* query,
+		dreal maxDistance) const
+	{
+		PENSURE_OP(maxDistance, >=, 0);
+
+		if (nodeSet_.empty())
+		{
+			return 0;
+		}
+
+		return countRange(0, query, maxDistance);
+	}
+
+	dreal PackedKdTree::searchNearest(
+		const dreal* query,
+		integer kNearest,
+		const dreal* exclude,
+		dreal maxRelativeError) const
+	{
+		return searchNearest(query, kNearest, exclude,
+			[](dreal, const dreal*) {}, maxRelativeError);
+	}
+
+	void PackedKdTree::searchAllNearest(
+		const std::vector<const dreal*>& querySet,
+		integer kNearest,
+		bool excludeQuery,
+		dreal* distanceSet,
+		integer* neighborSet,
+		dreal maxRelativeError) const
+	{
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE_OP(maxRelativeError, >=, 0);
+
+		integer queries = querySet.size();
+
+		std::fill(distanceSet, distanceSet + queries, infinity<dreal>());
+		if (neighborSet)
+		{
+			std::fill(neighborSet, neighborSet + queries * kNearest, (integer)-1);
+		}
+
+		if (queries == 0 || points() == 0)
+		{
+			return;
+		}
+
+		using Block = tbb::blocked_range<integer>;
+
+		// Group the queries by their leaf nodes.
+
+		std::vector<std::pair<integer, integer>> leafSet(queries);
+		tbb::parallel_for(Block(0, queries), 
+			[&](const Block& block)
+			{
+				for (integer i = block.begin();i < block.end();++i)
+				{
+					leafSet[i] = std::make_pair(locateLeaf(querySet[i]), i);
+				}
+			});
+
+		std::sort(leafSet.begin(), leafSet.end());
+
+		// A group is split into batches of bounded size, so
+		// that coinciding points do not form a huge batch.
+
+		std::vector<integer> batchBeginSet;
+		for (integer i = 0;i < queries;++i)
+		{
+			if (i == 0 || 
+				leafSet[i].first != leafSet[i - 1].first || 
+				i - batchBeginSet.back() == MaxBatchSize)
+			{
+				batchBeginSet.push_back(i);
+			}
+		}
+		batchBeginSet.push_back(queries);
+
+		integer batches = batchBeginSet.size() - 1;
+
+		auto search = [&](const Block& block)
+		{
+			Batch batch;
+			batch.excludeQuery = excludeQuery;
+			batch.shrink = 1 / (1 + maxRelativeError);
+			batch.kNearest = kNearest;
+			batch.neighborSet.resize(MaxBatchSize * kNearest);
+			batch.neighborsSet.resize(MaxBatchSize);
+			batch.boundSet.resize(2 * n_);
+			batch.distanceSet.resize(maxLeafSize_);
+
+			std::vector<const dreal*> batchQuerySet(MaxBatchSize);
+
+			for (integer b = block.begin();b < block.end();++b)
+			{
+				integer begin = batchBeginSet[b];
+				integer end = batchBeginSet[b + 1];
+
+				for (integer i = begin;i < end;++i)
+				{
+					batchQuerySet[i - begin] = querySet[leafSet[i].second];
+				}
+
+				batch.querySet = batchQuerySet.data();
+				batch.queries = end - begin;
+				std::fill(batch.neighborsSet.begin(), batch.neighborsSet.end(), (integer)0);
+
+				dreal* minBound = batch.boundSet.data();
+				dreal* maxBound = minBound + n_;
+				std::fill(minBound, minBound + n_, infinity<dreal>());
+				std::fill(maxBound, maxBound + n_, -infinity<dreal>());
+				for (integer i = 0;i < batch.queries;++i)
+				{
+					for (integer j = 0;j < n_;++j)
+					{
+						minBound[j] = std::min(minBound[j], batch.querySet[i][j]);
+						maxBound[j] = std::max(maxBound[j], batch.querySet[i][j]);
+					}
+				}
+
+				searchBatch(0, batch);
+
+				for (integer i = begin;i < end;++i)
+				{
+					integer query = leafSet[i].second;
+					integer j = i - begin;
+
+					distanceSet[query] = batch.bound(j);
+					if (neighborSet)
+					{
+						for (integer r = 0;r < batch.neighborsSet[j];++r)
+						{
+							neighborSet[query * kNearest + r] = 
+								indexSet_[batch.neighborSet[j * kNearest + r].position];
+						}
+					}
+				}
+			}
+		};
+
+		tbb::parallel_for(Block(0, batches, 1), search);
+	}
+
+	// Private
+
+	integer PackedKdTree::build(
+		std::vector<integer>& orderSet,
+		const std::vector<const dreal*>& pointSet,
+		integer begin, integer end,
+		integer parent,
+		std::vector<Node>& nodeSet,
+		std::vector<dreal>& boundSet) const
+	{
+		integer node = nodeSet.size();
+		nodeSet.push_back(Node{begin, end, -1, -1, parent, end - begin});
+		boundSet.resize(boundSet.size() + 2 * n_);
+
+		dreal* minBound = boundSet.data() + 2 * node * n_;
+		dreal* maxBound = minBound + n_;
+		computeBound(orderSet, pointSet, begin, end, minBound);
+
+		// Split along the longest side of the bounding box,
+		// at its midpoint.
+
+		integer axis = -1;
+		dreal extent = 0;
+		for (integer j = 0;j < n_;++j)
+		{
+			if (maxBound[j] - minBound[j] > extent)
+			{
+				axis = j;
+				extent = maxBound[j] - minBound[j];
+			}
+		}
+
+		bool leaf = (end - begin <= bucketSize_ || axis < 0);
+
+		integer middle = begin;
+		if (!leaf)
+		{
+			dreal split = (minBound[axis] + maxBound[axis]) / 2;
+			middle = std::partition(
+				orderSet.begin() + begin,
+				orderSet.begin() + end,
+				[&](integer i) {return pointSet[i][axis] < split;}) -
+				orderSet.begin();
+
+			// With a tight bounding box both sides are non-empty,
+			// except when the midpoint rounds to an end-point.
+			leaf = (middle == begin || middle == end);
+		}
+
+		if (leaf)
+		{
+			return node;
+		}
+
+		integer left = -1;
+		integer right = -1;
+
+		if (end - begin < ParallelBuildSize)
+		{
+			left = build(orderSet, pointSet, begin, middle, node, nodeSet, boundSet);
+			right = build(orderSet, pointSet, middle, end, node, nodeSet, boundSet);
+		}
+		else
+		{
+			// The subtrees are built concurrently. The right 
+			// subtree is built into storage of its own, and
+			// then appended after the left subtree, so that the 
+			// nodes are in the same order as when built serially.
+
+			std::vector<Node> rightNodeSet;
+			std::vector<dreal> rightBoundSet;
+
+			tbb::parallel_invoke(
+				[&]()
+				{
+					left = build(orderSet, pointSet, begin, middle, node, 
+						nodeSet, boundSet);
+				},
+				[&]()
+				{
+					build(orderSet, pointSet, middle, end, -1, 
+						rightNodeSet, rightBoundSet);
+				});
+
+			right = nodeSet.size();
+			for (Node child : rightNodeSet)
+			{
+				child.left = (child.left >= 0) ? child.left + right : -1;
+				child.right = (child.right >= 0) ? child.right + right : -1;
+				child.parent = (child.parent >= 0) ? child.parent + right : node;
+				nodeSet.push_back(child);
+			}
+			boundSet.insert(boundSet.end(), 
+				rightBoundSet.begin(), rightBoundSet.end());
+		}
+
+		nodeSet[node].left = left;
+		nodeSet[node].right = right;
+
+		return node;
+	}
+
+	integer PackedKdTree::locateLeaf(const dreal* query) const
+	{
+		integer node = 0;
+		while (nodeSet_[node].left >= 0)
+		{
+			const Node& current = nodeSet_[node];
+			node = (boxDistance(current.left, query) <= boxDistance(current.right, query)) ?
+				current.left : current.right;
+		}
+
+		return node;
+	}
+
+	void PackedKdTree::offer(
+		Neighbor* neighborSet,
+		integer& neighbors,
+		integer kNearest,
+		dreal distance,
+		integer position)
+	{
+		if (neighbors == kNearest)
+		{
+			if (distance >= neighborSet[kNearest - 1].distance)
+			{
+				return;
+			}
+			--neighbors;
+		}
+
+		// Insert in ascending order of distance.
+
+		integer j = neighbors;
+		while (j > 0 && neighborSet[j - 1].distance > distance)
+		{
+			neighborSet[j] = neighborSet[j - 1];
+			--j;
+		}
+		neighborSet[j] = Neighbor{distance, position};
+		++neighbors;
+	}
+
+	void PackedKdTree::computeBound(
+		const std::vector<integer>& orderSet,
+		const std::vector<const dreal*>& pointSet,
+		integer begin, integer end,
+		dreal* bound) const
+	{
+		auto extend = [&](integer first, integer last, dreal* minBound)
+		{
+			dreal* maxBound = minBound + n_;
+			for (integer i = first;i < last;++i)
+			{
+				const dreal* point = pointSet[orderSet[i]];
+				for (integer j = 0;j < n_;++j)
+				{
+					minBound[j] = std::min(minBound[j], point[j]);
+					maxBound[j] = std::max(maxBound[j], point[j]);
+				}
+			}
+		};
+
+		std::vector<dreal> emptyBound(2 * n_);
+		std::fill(emptyBound.begin(), emptyBound.begin() + n_, infinity<dreal>());
+		std::fill(emptyBound.begin() + n_, emptyBound.end(), -infinity<dreal>());
+
+		if (end - begin < ParallelBuildSize)
+		{
+			std::copy(emptyBound.begin(), emptyBound.end(), bound);
+			extend(begin, end, bound);
+			return;
+		}
+
+		using Block = tbb::blocked_range<integer>;
+
+		std::vector<dreal> result = tbb::parallel_reduce(
+			Block(begin, end, ParallelBuildSize / 4),
+			emptyBound,
+			[&](const Block& block, std::vector<dreal> partial)
+			{
+				extend(block.begin(), block.end(), partial.data());
+				return partial;
+			},
+			[&](std::vector<dreal> left, const std::vector<dreal>& right)
+			{
+				for (integer j = 0;j < n_;++j)
+				{
+					left[j] = std::min(left[j], right[j]);
+					left[n_ + j] = std::max(left[n_ + j], right[n_ + j]);
+				}
+				return left;
+			});
+
+		std::copy(result.begin(), result.end(), bound);
+	}
+
+	dreal PackedKdTree::boxDistance(
+		integer node, const dreal* query) const
+	{
+		const dreal* minBound = boundSet_.data() + 2 * node * n_;
+		const dreal* maxBound = minBound + n_;
+
+		dreal distance = 0;
+		for (integer j = 0;j < n_;++j)
+		{
+			distance = std::max(distance, minBound[j] - query[j]);
+			distance = std::max(distance, query[j] - maxBound[j]);
+		}
+
+		return distance;
+	}
+
+	void PackedKdTree::setVisible(integer begin, integer end, bool visible)
+	{
+		PENSURE_OP(begin, >=, 0);
+		PENSURE_OP(begin, <=, end);
+		PENSURE_OP(end, <=, size());
+
+		// A change in the visible count of a node.
+		using Change = std::pair<integer, integer>;
+
+		// Change the visibility of the points, and 
+		// collect the changes of their nodes.
+
+		integer delta = visible ? 1 : -1;
+		std::vector<Change> changeSet;
+		for (integer i = begin;i < end;++i)
+		{
+			integer position = positionSet_[i];
+			if ((bool)visibleSet_[position] == visible)
+			{
+				continue;
+			}
+
+			visibleSet_[position] = visible;
+			changeSet.emplace_back(leafSet_[position], delta);
+		}
+
+		// A parent node precedes its children in 'nodeSet_'. 
+		// When the changes are processed in descending order 
+		// of node, all the changes of a node have been merged
+		// before the node is updated, and passed on to its
+		// parent.
+
+		std::priority_queue<Change> changeQueue(
+			std::less<Change>(), std::move(changeSet));
+
+		while (!changeQueue.empty())
+		{
+			integer node = changeQueue.top().first;
+			integer change = 0;
+			while (!changeQueue.empty() && 
+				changeQueue.top().first == node)
+			{
+				change += changeQueue.top().second;
+				changeQueue.pop();
+			}
+
+			nodeSet_[node].visible += change;
+
+			integer parent = nodeSet_[node].parent;
+			if (parent >= 0)
+			{
+				changeQueue.emplace(parent, change);
+			}
+		}
+	}
+
+	integer PackedKdTree::countRange(
+		integer node,
+		const dreal* query,
+		dreal maxDistance) const
+	{
+		const Node& current = nodeSet_[node];
+		if (current.visible == 0)
+		{
+			return 0;
+		}
+
+		TIM_COUNT(instrumentation_, nodesVisited, 1);
+
+		// Classify the bounding box of the node against the ball.
+
+		const dreal* minBound = boundSet_.data() + 2 * node * n_;
+		const dreal* maxBound = minBound + n_;
+
+		bool inside = true;
+		for (integer j = 0;j < n_;++j)
+		{
+			// The differences are compared, rather than the
+			// bounds against query +- maxDistance, so that the
+			// rounding agrees with the distance of a point.
+			dreal toMin = minBound[j] - query[j];
+			dreal toMax = query[j] - maxBound[j];
+
+			if (toMin >= maxDistance || toMax >= maxDistance)
+			{
+				// The box does not intersect the open ball.
+				return 0;
+			}
+
+			if (-toMin >= maxDistance || -toMax >= maxDistance)
+			{
+				inside = false;
+			}
+		}
+
+		if (inside)
+		{
+			// All the points in the box are inside
+			// the open ball.
+			return current.visible;
+		}
+
+		if (current.left < 0)
+		{
+			TIM_COUNT(instrumentation_, distances, current.end - current.begin);
+
+			return scanCount(
+				coordinateSet_.data() + current.begin * n_,
+				visibleSet_.data() + current.begin,
+				current.end - current.begin,
+				n_, query, maxDistance);
+		}
+
+		return
+			countRange(current.left, query, maxDistance) +
+			countRange(current.right, query, maxDistance);
+	}
+
+	void PackedKdTree::searchNearest(
+		integer node,
+		const dreal* query,
+		const dreal* exclude,
+		integer kNearest,
+		dreal shrink,
+		Neighbor* neighborSet,
+		integer& neighbors,
+		dreal* distanceSet) const
+	{
+		const Node& current = nodeSet_[node];
+		TIM_COUNT(instrumentation_, nodesVisited, 1);
+
+		if (current.left < 0)
+		{
+			TIM_COUNT(instrumentation_, distances, current.end - current.begin);
+
+			// Only the distances less than the current k:th 
+			// distance are needed.
+			dreal bound = (neighbors < kNearest) ?
+				infinity<dreal>() : neighborSet[kNearest - 1].distance;
+
+			scanDistances(
+				coordinateSet_.data() + current.begin * n_,
+				current.end - current.begin,
+				n_, query, bound, distanceSet);
+
+			for (integer i = current.begin;i < current.end;++i)
+			{
+				if (!visibleSet_[i] || pointSet_[i] == exclude)
+				{
+					continue;
+				}
+
+				offer(neighborSet, neighbors, kNearest, 
+					distanceSet[i - current.begin], i);
+			}
+
+			return;
+		}
+
+		// Visit the nearer child first; the farther child
+		// is often culled by the shrunken search radius.
+
+		integer first = current.left;
+		integer second = current.right;
+		dreal firstDistance = boxDistance(first, query);
+		dreal secondDistance = boxDistance(second, query);
+		if (secondDistance < firstDistance)
+		{
+			std::swap(first, second);
+			std::swap(firstDistance, secondDistance);
+		}
+
+		if (nodeSet_[first].visible > 0 &&
+			(neighbors < kNearest || firstDistance < neighborSet[kNearest - 1].distance * shrink))
+		{
+			searchNearest(first, query, exclude, kNearest, shrink,
+				neighborSet, neighbors, distanceSet);
+		}
+
+		if (nodeSet_[second].visible > 0 &&
+			(neighbors < kNearest || secondDistance < neighborSet[kNearest - 1].distance * shrink))
+		{
+			searchNearest(second, query, exclude, kNearest, shrink,
+				neighborSet, neighbors, distanceSet);
+		}
+	}
+
+	bool PackedKdTree::batchNeeds(
+		integer node, 
+		const Batch& batch,
+		dreal& distance) const
+	{
+		// The distance between the bounding boxes of the node
+		// and the queries bounds the distance from any query
+		// to any point of the node.
+
+		const dreal* nodeMin = boundSet_.data() + 2 * node * n_;
+		const dreal* nodeMax = nodeMin + n_;
+		const dreal* batchMin = batch.boundSet.data();
+		const dreal* batchMax = batchMin + n_;
+
+		distance = 0;
+		for (integer j = 0;j < n_;++j)
+		{
+			distance = std::max(distance, nodeMin[j] - batchMax[j]);
+			distance = std::max(distance, batchMin[j] - nodeMax[j]);
+		}
+
+		return nodeSet_[node].visible > 0 && distance < batch.maxBound();
+	}
+
+	void PackedKdTree::searchBatch(
+		integer node, Batch& batch) const
+	{
+		const Node& current = nodeSet_[node];
+		TIM_COUNT(instrumentation_, nodesVisited, 1);
+
+		if (current.left < 0)
+		{
+			// The leaf data is scanned by all the queries
+			// of the batch while it is in cache.
+
+			integer count = current.end - current.begin;
+			const sreal* coordinateSet = coordinateSet_.data() + current.begin * n_;
+
+			for (integer q = 0;q < batch.queries;++q)
+			{
+				const dreal* query = batch.querySet[q];
+				if (boxDistance(node, query) >= batch.searchBound(q))
+				{
+					continue;
+				}
+
+				dreal bound = batch.bound(q);
+
+				TIM_COUNT(instrumentation_, distances, count);
+				scanDistances(
+					coordinateSet, count, n_, query, bound, 
+					batch.distanceSet.data());
+
+				const dreal* exclude = batch.excludeQuery ? query : nullptr;
+				Neighbor* neighborSet = batch.neighborSet.data() + q * batch.kNearest;
+				for (integer i = current.begin;i < current.end;++i)
+				{
+					if (!visibleSet_[i] || pointSet_[i] == exclude)
+					{
+						continue;
+					}
+
+					offer(neighborSet, batch.neighborsSet[q], batch.kNearest,
+						batch.distanceSet[i - current.begin], i);
+				}
+			}
+
+			return;
+		}
+
+		// Visit the child nearer to the batch first. The need
+		// for the farther child is decided only afterwards, 
+		// when the search radii have shrunk.
+
+		integer first = current.left;
+		integer second = current.right;
+		dreal firstDistance = 0;
+		dreal secondDistance = 0;
+		bool firstNeeded = batchNeeds(first, batch, firstDistance);
+		bool secondNeeded = batchNeeds(second, batch, secondDistance);
+		if (secondDistance < firstDistance)
+		{
+			std::swap(first, second);
+			std::swap(firstNeeded, secondNeeded);
+		}
+
+		if (firstNeeded)
+		{
+			searchBatch(first, batch);
+			secondNeeded = batchNeeds(second, batch, secondDistance);
+		}
+
+		if (secondNeeded)
+		{
+			searchBatch(second, batch);
+		}
+	}
+
+}
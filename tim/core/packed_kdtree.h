@@ -0,0 +1,405 @@
+// Description: PackedKdTree class
+// Detail: A static kd-tree with cache-friendly leaf storage
+// Documentation: packed_kdtree.txt
+
+#ifndef TIM_PACKED_KDTREE_H
+#define TIM_PACKED_KDTREE_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/instrumentation.h"
+
+#include <vector>
+
+namespace Tim
+{
+
+	//! A static kd-tree with packed leaf storage
+	/*!
+	The kd-tree is built once over a fixed set of points.
+	The coordinates of the points are copied so that the
+	points of each leaf node are stored contiguously, in
+	structure-of-arrays form: first the first coordinates
+	of all the points in the leaf, then the second coordinates,
+	and so on. The leaves are stored in tree order. A scan
+	over a leaf is then a linear sweep over memory, done
+	by the kernels of leaf_scan.h.
+
+	The points can be hidden and shown individually. Each
+	node maintains the number of visible points in its
+	subtree, so that subtrees without visible points are
+	skipped, and subtrees inside a search ball are counted
+	as a whole. The distances are measured in the maximum
+	norm. The coordinates are stored as sreal; the distances
+	are those of the stored coordinates.
+	*/
+	class TIM PackedKdTree
+	{
+	public:
+		//! Constructs an empty kd-tree.
+		PackedKdTree();
+
+		//! Constructs a kd-tree over the given points.
+		/*!
+		Preconditions:
+		dimension >= 0
+		bucketSize > 0
+
+		pointSet:
+		Pointers to the coordinates of the points. Each
+		pointer identifies its point; the queries report
+		the neighbors by these pointers. The i:th point
+		is referred to by the index i in hide() and show().
+
+		dimension:
+		The number of coordinates to copy from each point.
+
+		bucketSize:
+		The maximum number of points in a leaf node, unless
+		the points of the leaf coincide.
+
+		Initially all points are visible.
+		*/
+		PackedKdTree(
+			const std::vector<const dreal*>& pointSet,
+			integer dimension,
+			integer bucketSize = 16);
+
+		PackedKdTree(const PackedKdTree& that) = default;
+		PackedKdTree(PackedKdTree&& that);
+		PackedKdTree& operator=(PackedKdTree that);
+
+		//! Swaps two kd-trees.
+		void swap(PackedKdTree& that);
+
+		//! Sets the instrumentation which counts the searches.
+		/*!
+		The instrumentation can be null, which counts nothing.
+		*/
+		void setInstrumentation(Instrumentation* instrumentation);
+
+		//! Returns the dimension of the points.
+		integer n() const;
+
+		//! Returns the number of visible points.
+		integer points() const;
+
+		//! Returns the number of points, visible or hidden.
+		integer size() const;
+
+		//! Hides the i:th point.
+		void hide(integer i);
+
+		//! Shows the i:th point.
+		void show(integer i);
+
+		//! Hides all points.
+		void hide();
+
+		//! Shows all points.
+		void show();
+
+		//! Hides the points [begin, end[.
+		/*!
+		Preconditions:
+		0 <= begin <= end <= size()
+
+		This is as hiding each point, except that the 
+		visible counts of the nodes are updated in a single
+		bottom-up pass, which updates each node only once.
+		*/
+		void hide(integer begin, integer end);
+
+		//! Shows the points [begin, end[.
+		/*!
+		Preconditions:
+		0 <= begin <= end <= size()
+
+		See hide(begin, end).
+		*/
+		void show(integer begin, integer end);
+
+		//! Counts the visible points inside an open maximum-norm ball.
+		/*!
+		Preconditions:
+		maxDistance >= 0
+
+		A node whose bounding box is contained in the ball is 
+		counted as a whole, and a node whose bounding box misses 
+		the ball is skipped; no candidate points are collected.
+		See range_count.txt.
+
+		Returns:
+		The number of visible points p for which
+		max_i |p_i - query_i| < maxDistance.
+		*/
+		integer countRange(
+			const dreal* query,
+			dreal maxDistance) const;
+
+		//! Finds the k nearest visible points in the maximum norm.
+		/*!
+		Preconditions:
+		kNearest > 0
+
+		query:
+		The coordinates of the query point.
+
+		exclude:
+		A point which is not accepted as a neighbor,
+		typically the query point itself. Can be null.
+
+		report:
+		A function which is called as report(distance, point)
+		for each found neighbor, in ascending order of distance.
+		Here point is the pointer by which the point was given
+		in construction.
+
+		maxRelativeError:
+		The allowed relative error in the distances. A subtree 
+		is skipped when it can not improve the distance to the 
+		k:th nearest neighbor by more than a factor of 
+		1 + maxRelativeError. The i:th reported neighbor is then
+		at most 1 + maxRelativeError times farther than the 
+		true i:th nearest neighbor. Zero gives an exact search.
+
+		Returns:
+		The distance to the k:th nearest neighbor, or infinity
+		if there are less than k accepted visible points.
+		*/
+		template <typename Report>
+		dreal searchNearest(
+			const dreal* query,
+			integer kNearest,
+			const dreal* exclude,
+			Report&& report,
+			dreal maxRelativeError = 0) const;
+
+		//! Finds the distance to the k:th nearest visible point.
+		/*!
+		This is a convenience function which calls
+		searchNearest() with a report which does nothing.
+		*/
+		dreal searchNearest(
+			const dreal* query,
+			integer kNearest,
+			const dreal* exclude = nullptr,
+			dreal maxRelativeError = 0) const;
+
+		//! Finds the k nearest visible points of a set of queries.
+		/*!
+		Preconditions:
+		kNearest > 0
+
+		querySet:
+		Pointers to the coordinates of the query points.
+
+		excludeQuery:
+		Whether a point whose identifying pointer equals
+		the query pointer is rejected as a neighbor. Set
+		this when the queries are points of the kd-tree.
+
+		distanceSet:
+		The output for the distances to the k:th nearest 
+		neighbors, with querySet.size() elements. If there are 
+		less than k accepted visible points, the distance is 
+		infinity.
+
+		neighborSet:
+		An optional output for the nearest neighbors, with 
+		querySet.size() * kNearest elements. The neighbors of 
+		the i:th query are stored in ascending order of distance
+		in [neighborSet[i * kNearest], neighborSet[(i + 1) * kNearest][,
+		by their indices in construction; the missing neighbors 
+		are stored as -1. Can be null.
+
+		maxRelativeError:
+		The allowed relative error in the distances; see 
+		searchNearest().
+
+		The queries are grouped by the leaf node they fall in, and
+		each group is searched in a single traversal of the tree.
+		This shares the node visits, and the leaf data, between 
+		nearby queries. The groups are searched in parallel.
+		*/
+		void searchAllNearest(
+			const std::vector<const dreal*>& querySet,
+			integer kNearest,
+			bool excludeQuery,
+			dreal* distanceSet,
+			integer* neighborSet = nullptr,
+			dreal maxRelativeError = 0) const;
+
+	private:
+		struct Node
+		{
+			// The points of the subtree are [begin, end[
+			// in tree order.
+			integer begin;
+			integer end;
+
+			// The child nodes, or -1 for a leaf node.
+			integer left;
+			integer right;
+
+			// The parent node, or -1 for the root node.
+			integer parent;
+
+			// The number of visible points in the subtree.
+			integer visible;
+		};
+
+		struct Neighbor
+		{
+			dreal distance;
+			integer position;
+		};
+
+		// The state of a group of queries, defined in
+		// packed_kdtree.cpp.
+		struct Batch;
+
+		// Builds the subtree over [begin, end[ of orderSet,
+		// appending its nodes in preorder to nodeSet, and their
+		// bounding boxes to boundSet. Returns the root node.
+		// Large subtrees are built in parallel.
+		integer build(
+			std::vector<integer>& orderSet,
+			const std::vector<const dreal*>& pointSet,
+			integer begin, integer end,
+			integer parent,
+			std::vector<Node>& nodeSet,
+			std::vector<dreal>& boundSet) const;
+
+		// Computes the bounding box of the points [begin, end[
+		// of orderSet into bound; the minimum is followed by
+		// the maximum.
+		void computeBound(
+			const std::vector<integer>& orderSet,
+			const std::vector<const dreal*>& pointSet,
+			integer begin, integer end,
+			dreal* bound) const;
+
+		// Returns the maximum-norm distance from the query
+		// to the bounding box of the node.
+		dreal boxDistance(integer node, const dreal* query) const;
+
+		// Returns the leaf node whose bounding box is
+		// found nearest to the query by descending the tree.
+		integer locateLeaf(const dreal* query) const;
+
+		// Offers a neighbor candidate to a query, whose
+		// neighbors are kept in ascending order of distance.
+		static void offer(
+			Neighbor* neighborSet,
+			integer& neighbors,
+			integer kNearest,
+			dreal distance,
+			integer position);
+
+		// Sets the visibility of the points [begin, end[.
+		void setVisible(integer begin, integer end, bool visible);
+
+		integer countRange(
+			integer node,
+			const dreal* query,
+			dreal maxDistance) const;
+
+		// Subtrees are visited only if their distance to the
+		// query is less than shrink times the k:th distance,
+		// where shrink = 1 / (1 + maxRelativeError).
+		void searchNearest(
+			integer node,
+			const dreal* query,
+			const dreal* exclude,
+			integer kNearest,
+			dreal shrink,
+			Neighbor* neighborSet,
+			integer& neighbors,
+			dreal* distanceSet) const;
+
+		// Returns whether some query of the batch may have
+		// a neighbor in the node. The smallest distance 
+		// from the queries to the node is stored in distance.
+		bool batchNeeds(
+			integer node, 
+			const Batch& batch,
+			dreal& distance) const;
+
+		void searchBatch(integer node, Batch& batch) const;
+
+		// The maximum number of queries in a batch.
+		static constexpr integer MaxBatchSize = 32;
+
+		// The number of points from which a subtree is
+		// built in parallel.
+		static constexpr integer ParallelBuildSize = 16384;
+
+		// The scratch space of a query, in elements, which
+		// is allocated from the stack.
+		static constexpr integer StackSize = 64;
+
+		/*
+		n_:
+		The dimension of the points.
+
+		bucketSize_:
+		The maximum number of points in a leaf, unless
+		the points coincide.
+
+		maxLeafSize_:
+		The maximum number of points in any leaf.
+
+		nodeSet_:
+		The nodes; the root node is at index 0.
+
+		boundSet_:
+		The bounding box of node i is stored in
+		[boundSet_[2 * i * n_], boundSet_[(2 * i + 1) * n_][
+		for the minimum, and in the following n_ elements
+		for the maximum.
+
+		coordinateSet_:
+		The coordinates of the points in tree order. The
+		j:th coordinate of the point at position begin + i of
+		a leaf [begin, end[ is stored at
+		coordinateSet_[begin * n_ + j * (end - begin) + i].
+		The bounding boxes are those of these coordinates.
+
+		pointSet_:
+		The identifying pointer of the point at each position.
+
+		indexSet_:
+		The index, in construction, of the point at each position.
+
+		positionSet_:
+		The position of the i:th point in tree order.
+
+		leafSet_:
+		The leaf node of the point at each position.
+
+		visibleSet_:
+		Whether the point at each position is visible.
+
+		instrumentation_:
+		The instrumentation which counts the searches, or null.
+		*/
+
+		integer n_;
+		integer bucketSize_;
+		integer maxLeafSize_;
+		std::vector<Node> nodeSet_;
+		std::vector<dreal> boundSet_;
+		std::vector<sreal> coordinateSet_;
+		std::vector<const dreal*> pointSet_;
+		std::vector<integer> indexSet_;
+		std::vector<integer> positionSet_;
+		std::vector<integer> leafSet_;
+		std::vector<char> visibleSet_;
+		Instrumentation* instrumentation_;
+	};
+
+}
+
+#include "tim/core/packed_kdtree.hpp"
+
+#endif
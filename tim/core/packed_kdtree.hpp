@@ -0,0 +1,65 @@
+#ifndef TIM_PACKED_KDTREE_HPP
+#define TIM_PACKED_KDTREE_HPP
+
+#include "tim/core/packed_kdtree.h"
+
+namespace Tim
+{
+
+	template <typename Report>
+	dreal PackedKdTree::searchNearest(
+		const dreal* query,
+		integer kNearest,
+		const dreal* exclude,
+		Report&& report,
+		dreal maxRelativeError) const
+	{
+		PENSURE_OP(kNearest, >, 0);
+		PENSURE_OP(maxRelativeError, >=, 0);
+
+		if (nodeSet_.empty() || nodeSet_[0].visible == 0)
+		{
+			return infinity<dreal>();
+		}
+
+		Neighbor stackNeighborSet[StackSize];
+		dreal stackDistanceSet[StackSize];
+		std::vector<Neighbor> heapNeighborSet;
+		std::vector<dreal> heapDistanceSet;
+
+		Neighbor* neighborSet = stackNeighborSet;
+		if (kNearest > StackSize)
+		{
+			heapNeighborSet.resize(kNearest);
+			neighborSet = heapNeighborSet.data();
+		}
+
+		dreal* distanceSet = stackDistanceSet;
+		if (maxLeafSize_ > StackSize)
+		{
+			heapDistanceSet.resize(maxLeafSize_);
+			distanceSet = heapDistanceSet.data();
+		}
+
+		integer neighbors = 0;
+		searchNearest(
+			0, query, exclude, kNearest, 
+			1 / (1 + maxRelativeError),
+			neighborSet, neighbors, distanceSet);
+
+		for (integer i = 0;i < neighbors;++i)
+		{
+			report(neighborSet[i].distance, pointSet_[neighborSet[i].position]);
+		}
+
+		if (neighbors < kNearest)
+		{
+			return infinity<dreal>();
+		}
+
+		return neighborSet[kNearest - 1].distance;
+	}
+
+}
+
+#endif
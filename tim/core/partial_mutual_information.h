@@ -28,10 +28,11 @@ namespace Tim
 			const Y_Signal_Range& ySignalSet,
 			const Z_Signal_Range& zSignalSet,
 			integer timeWindowRadius,
-			Signal* result,
+			SignalData* result,
 			integer xLag, integer yLag, integer zLag,
 			integer kNearest,
-			const Filter_Range& filter)
+			const Filter_Range& filter,
+			Instrumentation* instrumentation)
 		{
 			ENSURE_OP(timeWindowRadius, >=, 0);
 			ENSURE_OP(kNearest, >, 0);
@@ -76,7 +77,12 @@ namespace Tim
 					timeWindowRadius,
 					range(lagSet),
 					kNearest,
-					filter);
+					filter,
+					1,
+					TemporalHop(),
+					0,
+					nullptr,
+					instrumentation);
 				return 0;
 			}
 
@@ -84,7 +90,10 @@ namespace Tim
 				signalSet,
 				range(rangeSet),
 				range(lagSet),
-				kNearest);
+				kNearest,
+				0,
+				nullptr,
+				instrumentation);
 		}
 
 	}
@@ -115,6 +124,9 @@ namespace Tim
 	kNearest:
 	The number of nearest neighbors to use in the estimation.
 
+	instrumentation:
+	See entropyCombination().
+
 	If the number of samples varies between trials, 
 	then the minimum number of samples among the trials
 	is used.
@@ -132,7 +144,8 @@ namespace Tim
 		integer timeWindowRadius,
 		integer xLag, integer yLag, integer zLag,
 		integer kNearest,
-		const Filter_Range& filter)
+		const Filter_Range& filter,
+		Instrumentation* instrumentation = nullptr)
 	{
 		SignalData result;
 		Tim::Detail_PartialMutualInformation::partialMutualInformation(
@@ -141,7 +154,8 @@ namespace Tim
 			&result,
 			xLag, yLag,	zLag,
 			kNearest,
-			filter);
+			filter,
+			instrumentation);
 		return result;
 	}
 
@@ -199,6 +213,9 @@ namespace Tim
 	kNearest:
 	The number of nearest neighbors to use in the estimation.
 
+	instrumentation:
+	See entropyCombination().
+
 	If the number of samples varies between trials, 
 	then the minimum number of samples among the trials
 	is used.
@@ -213,14 +230,16 @@ namespace Tim
 		const Y_Signal_Range& ySignalSet,
 		const Z_Signal_Range& zSignalSet,
 		integer xLag = 0, integer yLag = 0, integer zLag = 0,
-		integer kNearest = 1)
+		integer kNearest = 1,
+		Instrumentation* instrumentation = nullptr)
 	{
 		return Tim::Detail_PartialMutualInformation::partialMutualInformation(
 			xSignalSet, ySignalSet, zSignalSet,
 			0, 0,
 			xLag, yLag, zLag,
 			kNearest,
-			constantRange((dreal)1, 1));
+			constantRange((dreal)1, 1),
+			instrumentation);
 	}
 
 }
@@ -30,10 +30,11 @@ namespace Tim
 			const Z_Signal_Range& zSignalSet,
 			const W_Signal_Range& wSignalSet,
 			integer timeWindowRadius,
-			Signal* result,
+			SignalData* result,
 			integer xLag, integer yLag,	integer zLag, integer wLag,
 			integer kNearest,
-			const Filter_Range& filter)
+			const Filter_Range& filter,
+			Instrumentation* instrumentation)
 		{
 			ENSURE_OP(timeWindowRadius, >=, 0);
 			ENSURE_OP(kNearest, >, 0);
@@ -83,7 +84,12 @@ namespace Tim
 					timeWindowRadius,
 					range(lagSet),
 					kNearest,
-					filter);
+					filter,
+					1,
+					TemporalHop(),
+					0,
+					nullptr,
+					instrumentation);
 				return 0;
 			}
 
@@ -91,7 +97,10 @@ namespace Tim
 				signalSet,
 				range(rangeSet),
 				range(lagSet),
-				kNearest);
+				kNearest,
+				0,
+				nullptr,
+				instrumentation);
 		}
 
 	}
@@ -123,6 +132,9 @@ namespace Tim
 	kNearest:
 	The number of nearest neighbors to use in the estimation.
 
+	instrumentation:
+	See entropyCombination().
+
 	If the number of samples varies between trials, 
 	then the minimum number of samples among the trials
 	is used.
@@ -142,7 +154,8 @@ namespace Tim
 		integer timeWindowRadius,
 		integer xLag, integer yLag, integer zLag, integer wLag,
 		integer kNearest,
-		const Filter_Range& filter)
+		const Filter_Range& filter,
+		Instrumentation* instrumentation = nullptr)
 	{
 		SignalData result;
 		Tim::Detail_PartialTransferEntropy::partialTransferEntropy(
@@ -151,7 +164,8 @@ namespace Tim
 			&result,
 			xLag, yLag, zLag, wLag,
 			kNearest,
-			filter);
+			filter,
+			instrumentation);
 		return result;
 	}
 
@@ -211,6 +225,9 @@ namespace Tim
 	kNearest:
 	The number of nearest neighbors to use in the estimation.
 
+	instrumentation:
+	See entropyCombination().
+
 	If the number of samples varies between trials, 
 	then the minimum number of samples among the trials
 	is used.
@@ -228,14 +245,16 @@ namespace Tim
 		const W_Signal_Range& wSignalSet,
 		integer xLag = 0, integer yLag = 0,
 		integer zLag = 0, integer wLag = 0,
-		integer kNearest = 1)
+		integer kNearest = 1,
+		Instrumentation* instrumentation = nullptr)
 	{
 		return Tim::Detail_PartialTransferEntropy::partialTransferEntropy(
 			xSignalSet, ySignalSet, zSignalSet, wSignalSet,
 			0, 0,
 			xLag, yLag, zLag, wLag,
 			kNearest,
-			constantRange((dreal)1, 1));
+			constantRange((dreal)1, 1),
+			instrumentation);
 	}
 
 }
@@ -0,0 +1,338 @@
+// Description: Permutation tests for entropy combinations
+// Detail: Estimates the null distribution by permuting the trials of signals
+// Documentation: permutation_test.txt
+
+#ifndef TIM_PERMUTATION_TEST_H
+#define TIM_PERMUTATION_TEST_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/signal.h"
+#include "tim/core/lagged_signal.h"
+#include "tim/core/signalpointset.h"
+#include "tim/core/entropy_combination.h"
+
+#include <pastel/sys/array/array.h>
+#include <pastel/sys/range.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+namespace Tim
+{
+
+	//! The result of a permutation test.
+	struct PermutationTest
+	{
+		//! The estimate from the unpermuted signals.
+		dreal estimate = 0;
+
+		//! The estimates from the permuted signals.
+		std::vector<dreal> nullSet;
+
+		//! The maximum of the null distribution.
+		dreal maxNull = -infinity<dreal>();
+
+		//! The fraction of estimates at least as large as the estimate.
+		/*!
+		The unpermuted estimate is counted in, so that this is
+		(1 + |{i : nullSet[i] >= estimate}|) / (1 + nullSet.size()).
+		*/
+		dreal pValue = 1;
+	};
+
+	//! Permutation test for an entropy combination.
+	/*!
+	Preconditions:
+	kNearest > 0
+	permutations >= 0
+	ranges::size(lagSet) == signalSet.height()
+	ranges::size(groupSet) == signalSet.height()
+
+	signalSet, rangeSet, lagSet, kNearest, instrumentation:
+	See entropyCombination().
+
+	groupSet:
+	A group label for each signal. The signals with the same
+	label are kept together: their trials are permuted with
+	the same permutation. The signals in the group of the
+	first signal are not permuted.
+
+	permutations:
+	The number of permutations to estimate.
+
+	seed:
+	The seed of the random permutations. The i:th permutation
+	is generated from its own random stream, seeded by
+	(seed, i), so that the null distribution does not depend
+	on the scheduling of the threads.
+
+	Returns:
+	The estimate from the unpermuted signals, and the
+	estimates from the permuted signals.
+
+	Permuting the trials does not change the points of a
+	marginal whose signals are all in the same group; only
+	the correspondence of its points to the joint points
+	changes. The point sets of such marginals are built once,
+	and shared by all the permutations. Only the joint point
+	set, and the marginals spanning several groups, are
+	rebuilt for each permutation. The permutations are
+	estimated in parallel.
+	*/
+	template <
+		ranges::forward_range Integer3_Range,
+		ranges::forward_range Lag_Range,
+		ranges::forward_range Group_Range>
+	PermutationTest permutationTest(
+		const Array<Signal>& signalSet,
+		const Integer3_Range& rangeSet,
+		const Lag_Range& lagSet,
+		const Group_Range& groupSet,
+		integer permutations,
+		integer kNearest = 1,
+		integer seed = 0,
+		Instrumentation* instrumentation = nullptr)
+	{
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE_OP(permutations, >=, 0);
+		ENSURE_OP(ranges::size(lagSet), ==, signalSet.height());
+		ENSURE_OP(ranges::size(groupSet), ==, signalSet.height());
+
+		PermutationTest result;
+		result.nullSet.resize(permutations, 0);
+
+		if (ranges::empty(signalSet) || ranges::empty(rangeSet))
+		{
+			return result;
+		}
+
+		integer trials = signalSet.width();
+		integer signals = signalSet.height();
+		integer marginals = ranges::size(rangeSet);
+
+		// Number the groups in the order of their
+		// first appearance.
+
+		std::vector<integer> groupOfSet;
+		groupOfSet.reserve(signals);
+		std::vector<integer> labelSet;
+		for (integer label : groupSet)
+		{
+			auto iter = std::find(labelSet.begin(), labelSet.end(), label);
+			groupOfSet.push_back(iter - labelSet.begin());
+			if (iter == labelSet.end())
+			{
+				labelSet.push_back(label);
+			}
+		}
+
+		integer groups = labelSet.size();
+
+		// Find out the dimension ranges of the marginal
+		// signals.
+
+		std::vector<integer> offsetSet;
+		offsetSet.reserve(signals + 1);
+		offsetSet.push_back(0);
+		for (integer i = 1;i < signals + 1;++i)
+		{
+			offsetSet.push_back(offsetSet[i - 1] + signalSet(0, i - 1).dimension());
+		}
+
+		std::vector<Integer3> marginalSet(
+			std::begin(rangeSet), std::end(rangeSet));
+
+		std::vector<integer> weightSet;
+		weightSet.reserve(marginals);
+
+		std::vector<integer> marginalOffsetSet;
+		marginalOffsetSet.reserve(marginals);
+		for (const Integer3& marginal : marginalSet)
+		{
+			weightSet.push_back(marginal[2]);
+			marginalOffsetSet.push_back(offsetSet[marginal[0]]);
+		}
+
+		// A marginal is reused if all of its signals
+		// are in the same group.
+
+		auto isShared = [&](const Integer3& marginal)
+		{
+			for (integer i = marginal[0];i < marginal[1];++i)
+			{
+				if (groupOfSet[i] != groupOfSet[marginal[0]])
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+
+		using Layout = SignalPointSet::Layout;
+
+		// Estimates the entropy combination for the joint
+		// point set, reusing the given shared marginals.
+		auto estimate = [&](
+			const SignalPointSet& jointPointSet,
+			const std::vector<SignalPointSet>& sharedSet)
+		{
+			integer n = jointPointSet.end() - jointPointSet.begin();
+
+			std::vector<SignalPointSet> ownSet;
+			ownSet.reserve(marginals);
+
+			std::vector<const SignalPointSet*> pointSet;
+			pointSet.reserve(marginals);
+			for (integer i = 0;i < marginals;++i)
+			{
+				const Integer3& marginal = marginalSet[i];
+				if (isShared(marginal))
+				{
+					pointSet.push_back(&sharedSet[i]);
+					continue;
+				}
+
+				ownSet.emplace_back(
+					jointPointSet,
+					offsetSet[marginal[0]], offsetSet[marginal[1]],
+					Layout::Packed, Metric::Maximum,
+					instrumentation);
+				pointSet.push_back(&ownSet.back());
+			}
+
+			std::vector<dreal> distanceSet(n);
+			{
+				TIM_PHASE(instrumentation, JointSearch);
+				jointPointSet.searchAllNearest(kNearest, distanceSet.data());
+			}
+
+			return Detail_EntropyCombination::combine(
+				jointPointSet, pointSet, marginalOffsetSet,
+				weightSet, distanceSet, kNearest);
+		};
+
+		// Construct the unpermuted joint signal.
+
+		std::vector<LaggedSignal> jointSignalSet;
+		jointSignalSet.reserve(trials);
+		lagSignals(signalSet,
+			std::back_inserter(jointSignalSet), lagSet);
+
+		SignalPointSet jointPointSet(
+			jointSignalSet, Layout::Packed,
+			Metric::Maximum, instrumentation);
+
+		// The joint point set contains only the time interval 
+		// on which all the trials are defined.
+		if (jointPointSet.begin() == jointPointSet.end())
+		{
+			return result;
+		}
+
+		// Build the shared marginals from the unpermuted
+		// joint point set. The time interval shared by all the
+		// trials does not depend on the permutation, and
+		// so neither do the time-windows of the marginals.
+		// The shared marginals are therefore only read
+		// from, and can be used by all the permutations
+		// concurrently.
+
+		std::vector<SignalPointSet> sharedSet;
+		sharedSet.reserve(marginals);
+		for (integer i = 0;i < marginals;++i)
+		{
+			const Integer3& marginal = marginalSet[i];
+			if (!isShared(marginal))
+			{
+				sharedSet.emplace_back();
+				continue;
+			}
+
+			sharedSet.emplace_back(
+				jointPointSet,
+				offsetSet[marginal[0]], offsetSet[marginal[1]],
+				Layout::Packed, Metric::Maximum,
+				instrumentation);
+		}
+
+		result.estimate = estimate(jointPointSet, sharedSet);
+
+		using Block = tbb::blocked_range<integer>;
+
+		tbb::parallel_for(Block(0, permutations),
+			[&](const Block& block)
+			{
+				std::vector<std::vector<integer>> trialSet(
+					groups, std::vector<integer>(trials));
+				Array<Signal> permutedSet(Vector2i(trials, signals));
+
+				for (integer p = block.begin();p < block.end();++p)
+				{
+					// Generate the permutations of the trials.
+
+					// The seed sequence takes 32-bit values; 
+					// both halves of the seed and of the index
+					// are used, so that no bits are lost.
+					const std::uint64_t seedBits = (std::uint64_t)seed;
+					const std::uint64_t pBits = (std::uint64_t)p;
+					std::seed_seq seedSet{
+						(std::uint32_t)seedBits, (std::uint32_t)(seedBits >> 32),
+						(std::uint32_t)pBits, (std::uint32_t)(pBits >> 32)};
+					std::mt19937_64 random(seedSet);
+
+					for (integer g = 0;g < groups;++g)
+					{
+						std::iota(trialSet[g].begin(), trialSet[g].end(), (integer)0);
+						if (g > 0)
+						{
+							std::shuffle(trialSet[g].begin(), trialSet[g].end(), random);
+						}
+					}
+
+					for (integer y = 0;y < signals;++y)
+					{
+						const std::vector<integer>& trialOfSet = trialSet[groupOfSet[y]];
+						for (integer x = 0;x < trials;++x)
+						{
+							permutedSet(x, y) = signalSet(trialOfSet[x], y);
+						}
+					}
+
+					std::vector<LaggedSignal> permutedJointSet;
+					permutedJointSet.reserve(trials);
+					lagSignals(permutedSet,
+						std::back_inserter(permutedJointSet), lagSet);
+
+					SignalPointSet permutedPointSet(
+						permutedJointSet, Layout::Packed,
+						Metric::Maximum, instrumentation);
+
+					result.nullSet[p] = estimate(permutedPointSet, sharedSet);
+				}
+			});
+
+		integer exceeding = 0;
+		for (dreal nullEstimate : result.nullSet)
+		{
+			result.maxNull = std::max(result.maxNull, nullEstimate);
+			if (nullEstimate >= result.estimate)
+			{
+				++exceeding;
+			}
+		}
+
+		result.pValue = (dreal)(1 + exceeding) / (1 + permutations);
+
+		return result;
+	}
+
+}
+
+#endif
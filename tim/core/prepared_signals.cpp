@@ -0,0 +1,257 @@
+#include "tim/core/prepared_signals.h"
+
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace Tim
+{
+
+	PreparedSignals::PreparedSignals()
+		: dataSet_()
+		, signalSet_()
+		, offsetSet_(1, 0)
+		, cacheSize_(1)
+		, jointSet_()
+		, instrumentation_(nullptr)
+	{
+	}
+
+	PreparedSignals::PreparedSignals(
+		const Array<Signal>& signalSet,
+		integer cacheSize)
+		: dataSet_()
+		, signalSet_(Vector2i(signalSet.width(), signalSet.height()))
+		, offsetSet_(1, 0)
+		, cacheSize_(cacheSize)
+		, jointSet_()
+		, instrumentation_(nullptr)
+	{
+		ENSURE_OP(cacheSize, >, 0);
+
+		integer trials = signalSet.width();
+		integer signals = signalSet.height();
+
+		for (integer y = 0;y < signals;++y)
+		{
+			for (integer x = 1;x < trials;++x)
+			{
+				ENSURE_OP(signalSet(x, y).dimension(), ==,
+					signalSet(0, y).dimension());
+			}
+			offsetSet_.push_back(offsetSet_.back() +
+				(trials > 0 ? signalSet(0, y).dimension() : 0));
+		}
+
+		// The views are created only after all the data
+		// has been copied, since the copies must not be
+		// moved afterwards.
+
+		dataSet_.reserve(trials * signals);
+		for (integer y = 0;y < signals;++y)
+		{
+			for (integer x = 0;x < trials;++x)
+			{
+				const Signal& signal = signalSet(x, y);
+				dataSet_.emplace_back(
+					signal.dimension(), signal.samples(), signal.t());
+
+				// The samples are copied one by one, so that
+				// the signal can be any view of its data.
+				MatrixView<dreal> copy = dataSet_.back().data();
+				for (integer i = 0;i < signal.samples();++i)
+				{
+					ranges::copy(
+						signal.data().columnRange(i),
+						std::begin(copy.columnRange(i)));
+				}
+			}
+		}
+
+		for (integer y = 0;y < signals;++y)
+		{
+			for (integer x = 0;x < trials;++x)
+			{
+				const SignalData& data = dataSet_[y * trials + x];
+				signalSet_(x, y) = Signal(data.data(), data.t());
+			}
+		}
+	}
+
+	integer PreparedSignals::signals() const
+	{
+		return signalSet_.height();
+	}
+
+	integer PreparedSignals::trials() const
+	{
+		return signalSet_.width();
+	}
+
+	const Array<Signal>& PreparedSignals::signalSet() const
+	{
+		return signalSet_;
+	}
+
+	integer PreparedSignals::offset(integer signal) const
+	{
+		PENSURE_OP(signal, >=, 0);
+		PENSURE_OP(signal, <=, signals());
+
+		return offsetSet_[signal];
+	}
+
+	integer PreparedSignals::points(
+		const std::vector<integer>& lagSet)
+	{
+		Joint& lagged = joint(lagSet);
+		if (lagged.signalSet.front().samples() == 0)
+		{
+			return 0;
+		}
+
+		return lagged.pointSet.end() - lagged.pointSet.begin();
+	}
+
+	const SignalPointSet& PreparedSignals::jointPointSet(
+		const std::vector<integer>& lagSet)
+	{
+		return joint(lagSet).pointSet;
+	}
+
+	std::vector<const SignalPointSet*> PreparedSignals::marginalPointSets(
+		const std::vector<integer>& lagSet,
+		const std::vector<Integer2>& rangeSet)
+	{
+		using Key = std::pair<integer, integer>;
+
+		Joint& lagged = joint(lagSet);
+
+		// The interval of all signals is the joint signal.
+		auto full = [&](const Key& key)
+		{
+			return key.first == 0 && key.second == signals();
+		};
+
+		// Find the missing marginals, each only once.
+
+		std::vector<Key> missingSet;
+		for (const Integer2& range : rangeSet)
+		{
+			ENSURE_OP(range[0], >=, 0);
+			ENSURE_OP(range[0], <, range[1]);
+			ENSURE_OP(range[1], <=, signals());
+
+			Key key(range[0], range[1]);
+			if (!full(key) &&
+				!lagged.marginalSet.count(key) &&
+				std::find(missingSet.begin(), missingSet.end(), key) == missingSet.end())
+			{
+				missingSet.push_back(key);
+			}
+		}
+
+		// Build the missing marginals in parallel. They
+		// only read the joint point set.
+
+		integer missings = missingSet.size();
+		std::vector<SignalPointSet> builtSet(missings);
+
+		tbb::parallel_for((integer)0, missings,
+			[&](integer i)
+			{
+				builtSet[i] = SignalPointSet(
+					lagged.pointSet,
+					offsetSet_[missingSet[i].first],
+					offsetSet_[missingSet[i].second],
+					SignalPointSet::Layout::Packed,
+					Metric::Maximum,
+					instrumentation_);
+			});
+
+		for (integer i = 0;i < missings;++i)
+		{
+			lagged.marginalSet.emplace(
+				missingSet[i], std::move(builtSet[i]));
+		}
+
+		std::vector<const SignalPointSet*> result;
+		result.reserve(rangeSet.size());
+		for (const Integer2& range : rangeSet)
+		{
+			Key key(range[0], range[1]);
+			result.push_back(full(key) ? 
+				&lagged.pointSet : 
+				&lagged.marginalSet.at(key));
+		}
+
+		return result;
+	}
+
+	void PreparedSignals::clear()
+	{
+		jointSet_.clear();
+	}
+
+	void PreparedSignals::setInstrumentation(
+		Instrumentation* instrumentation)
+	{
+		instrumentation_ = instrumentation;
+	}
+
+	// Private
+
+	PreparedSignals::Joint& PreparedSignals::joint(
+		const std::vector<integer>& lagSet)
+	{
+		ENSURE_OP(lagSet.size(), ==, signals());
+		ENSURE_OP(trials(), >, 0);
+
+		auto iter = std::find_if(jointSet_.begin(), jointSet_.end(),
+			[&](const std::unique_ptr<Joint>& that)
+			{
+				return that->lagSet == lagSet;
+			});
+
+		if (iter != jointSet_.end())
+		{
+			jointSet_.splice(jointSet_.begin(), jointSet_, iter);
+
+			Joint& lagged = *jointSet_.front();
+			lagged.pointSet.setInstrumentation(instrumentation_);
+			for (auto& entry : lagged.marginalSet)
+			{
+				entry.second.setInstrumentation(instrumentation_);
+			}
+
+			return lagged;
+		}
+
+		// Drop the least recently used point sets
+		// before building the new ones.
+
+		while ((integer)jointSet_.size() >= cacheSize_)
+		{
+			jointSet_.pop_back();
+		}
+
+		std::unique_ptr<Joint> lagged(new Joint);
+		lagged->lagSet = lagSet;
+		lagged->signalSet.reserve(trials());
+		lagSignals(signalSet_,
+			std::back_inserter(lagged->signalSet), lagSet);
+
+		// Without shared samples the point set is left empty.
+		if (lagged->signalSet.front().samples() > 0)
+		{
+			lagged->pointSet = SignalPointSet(
+				lagged->signalSet, SignalPointSet::Layout::Packed,
+				Metric::Maximum, instrumentation_);
+		}
+
+		jointSet_.push_front(std::move(lagged));
+		return *jointSet_.front();
+	}
+
+}
@@ -0,0 +1,206 @@
+// Description: PreparedSignals class
+// Detail: An ensemble of signals whose point sets are reused between estimates
+// Documentation: prepared_signals.txt
+
+#ifndef TIM_PREPARED_SIGNALS_H
+#define TIM_PREPARED_SIGNALS_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/signal.h"
+#include "tim/core/lagged_signal.h"
+#include "tim/core/signalpointset.h"
+
+#include <pastel/sys/array/array.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Tim
+{
+
+	//! An ensemble of signals whose point sets are reused between estimates
+	/*!
+	The signals are copied in construction, so that the
+	caller's data need not outlive this object. For each
+	combination of lags, the joint point set of the lagged
+	signals, and the marginal point sets over intervals of
+	the signals, are built when first needed, and then kept
+	for the later estimates. The point sets use the packed
+	layout and the maximum metric, as in entropyCombination().
+
+	The point sets of at most 'cacheSize' combinations of
+	lags are kept; the least recently used combination is
+	dropped first. The point sets are never moved in their
+	time-windows; estimators which need to move them make
+	their own copies.
+
+	The member functions must not be called concurrently.
+	*/
+	class TIM PreparedSignals
+	{
+	public:
+		//! Constructs an empty ensemble.
+		PreparedSignals();
+
+		//! Constructs from a copy of an ensemble of signals.
+		/*!
+		Preconditions:
+		cacheSize > 0
+
+		signalSet:
+		An ensemble of joint signals representing trials
+		of the same experiment, as in entropyCombination().
+		The trials of a signal must have the same dimension.
+
+		cacheSize:
+		The maximum number of combinations of lags whose
+		point sets are kept.
+		*/
+		explicit PreparedSignals(
+			const Array<Signal>& signalSet,
+			integer cacheSize = 4);
+
+		PreparedSignals(const PreparedSignals& that) = delete;
+		PreparedSignals& operator=(const PreparedSignals& that) = delete;
+
+		//! Returns the number of signals.
+		integer signals() const;
+
+		//! Returns the number of trials.
+		integer trials() const;
+
+		//! Returns the copied ensemble of signals.
+		const Array<Signal>& signalSet() const;
+
+		//! Returns the offset of a signal in the joint dimensions.
+		/*!
+		Preconditions:
+		0 <= signal <= signals()
+
+		For signal == signals(), returns the dimension
+		of the joint signal.
+		*/
+		integer offset(integer signal) const;
+
+		//! Returns the number of points of the lagged signals.
+		/*!
+		Preconditions:
+		lagSet.size() == signals()
+
+		This is the number of points in jointPointSet(lagSet);
+		the number of samples on the time interval shared by 
+		all the lagged signals, times the number of trials.
+		*/
+		integer points(const std::vector<integer>& lagSet);
+
+		//! Returns the joint point set of the lagged signals.
+		/*!
+		Preconditions:
+		lagSet.size() == signals()
+
+		The point set is built, if it is not in the cache.
+		It is empty if points(lagSet) == 0.
+		The reference stays valid until the combination of
+		lags is dropped from the cache; that is, until a
+		point set is asked for more than cacheSize - 1 other
+		combinations of lags, or clear() is called.
+		*/
+		const SignalPointSet& jointPointSet(
+			const std::vector<integer>& lagSet);
+
+		//! Returns marginal point sets of the lagged signals.
+		/*!
+		Preconditions:
+		lagSet.size() == signals()
+		0 <= range[0] < range[1] <= signals(), for each range.
+
+		rangeSet:
+		Intervals [range[0], range[1][ of signals.
+
+		Returns:
+		The i:th element is the point set of the signals
+		in the i:th interval, as a marginal of the joint
+		point set of the lagged signals. The interval of
+		all the signals gives the joint point set.
+
+		The missing point sets are built in parallel. The
+		joint point set may be searched concurrently with
+		this function. See jointPointSet() for how long
+		the pointers stay valid.
+		*/
+		std::vector<const SignalPointSet*> marginalPointSets(
+			const std::vector<integer>& lagSet,
+			const std::vector<Integer2>& rangeSet);
+
+		//! Drops all the point sets.
+		void clear();
+
+		//! Sets the instrumentation of the point sets.
+		/*!
+		The point sets built afterwards, and the cached
+		point sets when they are next asked for, count
+		their searches into the instrumentation. It can
+		be null, which measures nothing.
+		*/
+		void setInstrumentation(Instrumentation* instrumentation);
+
+	private:
+		struct Joint
+		{
+			// The lags of the signals.
+			std::vector<integer> lagSet;
+
+			// The lagged signals of each trial.
+			std::vector<LaggedSignal> signalSet;
+
+			// The point set of the joint signal.
+			SignalPointSet pointSet;
+
+			// The marginal point sets, by the interval
+			// of signals.
+			std::map<std::pair<integer, integer>, SignalPointSet> marginalSet;
+		};
+
+		// Returns the joint of the given lags, building
+		// it if necessary, and marks it the most recently
+		// used one. Its point sets are given the current
+		// instrumentation.
+		Joint& joint(const std::vector<integer>& lagSet);
+
+		/*
+		dataSet_:
+		The copied data of the signals, in the order
+		of 'signalSet_'.
+
+		signalSet_:
+		The signals, as views of 'dataSet_'.
+
+		offsetSet_:
+		The offset of the i:th signal in the joint
+		dimensions, followed by the joint dimension.
+
+		cacheSize_:
+		The maximum number of elements in 'jointSet_'.
+
+		jointSet_:
+		The point sets of each combination of lags,
+		the most recently used first.
+
+		instrumentation_:
+		The instrumentation of the point sets, or null.
+		*/
+
+		std::vector<SignalData> dataSet_;
+		Array<Signal> signalSet_;
+		std::vector<integer> offsetSet_;
+		integer cacheSize_;
+		std::list<std::unique_ptr<Joint>> jointSet_;
+		Instrumentation* instrumentation_;
+	};
+
+}
+
+#endif
@@ -0,0 +1,145 @@
+#include "tim/core/range_count.h"
+#include "tim/core/instrumentation.h"
+
+#include <cmath>
+#include <vector>
+
+namespace Tim
+{
+
+	namespace
+	{
+
+		template <typename Node_ConstIterator>
+		integer countRange(
+			Node_ConstIterator node,
+			const dreal* query,
+			dreal maxDistance,
+			integer n,
+			dreal* minBound,
+			dreal* maxBound,
+			Instrumentation* instrumentation)
+		{
+			if (node->points() == 0)
+			{
+				return 0;
+			}
+
+			TIM_COUNT(instrumentation, nodesVisited, 1);
+
+			// Classify the cell of the node against the ball.
+
+			bool inside = true;
+			for (integer i = 0;i < n;++i)
+			{
+				// The differences are compared, rather than the
+				// bounds against query +- maxDistance, so that the
+				// rounding agrees with the distance of a point.
+				dreal toMin = minBound[i] - query[i];
+				dreal toMax = query[i] - maxBound[i];
+
+				if (toMin >= maxDistance || toMax >= maxDistance)
+				{
+					// The cell does not intersect the open ball.
+					return 0;
+				}
+
+				if (-toMin >= maxDistance || -toMax >= maxDistance)
+				{
+					inside = false;
+				}
+			}
+
+			if (inside)
+			{
+				// All the points in the cell are inside 
+				// the open ball.
+				return node->points();
+			}
+
+			if (node->leaf())
+			{
+				TIM_COUNT(instrumentation, distances, node->points());
+
+				integer count = 0;
+				for (auto iter = node->first();iter != node->end();++iter)
+				{
+					const dreal* point = iter->point();
+
+					integer i = 0;
+					while (i < n && std::abs(point[i] - query[i]) < maxDistance)
+					{
+						++i;
+					}
+
+					if (i == n)
+					{
+						++count;
+					}
+				}
+
+				return count;
+			}
+
+			integer axis = node->splitAxis();
+			dreal split = node->splitPosition();
+			integer count = 0;
+
+			dreal oldMax = maxBound[axis];
+			maxBound[axis] = split;
+			count += countRange(node->left(), query, maxDistance, n, minBound, maxBound, instrumentation);
+			maxBound[axis] = oldMax;
+
+			dreal oldMin = minBound[axis];
+			minBound[axis] = split;
+			count += countRange(node->right(), query, maxDistance, n, minBound, maxBound, instrumentation);
+			minBound[axis] = oldMin;
+
+			return count;
+		}
+
+	}
+
+	TIM integer countRange(
+		const SignalPointSet::KdTree& kdTree,
+		const dreal* query,
+		dreal maxDistance,
+		Instrumentation* instrumentation)
+	{
+		PENSURE_OP(maxDistance, >=, 0);
+
+		if (kdTree.points() == 0)
+		{
+			return 0;
+		}
+
+		integer n = kdTree.n();
+
+		// The cell of a node is tracked during the
+		// traversal, starting from the bounding box
+		// of the kd-tree.
+
+		static constexpr integer StackDimension = 32;
+		dreal stackBound[2 * StackDimension];
+		std::vector<dreal> heapBound;
+
+		dreal* minBound = stackBound;
+		if (n > StackDimension)
+		{
+			heapBound.resize(2 * n);
+			minBound = heapBound.data();
+		}
+		dreal* maxBound = minBound + n;
+
+		for (integer i = 0;i < n;++i)
+		{
+			minBound[i] = kdTree.bound().min()[i];
+			maxBound[i] = kdTree.bound().max()[i];
+		}
+
+		return countRange(
+			kdTree.root(), query, maxDistance, 
+			n, minBound, maxBound, instrumentation);
+	}
+
+}
@@ -0,0 +1,51 @@
+// Description: Range counting in a SignalPointSet
+// Detail: Counts the points in an open maximum-norm ball
+// Documentation: range_count.txt
+
+#ifndef TIM_RANGE_COUNT_H
+#define TIM_RANGE_COUNT_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/signalpointset.h"
+
+namespace Tim
+{
+
+	//! Counts the points inside an open maximum-norm ball.
+	/*!
+	Preconditions:
+	maxDistance >= 0
+
+	kdTree:
+	The kd-tree of a SignalPointSet.
+
+	query:
+	The coordinates of the center of the ball, with
+	kdTree.n() elements.
+
+	maxDistance:
+	The radius of the ball. Infinity is allowed.
+
+	instrumentation:
+	Counts the nodes visited and the distances computed,
+	or null.
+
+	Returns:
+	The number of points p in the kd-tree for which
+	max_i |p_i - query_i| < maxDistance. If the query is
+	itself a point of the kd-tree, it is counted.
+
+	In contrast to countNearest(), no candidates are collected
+	or ordered. A subtree whose cell is contained in the ball is
+	counted as a whole, and a subtree whose cell does not 
+	intersect the ball is skipped.
+	*/
+	TIM integer countRange(
+		const SignalPointSet::KdTree& kdTree,
+		const dreal* query,
+		dreal maxDistance,
+		Instrumentation* instrumentation = nullptr);
+
+}
+
+#endif
@@ -4,6 +4,7 @@
 #define TIM_RECONSTRUCTION_H
 
 #include "tim/core/mytypes.h"
+#include "tim/core/instrumentation.h"
 #include "pastel/sys/range.h"
 
 #include <algorithm>
@@ -12,8 +13,12 @@ namespace Tim
 {
 
 	template <typename Real_Range>
-	void reconstruct(Real_Range&& data)
+	void reconstruct(
+		Real_Range&& data,
+		Instrumentation* instrumentation = nullptr)
 	{
+		TIM_PHASE(instrumentation, Reconstruct);
+
 		dreal startValue = (dreal)Nan();
 
 		bool fill = false;
@@ -7,6 +7,7 @@
 #include "tim/core/signal.h"
 #include "tim/core/generic_entropy.h"
 #include "tim/core/generic_entropy_t.h"
+#include "tim/core/generic_entropies.h"
 #include "tim/core/differential_entropy_kl.h"
 
 #include <pastel/sys/range.h>
@@ -195,6 +196,10 @@ namespace Tim
 	For accurate results one should choose 
 	kNearestSuggestion >= 2 * ceil(q) - 1.
 
+	filter, maxRelativeError, relativeError, hop,
+	instrumentation:
+	See temporalGenericEntropy().
+
 	Returns:
 	The number of time instants that had an
 	undefined estimate. If not all estimates
@@ -209,12 +214,22 @@ namespace Tim
 		integer timeWindowRadius,
 		dreal q,
 		integer kNearestSuggestion,
-		const Filter_Range& filter)
+		const Filter_Range& filter,
+		dreal maxRelativeError = 0,
+		dreal* relativeError = nullptr,
+		const TemporalHop& hop = TemporalHop(),
+		Instrumentation* instrumentation = nullptr)
 	{
 		ENSURE_OP(timeWindowRadius, >=, 0);
 		ENSURE_OP(q, >, 0);
 		ENSURE_OP(kNearestSuggestion, >=, 0);
 		ENSURE(odd(ranges::size(filter)));
+		ENSURE_OP(maxRelativeError, >=, 0);
+
+		if (relativeError)
+		{
+			*relativeError = 0;
+		}
 
 		if (q == 1)
 		{
@@ -233,7 +248,12 @@ namespace Tim
 			return temporalDifferentialEntropyKl(
 				signalSet,
 				timeWindowRadius,
-				kNearest);
+				kNearest,
+				Default_Norm(),
+				filter,
+				maxRelativeError, relativeError,
+				SignalPointSet::Layout::Automatic,
+				hop, instrumentation);
 		}
 
 		if (ranges::empty(signalSet))
@@ -252,7 +272,10 @@ namespace Tim
 			entropyAlgorithm,
 			timeWindowRadius,
 			kNearest,
-			filter);
+			filter,
+			maxRelativeError, relativeError,
+			SignalPointSet::Layout::Automatic,
+			hop, instrumentation);
 	}
 
 	//! Computes temporal Renyi entropy of a signal.
@@ -308,6 +331,9 @@ namespace Tim
 	For accurate results one should choose 
 	kNearestSuggestion >= 2 * ceil(q) - 1.
 
+	maxRelativeError, relativeError, instrumentation:
+	See genericEntropy().
+
 	Returns:
 	A Renyi entropy estimate if successful,
 	NaN otherwise. The estimation may fail only
@@ -318,10 +344,19 @@ namespace Tim
 	dreal renyiEntropyLps(
 		const Signal_Range& signalSet,
 		dreal q = 2,
-		integer kNearestSuggestion = 0)
+		integer kNearestSuggestion = 0,
+		dreal maxRelativeError = 0,
+		dreal* relativeError = nullptr,
+		Instrumentation* instrumentation = nullptr)
 	{
 		ENSURE_OP(q, >, 0);
 		ENSURE_OP(kNearestSuggestion, >=, 0);
+		ENSURE_OP(maxRelativeError, >=, 0);
+
+		if (relativeError)
+		{
+			*relativeError = 0;
+		}
 
 		if (q == 1)
 		{
@@ -339,7 +374,12 @@ namespace Tim
 
 			return differentialEntropyKl(
 				signalSet,
-				kNearest);
+				kNearest,
+				Default_Norm(),
+				maxRelativeError,
+				relativeError,
+				SignalPointSet::Layout::Automatic,
+				instrumentation);
 		}
 
 		integer kNearest = renyiDecideK(q, kNearestSuggestion);
@@ -351,7 +391,113 @@ namespace Tim
 		return genericEntropy(
 			signalSet,
 			entropyAlgorithm,
-			kNearest);
+			kNearest,
+			maxRelativeError,
+			relativeError,
+			SignalPointSet::Layout::Automatic,
+			instrumentation);
+	}
+
+	//! Computes Renyi entropies of a signal for many q and k.
+	/*!
+	Preconditions:
+	Each q in qSet is positive.
+	Each suggestion in kNearestSuggestionSet is non-negative.
+
+	qSet:
+	The exponents in the definition of Renyi entropy.
+
+	kNearestSuggestionSet:
+	The suggestions for the k:th nearest neighbor.
+
+	instrumentation:
+	See genericEntropy().
+
+	Returns:
+	The element i * ranges::size(kNearestSuggestionSet) + j is
+	renyiEntropyLps(signalSet, qSet[i], kNearestSuggestionSet[j]).
+
+	The nearest neighbors are searched once for the maximum 
+	k over the grid, and all the estimates are evaluated from 
+	the same distances. The estimates for q == 1 use the 
+	maximum norm, as in renyiEntropyLps(), and so share
+	a second search. See genericEntropies().
+	*/
+	template <
+		ranges::forward_range Signal_Range,
+		ranges::forward_range Real_Range,
+		ranges::forward_range Integer_Range>
+	std::vector<dreal> renyiEntropiesLps(
+		const Signal_Range& signalSet,
+		const Real_Range& qSet,
+		const Integer_Range& kNearestSuggestionSet,
+		Instrumentation* instrumentation = nullptr)
+	{
+		integer qs = ranges::size(qSet);
+		integer ks = ranges::size(kNearestSuggestionSet);
+
+		std::vector<dreal> result(qs * ks, (dreal)Nan());
+		if (ranges::empty(signalSet) || result.empty())
+		{
+			return result;
+		}
+
+		integer dimension = std::begin(signalSet)->dimension();
+
+		std::vector<LpsRenyi_EntropyAlgorithm> entropyAlgorithmSet;
+		std::vector<integer> kNearestSet;
+		std::vector<integer> indexSet;
+
+		std::vector<integer> klNearestSet;
+		std::vector<integer> klIndexSet;
+
+		integer i = 0;
+		for (dreal q : qSet)
+		{
+			ENSURE_OP(q, >, 0);
+
+			integer j = 0;
+			for (integer kNearestSuggestion : kNearestSuggestionSet)
+			{
+				ENSURE_OP(kNearestSuggestion, >=, 0);
+
+				if (q == 1)
+				{
+					// See renyiEntropyLps().
+					klNearestSet.push_back(
+						kNearestSuggestion == 0 ? 1 : kNearestSuggestion);
+					klIndexSet.push_back(i * ks + j);
+				}
+				else
+				{
+					integer kNearest = renyiDecideK(q, kNearestSuggestion);
+					entropyAlgorithmSet.emplace_back(dimension, kNearest, q);
+					kNearestSet.push_back(kNearest);
+					indexSet.push_back(i * ks + j);
+				}
+
+				++j;
+			}
+
+			++i;
+		}
+
+		std::vector<dreal> estimateSet = 
+			genericEntropies(signalSet, entropyAlgorithmSet, kNearestSet,
+				SignalPointSet::Layout::Automatic, instrumentation);
+		for (integer m = 0;m < (integer)indexSet.size();++m)
+		{
+			result[indexSet[m]] = estimateSet[m];
+		}
+
+		estimateSet = differentialEntropiesKl(
+			signalSet, klNearestSet, Default_Norm(), instrumentation);
+		for (integer m = 0;m < (integer)klIndexSet.size();++m)
+		{
+			result[klIndexSet[m]] = estimateSet[m];
+		}
+
+		return result;
 	}
 
 }
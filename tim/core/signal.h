@@ -138,7 +138,7 @@ namespace Tim
 		SignalData& operator=(SignalData&& that) = default;
 
 		explicit operator Signal() const {
-			return data();
+			return Signal(data(), t_);
 		}
 
 		integer samples() const {
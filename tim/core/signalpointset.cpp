@@ -1,5 +1,8 @@
 #include "tim/core/signalpointset.h"
 #include "tim/core/signal_tools.h"
+#include "tim/core/range_count.h"
+#include "tim/core/instrumentation.h"
+#include "tim/core/leaf_scan.h"
 
 #include <pastel/geometry/splitrule/slidingmidpoint_splitrule.h>
 #include <pastel/geometry/difference/difference_alignedbox_alignedbox.h>
@@ -12,6 +15,13 @@
 #include <boost/iterator/reverse_iterator.hpp>
 #include <boost/bind.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
 namespace Tim
 {
 
@@ -21,10 +31,107 @@ namespace Tim
 		swap(that);
 	}
 
+	SignalPointSet::SignalPointSet(
+		const std::vector<LaggedSignal>& signalSet,
+		Layout layout,
+		Metric metric,
+		Instrumentation* instrumentation)
+		: SignalPointSet(
+			signalSet, 0, 
+			signalSet.empty() ? 0 : signalSet.front().dimension(),
+			layout, metric, instrumentation)
+	{
+	}
+
+	SignalPointSet::SignalPointSet(
+		const std::vector<LaggedSignal>& signalSet,
+		integer dimensionBegin,
+		integer dimensionEnd,
+		Layout layout,
+		Metric metric,
+		Instrumentation* instrumentation)
+		: kdTree_()
+		, kdPointSet_()
+		, layout_(layout)
+		, metric_(metric)
+		, packedKdTree_()
+		, sortedLine_()
+		, vpTree_()
+		, bruteForceSet_()
+		, pointSet_()
+		, pointData_()
+		, signals_(signalSet.size())
+		, samples_(0)
+		, windowBegin_(0)
+		, windowEnd_(0)
+		, dimensionBegin_(dimensionBegin)
+		, dimension_(dimensionEnd - dimensionBegin)
+		, timeBegin_(0)
+		, builtBegin_(0)
+		, builtEnd_(0)
+		, instrumentation_(instrumentation)
+	{
+		ENSURE(!signalSet.empty());
+		ENSURE_OP(dimensionBegin, >=, 0);
+		ENSURE_OP(dimensionBegin, <, dimensionEnd);
+		ENSURE_OP(dimensionEnd, <=, signalSet.front().dimension());
+
+		createPointSet(signalSet);
+	}
+
+	SignalPointSet::SignalPointSet(
+		const SignalPointSet& that,
+		integer dimensionBegin,
+		integer dimensionEnd,
+		Layout layout,
+		Metric metric,
+		Instrumentation* instrumentation)
+		: kdTree_()
+		, kdPointSet_()
+		, layout_(layout)
+		, metric_(metric)
+		, packedKdTree_()
+		, sortedLine_()
+		, vpTree_()
+		, bruteForceSet_()
+		, pointSet_()
+		, pointData_()
+		, signals_(that.signals_)
+		, samples_(that.samples_)
+		, windowBegin_(that.timeBegin_)
+		, windowEnd_(that.timeBegin_ + that.samples_)
+		, dimensionBegin_(that.dimensionBegin_ + dimensionBegin)
+		, dimension_(dimensionEnd - dimensionBegin)
+		, timeBegin_(that.timeBegin_)
+		, builtBegin_(0)
+		, builtEnd_(0)
+		, instrumentation_(instrumentation)
+	{
+		ENSURE_OP(dimensionBegin, >=, 0);
+		ENSURE_OP(dimensionBegin, <, dimensionEnd);
+		ENSURE_OP(dimensionEnd, <=, that.dimension());
+
+		pointSet_.reserve(that.pointSet_.size());
+		for (const dreal* point : that.pointSet_)
+		{
+			pointSet_.push_back(point + dimensionBegin);
+		}
+
+		createSearchStructure();
+	}
+
 	void SignalPointSet::swap(SignalPointSet& that)
 	{
 		kdTree_.swap(that.kdTree_);
+		kdPointSet_.swap(that.kdPointSet_);
+		std::swap(layout_, that.layout_);
+		std::swap(metric_, that.metric_);
+		packedKdTree_.swap(that.packedKdTree_);
+		sortedLine_.swap(that.sortedLine_);
+		vpTree_.swap(that.vpTree_);
+		bruteForceSet_.swap(that.bruteForceSet_);
 		pointSet_.swap(that.pointSet_);
+		pointData_.swap(that.pointData_);
 		std::swap(signals_, that.signals_);
 		std::swap(samples_, that.samples_);
 		std::swap(windowBegin_, that.windowBegin_);
@@ -32,6 +139,9 @@ namespace Tim
 		std::swap(dimensionBegin_, that.dimensionBegin_);
 		std::swap(dimension_, that.dimension_);
 		std::swap(timeBegin_, that.timeBegin_);
+		std::swap(builtBegin_, that.builtBegin_);
+		std::swap(builtEnd_, that.builtEnd_);
+		std::swap(instrumentation_, that.instrumentation_);
 	}
 
 	SignalPointSet& SignalPointSet::operator=(SignalPointSet that)
@@ -45,6 +155,24 @@ namespace Tim
 	{
 		ENSURE_OP(newWindowBegin, <=, newWindowEnd);
 
+		TIM_PHASE(instrumentation_, TimeWindow);
+
+#ifdef TIM_INSTRUMENTATION
+		{
+			// Count the points which leave and enter the window.
+			integer newBegin = std::max(newWindowBegin, timeBegin_);
+			integer newEnd = std::max(
+				std::min(newWindowEnd, timeBegin_ + samples_), newBegin);
+			integer kept = std::max(
+				std::min(windowEnd_, newEnd) - std::max(windowBegin_, newBegin), 
+				(integer)0);
+			integer old = std::max(windowEnd_ - windowBegin_, (integer)0);
+
+			TIM_COUNT(instrumentation_, pointsHidden, (old - kept) * signals_);
+			TIM_COUNT(instrumentation_, pointsShown, (newEnd - newBegin - kept) * signals_);
+		}
+#endif
+
 		AlignedBox<integer, 1> sampleWindow(
 			timeBegin_, timeBegin_ + samples_);
 		AlignedBox<integer, 1> window(
@@ -57,7 +185,14 @@ namespace Tim
 		{
 			// The new window does not overlap with the
 			// sample window. Hide all points.
-			kdTree_.hide();
+			if (layout_ == Layout::Pointer)
+			{
+				kdTree_.hide();
+			}
+			packedKdTree_.hide();
+			sortedLine_.hide();
+			vpTree_.hide();
+			bruteForceSet_.hide();
 		}
 		else
 		{
@@ -65,7 +200,14 @@ namespace Tim
 			{
 				// The new window does not contain any of the
 				// existing points.
-				kdTree_.hide();
+				if (layout_ == Layout::Pointer)
+				{
+					kdTree_.hide();
+				}
+				packedKdTree_.hide();
+				sortedLine_.hide();
+				vpTree_.hide();
+				bruteForceSet_.hide();
 			}
 			else
 			{			
@@ -78,7 +220,14 @@ namespace Tim
 			if (contains(newWindow, sampleWindow))
 			{
 				// The new window contains all points.
-				kdTree_.show();
+				if (layout_ == Layout::Pointer)
+				{
+					kdTree_.show();
+				}
+				packedKdTree_.show();
+				sortedLine_.show();
+				vpTree_.show();
+				bruteForceSet_.show();
 			}
 			else
 			{
@@ -90,6 +239,8 @@ namespace Tim
 
 		windowBegin_ = newWindow.min().x();
 		windowEnd_ = newWindow.max().x();
+
+		updateSearchStructure();
 	}
 
 	const SignalPointSet::KdTree& SignalPointSet::kdTree() const
@@ -97,6 +248,252 @@ namespace Tim
 		return kdTree_;
 	}
 
+	SignalPointSet::Layout SignalPointSet::layout() const
+	{
+		return layout_;
+	}
+
+	Metric SignalPointSet::metric() const
+	{
+		return metric_;
+	}
+
+	void SignalPointSet::setInstrumentation(
+		Instrumentation* instrumentation)
+	{
+		instrumentation_ = instrumentation;
+		packedKdTree_.setInstrumentation(instrumentation);
+		sortedLine_.setInstrumentation(instrumentation);
+		vpTree_.setInstrumentation(instrumentation);
+		bruteForceSet_.setInstrumentation(instrumentation);
+	}
+
+	Instrumentation* SignalPointSet::instrumentation() const
+	{
+		return instrumentation_;
+	}
+
+	dreal SignalPointSet::distance(
+		const dreal* left, 
+		const dreal* right) const
+	{
+		if (layout_ != Layout::Pointer)
+		{
+			if (metric_ == Metric::Euclidean)
+			{
+				return storedEuclideanDistance(left, right, dimension_);
+			}
+
+			return storedDistance(left, right, dimension_);
+		}
+
+		dreal result = 0;
+		if (metric_ == Metric::Euclidean)
+		{
+			for (integer j = 0;j < dimension_;++j)
+			{
+				dreal delta = left[j] - right[j];
+				result += delta * delta;
+			}
+			return std::sqrt(result);
+		}
+
+		for (integer j = 0;j < dimension_;++j)
+		{
+			result = std::max(result, std::abs(left[j] - right[j]));
+		}
+		return result;
+	}
+
+	dreal SignalPointSet::relativeError(
+		dreal maxRelativeError) const
+	{
+		PENSURE_OP(maxRelativeError, >=, 0);
+
+		if (layout_ == Layout::Sorted ||
+			layout_ == Layout::BruteForce)
+		{
+			return 0;
+		}
+
+		return maxRelativeError;
+	}
+
+	dreal SignalPointSet::searchNearest(
+		const dreal* query,
+		integer kNearest,
+		const dreal* exclude,
+		dreal maxRelativeError) const
+	{
+		return searchNearest(query, kNearest, exclude,
+			[](dreal, const dreal*) {}, maxRelativeError);
+	}
+
+	void SignalPointSet::searchAllNearest(
+		integer kNearest,
+		integer queryBegin,
+		integer queryEnd,
+		dreal* distanceSet,
+		integer* neighborSet,
+		dreal maxRelativeError) const
+	{
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE_OP(queryBegin, >=, 0);
+		ENSURE_OP(queryBegin, <=, queryEnd);
+		ENSURE_OP(queryEnd, <=, end() - begin());
+
+		if (layout_ != Layout::Pointer)
+		{
+			// The Pointer layout counts its queries one by one.
+			TIM_COUNT(instrumentation_, nearestQueries, queryEnd - queryBegin);
+		}
+
+		std::vector<const dreal*> querySet;
+		querySet.reserve(queryEnd - queryBegin);
+		for (auto iter = begin() + queryBegin;iter != begin() + queryEnd;++iter)
+		{
+			querySet.push_back(*iter);
+		}
+
+		if (layout_ == Layout::Packed)
+		{
+			packedKdTree_.searchAllNearest(
+				querySet, kNearest, true, 
+				distanceSet, neighborSet, maxRelativeError);
+
+			toWindowIndices(neighborSet, querySet.size() * kNearest);
+		}
+		else if (layout_ == Layout::Sorted)
+		{
+			sortedLine_.searchAllNearest(
+				querySet, kNearest, true, 
+				distanceSet, neighborSet);
+
+			toWindowIndices(neighborSet, querySet.size() * kNearest);
+		}
+		else if (layout_ == Layout::VpTree)
+		{
+			vpTree_.searchAllNearest(
+				querySet, kNearest, true, 
+				distanceSet, neighborSet, maxRelativeError);
+
+			toWindowIndices(neighborSet, querySet.size() * kNearest);
+		}
+		else if (layout_ == Layout::BruteForce)
+		{
+			bruteForceSet_.searchAllNearest(
+				querySet, kNearest, true, 
+				distanceSet, neighborSet);
+
+			toWindowIndices(neighborSet, querySet.size() * kNearest);
+		}
+		else
+		{
+			searchEachNearest(
+				querySet, kNearest, true, 
+				distanceSet, neighborSet, maxRelativeError);
+		}
+	}
+
+	void SignalPointSet::searchAllNearest(
+		integer kNearest,
+		dreal* distanceSet,
+		integer* neighborSet,
+		dreal maxRelativeError) const
+	{
+		searchAllNearest(
+			kNearest, 0, end() - begin(), 
+			distanceSet, neighborSet, maxRelativeError);
+	}
+
+	void SignalPointSet::searchAllNearest(
+		const std::vector<const dreal*>& querySet,
+		integer kNearest,
+		dreal* distanceSet,
+		integer* neighborSet,
+		dreal maxRelativeError) const
+	{
+		ENSURE_OP(kNearest, >, 0);
+
+		if (layout_ != Layout::Pointer)
+		{
+			// The Pointer layout counts its queries one by one.
+			TIM_COUNT(instrumentation_, nearestQueries, querySet.size());
+		}
+
+		if (layout_ == Layout::Packed)
+		{
+			packedKdTree_.searchAllNearest(
+				querySet, kNearest, false, 
+				distanceSet, neighborSet, maxRelativeError);
+
+			toWindowIndices(neighborSet, querySet.size() * kNearest);
+		}
+		else if (layout_ == Layout::Sorted)
+		{
+			sortedLine_.searchAllNearest(
+				querySet, kNearest, false, 
+				distanceSet, neighborSet);
+
+			toWindowIndices(neighborSet, querySet.size() * kNearest);
+		}
+		else if (layout_ == Layout::VpTree)
+		{
+			vpTree_.searchAllNearest(
+				querySet, kNearest, false, 
+				distanceSet, neighborSet, maxRelativeError);
+
+			toWindowIndices(neighborSet, querySet.size() * kNearest);
+		}
+		else if (layout_ == Layout::BruteForce)
+		{
+			bruteForceSet_.searchAllNearest(
+				querySet, kNearest, false, 
+				distanceSet, neighborSet);
+
+			toWindowIndices(neighborSet, querySet.size() * kNearest);
+		}
+		else
+		{
+			searchEachNearest(
+				querySet, kNearest, false, 
+				distanceSet, neighborSet, maxRelativeError);
+		}
+	}
+
+	integer SignalPointSet::countRange(
+		const dreal* query,
+		dreal maxDistance) const
+	{
+		PENSURE_OP(maxDistance, >=, 0);
+
+		TIM_COUNT(instrumentation_, rangeQueries, 1);
+
+		if (layout_ == Layout::Packed)
+		{
+			return packedKdTree_.countRange(query, maxDistance);
+		}
+
+		if (layout_ == Layout::Sorted)
+		{
+			return sortedLine_.countRange(query, maxDistance);
+		}
+
+		if (layout_ == Layout::VpTree)
+		{
+			return vpTree_.countRange(query, maxDistance);
+		}
+
+		if (layout_ == Layout::BruteForce)
+		{
+			return bruteForceSet_.countRange(query, maxDistance);
+		}
+
+		PENSURE(metric_ == Metric::Maximum);
+
+		return Tim::countRange(kdTree_, query, maxDistance, instrumentation_);
+	}
+
 	SignalPointSet::Point_ConstIterator_Iterator 
 		SignalPointSet::begin() const
 	{
@@ -124,6 +521,30 @@ namespace Tim
 		return samples_;
 	}
 
+	integer SignalPointSet::trials() const
+	{
+		return signals_;
+	}
+
+	integer SignalPointSet::timeBegin() const
+	{
+		return timeBegin_;
+	}
+
+	integer SignalPointSet::timeEnd() const
+	{
+		return timeBegin_ + samples_;
+	}
+
+	SignalPointSet::Point_ConstIterator_Iterator 
+		SignalPointSet::sliceBegin(integer t) const
+	{
+		PENSURE_OP(t, >=, timeBegin_);
+		PENSURE_OP(t, <=, timeBegin_ + samples_);
+
+		return pointSet_.begin() + (t - timeBegin_) * signals_;
+	}
+
 	integer SignalPointSet::dimension() const
 	{
 		return dimension_;
@@ -141,26 +562,398 @@ namespace Tim
 
 	// Private
 
+	void SignalPointSet::createPointSet(
+		const std::vector<LaggedSignal>& signalSet)
+	{
+		TIM_PHASE(instrumentation_, Merge);
+
+		// Find out the time interval on which
+		// all trials are defined.
+
+		integer tBegin = signalSet.front().t();
+		integer tEnd = tBegin + signalSet.front().samples();
+		for (const LaggedSignal& signal : signalSet)
+		{
+			tBegin = std::max(tBegin, signal.t());
+			tEnd = std::min(tEnd, signal.t() + signal.samples());
+		}
+
+		if (tEnd < tBegin)
+		{
+			tBegin = 0;
+			tEnd = 0;
+		}
+
+		integer samples = tEnd - tBegin;
+		integer signals = signalSet.size();
+		integer dimensionEnd = dimensionBegin_ + dimension_;
+
+		// If the dimensions are contained in a single
+		// component, the points can refer to its data.
+		// Otherwise the coordinates are gathered.
+
+		integer component = signalSet.front().componentOf(
+			dimensionBegin_, dimensionEnd);
+
+		if (component < 0)
+		{
+			pointData_.resize(samples * signals * dimension_);
+		}
+
+		// Store points in an interleaved
+		// manner. The time slices are independent,
+		// and are gathered in parallel.
+
+		pointSet_.resize(samples * signals);
+
+		using Block = tbb::blocked_range<integer>;
+
+		tbb::parallel_for(Block(tBegin, tEnd),
+			[&](const Block& block)
+			{
+				for (integer t = block.begin();t < block.end();++t)
+				{
+					for (integer i = 0;i < signals;++i)
+					{
+						const LaggedSignal& signal = signalSet[i];
+						integer index = (t - tBegin) * signals + i;
+
+						const dreal* point = nullptr;
+						if (component >= 0)
+						{
+							point = signal.point(component, t) + 
+								(dimensionBegin_ - signal.dimensionBegin(component));
+						}
+						else
+						{
+							dreal* data = pointData_.data() + index * dimension_;
+							signal.copyPoint(t, dimensionBegin_, dimensionEnd, data);
+							point = data;
+						}
+
+						pointSet_[index] = point;
+					}
+				}
+			});
+
+		signals_ = signals;
+		samples_ = samples;
+		timeBegin_ = tBegin;
+
+		windowBegin_ = tBegin;
+		windowEnd_ = tBegin + samples;
+
+		createSearchStructure();
+	}
+
+	void SignalPointSet::createSearchStructure()
+	{
+		integer points = pointSet_.size();
+
+		if (layout_ == Layout::Automatic)
+		{
+			// The Packed layout is further resolved below.
+			layout_ = (dimension_ > 1 && points <= BruteForceLimit) ?
+				Layout::BruteForce : Layout::Packed;
+		}
+
+		if (layout_ == Layout::Packed && dimension_ == 1)
+		{
+			// A sorted array is faster than a kd-tree
+			// on the real line. On the real line, all
+			// the metrics coincide.
+			layout_ = Layout::Sorted;
+		}
+
+		if (layout_ == Layout::Packed && metric_ != Metric::Maximum)
+		{
+			// The packed kd-tree only measures in the
+			// maximum norm.
+			layout_ = Layout::VpTree;
+		}
+
+		if (layout_ == Layout::Sorted)
+		{
+			ENSURE_OP(dimension_, ==, 1);
+		}
+
+		builtBegin_ = timeBegin_;
+		builtEnd_ = timeBegin_ + samples_;
+
+		if (layout_ != Layout::Pointer)
+		{
+			buildSearchStructure();
+		}
+		else
+		{
+			TIM_PHASE(instrumentation_, Build);
+
+			// Only the Pointer layout uses the kd-tree.
+			Pointer_Locator<dreal> locator(dimension_);
+			KdTree kdTree(locator);
+			kdTree_.swap(kdTree);
+
+			kdPointSet_.reserve(points);
+			for (const dreal* point : pointSet_)
+			{
+				kdPointSet_.push_back(kdTree_.insert(point));
+			}
+
+			kdTree_.refine(SplitRule());
+		}
+	}
+
+	void SignalPointSet::buildSearchStructure()
+	{
+		TIM_PHASE(instrumentation_, Build);
+
+		integer iBegin = (builtBegin_ - timeBegin_) * signals_;
+		integer iEnd = (builtEnd_ - timeBegin_) * signals_;
+
+		std::vector<const dreal*> coordinateSet;
+		coordinateSet.reserve(iEnd - iBegin);
+		for (integer i = iBegin;i < iEnd;++i)
+		{
+			coordinateSet.push_back(pointSet_[i]);
+		}
+
+		if (layout_ == Layout::Sorted)
+		{
+			sortedLine_ = SortedLine(coordinateSet);
+		}
+		else if (layout_ == Layout::VpTree)
+		{
+			vpTree_ = VpTree(coordinateSet, dimension_, metric_);
+		}
+		else if (layout_ == Layout::BruteForce)
+		{
+			bruteForceSet_ = BruteForceSet(coordinateSet, dimension_, metric_);
+		}
+		else
+		{
+			packedKdTree_ = PackedKdTree(coordinateSet, dimension_);
+		}
+
+		// The new search structure counts its searches
+		// into the instrumentation of the point set.
+		setInstrumentation(instrumentation_);
+	}
+
+	void SignalPointSet::updateSearchStructure()
+	{
+		if (layout_ == Layout::Pointer)
+		{
+			return;
+		}
+
+		integer width = windowEnd_ - windowBegin_;
+		if (width <= 0 ||
+			windowBegin_ < timeBegin_ ||
+			windowEnd_ > timeBegin_ + samples_)
+		{
+			return;
+		}
+
+		bool contained = 
+			windowBegin_ >= builtBegin_ && 
+			windowEnd_ <= builtEnd_;
+
+		if (contained && builtEnd_ - builtBegin_ <= RebuildRatio * width)
+		{
+			return;
+		}
+
+		// Rebuild over the time-window and its width on 
+		// both sides, so that the time-window can slide
+		// by its width in either direction before the next
+		// rebuild.
+
+		builtBegin_ = std::max(windowBegin_ - width, timeBegin_);
+		builtEnd_ = std::min(windowEnd_ + width, timeBegin_ + samples_);
+
+		buildSearchStructure();
+
+		setStructureVisible(builtBegin_, windowBegin_, false);
+		setStructureVisible(windowEnd_, builtEnd_, false);
+	}
+
+	void SignalPointSet::setStructureVisible(
+		integer tBegin, integer tEnd, bool visible)
+	{
+		if (layout_ == Layout::Pointer)
+		{
+			return;
+		}
+
+		// Only the points of [builtBegin_, builtEnd_[ 
+		// are in the search structure.
+		tBegin = std::max(tBegin, builtBegin_);
+		tEnd = std::min(tEnd, builtEnd_);
+		if (tBegin >= tEnd)
+		{
+			return;
+		}
+
+		const integer iBegin = (tBegin - builtBegin_) * signals_;
+		const integer iEnd = (tEnd - builtBegin_) * signals_;
+
+		if (layout_ == Layout::Packed)
+		{
+			if (visible)
+			{
+				packedKdTree_.show(iBegin, iEnd);
+			}
+			else
+			{
+				packedKdTree_.hide(iBegin, iEnd);
+			}
+		}
+		else if (layout_ == Layout::Sorted)
+		{
+			if (visible)
+			{
+				sortedLine_.show(iBegin, iEnd);
+			}
+			else
+			{
+				sortedLine_.hide(iBegin, iEnd);
+			}
+		}
+		else if (layout_ == Layout::VpTree)
+		{
+			if (visible)
+			{
+				vpTree_.show(iBegin, iEnd);
+			}
+			else
+			{
+				vpTree_.hide(iBegin, iEnd);
+			}
+		}
+		else if (layout_ == Layout::BruteForce)
+		{
+			if (visible)
+			{
+				bruteForceSet_.show(iBegin, iEnd);
+			}
+			else
+			{
+				bruteForceSet_.hide(iBegin, iEnd);
+			}
+		}
+	}
+
+	void SignalPointSet::searchEachNearest(
+		const std::vector<const dreal*>& querySet,
+		integer kNearest,
+		bool excludeQuery,
+		dreal* distanceSet,
+		integer* neighborSet,
+		dreal maxRelativeError) const
+	{
+		integer queries = querySet.size();
+
+		// The neighbors are reported by their coordinate
+		// pointers; map them to indices in the time-window.
+		std::unordered_map<const dreal*, integer> indexMap;
+		if (neighborSet)
+		{
+			indexMap.reserve(end() - begin());
+			for (auto iter = begin();iter != end();++iter)
+			{
+				indexMap.emplace(*iter, iter - begin());
+			}
+		}
+
+		using Block = tbb::blocked_range<integer>;
+
+		auto search = [&](const Block& block)
+		{
+			std::vector<std::pair<dreal, integer>> neighborPairSet;
+			for (integer i = block.begin();i < block.end();++i)
+			{
+				const dreal* query = querySet[i];
+				neighborPairSet.clear();
+
+				distanceSet[i] = searchNearest(
+					query, kNearest, 
+					excludeQuery ? query : nullptr,
+					[&](dreal distance, const dreal* point)
+					{
+						if (neighborSet)
+						{
+							neighborPairSet.emplace_back(distance, indexMap.at(point));
+						}
+					},
+					maxRelativeError);
+
+				if (neighborSet)
+				{
+					std::sort(neighborPairSet.begin(), neighborPairSet.end());
+
+					integer* neighborBegin = neighborSet + i * kNearest;
+					std::fill(neighborBegin, neighborBegin + kNearest, (integer)-1);
+					for (integer j = 0;j < neighborPairSet.size();++j)
+					{
+						neighborBegin[j] = neighborPairSet[j].second;
+					}
+				}
+			}
+		};
+
+		tbb::parallel_for(Block(0, queries), search);
+	}
+
+	void SignalPointSet::toWindowIndices(
+		integer* neighborSet, integer neighbors) const
+	{
+		if (!neighborSet)
+		{
+			return;
+		}
+
+		// The search structure reports the indices of the 
+		// points of [builtBegin_, builtEnd_[.
+		integer windowOffset = (windowBegin_ - builtBegin_) * signals_;
+		for (integer i = 0;i < neighbors;++i)
+		{
+			if (neighborSet[i] >= 0)
+			{
+				neighborSet[i] -= windowOffset;
+			}
+		}
+	}
+
 	void SignalPointSet::hide(
 		const AlignedBox<integer, 1>& range)
 	{
-		const integer iBegin = (range.min().x() - timeBegin_) * signals_;
-		const integer iEnd = (range.max().x() - timeBegin_) * signals_;
-		for (integer i = iBegin;i < iEnd;++i)
+		if (layout_ == Layout::Pointer)
 		{
-			kdTree_.hide(pointSet_[i]);
+			const integer iBegin = (range.min().x() - timeBegin_) * signals_;
+			const integer iEnd = (range.max().x() - timeBegin_) * signals_;
+			for (integer i = iBegin;i < iEnd;++i)
+			{
+				kdTree_.hide(kdPointSet_[i]);
+			}
 		}
+
+		setStructureVisible(range.min().x(), range.max().x(), false);
 	}
 
 	void SignalPointSet::show(
 		const AlignedBox<integer, 1>& range)
 	{
-		const integer iBegin = (range.min().x() - timeBegin_) * signals_;
-		const integer iEnd = (range.max().x() - timeBegin_) * signals_;
-		for (integer i = iBegin;i < iEnd;++i)
+		if (layout_ == Layout::Pointer)
 		{
-			kdTree_.show(pointSet_[i]);
+			const integer iBegin = (range.min().x() - timeBegin_) * signals_;
+			const integer iEnd = (range.max().x() - timeBegin_) * signals_;
+			for (integer i = iBegin;i < iEnd;++i)
+			{
+				kdTree_.show(kdPointSet_[i]);
+			}
 		}
+
+		setStructureVisible(range.min().x(), range.max().x(), true);
 	}
 
 }
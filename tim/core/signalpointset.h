@@ -6,6 +6,12 @@
 
 #include "tim/core/mytypes.h"
 #include "tim/core/signal.h"
+#include "tim/core/lagged_signal.h"
+#include "tim/core/packed_kdtree.h"
+#include "tim/core/sorted_line.h"
+#include "tim/core/vp_tree.h"
+#include "tim/core/brute_force_set.h"
+#include "tim/core/instrumentation.h"
 
 #include <pastel/geometry/pointkdtree/pointkdtree.h>
 
@@ -13,6 +19,9 @@
 #include <pastel/sys/array/array.h>
 #include <pastel/sys/locator/pointer_locator.h>
 
+#include <pastel/math/normbijection/maximum_normbijection.h>
+#include <pastel/math/normbijection/euclidean_normbijection.h>
+
 #include <vector>
 #include <deque>
 
@@ -28,16 +37,82 @@ namespace Tim
 		typedef KdTree::Point_ConstIterator Point_ConstIterator;
 		typedef KdTree::Point Point;
 
-		typedef std::vector<Point_ConstIterator> PointSet;
+		typedef std::vector<const dreal*> PointSet;
 		typedef PointSet::const_iterator Point_ConstIterator_Iterator;
 
+		//! The search structure behind the queries.
+		/*!
+		Pointer:
+		The points are searched in the multi-resolution 
+		kd-tree, whose leaves refer to the signal data
+		by pointers.
+
+		Packed:
+		The coordinates are copied into a PackedKdTree, 
+		whose leaves store them contiguously. The 
+		multi-resolution kd-tree is then empty; use the 
+		searchNearest() and countRange() member functions
+		for searching. A one-dimensional point set uses 
+		the Sorted layout instead.
+
+		Sorted:
+		The coordinates are copied into a SortedLine. 
+		Requires a one-dimensional point set. Otherwise
+		as with the Packed layout.
+
+		VpTree:
+		The coordinates are copied into a VpTree. This 
+		prunes by the triangle inequality rather than by 
+		bounding boxes, and so adapts to the intrinsic 
+		dimension of the points. Otherwise as with the 
+		Packed layout.
+
+		BruteForce:
+		The coordinates are copied into a BruteForceSet,
+		which scans all the points for every query. This
+		is the fastest for small point sets, and for high
+		dimensions where no subdivision prunes. Otherwise 
+		as with the Packed layout.
+
+		Automatic:
+		Chooses one of the above by the dimension, the
+		number of points, and the metric; see layout().
+
+		The Packed layout only supports the maximum metric;
+		with the Euclidean metric it is replaced with the
+		VpTree layout.
+		*/
+		enum class Layout
+		{
+			Pointer,
+			Packed,
+			Sorted,
+			VpTree,
+			BruteForce,
+			Automatic
+		};
+
 	public:
 		SignalPointSet() = default;
 
 		//! Constructs using the given ensemble of signals.
+		/*!
+		layout:
+		The search structure behind the queries.
+
+		metric:
+		The norm in which the queries measure distances.
+
+		instrumentation:
+		Measures the building of the point set, and counts 
+		its searches, or null. See setInstrumentation().
+		*/
 		template <ranges::forward_range Signal_Range>
 		explicit SignalPointSet(
-			const Signal_Range& signalSet);
+			const Signal_Range& signalSet,
+			Layout layout = Layout::Pointer,
+			Metric metric = Metric::Maximum,
+			Instrumentation* instrumentation = nullptr);
 
 		SignalPointSet(const SignalPointSet& that) = delete;
 
@@ -59,7 +134,63 @@ namespace Tim
 		SignalPointSet(
 			const Signal_Range& signalSet,
 			integer dimensionBegin,
-			integer dimensionEnd);
+			integer dimensionEnd,
+			Layout layout = Layout::Pointer,
+			Metric metric = Metric::Maximum,
+			Instrumentation* instrumentation = nullptr);
+
+		//! Constructs using the given ensemble of lagged signals.
+		/*!
+		Preconditions:
+		!signalSet.empty()
+
+		This is as constructing from the merged signals, 
+		except that the signals are not copied when possible.
+		See the constructor below.
+		*/
+		explicit SignalPointSet(
+			const std::vector<LaggedSignal>& signalSet,
+			Layout layout = Layout::Pointer,
+			Metric metric = Metric::Maximum,
+			Instrumentation* instrumentation = nullptr);
+
+		//! Constructs using given subdimensions of lagged signals.
+		/*!
+		Preconditions:
+		!signalSet.empty()
+		0 <= dimensionBegin < dimensionEnd <= signalSet.front().dimension()
+
+		If the subdimensions are contained in a single component
+		signal, then the points refer directly to the data of 
+		that signal. Otherwise the coordinates of the points are 
+		gathered from the component signals into the point set.
+		*/
+		SignalPointSet(
+			const std::vector<LaggedSignal>& signalSet,
+			integer dimensionBegin,
+			integer dimensionEnd,
+			Layout layout = Layout::Pointer,
+			Metric metric = Metric::Maximum,
+			Instrumentation* instrumentation = nullptr);
+
+		//! Constructs using given subdimensions of another point set.
+		/*!
+		Preconditions:
+		0 <= dimensionBegin < dimensionEnd <= that.dimension()
+
+		The points refer to the coordinates of the points of 
+		'that', which must outlive this point set. The points 
+		are defined on the same time interval as in 'that', and
+		initially all of them are in the time-window. This is 
+		useful for marginal point sets of a joint point set.
+		*/
+		SignalPointSet(
+			const SignalPointSet& that,
+			integer dimensionBegin,
+			integer dimensionEnd,
+			Layout layout = Layout::Pointer,
+			Metric metric = Metric::Maximum,
+			Instrumentation* instrumentation = nullptr);
 
 		//! Swaps the contents of two SignalPointSet's.
 		/*!
@@ -76,14 +207,218 @@ namespace Tim
 		tNewBegin <= tNewEnd
 
 		The more the old time-window and the new time-window
-		overlap, the less work needs to be done.
+		overlap, the less work needs to be done. The points
+		entering and leaving the time-window are hidden and 
+		shown in the search structure in batches, one time
+		slice at a time.
+
+		With the layouts other than Pointer, the search 
+		structure contains only the points of a time interval
+		around the time-window. When the time-window leaves that
+		interval, or covers less than 1 / RebuildRatio of it, the
+		search structure is rebuilt over the time-window and its 
+		width on both sides, so that the searches do not visit
+		subtrees of points far outside the time-window.
 		*/
 		void setTimeWindow(integer tNewBegin, integer tNewEnd);
 
 		//! Returns a non-mutable reference to the multi-resolution kd-tree.
+		/*!
+		With the Pointer layout, the kd-tree contains the 
+		points of the time-window. With the other layouts,
+		the kd-tree is empty.
+		*/
 		const KdTree& kdTree() const;
 
+		//! Returns the search structure behind the queries.
+		/*!
+		This is the layout given in construction, except
+		that a one-dimensional point set replaces the
+		Packed layout with the Sorted layout, and that the
+		Automatic layout is resolved as follows. A 
+		one-dimensional point set uses the Sorted layout.
+		Otherwise, a point set of at most BruteForceLimit 
+		points uses the BruteForce layout. Otherwise, the
+		maximum metric uses the Packed layout, and the 
+		other metrics use the VpTree layout.
+		*/
+		Layout layout() const;
+
+		//! Returns the norm in which the queries measure distances.
+		Metric metric() const;
+
+		//! Sets the instrumentation of the point set.
+		/*!
+		The instrumentation measures the time-window moves
+		and counts the searches of the point set, including
+		those done by Pastel's searches over kdTree() with 
+		the Pointer layout. It can be null, which measures
+		nothing. Point sets shared by concurrent estimates 
+		are measured into the instrumentation set last.
+		*/
+		void setInstrumentation(Instrumentation* instrumentation);
+
+		//! Returns the instrumentation of the point set, or null.
+		Instrumentation* instrumentation() const;
+
+		//! Returns the distance between two points in the metric.
+		/*!
+		The points have dimension() coordinates. This is the
+		distance as the queries measure it: with the layouts
+		other than Pointer, the coordinates of 'right' are 
+		rounded as the search structure stores them; see
+		storedDistance().
+		*/
+		dreal distance(const dreal* left, const dreal* right) const;
+
+		//! Returns the relative error that the searches would have.
+		/*!
+		Preconditions:
+		maxRelativeError >= 0
+
+		This is 'maxRelativeError', except that it is zero for 
+		the Sorted and BruteForce layouts, whose searches are 
+		always exact.
+		*/
+		dreal relativeError(dreal maxRelativeError) const;
+
+		//! Finds the k nearest points in the time-window.
+		/*!
+		Preconditions:
+		kNearest > 0
+
+		query:
+		The coordinates of the query point, with
+		dimension() elements.
+
+		exclude:
+		The coordinate pointer of a point which is not
+		accepted as a neighbor, typically that of the
+		query point itself. Can be null.
+
+		report:
+		A function which is called as report(distance, point)
+		for each found neighbor, where point is the coordinate
+		pointer of the neighbor.
+
+		maxRelativeError:
+		The allowed relative error in the distances; the
+		reported neighbors are at most 1 + maxRelativeError 
+		times farther than the true nearest neighbors. Zero 
+		gives an exact search. See relativeError().
+
+		Returns:
+		The distance to the k:th nearest neighbor in the 
+		metric, or infinity if there are less than k accepted 
+		points in the time-window.
+		*/
+		template <typename Report>
+		dreal searchNearest(
+			const dreal* query,
+			integer kNearest,
+			const dreal* exclude,
+			Report&& report,
+			dreal maxRelativeError = 0) const;
+
+		//! Finds the distance to the k:th nearest point in the time-window.
+		dreal searchNearest(
+			const dreal* query,
+			integer kNearest,
+			const dreal* exclude = nullptr,
+			dreal maxRelativeError = 0) const;
+
+		//! Finds the k nearest neighbors of points in the time-window.
+		/*!
+		Preconditions:
+		kNearest > 0
+		0 <= queryBegin <= queryEnd <= end() - begin()
+
+		The queries are the points [begin() + queryBegin, 
+		begin() + queryEnd[, each of which rejects itself as 
+		a neighbor. 
+
+		distanceSet:
+		The output for the distances to the k:th 
+		nearest neighbors, with queryEnd - queryBegin elements. 
+		The distance is infinity if there are less than k other 
+		points in the time-window.
+
+		neighborSet:
+		An optional output for the k nearest neighbors of each 
+		query, in ascending order of distance, with 
+		(queryEnd - queryBegin) * kNearest elements. A neighbor 
+		is stored by its index i relative to the time-window, so 
+		that it is the point *(begin() + i). The missing neighbors
+		are stored as -1. Can be null.
+
+		maxRelativeError:
+		The allowed relative error in the distances; see
+		searchNearest().
+
+		With the packed layout the queries are searched in
+		batches which share the traversal of the kd-tree; see
+		PackedKdTree::searchAllNearest(). This is much faster 
+		than calling searchNearest() for each point.
+		*/
+		void searchAllNearest(
+			integer kNearest,
+			integer queryBegin,
+			integer queryEnd,
+			dreal* distanceSet,
+			integer* neighborSet = nullptr,
+			dreal maxRelativeError = 0) const;
+
+		//! Finds the k nearest neighbors of all points in the time-window.
+		/*!
+		This is a convenience function which calls
+		searchAllNearest(kNearest, 0, end() - begin(), 
+		distanceSet, neighborSet, maxRelativeError).
+		*/
+		void searchAllNearest(
+			integer kNearest,
+			dreal* distanceSet,
+			integer* neighborSet = nullptr,
+			dreal maxRelativeError = 0) const;
+
+		//! Finds the k nearest neighbors of arbitrary query points.
+		/*!
+		Preconditions:
+		kNearest > 0
+
+		querySet:
+		Pointers to the coordinates of the query points,
+		each with dimension() elements. A query does not
+		reject any point as a neighbor.
+
+		Otherwise as the other searchAllNearest().
+		*/
+		void searchAllNearest(
+			const std::vector<const dreal*>& querySet,
+			integer kNearest,
+			dreal* distanceSet,
+			integer* neighborSet = nullptr,
+			dreal maxRelativeError = 0) const;
+
+		//! Counts the points in the time-window inside an open ball.
+		/*!
+		Preconditions:
+		maxDistance >= 0
+
+		Returns:
+		The number of points p in the time-window whose
+		distance to the query is less than maxDistance.
+
+		The Pointer layout only supports this in the maximum
+		metric; see countRange() in range_count.h.
+		*/
+		integer countRange(
+			const dreal* query,
+			dreal maxDistance) const;
+
 		//! First iterator to set of points currently in the window.
+		/*!
+		A point is given by the pointer to its coordinates.
+		*/
 		Point_ConstIterator_Iterator begin() const;
 
 		//! One-past-last iterator to set of points currently in the window.
@@ -104,6 +439,35 @@ namespace Tim
 		//! Returns the total number of points in the point set.
 		integer samples() const;
 
+		//! Returns the number of trials in the point set.
+		/*!
+		Each time instant contributes one point per trial.
+		*/
+		integer trials() const;
+
+		//! Returns the first time instant of the sample range.
+		/*!
+		The points are defined on the time interval 
+		[timeBegin(), timeEnd()[, which contains the 
+		time-window.
+		*/
+		integer timeBegin() const;
+
+		//! Returns the one-past-last time instant of the sample range.
+		integer timeEnd() const;
+
+		//! First iterator to the points at time instant t.
+		/*!
+		Preconditions:
+		timeBegin() <= t <= timeEnd()
+
+		The points of the time instant t are given by
+		[sliceBegin(t), sliceBegin(t) + trials()[, one
+		point per trial, regardless of whether they are 
+		currently contained in the time-window.
+		*/
+		Point_ConstIterator_Iterator sliceBegin(integer t) const;
+
 		//! Returns the dimension of the point set.
 		/*!
 		Note that the dimension of the point set is not
@@ -123,6 +487,12 @@ namespace Tim
 		//! Returns a vector that corresponds to a given point.
 		VectorD point(const Point& object) const;
 
+		//! The number of points up to which the BruteForce layout is automatic.
+		static constexpr integer BruteForceLimit = 2048;
+
+		//! The ratio of built to windowed time at which the search structure is rebuilt.
+		static constexpr integer RebuildRatio = 4;
+
 	private:
 		// Extracts points from the given ensemble of signals.
 		/*
@@ -133,18 +503,86 @@ namespace Tim
 		void createPointSet(
 			const Signal_Range& signalSet);
 
+		// Extracts points from the given ensemble of 
+		// lagged signals.
+		void createPointSet(
+			const std::vector<LaggedSignal>& signalSet);
+
+		// Creates the search structure of the layout
+		// over the points in 'pointSet_'.
+		void createSearchStructure();
+
+		// Builds the search structure of the layout over
+		// the points of [builtBegin_, builtEnd_[.
+		void buildSearchStructure();
+
+		// Rebuilds the search structure around the time-window,
+		// if the time-window has left [builtBegin_, builtEnd_[,
+		// or covers too small a part of it.
+		void updateSearchStructure();
+
+		// Implements searchAllNearest() by searching for
+		// each query separately.
+		void searchEachNearest(
+			const std::vector<const dreal*>& querySet,
+			integer kNearest,
+			bool excludeQuery,
+			dreal* distanceSet,
+			integer* neighborSet,
+			dreal maxRelativeError) const;
+
+		// Converts indices of 'pointSet_' to indices relative
+		// to the time-window; -1 is kept as is.
+		void toWindowIndices(
+			integer* neighborSet, integer neighbors) const;
+
 		void hide(
 			const AlignedBox<integer, 1>& range);
 
 		void show(
 			const AlignedBox<integer, 1>& range);
 
+		// Sets the visibility of the points of [tBegin, tEnd[
+		// in the search structure of the layout. The points 
+		// outside [builtBegin_, builtEnd_[ are ignored.
+		void setStructureVisible(
+			integer tBegin, integer tEnd, bool visible);
+
 		/*
 		kdTree_:
 		A multi-resolution kd-tree that has been subdivided with
 		all available points but which only contains the points
 		in the time-window at any time instant. Note multi-resolution
 		kd-tree adapts itself automatically to smaller number of points.
+		With the other layouts than Pointer the kd-tree is empty.
+
+		kdPointSet_:
+		With the Pointer layout, the kd-tree point of 
+		'pointSet_[i]' is 'kdPointSet_[i]'. This is needed 
+		to hide and show the points when the time-window is
+		moved. Otherwise empty.
+
+		layout_:
+		The search structure behind the queries.
+
+		metric_:
+		The norm in which the queries measure distances.
+
+		packedKdTree_:
+		With the packed layout, a kd-tree over the coordinates
+		of the points of [builtBegin_, builtEnd_[, whose i:th point
+		is 'pointSet_[(builtBegin_ - timeBegin_) * signals_ + i]'.
+		Only the points in the time-window are visible. Otherwise 
+		empty.
+
+		sortedLine_:
+		As 'packedKdTree_', but for the sorted layout.
+
+		vpTree_:
+		As 'packedKdTree_', but for the VpTree layout.
+
+		bruteForceSet_:
+		As 'packedKdTree_', but for the BruteForce layout.
 
 		signalSet_:
 		Contains the ensemble of signals that are the input 
@@ -154,9 +592,11 @@ namespace Tim
 		Contains a set of pointers with each pointer pointing
 		to the beginning of point coordinate data. This set represents
 		the set of all available points without culling by a 
-		time-window. Note that kdTree_ uses a PointPolicy
-		in which the point is a const dreal*. This container is
-		needed to insert points when the time-window is moved.
+		time-window.
+
+		pointData_:
+		The coordinates of the points, when they had to be 
+		gathered from several lagged signals. Otherwise empty.
 
 		samples_:
 		Contains the number of samples that are considered
@@ -176,17 +616,63 @@ namespace Tim
 		timeBegin_:
 		The time instant t corresponding to 'pointSet_[i]'
 		is given by 't = timeBegin_ + (i / signals_)'.
+
+		builtBegin_, builtEnd_:
+		The search structure of the layout contains the points
+		of the time interval [builtBegin_, builtEnd_[.
+
+		instrumentation_:
+		Measures the point set and its searches, or null.
 		*/
 
 		KdTree kdTree_;
+		std::vector<Point_ConstIterator> kdPointSet_;
+		Layout layout_ = Layout::Pointer;
+		Metric metric_ = Metric::Maximum;
+		PackedKdTree packedKdTree_;
+		SortedLine sortedLine_;
+		VpTree vpTree_;
+		BruteForceSet bruteForceSet_;
 		PointSet pointSet_;
-		integer signals_;
-		integer samples_;
-		integer windowBegin_;
-		integer windowEnd_;
-		integer dimensionBegin_;
-		integer dimension_;
-		integer timeBegin_;
+		std::vector<dreal> pointData_;
+		integer signals_ = 0;
+		integer samples_ = 0;
+		integer windowBegin_ = 0;
+		integer windowEnd_ = 0;
+		integer dimensionBegin_ = 0;
+		integer dimension_ = 0;
+		integer timeBegin_ = 0;
+		integer builtBegin_ = 0;
+		integer builtEnd_ = 0;
+		Instrumentation* instrumentation_ = nullptr;
+	};
+
+	//! The metric of a norm.
+	/*!
+	For the norms which SignalPointSet supports, 'exists'
+	is true, and 'value' is the corresponding metric. The
+	other norms must be searched with the Pointer layout
+	and the Pastel search algorithms.
+	*/
+	template <typename Norm>
+	struct NormMetric
+	{
+		static constexpr bool exists = false;
+		static constexpr Metric value = Metric::Maximum;
+	};
+
+	template <>
+	struct NormMetric<Maximum_Norm<dreal>>
+	{
+		static constexpr bool exists = true;
+		static constexpr Metric value = Metric::Maximum;
+	};
+
+	template <>
+	struct NormMetric<Euclidean_Norm<dreal>>
+	{
+		static constexpr bool exists = true;
+		static constexpr Metric value = Metric::Euclidean;
 	};
 
 }
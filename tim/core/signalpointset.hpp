@@ -3,24 +3,45 @@
 
 #include "tim/core/signalpointset.h"
 #include "tim/core/signal_tools.h"
+#include "tim/core/instrumentation.h"
 
 #include <pastel/sys/ensure.h>
 
+#include <pastel/geometry/search_nearest.h>
+#include <pastel/geometry/nearestset/kdtree_nearestset.h>
+
+#include <pastel/math/normbijection/maximum_normbijection.h>
+#include <pastel/math/normbijection/euclidean_normbijection.h>
+
 namespace Tim
 {
 
 	template <ranges::forward_range Signal_Range>
 	SignalPointSet::SignalPointSet(
-		const Signal_Range& signalSet)
-		: kdTree_(Pointer_Locator<dreal>(ranges::empty(signalSet) ? 0 : std::begin(signalSet)->dimension()))
+		const Signal_Range& signalSet,
+		Layout layout,
+		Metric metric,
+		Instrumentation* instrumentation)
+		: kdTree_()
+		, kdPointSet_()
+		, layout_(layout)
+		, metric_(metric)
+		, packedKdTree_()
+		, sortedLine_()
+		, vpTree_()
+		, bruteForceSet_()
 		, pointSet_()
+		, pointData_()
 		, signals_(ranges::size(signalSet))
 		, samples_(0)
 		, windowBegin_(0)
 		, windowEnd_(0)
 		, dimensionBegin_(0)
-		, dimension_(kdTree_.n())
+		, dimension_(ranges::empty(signalSet) ? 0 : std::begin(signalSet)->dimension())
 		, timeBegin_(0)
+		, builtBegin_(0)
+		, builtEnd_(0)
+		, instrumentation_(instrumentation)
 	{
 		ENSURE(!ranges::empty(signalSet));
 		PENSURE(equalDimension(signalSet));
@@ -32,9 +53,20 @@ namespace Tim
 	SignalPointSet::SignalPointSet(
 		const Signal_Range& signalSet,
 		integer dimensionBegin,
-		integer dimensionEnd)
-		: kdTree_(Pointer_Locator<dreal>(dimensionEnd - dimensionBegin))
+		integer dimensionEnd,
+		Layout layout,
+		Metric metric,
+		Instrumentation* instrumentation)
+		: kdTree_()
+		, kdPointSet_()
+		, layout_(layout)
+		, metric_(metric)
+		, packedKdTree_()
+		, sortedLine_()
+		, vpTree_()
+		, bruteForceSet_()
 		, pointSet_()
+		, pointData_()
 		, signals_(ranges::size(signalSet))
 		, samples_(0)
 		, windowBegin_(0)
@@ -42,6 +74,9 @@ namespace Tim
 		, dimensionBegin_(dimensionBegin)
 		, dimension_(dimensionEnd - dimensionBegin)
 		, timeBegin_(0)
+		, builtBegin_(0)
+		, builtEnd_(0)
+		, instrumentation_(instrumentation)
 	{
 		ENSURE(!ranges::empty(signalSet));
 		PENSURE(equalDimension(signalSet));
@@ -52,12 +87,85 @@ namespace Tim
 		createPointSet(signalSet);
 	}
 
+	template <typename Report>
+	dreal SignalPointSet::searchNearest(
+		const dreal* query,
+		integer kNearest,
+		const dreal* exclude,
+		Report&& report,
+		dreal maxRelativeError) const
+	{
+		PENSURE_OP(kNearest, >, 0);
+		PENSURE_OP(maxRelativeError, >=, 0);
+
+		TIM_COUNT(instrumentation_, nearestQueries, 1);
+
+		if (layout_ == Layout::Packed)
+		{
+			return packedKdTree_.searchNearest(
+				query, kNearest, exclude, report, 
+				maxRelativeError);
+		}
+
+		if (layout_ == Layout::Sorted)
+		{
+			return sortedLine_.searchNearest(
+				query, kNearest, exclude, report);
+		}
+
+		if (layout_ == Layout::VpTree)
+		{
+			return vpTree_.searchNearest(
+				query, kNearest, exclude, report, 
+				maxRelativeError);
+		}
+
+		if (layout_ == Layout::BruteForce)
+		{
+			return bruteForceSet_.searchNearest(
+				query, kNearest, exclude, report);
+		}
+
+		Vector<dreal> queryPoint(
+			ofDimension(dimension_),
+			withAliasing((dreal*)query));
+
+		auto search = [&](const auto& norm)
+		{
+			return (dreal)Pastel::searchNearest(
+				kdTreeNearestSet(kdTree_),
+				queryPoint,
+				PASTEL_TAG(accept), countingIndicator(instrumentation_,
+					[exclude](const Point_ConstIterator& point)
+					{
+						return point->point() != exclude;
+					}),
+				PASTEL_TAG(norm), norm,
+				PASTEL_TAG(kNearest), kNearest,
+				PASTEL_TAG(maxRelativeError), maxRelativeError,
+				PASTEL_TAG(report), [&](auto distance, auto point)
+				{
+					report((dreal)distance, point->point());
+				}
+			).first;
+		};
+
+		if (metric_ == Metric::Euclidean)
+		{
+			return search(Euclidean_Norm<dreal>());
+		}
+
+		return search(Maximum_Norm<dreal>());
+	}
+
 	// Private
 
 	template <ranges::forward_range Signal_Range>
 	void SignalPointSet::createPointSet(
 		const Signal_Range& signalSet)
 	{
+		TIM_PHASE(instrumentation_, Merge);
+
 		// Find out the time interval on which
 		// all trials are defined.
 
@@ -79,9 +187,8 @@ namespace Tim
 			Signal signal = (Signal)*iter;
 			for (integer t = tBegin;t < tEnd;++t)
 			{
-				const dreal* point = 
+				pointSet_[(t - tBegin) * signals + i] = 
 					std::begin(signal.pointRange(dimensionBegin_))[t - signal.t()];
-				pointSet_[(t - tBegin) * signals + i] = kdTree_.insert(point);
 			}
 			
 			++iter;
@@ -94,7 +201,7 @@ namespace Tim
 		windowBegin_ = tBegin;
 		windowEnd_ = tBegin + samples;
 
-		kdTree_.refine(SplitRule());
+		createSearchStructure();
 	}
 
 }
@@ -0,0 +1,413 @@
+#include "tim/core/sliding_neighbors.h"
+#include "tim/core/instrumentation.h"
+#include "tim/core/leaf_scan.h"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Tim
+{
+
+	SlidingNeighbors::SlidingNeighbors(
+		const SignalPointSet& jointPointSet,
+		const std::vector<SignalPointSet>& marginalSet,
+		integer kNearest,
+		dreal maxRelativeError)
+		: jointPointSet_(&jointPointSet)
+		, marginalSet_(&marginalSet)
+		, kNearest_(kNearest)
+		, maxRelativeError_(maxRelativeError)
+		, trackBegin_(0)
+		, trackEnd_(0)
+		, storeBegin_(0)
+		, storeEnd_(0)
+		, windowBegin_(0)
+		, windowEnd_(0)
+		, neighborSet_()
+		, neighborsSet_()
+		, countSet_()
+		, recountSet_()
+		, oldNeighborSet_()
+		, oldNeighborsSet_()
+		, oldCountSet_()
+	{
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE_OP(maxRelativeError, >=, 0);
+		for (const SignalPointSet& pointSet : marginalSet)
+		{
+			ENSURE_OP(pointSet.timeBegin(), ==, jointPointSet.timeBegin());
+			ENSURE_OP(pointSet.timeEnd(), ==, jointPointSet.timeEnd());
+			ENSURE_OP(pointSet.trials(), ==, jointPointSet.trials());
+		}
+	}
+
+	void SlidingNeighbors::update(
+		integer trackBegin, integer trackEnd)
+	{
+		integer windowBegin = jointPointSet_->windowBegin();
+		integer windowEnd = jointPointSet_->windowEnd();
+
+		ENSURE_OP(windowBegin, <=, trackBegin);
+		ENSURE_OP(trackBegin, <=, trackEnd);
+		ENSURE_OP(trackEnd, <=, windowEnd);
+
+		// Find out the time instants which have left,
+		// or entered, the time-window since the previous
+		// update.
+
+		std::vector<integer> leftSet;
+		for (integer t = windowBegin_;t < windowEnd_;++t)
+		{
+			if (t < windowBegin || t >= windowEnd)
+			{
+				leftSet.push_back(t);
+			}
+		}
+
+		std::vector<integer> enteredSet;
+		for (integer t = windowBegin;t < windowEnd;++t)
+		{
+			if (t < windowBegin_ || t >= windowEnd_)
+			{
+				enteredSet.push_back(t);
+			}
+		}
+
+		integer trials = jointPointSet_->trials();
+		integer marginals = marginalSet_->size();
+
+		// An incremental update measures each retained point 
+		// against every trial of the changed time instants. 
+		// When there are more of these than time instants in 
+		// the time-window, the incremental updates cost more 
+		// than searching from scratch.
+		integer changed = leftSet.size() + enteredSet.size();
+		bool retain = changed * trials < windowEnd - windowBegin;
+
+		// Store the whole time-window when the tracked
+		// interval covers most of it.
+		bool storeWindow = 
+			((windowEnd - windowBegin) - (trackEnd - trackBegin)) * TrackRatio <= 
+			windowEnd - windowBegin;
+		integer storeBegin = storeWindow ? windowBegin : trackBegin;
+		integer storeEnd = storeWindow ? windowEnd : trackEnd;
+		integer points = (storeEnd - storeBegin) * trials;
+
+		// The joint points which left the time-window, sorted, 
+		// so that a point finds out in O(k log n) time whether 
+		// it lost one of its neighbors.
+
+		std::vector<const dreal*> leftPointSet;
+		leftPointSet.reserve(leftSet.size() * trials);
+		for (integer s : leftSet)
+		{
+			for (integer j = 0;j < trials;++j)
+			{
+				leftPointSet.push_back(coordinates(*jointPointSet_, s, j));
+			}
+		}
+		std::sort(leftPointSet.begin(), leftPointSet.end());
+
+		neighborSet_.swap(oldNeighborSet_);
+		neighborsSet_.swap(oldNeighborsSet_);
+		countSet_.swap(oldCountSet_);
+
+		neighborSet_.resize(points * kNearest_);
+		neighborsSet_.assign(points, -1);
+		countSet_.resize(points * marginals);
+
+		if (retain)
+		{
+			// Move the state of the points which stay
+			// in the stored interval.
+
+			integer tBegin = std::max(storeBegin, storeBegin_);
+			integer tEnd = std::min(storeEnd, storeEnd_);
+			for (integer t = tBegin;t < tEnd;++t)
+			{
+				for (integer j = 0;j < trials;++j)
+				{
+					integer from = (t - storeBegin_) * trials + j;
+					integer to = (t - storeBegin) * trials + j;
+
+					std::copy_n(
+						oldNeighborSet_.begin() + from * kNearest_,
+						oldNeighborsSet_[from],
+						neighborSet_.begin() + to * kNearest_);
+					std::copy_n(
+						oldCountSet_.begin() + from * marginals,
+						marginals,
+						countSet_.begin() + to * marginals);
+					neighborsSet_[to] = oldNeighborsSet_[from];
+				}
+			}
+		}
+
+		trackBegin_ = trackBegin;
+		trackEnd_ = trackEnd;
+		storeBegin_ = storeBegin;
+		storeEnd_ = storeEnd;
+
+		recountSet_.assign(points, true);
+
+		using Block = tbb::blocked_range<integer>;
+
+		// Update the joint nearest neighbors.
+
+		auto search = [&](const Block& block)
+		{
+			for (integer i = block.begin();i < block.end();++i)
+			{
+				if (neighborsSet_[i] >= 0)
+				{
+					recountSet_[i] = updatePoint(i, leftPointSet, enteredSet);
+				}
+				else
+				{
+					searchPoint(i);
+				}
+			}
+		};
+
+		{
+			TIM_PHASE(jointPointSet_->instrumentation(), JointSearch);
+			tbb::parallel_for(Block(0, points), search);
+		}
+
+		// Update the marginal range counts. The work is
+		// divided over both the points and the marginals.
+
+		auto count = [&](const Block& block)
+		{
+			for (integer r = block.begin();r < block.end();++r)
+			{
+				integer i = r / marginals;
+				integer m = r % marginals;
+				if (recountSet_[i])
+				{
+					countPoint(i, m);
+				}
+				else
+				{
+					updateCount(i, m, leftSet, enteredSet);
+				}
+			}
+		};
+
+		{
+			TIM_PHASE(jointPointSet_->instrumentation(), MarginalCount);
+			tbb::parallel_for(Block(0, points * marginals), count);
+		}
+
+		windowBegin_ = windowBegin;
+		windowEnd_ = windowEnd;
+	}
+
+	integer SlidingNeighbors::points() const
+	{
+		return (trackEnd_ - trackBegin_) * jointPointSet_->trials();
+	}
+
+	dreal SlidingNeighbors::distance(integer i) const
+	{
+		PENSURE_OP(i, >=, 0);
+		PENSURE_OP(i, <, points());
+
+		return neighborDistance(i + (trackBegin_ - storeBegin_) * jointPointSet_->trials());
+	}
+
+	integer SlidingNeighbors::count(
+		integer marginal, integer i) const
+	{
+		PENSURE_OP(i, >=, 0);
+		PENSURE_OP(i, <, points());
+
+		i += (trackBegin_ - storeBegin_) * jointPointSet_->trials();
+		return countSet_[i * marginalSet_->size() + marginal];
+	}
+
+	integer SlidingNeighbors::trackBegin() const
+	{
+		return trackBegin_;
+	}
+
+	integer SlidingNeighbors::trackEnd() const
+	{
+		return trackEnd_;
+	}
+
+	// Private
+
+	dreal SlidingNeighbors::neighborDistance(integer i) const
+	{
+		if (neighborsSet_[i] < kNearest_)
+		{
+			return infinity<dreal>();
+		}
+
+		return neighborSet_[i * kNearest_ + kNearest_ - 1].distance;
+	}
+
+	const dreal* SlidingNeighbors::coordinates(
+		const SignalPointSet& pointSet,
+		integer t, integer trial) const
+	{
+		return *(pointSet.sliceBegin(t) + trial);
+	}
+
+	bool SlidingNeighbors::updatePoint(
+		integer i,
+		const std::vector<const dreal*>& leftPointSet,
+		const std::vector<integer>& enteredSet)
+	{
+		integer trials = jointPointSet_->trials();
+		integer t = storeBegin_ + i / trials;
+		integer trial = i % trials;
+
+		const dreal* query = coordinates(*jointPointSet_, t, trial);
+		const Neighbor* neighborBegin = neighborSet_.data() + i * kNearest_;
+		const Neighbor* neighborEnd = neighborBegin + neighborsSet_[i];
+		dreal oldDistance = neighborDistance(i);
+
+		// If one of the nearest neighbors left the time-window,
+		// the replacing neighbor can be anywhere in the window.
+		// The range counts can still be updated incrementally
+		// if the k:th neighbor distance stays the same.
+
+		bool lost = std::any_of(neighborBegin, neighborEnd,
+			[&](const Neighbor& neighbor) 
+			{
+				return std::binary_search(
+					leftPointSet.begin(), leftPointSet.end(), neighbor.point);
+			});
+		if (lost)
+		{
+			searchPoint(i);
+			return neighborDistance(i) != oldDistance;
+		}
+
+		// The entering points can only bring the neighbors
+		// closer.
+
+		integer dimension = jointPointSet_->dimension();
+		for (integer s : enteredSet)
+		{
+			for (integer j = 0;j < trials;++j)
+			{
+				const dreal* point = coordinates(*jointPointSet_, s, j);
+				offer(i, storedDistance(query, point, dimension), point);
+			}
+		}
+
+		return neighborDistance(i) != oldDistance;
+	}
+
+	void SlidingNeighbors::updateCount(
+		integer i, integer marginal,
+		const std::vector<integer>& leftSet,
+		const std::vector<integer>& enteredSet)
+	{
+		// The search radius did not change; account for
+		// the changed slices in the range count. The distances
+		// must agree with those of the counts exactly, or the
+		// counts would drift.
+
+		integer trials = jointPointSet_->trials();
+		integer t = storeBegin_ + i / trials;
+		integer trial = i % trials;
+
+		const SignalPointSet& pointSet = (*marginalSet_)[marginal];
+		const dreal* query = coordinates(pointSet, t, trial);
+		integer dimension = pointSet.dimension();
+		dreal maxDistance = neighborDistance(i);
+		integer& k = countSet_[i * marginalSet_->size() + marginal];
+
+		for (integer s : leftSet)
+		{
+			for (integer j = 0;j < trials;++j)
+			{
+				if (storedDistance(query,
+					coordinates(pointSet, s, j), dimension) < maxDistance)
+				{
+					--k;
+				}
+			}
+		}
+
+		for (integer s : enteredSet)
+		{
+			for (integer j = 0;j < trials;++j)
+			{
+				if (storedDistance(query,
+					coordinates(pointSet, s, j), dimension) < maxDistance)
+				{
+					++k;
+				}
+			}
+		}
+	}
+
+	void SlidingNeighbors::searchPoint(integer i)
+	{
+		integer trials = jointPointSet_->trials();
+		integer t = storeBegin_ + i / trials;
+		integer trial = i % trials;
+
+		const dreal* query = coordinates(*jointPointSet_, t, trial);
+
+		neighborsSet_[i] = 0;
+
+		jointPointSet_->searchNearest(
+			query, kNearest_, query,
+			[&](dreal distance, const dreal* point)
+			{
+				offer(i, distance, point);
+			},
+			maxRelativeError_);
+	}
+
+	void SlidingNeighbors::countPoint(
+		integer i, integer marginal)
+	{
+		integer trials = jointPointSet_->trials();
+		integer t = storeBegin_ + i / trials;
+		integer trial = i % trials;
+
+		const SignalPointSet& pointSet = (*marginalSet_)[marginal];
+
+		countSet_[i * marginalSet_->size() + marginal] = pointSet.countRange(
+			coordinates(pointSet, t, trial),
+			neighborDistance(i));
+	}
+
+	void SlidingNeighbors::offer(
+		integer i, dreal distance, const dreal* point)
+	{
+		Neighbor* neighborBegin = neighborSet_.data() + i * kNearest_;
+		integer& neighbors = neighborsSet_[i];
+
+		if (neighbors == kNearest_)
+		{
+			if (distance >= neighborBegin[kNearest_ - 1].distance)
+			{
+				return;
+			}
+			--neighbors;
+		}
+
+		// Insert in ascending order of distance.
+
+		integer j = neighbors;
+		while (j > 0 && neighborBegin[j - 1].distance > distance)
+		{
+			neighborBegin[j] = neighborBegin[j - 1];
+			--j;
+		}
+		neighborBegin[j] = Neighbor{distance, point};
+		++neighbors;
+	}
+
+}
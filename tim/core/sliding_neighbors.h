@@ -0,0 +1,234 @@
+// Description: Sliding-window nearest neighbors
+// Detail: Incrementally maintained k-nn distances and marginal range counts
+// Documentation: sliding_neighbors.txt
+
+#ifndef TIM_SLIDING_NEIGHBORS_H
+#define TIM_SLIDING_NEIGHBORS_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/signalpointset.h"
+
+#include <vector>
+
+namespace Tim
+{
+
+	//! Incrementally maintained nearest neighbors in a time-window.
+	/*!
+	A SlidingNeighbors object provides, for the points of a 
+	joint SignalPointSet whose time instants lie in a given
+	_tracked interval_, the k nearest neighbors in the joint 
+	space (maximum norm), and for each marginal point set the 
+	number of points inside the open maximum-norm ball whose 
+	radius is the distance to the k:th neighbor. These are 
+	exactly the quantities needed by the entropy combination 
+	estimator.
+
+	The neighbors and counts are stored for the _stored 
+	interval_, which is either the whole time-window or the
+	tracked interval; see TrackRatio. When the time-window is 
+	moved by one time instant, only one time slice enters and 
+	one time slice leaves. Only the stored points whose 
+	neighborhoods these slices affect are then updated. A full 
+	search is done only for points which enter the stored 
+	interval, and for points which lose one of their k nearest 
+	neighbors. With many trials, the incremental updates cost 
+	more than the searches; all of the stored points are then
+	searched from scratch.
+	*/
+	class TIM SlidingNeighbors
+	{
+	public:
+		//! Constructs an empty tracker.
+		/*!
+		Preconditions:
+		kNearest > 0
+		maxRelativeError >= 0
+		Each marginal point set has the same sample range
+		and trials as the joint point set.
+
+		The point sets must outlive this object. Their
+		time-windows are set by the caller, who then calls
+		update() to synchronize.
+
+		The incremental updates measure the distances from 
+		the coordinates rounded to sreal, as the search 
+		structures of the layouts other than Pointer do. 
+		With single-precision search, the point sets should
+		therefore not use the Pointer layout.
+
+		maxRelativeError:
+		The allowed relative error of the searches from 
+		scratch; see SignalPointSet::searchNearest(). The 
+		incremental updates only replace neighbors by closer 
+		ones, so that the i:th neighbor stays within 
+		1 + maxRelativeError times the exact i:th distance.
+		*/
+		SlidingNeighbors(
+			const SignalPointSet& jointPointSet,
+			const std::vector<SignalPointSet>& marginalSet,
+			integer kNearest,
+			dreal maxRelativeError = 0);
+
+		SlidingNeighbors(const SlidingNeighbors&) = delete;
+		SlidingNeighbors& operator=(const SlidingNeighbors&) = delete;
+
+		//! Synchronizes with the current time-window.
+		/*!
+		Preconditions:
+		The joint and marginal point sets have the same time-window.
+		jointPointSet.windowBegin() <= trackBegin
+		trackBegin <= trackEnd
+		trackEnd <= jointPointSet.windowEnd()
+
+		The tracked interval is set to [trackBegin, trackEnd[.
+		If at most 1 / TrackRatio of the time-window lies 
+		outside the tracked interval, the whole time-window 
+		is stored, so that the points are retained across the 
+		updates until they leave the time-window. Otherwise 
+		only the tracked interval is stored.
+		*/
+		void update(integer trackBegin, integer trackEnd);
+
+		//! Returns the number of tracked points.
+		integer points() const;
+
+		//! Returns the distance to the k:th nearest neighbor.
+		/*!
+		Preconditions:
+		0 <= i < points()
+
+		The tracked points are ordered by time, and then by
+		trial, as in SignalPointSet. If there are less than k
+		other points in the time-window, infinity is returned.
+		*/
+		dreal distance(integer i) const;
+
+		//! Returns the range count of a tracked point in a marginal.
+		/*!
+		Preconditions:
+		0 <= marginal < marginalSet.size()
+		0 <= i < points()
+
+		The count includes the point itself, unless the
+		k:th neighbor distance is zero.
+		*/
+		integer count(integer marginal, integer i) const;
+
+		//! Returns the first time instant of the tracked interval.
+		integer trackBegin() const;
+
+		//! Returns the one-past-last time instant of the tracked interval.
+		integer trackEnd() const;
+
+		//! The inverse of the untracked part of the time-window up to which the time-window is stored.
+		/*!
+		A stored point is updated at every time instant, 
+		whether or not it is tracked. A point which enters 
+		the tracked interval from an untracked part of a 
+		stored time-window needs no search, but the updates
+		of the untracked points cost more than these searches
+		unless the untracked part is small; see 
+		sliding_neighbors.txt.
+		*/
+		static constexpr integer TrackRatio = 8;
+
+	private:
+		struct Neighbor
+		{
+			dreal distance;
+			const dreal* point;
+		};
+
+		// Returns the distance to the k:th nearest neighbor
+		// of a stored point.
+		dreal neighborDistance(integer i) const;
+
+		// Returns the coordinates of a point.
+		const dreal* coordinates(
+			const SignalPointSet& pointSet,
+			integer t, integer trial) const;
+
+		// Updates the neighbors of a retained point against the 
+		// changed slices. Returns whether the k:th neighbor 
+		// distance changed.
+		bool updatePoint(
+			integer i,
+			const std::vector<const dreal*>& leftPointSet,
+			const std::vector<integer>& enteredSet);
+
+		// Updates a retained range count against the changed slices.
+		void updateCount(
+			integer i, integer marginal,
+			const std::vector<integer>& leftSet,
+			const std::vector<integer>& enteredSet);
+
+		// Finds the nearest neighbors of a point from scratch.
+		void searchPoint(integer i);
+
+		// Counts the marginal neighbors of a point from scratch.
+		void countPoint(integer i, integer marginal);
+
+		// Offers a neighbor candidate to a point.
+		void offer(integer i, dreal distance, const dreal* point);
+
+		/*
+		jointPointSet_, marginalSet_:
+		The point sets whose time-windows are tracked.
+
+		kNearest_:
+		The k:th nearest neighbor to track.
+
+		maxRelativeError_:
+		The allowed relative error of the searches.
+
+		trackBegin_, trackEnd_:
+		The tracked time interval [trackBegin_, trackEnd_[.
+
+		storeBegin_, storeEnd_:
+		The stored time interval [storeBegin_, storeEnd_[.
+
+		windowBegin_, windowEnd_:
+		The time-window at the previous update.
+
+		neighborSet_:
+		For stored point i, the nearest neighbors in
+		ascending order of distance are stored in
+		[i * kNearest_, i * kNearest_ + neighborsSet_[i][.
+		The stored points are indexed from storeBegin_.
+
+		countSet_:
+		For stored point i, the count in marginal j is
+		stored at countSet_[i * marginals + j].
+
+		recountSet_:
+		For stored point i, whether the range counts need
+		to be computed from scratch in the current update.
+
+		oldNeighborSet_, oldNeighborsSet_, oldCountSet_:
+		The state of the previous update, kept to avoid 
+		reallocating the state at each update.
+		*/
+
+		const SignalPointSet* jointPointSet_;
+		const std::vector<SignalPointSet>* marginalSet_;
+		integer kNearest_;
+		dreal maxRelativeError_;
+		integer trackBegin_;
+		integer trackEnd_;
+		integer storeBegin_;
+		integer storeEnd_;
+		integer windowBegin_;
+		integer windowEnd_;
+		std::vector<Neighbor> neighborSet_;
+		std::vector<integer> neighborsSet_;
+		std::vector<integer> countSet_;
+		std::vector<char> recountSet_;
+		std::vector<Neighbor> oldNeighborSet_;
+		std::vector<integer> oldNeighborsSet_;
+		std::vector<integer> oldCountSet_;
+	};
+
+}
+
+#endif
@@ -0,0 +1,364 @@
+#include "tim/core/sorted_line.h"
+#include "tim/core/instrumentation.h"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace Tim
+{
+
+	SortedLine::SortedLine()
+		: valueSet_()
+		, pointSet_()
+		, indexSet_()
+		, positionSet_()
+		, visibleSet_()
+		, fenwickSet_()
+		, visible_(0)
+		, instrumentation_(nullptr)
+	{
+	}
+
+	SortedLine::SortedLine(
+		const std::vector<const dreal*>& pointSet)
+		: valueSet_()
+		, pointSet_()
+		, indexSet_()
+		, positionSet_()
+		, visibleSet_()
+		, fenwickSet_()
+		, visible_(0)
+		, instrumentation_(nullptr)
+	{
+		integer points = pointSet.size();
+
+		indexSet_.resize(points);
+		std::iota(indexSet_.begin(), indexSet_.end(), (integer)0);
+
+		// Ties are broken by the index, so that the order 
+		// is the same as with a stable sort.
+		tbb::parallel_sort(indexSet_.begin(), indexSet_.end(),
+			[&](integer left, integer right)
+			{
+				return pointSet[left][0] < pointSet[right][0] ||
+					(pointSet[left][0] == pointSet[right][0] && left < right);
+			});
+
+		valueSet_.resize(points);
+		pointSet_.resize(points);
+		positionSet_.resize(points);
+		for (integer position = 0;position < points;++position)
+		{
+			integer i = indexSet_[position];
+			valueSet_[position] = (sreal)pointSet[i][0];
+			pointSet_[position] = pointSet[i];
+			positionSet_[i] = position;
+		}
+
+		visibleSet_.assign(points, true);
+		fenwickSet_.resize(points);
+		rebuild();
+	}
+
+	SortedLine::SortedLine(SortedLine&& that)
+		: SortedLine()
+	{
+		swap(that);
+	}
+
+	SortedLine& SortedLine::operator=(SortedLine that)
+	{
+		swap(that);
+		return *this;
+	}
+
+	void SortedLine::swap(SortedLine& that)
+	{
+		valueSet_.swap(that.valueSet_);
+		pointSet_.swap(that.pointSet_);
+		indexSet_.swap(that.indexSet_);
+		positionSet_.swap(that.positionSet_);
+		visibleSet_.swap(that.visibleSet_);
+		fenwickSet_.swap(that.fenwickSet_);
+		std::swap(visible_, that.visible_);
+	}
+
+	void SortedLine::setInstrumentation(Instrumentation* instrumentation)
+	{
+		instrumentation_ = instrumentation;
+	}
+
+	integer SortedLine::points() const
+	{
+		return visible_;
+	}
+
+	integer SortedLine::size() const
+	{
+		return valueSet_.size();
+	}
+
+	void SortedLine::hide(integer i)
+	{
+		PENSURE_OP(i, >=, 0);
+		PENSURE_OP(i, <, size());
+
+		integer position = positionSet_[i];
+		if (!visibleSet_[position])
+		{
+			return;
+		}
+
+		visibleSet_[position] = false;
+		update(position, -1);
+	}
+
+	void SortedLine::show(integer i)
+	{
+		PENSURE_OP(i, >=, 0);
+		PENSURE_OP(i, <, size());
+
+		integer position = positionSet_[i];
+		if (visibleSet_[position])
+		{
+			return;
+		}
+
+		visibleSet_[position] = true;
+		update(position, 1);
+	}
+
+	void SortedLine::hide()
+	{
+		std::fill(visibleSet_.begin(), visibleSet_.end(), false);
+		rebuild();
+	}
+
+	void SortedLine::show()
+	{
+		std::fill(visibleSet_.begin(), visibleSet_.end(), true);
+		rebuild();
+	}
+
+	void SortedLine::hide(integer begin, integer end)
+	{
+		setVisible(begin, end, false);
+	}
+
+	void SortedLine::show(integer begin, integer end)
+	{
+		setVisible(begin, end, true);
+	}
+
+	integer SortedLine::countRange(
+		const dreal* query,
+		dreal maxDistance) const
+	{
+		PENSURE_OP(maxDistance, >=, 0);
+
+		dreal q = query[0];
+
+		// The distances are computed exactly as in the
+		// other point sets, so that the counts agree with
+		// them even under rounding. The distance to the 
+		// query decreases up to the query, and increases 
+		// after it.
+
+		auto begin = valueSet_.begin();
+		auto middle = begin + lowerBound(q);
+
+		// Each point compared with the query counts as 
+		// a visited node.
+		integer compared = 0;
+		
+		integer first = std::partition_point(begin, middle,
+			[&](dreal x) {++compared; return q - x >= maxDistance; }) - begin;
+		integer last = std::partition_point(middle, valueSet_.end(),
+			[&](dreal x) {++compared; return x - q < maxDistance; }) - begin;
+
+		TIM_COUNT(instrumentation_, nodesVisited, compared);
+		TIM_COUNT(instrumentation_, distances, compared);
+
+		return rank(last) - rank(first);
+	}
+
+	dreal SortedLine::searchNearest(
+		const dreal* query,
+		integer kNearest,
+		const dreal* exclude) const
+	{
+		return searchPositions(query, kNearest, exclude,
+			[](dreal, integer) {});
+	}
+
+	void SortedLine::searchAllNearest(
+		const std::vector<const dreal*>& querySet,
+		integer kNearest,
+		bool excludeQuery,
+		dreal* distanceSet,
+		integer* neighborSet) const
+	{
+		ENSURE_OP(kNearest, >, 0);
+
+		integer queries = querySet.size();
+
+		if (neighborSet)
+		{
+			std::fill(neighborSet, neighborSet + queries * kNearest, (integer)-1);
+		}
+
+		using Block = tbb::blocked_range<integer>;
+
+		tbb::parallel_for(Block(0, queries),
+			[&](const Block& block)
+			{
+				for (integer i = block.begin();i < block.end();++i)
+				{
+					integer* neighbor = neighborSet ? 
+						neighborSet + i * kNearest : nullptr;
+
+					distanceSet[i] = searchPositions(
+						querySet[i], kNearest, 
+						excludeQuery ? querySet[i] : nullptr,
+						[&](dreal, integer position)
+						{
+							if (neighbor)
+							{
+								*neighbor = indexSet_[position];
+								++neighbor;
+							}
+						});
+				}
+			});
+	}
+
+	integer SortedLine::rank(integer position) const
+	{
+		if (visible_ == size())
+		{
+			return position;
+		}
+
+		integer result = 0;
+		for (integer i = position;i > 0;i -= i & -i)
+		{
+			result += fenwickSet_[i - 1];
+		}
+
+		return result;
+	}
+
+	integer SortedLine::select(integer r) const
+	{
+		if (visible_ == size())
+		{
+			return r;
+		}
+
+		// Descend the implicit tree, skipping over
+		// the nodes whose counts fit in the rank.
+
+		integer n = size();
+		integer step = 1;
+		while (2 * step <= n)
+		{
+			step *= 2;
+		}
+
+		integer position = 0;
+		for (;step > 0;step /= 2)
+		{
+			integer next = position + step;
+			if (next <= n && fenwickSet_[next - 1] <= r)
+			{
+				position = next;
+				r -= fenwickSet_[next - 1];
+			}
+		}
+
+		return position;
+	}
+
+	void SortedLine::update(integer position, integer delta)
+	{
+		integer n = size();
+		for (integer i = position + 1;i <= n;i += i & -i)
+		{
+			fenwickSet_[i - 1] += delta;
+		}
+
+		visible_ += delta;
+	}
+
+	void SortedLine::rebuild()
+	{
+		integer n = size();
+		
+		visible_ = 0;
+		for (integer i = 0;i < n;++i)
+		{
+			fenwickSet_[i] = visibleSet_[i] ? 1 : 0;
+			visible_ += fenwickSet_[i];
+		}
+
+		for (integer i = 1;i <= n;++i)
+		{
+			integer parent = i + (i & -i);
+			if (parent <= n)
+			{
+				fenwickSet_[parent - 1] += fenwickSet_[i - 1];
+			}
+		}
+	}
+
+	void SortedLine::setVisible(integer begin, integer end, bool visible)
+	{
+		PENSURE_OP(begin, >=, 0);
+		PENSURE_OP(begin, <=, end);
+		PENSURE_OP(end, <=, size());
+
+		// An update of the Fenwick tree costs about log2(n)
+		// steps, a rebuild about n steps.
+
+		integer n = size();
+		integer depth = 1;
+		while (((integer)1 << depth) < n)
+		{
+			++depth;
+		}
+
+		if ((end - begin) * depth < n)
+		{
+			for (integer i = begin;i < end;++i)
+			{
+				if (visible)
+				{
+					show(i);
+				}
+				else
+				{
+					hide(i);
+				}
+			}
+			return;
+		}
+
+		for (integer i = begin;i < end;++i)
+		{
+			visibleSet_[positionSet_[i]] = visible;
+		}
+
+		rebuild();
+	}
+
+	integer SortedLine::lowerBound(dreal query) const
+	{
+		return std::lower_bound(
+			valueSet_.begin(), valueSet_.end(), query) - valueSet_.begin();
+	}
+
+}
@@ -0,0 +1,223 @@
+// Description: SortedLine class
+// Detail: A sorted array of points on the real line, with order statistics
+// Documentation: sorted_line.txt
+
+#ifndef TIM_SORTED_LINE_H
+#define TIM_SORTED_LINE_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/instrumentation.h"
+
+#include <vector>
+
+namespace Tim
+{
+
+	//! A sorted array of points on the real line
+	/*!
+	This is the one-dimensional counterpart of PackedKdTree,
+	with the same interface. The coordinates of the points
+	are copied into a sorted array, so that range counting
+	is done with two binary searches, and nearest neighbor
+	searching by walking outwards from the query.
+
+	The points can be hidden and shown individually. The
+	visibility is tracked by a Fenwick tree over the sorted
+	positions, which gives the number of visible points before
+	a given position, and the position of the visible point
+	of a given rank, both in O(log n) time. When all points
+	are visible, these reduce to identities.
+	*/
+	class TIM SortedLine
+	{
+	public:
+		//! Constructs an empty set.
+		SortedLine();
+
+		//! Constructs a set over the given points.
+		/*!
+		pointSet:
+		Pointers to the coordinates of the points; only the
+		first coordinate is used. Each pointer identifies its
+		point; the queries report the neighbors by these
+		pointers. The i:th point is referred to by the index i
+		in hide() and show().
+
+		Initially all points are visible.
+		*/
+		explicit SortedLine(
+			const std::vector<const dreal*>& pointSet);
+
+		SortedLine(const SortedLine& that) = default;
+		SortedLine(SortedLine&& that);
+		SortedLine& operator=(SortedLine that);
+
+		//! Swaps two sets.
+		void swap(SortedLine& that);
+
+		//! Sets the instrumentation which counts the searches.
+		/*!
+		The instrumentation can be null, which counts nothing.
+		*/
+		void setInstrumentation(Instrumentation* instrumentation);
+
+		//! Returns the number of visible points.
+		integer points() const;
+
+		//! Returns the number of points, visible or hidden.
+		integer size() const;
+
+		//! Hides the i:th point.
+		void hide(integer i);
+
+		//! Shows the i:th point.
+		void show(integer i);
+
+		//! Hides all points.
+		void hide();
+
+		//! Shows all points.
+		void show();
+
+		//! Hides the points [begin, end[.
+		/*!
+		Preconditions:
+		0 <= begin <= end <= size()
+
+		This is as hiding each point, except that the 
+		Fenwick tree is rebuilt instead, when that is 
+		cheaper than updating it for each point.
+		*/
+		void hide(integer begin, integer end);
+
+		//! Shows the points [begin, end[.
+		/*!
+		Preconditions:
+		0 <= begin <= end <= size()
+
+		See hide(begin, end).
+		*/
+		void show(integer begin, integer end);
+
+		//! Counts the visible points inside an open interval.
+		/*!
+		Preconditions:
+		maxDistance >= 0
+
+		Returns:
+		The number of visible points p for which
+		|p - query[0]| < maxDistance.
+		*/
+		integer countRange(
+			const dreal* query,
+			dreal maxDistance) const;
+
+		//! Finds the k nearest visible points.
+		/*!
+		Preconditions:
+		kNearest > 0
+
+		See PackedKdTree::searchNearest().
+		*/
+		template <typename Report>
+		dreal searchNearest(
+			const dreal* query,
+			integer kNearest,
+			const dreal* exclude,
+			Report&& report) const;
+
+		//! Finds the distance to the k:th nearest visible point.
+		dreal searchNearest(
+			const dreal* query,
+			integer kNearest,
+			const dreal* exclude = nullptr) const;
+
+		//! Finds the k nearest visible points of a set of queries.
+		/*!
+		Preconditions:
+		kNearest > 0
+
+		See PackedKdTree::searchAllNearest(). The queries
+		are searched in parallel.
+		*/
+		void searchAllNearest(
+			const std::vector<const dreal*>& querySet,
+			integer kNearest,
+			bool excludeQuery,
+			dreal* distanceSet,
+			integer* neighborSet = nullptr) const;
+
+	private:
+		// Finds the k nearest visible points, and reports
+		// them by their positions in ascending order of distance.
+		template <typename Report>
+		dreal searchPositions(
+			const dreal* query,
+			integer kNearest,
+			const dreal* exclude,
+			Report&& report) const;
+
+		// Returns the number of visible points in
+		// the positions [0, position[.
+		integer rank(integer position) const;
+
+		// Returns the position of the visible point
+		// which has r visible points before it.
+		integer select(integer r) const;
+
+		// Adds delta to the visibility count of a position.
+		void update(integer position, integer delta);
+
+		// Rebuilds the Fenwick tree from visibleSet_.
+		void rebuild();
+
+		// Sets the visibility of the points [begin, end[.
+		void setVisible(integer begin, integer end, bool visible);
+
+		// Returns the first position whose value is
+		// not less than the query.
+		integer lowerBound(dreal query) const;
+
+		/*
+		valueSet_:
+		The coordinates of the points in ascending order,
+		as sreal.
+
+		pointSet_:
+		The identifying pointer of the point at each position.
+
+		indexSet_:
+		The index, in construction, of the point at each position.
+
+		positionSet_:
+		The position of the i:th point in ascending order.
+
+		visibleSet_:
+		Whether the point at each position is visible.
+
+		fenwickSet_:
+		A Fenwick tree over visibleSet_; fenwickSet_[i - 1]
+		stores the sum over positions ]i - lowbit(i), i].
+
+		visible_:
+		The number of visible points.
+
+		instrumentation_:
+		The instrumentation which counts the searches, or null.
+		*/
+
+		std::vector<sreal> valueSet_;
+		std::vector<const dreal*> pointSet_;
+		std::vector<integer> indexSet_;
+		std::vector<integer> positionSet_;
+		std::vector<char> visibleSet_;
+		std::vector<integer> fenwickSet_;
+		integer visible_;
+		Instrumentation* instrumentation_;
+	};
+
+}
+
+#include "tim/core/sorted_line.hpp"
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef TIM_SORTED_LINE_HPP
+#define TIM_SORTED_LINE_HPP
+
+#include "tim/core/sorted_line.h"
+#include "tim/core/instrumentation.h"
+
+namespace Tim
+{
+
+	template <typename Report>
+	dreal SortedLine::searchNearest(
+		const dreal* query,
+		integer kNearest,
+		const dreal* exclude,
+		Report&& report) const
+	{
+		return searchPositions(query, kNearest, exclude,
+			[&](dreal distance, integer position)
+			{
+				report(distance, pointSet_[position]);
+			});
+	}
+
+	template <typename Report>
+	dreal SortedLine::searchPositions(
+		const dreal* query,
+		integer kNearest,
+		const dreal* exclude,
+		Report&& report) const
+	{
+		PENSURE_OP(kNearest, >, 0);
+
+		dreal q = query[0];
+
+		// The visible points are walked outwards from 
+		// the query by their ranks; the left cursor is 
+		// the rank of the nearest unvisited point on the 
+		// left, and the right cursor that on the right.
+
+		integer right = rank(lowerBound(q));
+		integer left = right - 1;
+
+		integer leftPosition = (left >= 0) ? select(left) : -1;
+		integer rightPosition = (right < visible_) ? select(right) : -1;
+
+		integer neighbors = 0;
+		dreal distance = infinity<dreal>();
+		while (neighbors < kNearest && 
+			(leftPosition >= 0 || rightPosition >= 0))
+		{
+			integer position = 0;
+			if (rightPosition < 0 ||
+				(leftPosition >= 0 &&
+				q - valueSet_[leftPosition] <= valueSet_[rightPosition] - q))
+			{
+				position = leftPosition;
+				distance = q - valueSet_[position];
+				--left;
+				leftPosition = (left >= 0) ? select(left) : -1;
+			}
+			else
+			{
+				position = rightPosition;
+				distance = valueSet_[position] - q;
+				++right;
+				rightPosition = (right < visible_) ? select(right) : -1;
+			}
+
+			if (pointSet_[position] == exclude)
+			{
+				continue;
+			}
+
+			report(distance, position);
+			++neighbors;
+		}
+
+		// The cursors have walked over the ranks ]left, right[;
+		// each point walked over counts as a visited node.
+		TIM_COUNT(instrumentation_, nodesVisited, right - left - 1);
+		TIM_COUNT(instrumentation_, distances, right - left - 1);
+
+		if (neighbors < kNearest)
+		{
+			return infinity<dreal>();
+		}
+
+		return distance;
+	}
+
+}
+
+#endif
@@ -0,0 +1,517 @@
+#include "tim/core/streaming_entropy_combination.h"
+#include "tim/core/entropy_combination.h"
+#include "tim/core/leaf_scan.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Tim
+{
+
+	StreamingEntropyCombination::StreamingEntropyCombination(
+		const std::vector<integer>& dimensionSet,
+		integer trials,
+		const std::vector<Integer3>& rangeSet,
+		integer timeWindowRadius,
+		const std::vector<integer>& lagSet,
+		integer kNearest,
+		const std::vector<dreal>& filter)
+		: dimensionSet_(dimensionSet)
+		, offsetSet_()
+		, trials_(trials)
+		, rangeSet_(rangeSet)
+		, timeWindowRadius_(timeWindowRadius)
+		, kNearest_(kNearest)
+		, filter_(filter)
+		, lagSet_(lagSet)
+		, minLag_(0)
+		, maxLag_(0)
+		, historySet_()
+		, samples_(0)
+		, tFirst_(0)
+		, tEnd_(0)
+		, tNext_(0)
+		, blockSize_(1)
+		, blockSet_()
+		, freeSet_()
+		, estimate_((dreal)Nan())
+		, time_(-1)
+		, finished_(false)
+	{
+		integer signals = dimensionSet.size();
+
+		ENSURE_OP(trials, >, 0);
+		ENSURE_OP(signals, >, 0);
+		ENSURE(!rangeSet.empty());
+		ENSURE_OP(timeWindowRadius, >=, 0);
+		ENSURE(lagSet.empty() || lagSet.size() == signals);
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE(odd(filter.size()));
+
+		offsetSet_.reserve(signals + 1);
+		offsetSet_.push_back(0);
+		for (integer i = 0;i < signals;++i)
+		{
+			ENSURE_OP(dimensionSet[i], >, 0);
+			offsetSet_.push_back(offsetSet_.back() + dimensionSet[i]);
+		}
+
+		for (const Integer3& range : rangeSet)
+		{
+			ENSURE_OP(range[0], >=, 0);
+			ENSURE_OP(range[0], <, range[1]);
+			ENSURE_OP(range[1], <=, signals);
+		}
+
+		if (lagSet_.empty())
+		{
+			lagSet_.assign(signals, 0);
+		}
+
+		minLag_ = *std::min_element(lagSet_.begin(), lagSet_.end());
+		maxLag_ = *std::max_element(lagSet_.begin(), lagSet_.end());
+
+		// The joint signal is defined from the time instant
+		// at which the most lagged signal is defined.
+		tFirst_ = std::max(maxLag_, (integer)0);
+		tEnd_ = tFirst_;
+		tNext_ = tFirst_;
+
+		historySet_.resize(
+			(maxLag_ - minLag_ + 1) * trials_ * dimension());
+
+		// A query scans the partial block by brute force, and
+		// searches the kd-tree of each full block. The square
+		// root of the width of the time-window balances these.
+		integer windowWidth = 2 * timeWindowRadius_ + 1;
+		blockSize_ = std::max(
+			(integer)std::sqrt((dreal)windowWidth), (integer)1);
+	}
+
+	bool StreamingEntropyCombination::push(const dreal* sampleSet)
+	{
+		ENSURE(!finished_);
+
+		integer sliceSize = trials_ * dimension();
+		integer history = maxLag_ - minLag_ + 1;
+
+		std::copy_n(
+			sampleSet, sliceSize,
+			historySet_.begin() + (samples_ % history) * sliceSize);
+		++samples_;
+
+		// The joint time instant whose last missing sample
+		// has now been pushed.
+		integer t = samples_ - 1 + minLag_;
+		if (t < tFirst_)
+		{
+			return false;
+		}
+
+		appendSlice(t);
+		tEnd_ = t + 1;
+
+		integer tEstimate = t - timeWindowRadius_;
+		if (tEstimate < tNext_)
+		{
+			return false;
+		}
+
+		integer windowBegin = std::max(tEstimate - timeWindowRadius_, tFirst_);
+		dropBefore(windowBegin);
+
+		estimate_ = estimateAt(tEstimate, windowBegin, tEnd_);
+		time_ = tEstimate;
+		tNext_ = tEstimate + 1;
+
+		return true;
+	}
+
+	SignalData StreamingEntropyCombination::finish()
+	{
+		ENSURE(!finished_);
+
+		finished_ = true;
+
+		if (tNext_ >= tEnd_)
+		{
+			return SignalData();
+		}
+
+		SignalData result(1, tEnd_ - tNext_, tNext_);
+		for (integer t = tNext_;t < tEnd_;++t)
+		{
+			integer windowBegin = std::max(t - timeWindowRadius_, tFirst_);
+			dropBefore(windowBegin);
+
+			result.data()(t - tNext_) = estimateAt(t, windowBegin, tEnd_);
+		}
+		tNext_ = tEnd_;
+
+		return result;
+	}
+
+	bool StreamingEntropyCombination::finished() const
+	{
+		return finished_;
+	}
+
+	dreal StreamingEntropyCombination::estimate() const
+	{
+		return estimate_;
+	}
+
+	integer StreamingEntropyCombination::time() const
+	{
+		return time_;
+	}
+
+	integer StreamingEntropyCombination::samples() const
+	{
+		return samples_;
+	}
+
+	integer StreamingEntropyCombination::dimension() const
+	{
+		return offsetSet_.back();
+	}
+
+	integer StreamingEntropyCombination::offset(integer i) const
+	{
+		PENSURE_OP(i, >=, 0);
+		PENSURE_OP(i, <, signals());
+
+		return offsetSet_[i];
+	}
+
+	integer StreamingEntropyCombination::signals() const
+	{
+		return dimensionSet_.size();
+	}
+
+	integer StreamingEntropyCombination::trials() const
+	{
+		return trials_;
+	}
+
+	integer StreamingEntropyCombination::blockSize() const
+	{
+		return blockSize_;
+	}
+
+	integer StreamingEntropyCombination::keptSamples() const
+	{
+		integer kept = 0;
+		for (const Block& block : blockSet_)
+		{
+			kept += block.slices;
+		}
+		return kept;
+	}
+
+	void StreamingEntropyCombination::appendSlice(integer t)
+	{
+		integer n = dimension();
+		integer sliceSize = trials_ * n;
+		integer history = maxLag_ - minLag_ + 1;
+
+		if (blockSet_.empty() || blockSet_.back().slices == blockSize_)
+		{
+			Block block;
+			block.tBegin = t;
+			block.slices = 0;
+			block.hidden = 0;
+
+			// Reuse the storage of a dropped block. The storage
+			// is never resized afterwards, so that the kd-trees
+			// can identify the points by their addresses.
+			if (!freeSet_.empty())
+			{
+				block.sampleSet.swap(freeSet_.back());
+				freeSet_.pop_back();
+			}
+			block.sampleSet.resize(blockSize_ * sliceSize);
+
+			blockSet_.push_back(std::move(block));
+		}
+
+		Block& block = blockSet_.back();
+		dreal* slice = block.sampleSet.data() + block.slices * sliceSize;
+
+		// Gather the lagged samples of each signal.
+		integer signals = dimensionSet_.size();
+		for (integer i = 0;i < signals;++i)
+		{
+			integer s = t - lagSet_[i];
+			const dreal* from = historySet_.data() + (s % history) * sliceSize;
+			for (integer j = 0;j < trials_;++j)
+			{
+				std::copy_n(
+					from + j * n + offsetSet_[i],
+					dimensionSet_[i],
+					slice + j * n + offsetSet_[i]);
+			}
+		}
+
+		++block.slices;
+		if (block.slices == blockSize_)
+		{
+			buildBlock(block);
+		}
+	}
+
+	void StreamingEntropyCombination::buildBlock(Block& block) const
+	{
+		integer n = dimension();
+		integer points = block.slices * trials_;
+
+		std::vector<const dreal*> pointSet;
+		pointSet.reserve(points);
+		for (integer i = 0;i < points;++i)
+		{
+			pointSet.push_back(block.sampleSet.data() + i * n);
+		}
+
+		block.jointTree = PackedKdTree(pointSet, n);
+
+		integer marginals = rangeSet_.size();
+		block.marginalTreeSet.clear();
+		block.marginalTreeSet.reserve(marginals);
+
+		std::vector<const dreal*> marginalSet(points);
+		for (const Integer3& range : rangeSet_)
+		{
+			integer begin = offsetSet_[range[0]];
+			integer end = offsetSet_[range[1]];
+			for (integer i = 0;i < points;++i)
+			{
+				marginalSet[i] = pointSet[i] + begin;
+			}
+
+			block.marginalTreeSet.emplace_back(marginalSet, end - begin);
+		}
+
+		if (block.hidden > 0)
+		{
+			block.jointTree.hide(0, block.hidden * trials_);
+			for (PackedKdTree& tree : block.marginalTreeSet)
+			{
+				tree.hide(0, block.hidden * trials_);
+			}
+		}
+	}
+
+	void StreamingEntropyCombination::dropBefore(integer tBegin)
+	{
+		for (Block& block : blockSet_)
+		{
+			if (block.tBegin >= tBegin)
+			{
+				break;
+			}
+
+			integer hidden = std::min(tBegin - block.tBegin, blockSize_);
+			if (hidden <= block.hidden)
+			{
+				continue;
+			}
+
+			if (block.slices == blockSize_)
+			{
+				// Hide the time instants in a single pass
+				// over each kd-tree.
+				block.jointTree.hide(
+					block.hidden * trials_, hidden * trials_);
+				for (PackedKdTree& tree : block.marginalTreeSet)
+				{
+					tree.hide(block.hidden * trials_, hidden * trials_);
+				}
+			}
+
+			block.hidden = hidden;
+		}
+
+		while (!blockSet_.empty() &&
+			blockSet_.front().hidden == blockSize_)
+		{
+			freeSet_.clear();
+			freeSet_.push_back(std::move(blockSet_.front().sampleSet));
+			blockSet_.pop_front();
+		}
+	}
+
+	dreal StreamingEntropyCombination::estimateAt(
+		integer t, integer windowBegin, integer windowEnd) const
+	{
+		integer filterRadius = filter_.size() / 2;
+		integer filterBegin = std::max(t - filterRadius, windowBegin);
+		integer filterEnd = std::min(t + filterRadius + 1, windowEnd);
+
+		// Find the distance to the k:th nearest neighbor
+		// of each point in the filter window.
+
+		std::vector<dreal> distanceSet;
+		distanceSet.reserve((filterEnd - filterBegin) * trials_);
+		for (integer s = filterBegin;s < filterEnd;++s)
+		{
+			for (integer j = 0;j < trials_;++j)
+			{
+				distanceSet.push_back(
+					nearestDistance(point(s, j), windowBegin, windowEnd));
+			}
+		}
+
+		dreal signalWeightSum = 0;
+		for (const Integer3& range : rangeSet_)
+		{
+			signalWeightSum += range[2];
+		}
+
+		dreal estimate = 0;
+		integer marginals = rangeSet_.size();
+		for (integer i = 0;i < marginals;++i)
+		{
+			dreal signalEstimate = 0;
+			dreal weightSum = 0;
+			for (integer s = filterBegin;s < filterEnd;++s)
+			{
+				dreal weight = filter_[s - (t - filterRadius)];
+				for (integer j = 0;j < trials_;++j)
+				{
+					integer k = countRange(
+						point(s, j), i,
+						distanceSet[(s - filterBegin) * trials_ + j],
+						windowBegin, windowEnd);
+
+					// As in temporalEntropyCombination(), a zero
+					// count is possible when the distance to the
+					// k:th neighbor is zero; it is ignored.
+					if (k > 0)
+					{
+						signalEstimate += weight * digamma<dreal>(k);
+						weightSum += weight;
+					}
+				}
+			}
+
+			if (weightSum == 0)
+			{
+				// The estimate is undefined. Unlike in
+				// temporalEntropyCombination(), it can not
+				// be reconstructed from the later estimates.
+				return (dreal)Nan();
+			}
+
+			estimate -= (signalEstimate / weightSum) * rangeSet_[i][2];
+		}
+
+		estimate += digamma<dreal>(kNearest_);
+		estimate += (signalWeightSum - 1) *
+			digamma<dreal>((windowEnd - windowBegin) * trials_);
+
+		return estimate;
+	}
+
+	dreal StreamingEntropyCombination::nearestDistance(
+		const dreal* query,
+		integer windowBegin, integer windowEnd) const
+	{
+		integer n = dimension();
+
+		std::vector<dreal> candidateSet;
+		auto report = [&](dreal distance, const dreal* neighbor)
+		{
+			candidateSet.push_back(distance);
+		};
+
+		for (const Block& block : blockSet_)
+		{
+			if (block.slices == blockSize_)
+			{
+				// The hidden points are those before
+				// the time-window.
+				block.jointTree.searchNearest(
+					query, kNearest_, query, report);
+				continue;
+			}
+
+			integer tBegin = std::max(block.tBegin, windowBegin);
+			integer tEnd = std::min(block.tBegin + block.slices, windowEnd);
+			for (integer s = tBegin;s < tEnd;++s)
+			{
+				for (integer j = 0;j < trials_;++j)
+				{
+					const dreal* other = point(s, j);
+					if (other != query)
+					{
+						candidateSet.push_back(
+							storedDistance(query, other, n));
+					}
+				}
+			}
+		}
+
+		if ((integer)candidateSet.size() < kNearest_)
+		{
+			return infinity<dreal>();
+		}
+
+		std::nth_element(
+			candidateSet.begin(),
+			candidateSet.begin() + (kNearest_ - 1),
+			candidateSet.end());
+
+		return candidateSet[kNearest_ - 1];
+	}
+
+	integer StreamingEntropyCombination::countRange(
+		const dreal* query,
+		integer marginal,
+		dreal maxDistance,
+		integer windowBegin, integer windowEnd) const
+	{
+		const Integer3& range = rangeSet_[marginal];
+		integer begin = offsetSet_[range[0]];
+		integer end = offsetSet_[range[1]];
+
+		integer count = 0;
+		for (const Block& block : blockSet_)
+		{
+			if (block.slices == blockSize_)
+			{
+				count += block.marginalTreeSet[marginal].countRange(
+					query + begin, maxDistance);
+				continue;
+			}
+
+			integer tBegin = std::max(block.tBegin, windowBegin);
+			integer tEnd = std::min(block.tBegin + block.slices, windowEnd);
+			for (integer s = tBegin;s < tEnd;++s)
+			{
+				for (integer j = 0;j < trials_;++j)
+				{
+					if (storedDistance(query + begin,
+						point(s, j) + begin, end - begin) < maxDistance)
+					{
+						++count;
+					}
+				}
+			}
+		}
+
+		return count;
+	}
+
+	const dreal* StreamingEntropyCombination::point(
+		integer t, integer trial) const
+	{
+		// The blocks are consecutive, and all but the
+		// last one are full.
+		const Block& block = blockSet_[
+			(t - blockSet_.front().tBegin) / blockSize_];
+
+		return block.sampleSet.data() +
+			((t - block.tBegin) * trials_ + trial) * dimension();
+	}
+
+}
@@ -0,0 +1,283 @@
+// Description: StreamingEntropyCombination class
+// Detail: Online temporal estimation of entropy combinations with bounded memory
+// Documentation: streaming_entropy_combination.txt
+
+#ifndef TIM_STREAMING_ENTROPY_COMBINATION_H
+#define TIM_STREAMING_ENTROPY_COMBINATION_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/signal.h"
+#include "tim/core/packed_kdtree.h"
+
+#include <deque>
+#include <vector>
+
+namespace Tim
+{
+
+	//! Online temporal estimation of an entropy combination
+	/*!
+	The samples are pushed one time instant at a time, and
+	the temporal estimate at time instant t is given as soon
+	as the samples of time instant t + timeWindowRadius have
+	been pushed. The estimates are those of
+	temporalEntropyCombination() over the signals pushed so
+	far, except that the undefined estimates are left as NaNs,
+	since they can not be reconstructed from the future ones.
+
+	Only the samples of the time-window are kept. They are
+	stored in blocks of consecutive time instants; a full block
+	is indexed by packed kd-trees, one for the joint space and
+	one for each marginal, and the time instants which leave
+	the time-window are hidden from them. A block is dropped
+	as a whole when all of its time instants have left the
+	time-window. The memory use, and the work per time instant,
+	are then proportional to the time-window, and do not grow
+	with the length of the stream.
+
+	The member functions must not be called concurrently.
+	*/
+	class TIM StreamingEntropyCombination
+	{
+	public:
+		//! Constructs an estimator.
+		/*!
+		Preconditions:
+		trials > 0
+		dimensionSet[i] > 0
+		!rangeSet.empty()
+		0 <= rangeSet[i][0] < rangeSet[i][1] <= dimensionSet.size()
+		timeWindowRadius >= 0
+		lagSet.empty() || lagSet.size() == dimensionSet.size()
+		kNearest > 0
+		odd(filter.size())
+
+		dimensionSet:
+		The dimension of each signal.
+
+		trials:
+		The number of trials of each signal.
+
+		rangeSet, timeWindowRadius, kNearest, filter:
+		See temporalEntropyCombination().
+
+		lagSet:
+		The lag of each signal, as in temporalEntropyCombination().
+		The joint point at time instant t contains the sample of
+		the i:th signal at time instant t - lagSet[i]. Empty means
+		zero lags.
+		*/
+		StreamingEntropyCombination(
+			const std::vector<integer>& dimensionSet,
+			integer trials,
+			const std::vector<Integer3>& rangeSet,
+			integer timeWindowRadius,
+			const std::vector<integer>& lagSet = std::vector<integer>(),
+			integer kNearest = 1,
+			const std::vector<dreal>& filter = std::vector<dreal>(1, 1));
+
+		StreamingEntropyCombination(const StreamingEntropyCombination&) = delete;
+		StreamingEntropyCombination& operator=(const StreamingEntropyCombination&) = delete;
+
+		//! Appends the samples of the next time instant.
+		/*!
+		Preconditions:
+		!finished()
+
+		sampleSet:
+		The samples of all the signals of all the trials at the
+		next time instant. The sample of the i:th signal of the
+		j:th trial begins at sampleSet[j * dimension() + offset(i)].
+
+		Returns:
+		Whether an estimate was given; it is then returned by
+		estimate(), and its time instant by time().
+		*/
+		bool push(const dreal* sampleSet);
+
+		//! Ends the stream.
+		/*!
+		Preconditions:
+		!finished()
+
+		Returns:
+		The estimates at the remaining time instants, whose
+		time-windows are cut by the end of the stream. Empty
+		if no estimate was due.
+		*/
+		SignalData finish();
+
+		//! Returns whether finish() has been called.
+		bool finished() const;
+
+		//! Returns the latest estimate given by push().
+		/*!
+		This is NaN if the estimate is undefined, or if no
+		estimate has been given yet.
+		*/
+		dreal estimate() const;
+
+		//! Returns the time instant of the latest estimate given by push().
+		/*!
+		The first pushed time instant is 0. This is -1 if no
+		estimate has been given yet.
+		*/
+		integer time() const;
+
+		//! Returns the number of pushed time instants.
+		integer samples() const;
+
+		//! Returns the sum of the dimensions of the signals.
+		integer dimension() const;
+
+		//! Returns the offset of a signal in the joint dimensions.
+		/*!
+		Preconditions:
+		0 <= i < signals()
+		*/
+		integer offset(integer i) const;
+
+		//! Returns the number of signals.
+		integer signals() const;
+
+		//! Returns the number of trials.
+		integer trials() const;
+
+		//! Returns the number of time instants in a block.
+		integer blockSize() const;
+
+		//! Returns the number of kept joint time instants.
+		integer keptSamples() const;
+
+	private:
+		struct Block
+		{
+			// The first joint time instant of the block.
+			integer tBegin;
+
+			// The number of time instants stored.
+			integer slices;
+
+			// The time instants [tBegin, tBegin + hidden[
+			// are hidden from the kd-trees.
+			integer hidden;
+
+			// The joint points, for each time instant, for
+			// each trial, the joint coordinates.
+			std::vector<dreal> sampleSet;
+
+			// The kd-tree of the joint space, and of each
+			// marginal; empty until the block is full.
+			PackedKdTree jointTree;
+			std::vector<PackedKdTree> marginalTreeSet;
+		};
+
+		// Appends the joint points of time instant t, formed
+		// from the samples in 'historySet_'.
+		void appendSlice(integer t);
+
+		// Builds the kd-trees of a full block.
+		void buildBlock(Block& block) const;
+
+		// Hides the time instants before tBegin, and drops
+		// the blocks which are then hidden entirely.
+		void dropBefore(integer tBegin);
+
+		// Estimates time instant t with the time-window
+		// [windowBegin, windowEnd[.
+		dreal estimateAt(
+			integer t, integer windowBegin, integer windowEnd) const;
+
+		// Returns the distance to the k:th nearest neighbor of a
+		// joint point among the points of [windowBegin, windowEnd[.
+		dreal nearestDistance(
+			const dreal* query,
+			integer windowBegin, integer windowEnd) const;
+
+		// Returns the number of points of [windowBegin, windowEnd[
+		// in the open ball of a marginal.
+		integer countRange(
+			const dreal* query,
+			integer marginal,
+			dreal maxDistance,
+			integer windowBegin, integer windowEnd) const;
+
+		// Returns the joint point of the given trial at
+		// time instant t.
+		const dreal* point(integer t, integer trial) const;
+
+		/*
+		dimensionSet_, offsetSet_:
+		The dimension of each signal, and the offset of each
+		signal in the joint dimensions; offsetSet_ has one
+		more element, the joint dimension.
+
+		trials_:
+		The number of trials.
+
+		rangeSet_, timeWindowRadius_, kNearest_, filter_:
+		As given in construction.
+
+		lagSet_, minLag_, maxLag_:
+		The lag of each signal, and their minimum and maximum.
+
+		historySet_:
+		A ring buffer of the pushed time instants, which
+		holds the last maxLag_ - minLag_ + 1 of them.
+
+		samples_:
+		The number of pushed time instants.
+
+		tFirst_:
+		The first joint time instant, at which all the
+		lagged signals are defined.
+
+		tEnd_:
+		The one-past-last joint time instant.
+
+		tNext_:
+		The next time instant to estimate.
+
+		blockSize_:
+		The number of time instants in a block.
+
+		blockSet_:
+		The blocks of the kept time instants; only the last
+		one can be partial.
+
+		freeSet_:
+		The storage of the dropped blocks, for reuse.
+
+		estimate_, time_:
+		The latest estimate given by push(), and its time instant.
+
+		finished_:
+		Whether finish() has been called.
+		*/
+
+		std::vector<integer> dimensionSet_;
+		std::vector<integer> offsetSet_;
+		integer trials_;
+		std::vector<Integer3> rangeSet_;
+		integer timeWindowRadius_;
+		integer kNearest_;
+		std::vector<dreal> filter_;
+		std::vector<integer> lagSet_;
+		integer minLag_;
+		integer maxLag_;
+		std::vector<dreal> historySet_;
+		integer samples_;
+		integer tFirst_;
+		integer tEnd_;
+		integer tNext_;
+		integer blockSize_;
+		std::deque<Block> blockSet_;
+		std::vector<std::vector<dreal>> freeSet_;
+		dreal estimate_;
+		integer time_;
+		bool finished_;
+	};
+
+}
+
+#endif
@@ -0,0 +1,271 @@
+// Description: Strided evaluation of temporal estimates
+// Detail: Evaluates every h:th time instant, with optional adaptive refinement
+// Documentation: temporal_hop.txt
+
+#ifndef TIM_TEMPORAL_HOP_H
+#define TIM_TEMPORAL_HOP_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/reconstruction.h"
+
+#include <pastel/sys/range.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace Tim
+{
+
+	//! The time instants at which a temporal estimate is evaluated.
+	struct TemporalHop
+	{
+		//! The distance between the evaluated time instants.
+		/*!
+		The estimate is evaluated at the first time instant,
+		at every hop:th time instant after it, and at the
+		last time instant. Hop 1 evaluates every time instant.
+		*/
+		integer hop = 1;
+
+		//! The difference above which to refine between estimates.
+		/*!
+		When two consecutive evaluated estimates differ by
+		more than this, the time instant in their middle is
+		also evaluated, recursively, until the estimates are
+		either close enough or adjacent. Infinity disables
+		the refinement.
+		*/
+		dreal refineThreshold = (dreal)Infinity();
+
+		//! Whether to fill in the time instants not evaluated.
+		/*!
+		If true, the time instants which are not evaluated
+		are reconstructed by linear interpolation, as the
+		undefined estimates; see reconstruct(). Otherwise they
+		are left as NaNs.
+		*/
+		bool fill = true;
+	};
+
+	//! Evaluates temporal estimates at the time instants of a hop.
+	/*!
+	Preconditions:
+	hop.hop > 0
+	hop.refineThreshold >= 0
+	chunks > 0
+	tBegin <= tEnd
+
+	tBegin, tEnd:
+	The time interval [tBegin, tEnd[ of the estimates.
+
+	chunks:
+	The number of contiguous groups into which the time
+	instants of each pass are divided, and which are
+	estimated in parallel.
+
+	estimateSet:
+	Pointers to the temporal estimates, whose i:th element
+	is the estimate at time instant tBegin + i. Each must
+	have tEnd - tBegin elements. The refinement compares
+	all of the estimates.
+
+	estimateInstants:
+	A function which is called as
+	estimateInstants(tSetBegin, tSetEnd), where
+	[tSetBegin, tSetEnd[ is an ascending sequence of time
+	instants, and which stores the estimates at those time
+	instants, or NaN where an estimate is undefined. The
+	calls for distinct groups may be concurrent.
+
+	instrumentation:
+	Measures the reconstruction, or null.
+
+	Finally, the NaNs of the estimates are reconstructed;
+	with hop.fill == false, only those at the evaluated
+	time instants.
+	*/
+	template <typename Estimate_Instants>
+	void estimateHops(
+		integer tBegin, integer tEnd,
+		const TemporalHop& hop,
+		integer chunks,
+		const std::vector<dreal*>& estimateSet,
+		Estimate_Instants&& estimateInstants,
+		Instrumentation* instrumentation = nullptr)
+	{
+		ENSURE_OP(hop.hop, >, 0);
+		ENSURE_OP(hop.refineThreshold, >=, 0);
+		ENSURE_OP(chunks, >, 0);
+		ENSURE_OP(tBegin, <=, tEnd);
+
+		integer samples = tEnd - tBegin;
+		if (samples == 0)
+		{
+			return;
+		}
+
+		using Block = tbb::blocked_range<integer>;
+
+		// Estimates the given ascending time instants,
+		// in contiguous groups in parallel.
+		auto estimate = [&](const std::vector<integer>& tSet)
+		{
+			integer instants = tSet.size();
+			integer groups = std::min(chunks, instants);
+
+			auto estimateGroups = [&](const Block& block)
+			{
+				for (integer i = block.begin();i < block.end();++i)
+				{
+					estimateInstants(
+						tSet.data() + (instants * i) / groups,
+						tSet.data() + (instants * (i + 1)) / groups);
+				}
+			};
+
+			tbb::parallel_for(Block(0, groups, 1), estimateGroups);
+		};
+
+		if (hop.hop == 1)
+		{
+			std::vector<integer> tSet(samples);
+			for (integer i = 0;i < samples;++i)
+			{
+				tSet[i] = tBegin + i;
+			}
+
+			estimate(tSet);
+
+			for (dreal* data : estimateSet)
+			{
+				reconstruct(range(data, data + samples), instrumentation);
+			}
+
+			return;
+		}
+
+		for (dreal* data : estimateSet)
+		{
+			std::fill(data, data + samples, (dreal)Nan());
+		}
+
+		// Evaluate every hop:th time instant, and
+		// the last time instant.
+
+		std::vector<integer> evaluatedSet;
+		for (integer t = tBegin;t < tEnd;t += hop.hop)
+		{
+			evaluatedSet.push_back(t);
+		}
+		if (evaluatedSet.back() != tEnd - 1)
+		{
+			evaluatedSet.push_back(tEnd - 1);
+		}
+
+		estimate(evaluatedSet);
+
+		// Refine by bisection between the consecutive
+		// estimates which differ too much. Each pass
+		// halves the gaps, so that there are at most
+		// log2(hop) passes.
+
+		auto differ = [&](integer a, integer b)
+		{
+			for (const dreal* data : estimateSet)
+			{
+				dreal left = data[a - tBegin];
+				dreal right = data[b - tBegin];
+				if (!isNan(left) && !isNan(right) &&
+					std::abs(left - right) > hop.refineThreshold)
+				{
+					return true;
+				}
+			}
+			return false;
+		};
+
+		std::vector<integer> refineSet;
+		if (hop.refineThreshold < (dreal)Infinity())
+		{
+			for (integer i = 1;i < evaluatedSet.size();++i)
+			{
+				integer a = evaluatedSet[i - 1];
+				integer b = evaluatedSet[i];
+				if (b - a > 1 && differ(a, b))
+				{
+					refineSet.push_back(a + (b - a) / 2);
+				}
+			}
+		}
+
+		while (!refineSet.empty())
+		{
+			estimate(refineSet);
+
+			std::vector<integer> mergedSet;
+			mergedSet.reserve(evaluatedSet.size() + refineSet.size());
+			std::merge(
+				evaluatedSet.begin(), evaluatedSet.end(),
+				refineSet.begin(), refineSet.end(),
+				std::back_inserter(mergedSet));
+
+			// Only the gaps next to the new time instants
+			// can need further refinement.
+
+			std::vector<integer> nextSet;
+			for (integer t : refineSet)
+			{
+				auto iter = std::lower_bound(
+					mergedSet.begin(), mergedSet.end(), t);
+				integer a = *(iter - 1);
+				integer b = *(iter + 1);
+				if (t - a > 1 && differ(a, t))
+				{
+					nextSet.push_back(a + (t - a) / 2);
+				}
+				if (b - t > 1 && differ(t, b))
+				{
+					nextSet.push_back(t + (b - t) / 2);
+				}
+			}
+
+			evaluatedSet.swap(mergedSet);
+			refineSet.swap(nextSet);
+		}
+
+		// Reconstruct the NaN's.
+
+		for (dreal* data : estimateSet)
+		{
+			if (hop.fill)
+			{
+				reconstruct(range(data, data + samples), instrumentation);
+			}
+			else
+			{
+				std::vector<dreal> evaluated;
+				evaluated.reserve(evaluatedSet.size());
+				for (integer t : evaluatedSet)
+				{
+					evaluated.push_back(data[t - tBegin]);
+				}
+
+				reconstruct(
+					range(evaluated.begin(), evaluated.end()),
+					instrumentation);
+
+				for (integer i = 0;i < evaluatedSet.size();++i)
+				{
+					data[evaluatedSet[i] - tBegin] = evaluated[i];
+				}
+			}
+		}
+	}
+
+}
+
+#endif
@@ -28,10 +28,11 @@ namespace Tim
 			const Y_Signal_Range& ySignalSet,
 			const W_Signal_Range& wSignalSet,
 			integer timeWindowRadius,
-			Signal* result,
+			SignalData* result,
 			integer xLag, integer yLag, integer wLag,
 			integer kNearest,
-			const Filter_Range& filter)
+			const Filter_Range& filter,
+			Instrumentation* instrumentation)
 		{
 			ENSURE_OP(timeWindowRadius, >=, 0);
 			ENSURE_OP(kNearest, >, 0);
@@ -79,7 +80,12 @@ namespace Tim
 					timeWindowRadius,
 					range(lagSet),
 					kNearest,
-					filter);
+					filter,
+					1,
+					TemporalHop(),
+					0,
+					nullptr,
+					instrumentation);
 				return 0;
 			}
 
@@ -87,7 +93,10 @@ namespace Tim
 				signalSet,
 				range(rangeSet),
 				range(lagSet),
-				kNearest);
+				kNearest,
+				0,
+				nullptr,
+				instrumentation);
 		}
 
 	}
@@ -118,6 +127,9 @@ namespace Tim
 	kNearest:
 	The number of nearest neighbors to use in the estimation.
 
+	instrumentation:
+	See entropyCombination().
+
 	If the number of samples varies between trials, 
 	then the minimum number of samples among the trials
 	is used.
@@ -134,7 +146,8 @@ namespace Tim
 		integer timeWindowRadius,
 		integer xLag, integer yLag, integer wLag,
 		integer kNearest,
-		const Filter_Range& filter)
+		const Filter_Range& filter,
+		Instrumentation* instrumentation = nullptr)
 	{
 		SignalData result;
 		Tim::Detail_TransferEntropy::transferEntropy(
@@ -143,7 +156,8 @@ namespace Tim
 			&result,
 			xLag, yLag, wLag,
 			kNearest,
-			filter);
+			filter,
+			instrumentation);
 		return result;
 	}
 
@@ -198,6 +212,9 @@ namespace Tim
 	kNearest:
 	The number of nearest neighbors to use in the estimation.
 
+	instrumentation:
+	See entropyCombination().
+
 	If the number of samples varies between trials, 
 	then the minimum number of samples among the trials
 	is used.
@@ -211,14 +228,16 @@ namespace Tim
 		const Y_Signal_Range& ySignalSet,
 		const W_Signal_Range& wSignalSet,
 		integer xLag = 0, integer yLag = 0, integer wLag = 0,
-		integer kNearest = 1)
+		integer kNearest = 1,
+		Instrumentation* instrumentation = nullptr)
 	{
 		return Tim::Detail_TransferEntropy::transferEntropy(
 			xSignalSet, ySignalSet, wSignalSet,
 			0, 0,
 			xLag, yLag, wLag,
 			kNearest,
-			constantRange((dreal)1, 1));
+			constantRange((dreal)1, 1),
+			instrumentation);
 	}
 
 }
@@ -0,0 +1,717 @@
+#include "tim/core/vp_tree.h"
+#include "tim/core/instrumentation.h"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <queue>
+#include <type_traits>
+#include <utility>
+
+namespace Tim
+{
+
+	VpTree::VpTree()
+		: n_(0)
+		, metric_(Metric::Maximum)
+		, bucketSize_(16)
+		, nodeSet_()
+		, coordinateSet_()
+		, pointSet_()
+		, indexSet_()
+		, positionSet_()
+		, nodeOfSet_()
+		, visibleSet_()
+		, instrumentation_(nullptr)
+	{
+	}
+
+	VpTree::VpTree(
+		const std::vector<const dreal*>& pointSet,
+		integer dimension,
+		Metric metric,
+		integer bucketSize)
+		: n_(dimension)
+		, metric_(metric)
+		, bucketSize_(bucketSize)
+		, nodeSet_()
+		, coordinateSet_()
+		, pointSet_()
+		, indexSet_()
+		, positionSet_()
+		, nodeOfSet_()
+		, visibleSet_()
+		, instrumentation_(nullptr)
+	{
+		ENSURE_OP(dimension, >=, 0);
+		ENSURE_OP(bucketSize, >=, 2);
+
+		integer points = pointSet.size();
+		if (points == 0)
+		{
+			return;
+		}
+
+		std::vector<integer> orderSet(points);
+		std::iota(orderSet.begin(), orderSet.end(), (integer)0);
+
+		// The tree is built over the coordinates as they
+		// are stored, so that the distance bounds hold for
+		// the stored coordinates.
+		std::vector<dreal> roundedSet;
+		std::vector<const dreal*> buildSet = 
+			storedPoints(pointSet, n_, roundedSet);
+
+		nodeSet_.reserve(2 * (points / (bucketSize_ / 2)) + 1);
+		build(orderSet, buildSet, 0, points, -1, 0, infinity<dreal>());
+
+		// Copy the coordinates of the points in tree order;
+		// the vantage points of the inner nodes are stored
+		// as leaves of one point.
+
+		coordinateSet_.resize(points * n_);
+		pointSet_.resize(points);
+		indexSet_.resize(points);
+		positionSet_.resize(points);
+		nodeOfSet_.resize(points);
+		visibleSet_.assign(points, true);
+
+		integer nodes = nodeSet_.size();
+		for (integer node = 0;node < nodes;++node)
+		{
+			const Node& current = nodeSet_[node];
+			integer count = (current.left < 0) ?
+				current.end - current.begin : 1;
+
+			sreal* coordinate = coordinateSet_.data() + current.begin * n_;
+			for (integer i = 0;i < count;++i)
+			{
+				integer position = current.begin + i;
+				const dreal* point = pointSet[orderSet[position]];
+				for (integer j = 0;j < n_;++j)
+				{
+					coordinate[j * count + i] = (sreal)point[j];
+				}
+
+				pointSet_[position] = point;
+				indexSet_[position] = orderSet[position];
+				positionSet_[orderSet[position]] = position;
+				nodeOfSet_[position] = node;
+			}
+		}
+	}
+
+	VpTree::VpTree(VpTree&& that)
+		: VpTree()
+	{
+		swap(that);
+	}
+
+	VpTree& VpTree::operator=(VpTree that)
+	{
+		swap(that);
+		return *this;
+	}
+
+	void VpTree::swap(VpTree& that)
+	{
+		std::swap(n_, that.n_);
+		std::swap(metric_, that.metric_);
+		std::swap(bucketSize_, that.bucketSize_);
+		nodeSet_.swap(that.nodeSet_);
+		coordinateSet_.swap(that.coordinateSet_);
+		pointSet_.swap(that.pointSet_);
+		indexSet_.swap(that.indexSet_);
+		positionSet_.swap(that.positionSet_);
+		nodeOfSet_.swap(that.nodeOfSet_);
+		visibleSet_.swap(that.visibleSet_);
+	}
+
+	void VpTree::setInstrumentation(Instrumentation* instrumentation)
+	{
+		instrumentation_ = instrumentation;
+	}
+
+	integer VpTree::n() const
+	{
+		return n_;
+	}
+
+	Metric VpTree::metric() const
+	{
+		return metric_;
+	}
+
+	integer VpTree::points() const
+	{
+		if (nodeSet_.empty())
+		{
+			return 0;
+		}
+
+		return nodeSet_[0].visible;
+	}
+
+	integer VpTree::size() const
+	{
+		return pointSet_.size();
+	}
+
+	void VpTree::hide(integer i)
+	{
+		PENSURE_OP(i, >=, 0);
+		PENSURE_OP(i, <, size());
+
+		integer position = positionSet_[i];
+		if (!visibleSet_[position])
+		{
+			return;
+		}
+
+		visibleSet_[position] = false;
+		for (integer node = nodeOfSet_[position];node >= 0;node = nodeSet_[node].parent)
+		{
+			--nodeSet_[node].visible;
+		}
+	}
+
+	void VpTree::show(integer i)
+	{
+		PENSURE_OP(i, >=, 0);
+		PENSURE_OP(i, <, size());
+
+		integer position = positionSet_[i];
+		if (visibleSet_[position])
+		{
+			return;
+		}
+
+		visibleSet_[position] = true;
+		for (integer node = nodeOfSet_[position];node >= 0;node = nodeSet_[node].parent)
+		{
+			++nodeSet_[node].visible;
+		}
+	}
+
+	void VpTree::hide()
+	{
+		std::fill(visibleSet_.begin(), visibleSet_.end(), false);
+		for (Node& node : nodeSet_)
+		{
+			node.visible = 0;
+		}
+	}
+
+	void VpTree::show()
+	{
+		std::fill(visibleSet_.begin(), visibleSet_.end(), true);
+		for (Node& node : nodeSet_)
+		{
+			node.visible = node.end - node.begin;
+		}
+	}
+
+	void VpTree::hide(integer begin, integer end)
+	{
+		setVisible(begin, end, false);
+	}
+
+	void VpTree::show(integer begin, integer end)
+	{
+		setVisible(begin, end, true);
+	}
+
+	integer VpTree::countRange(
+		const dreal* query,
+		dreal maxDistance) const
+	{
+		PENSURE_OP(maxDistance, >=, 0);
+
+		if (nodeSet_.empty())
+		{
+			return 0;
+		}
+
+		std::vector<dreal> distanceSet(bucketSize_);
+		return countRange(0, query, maxDistance, distanceSet.data());
+	}
+
+	dreal VpTree::searchNearest(
+		const dreal* query,
+		integer kNearest,
+		const dreal* exclude,
+		dreal maxRelativeError) const
+	{
+		return searchNearest(query, kNearest, exclude,
+			[](dreal, const dreal*) {}, maxRelativeError);
+	}
+
+	void VpTree::searchAllNearest(
+		const std::vector<const dreal*>& querySet,
+		integer kNearest,
+		bool excludeQuery,
+		dreal* distanceSet,
+		integer* neighborSet,
+		dreal maxRelativeError) const
+	{
+		ENSURE_OP(kNearest, >, 0);
+		ENSURE_OP(maxRelativeError, >=, 0);
+
+		integer queries = querySet.size();
+
+		std::fill(distanceSet, distanceSet + queries, infinity<dreal>());
+		if (neighborSet)
+		{
+			std::fill(neighborSet, neighborSet + queries * kNearest, (integer)-1);
+		}
+
+		if (queries == 0 || points() == 0)
+		{
+			return;
+		}
+
+		using Block = tbb::blocked_range<integer>;
+
+		auto search = [&](const Block& block)
+		{
+			std::vector<Neighbor> queryNeighborSet(kNearest);
+			std::vector<dreal> scanDistanceSet(bucketSize_);
+
+			for (integer i = block.begin();i < block.end();++i)
+			{
+				const dreal* query = querySet[i];
+
+				integer neighbors = 0;
+				searchNearest(
+					0, query,
+					excludeQuery ? query : nullptr,
+					kNearest, 1 / (1 + maxRelativeError),
+					queryNeighborSet.data(), neighbors,
+					scanDistanceSet.data());
+
+				if (neighbors == kNearest)
+				{
+					distanceSet[i] = queryNeighborSet[kNearest - 1].distance;
+				}
+
+				if (neighborSet)
+				{
+					for (integer r = 0;r < neighbors;++r)
+					{
+						neighborSet[i * kNearest + r] =
+							indexSet_[queryNeighborSet[r].position];
+					}
+				}
+			}
+		};
+
+		tbb::parallel_for(Block(0, queries), search);
+	}
+
+	// Private
+
+	integer VpTree::build(
+		std::vector<integer>& orderSet,
+		const std::vector<const dreal*>& pointSet,
+		integer begin, integer end,
+		integer parent,
+		dreal minDistance,
+		dreal maxDistance)
+	{
+		integer node = nodeSet_.size();
+		nodeSet_.push_back(Node{begin, end, -1, -1, parent, end - begin,
+			minDistance, maxDistance});
+
+		if (end - begin <= bucketSize_)
+		{
+			return node;
+		}
+
+		// Pick the point farthest from an arbitrary point
+		// as the vantage point. Such a point lies near the
+		// boundary of the set, which separates the shells
+		// around it well.
+
+		const dreal* first = pointSet[orderSet[begin]];
+		integer vantage = begin;
+		dreal farthest = -1;
+		for (integer i = begin;i < end;++i)
+		{
+			dreal d = distance(first, pointSet[orderSet[i]]);
+			if (d > farthest)
+			{
+				vantage = i;
+				farthest = d;
+			}
+		}
+
+		std::swap(orderSet[begin], orderSet[vantage]);
+		const dreal* vantagePoint = pointSet[orderSet[begin]];
+
+		// Split the rest of the points in halves at the
+		// median distance to the vantage point. Since
+		// bucketSize >= 2, both halves are non-empty.
+
+		std::vector<std::pair<dreal, integer>> distanceSet;
+		distanceSet.reserve(end - begin - 1);
+		for (integer i = begin + 1;i < end;++i)
+		{
+			distanceSet.emplace_back(
+				distance(vantagePoint, pointSet[orderSet[i]]),
+				orderSet[i]);
+		}
+
+		integer half = distanceSet.size() / 2;
+		std::nth_element(
+			distanceSet.begin(),
+			distanceSet.begin() + half,
+			distanceSet.end());
+
+		integer middle = begin + 1 + half;
+
+		dreal leftMin = infinity<dreal>();
+		dreal leftMax = 0;
+		dreal rightMin = infinity<dreal>();
+		dreal rightMax = 0;
+		for (integer i = 0;i < (integer)distanceSet.size();++i)
+		{
+			dreal d = distanceSet[i].first;
+			if (i < half)
+			{
+				leftMin = std::min(leftMin, d);
+				leftMax = std::max(leftMax, d);
+			}
+			else
+			{
+				rightMin = std::min(rightMin, d);
+				rightMax = std::max(rightMax, d);
+			}
+
+			orderSet[begin + 1 + i] = distanceSet[i].second;
+		}
+
+		integer left = build(orderSet, pointSet, begin + 1, middle, node, leftMin, leftMax);
+		integer right = build(orderSet, pointSet, middle, end, node, rightMin, rightMax);
+		nodeSet_[node].left = left;
+		nodeSet_[node].right = right;
+
+		return node;
+	}
+
+	template <typename Real>
+	dreal VpTree::distance(const dreal* left, const Real* right) const
+	{
+		// The distances are computed as in the leaf scans, 
+		// so that a vantage point is measured as any other
+		// point; a fused multiply-add would round differently.
+
+		if constexpr (std::is_same<Real, sreal>::value)
+		{
+			dreal result = 0;
+			if (metric_ == Metric::Euclidean)
+			{
+				scanSquaredDistances(right, 1, n_, left, infinity<dreal>(), &result);
+				return std::sqrt(result);
+			}
+
+			scanDistances(right, 1, n_, left, infinity<dreal>(), &result);
+			return result;
+		}
+		else
+		{
+			if (metric_ == Metric::Euclidean)
+			{
+				return storedEuclideanDistance(left, right, n_);
+			}
+
+			return storedDistance(left, right, n_);
+		}
+	}
+
+	dreal VpTree::childDistance(
+		const Node& child,
+		dreal vantageDistance)
+	{
+		// By the triangle inequality, a point p whose distance
+		// to the vantage point v is in [minDistance, maxDistance]
+		// has d(q, p) >= |d(q, v) - d(v, p)|.
+		return std::max(
+			std::max(
+				child.minDistance - vantageDistance,
+				vantageDistance - child.maxDistance),
+			(dreal)0);
+	}
+
+	dreal VpTree::squaredBound(dreal distance)
+	{
+		// The square is rounded up, so that no point whose
+		// distance, rounded, is less than the given distance
+		// is cut off by the squared comparison.
+		return std::nextafter(distance * distance, infinity<dreal>());
+	}
+
+	void VpTree::offer(
+		Neighbor* neighborSet,
+		integer& neighbors,
+		integer kNearest,
+		dreal distance,
+		integer position)
+	{
+		if (neighbors == kNearest)
+		{
+			if (distance >= neighborSet[kNearest - 1].distance)
+			{
+				return;
+			}
+			--neighbors;
+		}
+
+		// Insert in ascending order of distance.
+
+		integer j = neighbors;
+		while (j > 0 && neighborSet[j - 1].distance > distance)
+		{
+			neighborSet[j] = neighborSet[j - 1];
+			--j;
+		}
+		neighborSet[j] = Neighbor{distance, position};
+		++neighbors;
+	}
+
+	void VpTree::setVisible(integer begin, integer end, bool visible)
+	{
+		PENSURE_OP(begin, >=, 0);
+		PENSURE_OP(begin, <=, end);
+		PENSURE_OP(end, <=, size());
+
+		// A change in the visible count of a node.
+		using Change = std::pair<integer, integer>;
+
+		// Change the visibility of the points, and 
+		// collect the changes of their nodes.
+
+		integer delta = visible ? 1 : -1;
+		std::vector<Change> changeSet;
+		for (integer i = begin;i < end;++i)
+		{
+			integer position = positionSet_[i];
+			if ((bool)visibleSet_[position] == visible)
+			{
+				continue;
+			}
+
+			visibleSet_[position] = visible;
+			changeSet.emplace_back(nodeOfSet_[position], delta);
+		}
+
+		// A parent node precedes its children in 'nodeSet_'. 
+		// When the changes are processed in descending order 
+		// of node, all the changes of a node have been merged
+		// before the node is updated, and passed on to its
+		// parent.
+
+		std::priority_queue<Change> changeQueue(
+			std::less<Change>(), std::move(changeSet));
+
+		while (!changeQueue.empty())
+		{
+			integer node = changeQueue.top().first;
+			integer change = 0;
+			while (!changeQueue.empty() && 
+				changeQueue.top().first == node)
+			{
+				change += changeQueue.top().second;
+				changeQueue.pop();
+			}
+
+			nodeSet_[node].visible += change;
+
+			integer parent = nodeSet_[node].parent;
+			if (parent >= 0)
+			{
+				changeQueue.emplace(parent, change);
+			}
+		}
+	}
+
+	integer VpTree::countRange(
+		integer node,
+		const dreal* query,
+		dreal maxDistance,
+		dreal* distanceSet) const
+	{
+		const Node& current = nodeSet_[node];
+		if (current.visible == 0)
+		{
+			return 0;
+		}
+
+		TIM_COUNT(instrumentation_, nodesVisited, 1);
+
+		if (current.left < 0)
+		{
+			integer count = current.end - current.begin;
+			const char* visibleSet = visibleSet_.data() + current.begin;
+
+			TIM_COUNT(instrumentation_, distances, count);
+
+			if (metric_ == Metric::Maximum)
+			{
+				return scanCount(
+					coordinateSet_.data() + current.begin * n_,
+					visibleSet, count, n_, query, maxDistance);
+			}
+
+			dreal bound = squaredBound(maxDistance);
+			scan(current, query, bound, distanceSet);
+
+			integer result = 0;
+			for (integer i = 0;i < count;++i)
+			{
+				result += (visibleSet[i] && 
+					distanceSet[i] < bound &&
+					std::sqrt(distanceSet[i]) < maxDistance);
+			}
+			return result;
+		}
+
+		TIM_COUNT(instrumentation_, distances, 1);
+		dreal vantageDistance = distance(
+			query, coordinateSet_.data() + current.begin * n_);
+
+		integer result =
+			(visibleSet_[current.begin] && vantageDistance < maxDistance);
+
+		for (integer child : {current.left, current.right})
+		{
+			const Node& subtree = nodeSet_[child];
+			if (vantageDistance + subtree.maxDistance < maxDistance)
+			{
+				// The subtree is inside the ball.
+				result += subtree.visible;
+			}
+			else if (childDistance(subtree, vantageDistance) < maxDistance)
+			{
+				result += countRange(child, query, maxDistance, distanceSet);
+			}
+		}
+
+		return result;
+	}
+
+	void VpTree::searchNearest(
+		integer node,
+		const dreal* query,
+		const dreal* exclude,
+		integer kNearest,
+		dreal shrink,
+		Neighbor* neighborSet,
+		integer& neighbors,
+		dreal* distanceSet) const
+	{
+		const Node& current = nodeSet_[node];
+		if (current.visible == 0)
+		{
+			return;
+		}
+
+		TIM_COUNT(instrumentation_, nodesVisited, 1);
+
+		if (current.left < 0)
+		{
+			TIM_COUNT(instrumentation_, distances, current.end - current.begin);
+
+			dreal bound = (neighbors < kNearest) ?
+				infinity<dreal>() :
+				neighborSet[kNearest - 1].distance;
+
+			bool euclidean = (metric_ == Metric::Euclidean);
+			dreal scanBound = euclidean ? squaredBound(bound) : bound;
+			scan(current, query, scanBound, distanceSet);
+
+			integer count = current.end - current.begin;
+			for (integer i = 0;i < count;++i)
+			{
+				integer position = current.begin + i;
+				if (!(distanceSet[i] < scanBound) ||
+					!visibleSet_[position] ||
+					pointSet_[position] == exclude)
+				{
+					continue;
+				}
+
+				dreal d = euclidean ? std::sqrt(distanceSet[i]) : distanceSet[i];
+				offer(neighborSet, neighbors, kNearest, d, position);
+
+				if (neighbors == kNearest)
+				{
+					bound = neighborSet[kNearest - 1].distance;
+					scanBound = euclidean ? squaredBound(bound) : bound;
+				}
+			}
+
+			return;
+		}
+
+		TIM_COUNT(instrumentation_, distances, 1);
+		dreal vantageDistance = distance(
+			query, coordinateSet_.data() + current.begin * n_);
+
+		if (visibleSet_[current.begin] &&
+			pointSet_[current.begin] != exclude)
+		{
+			offer(neighborSet, neighbors, kNearest,
+				vantageDistance, current.begin);
+		}
+
+		// Visit the nearer child first.
+
+		integer first = current.left;
+		integer second = current.right;
+		dreal firstDistance = childDistance(nodeSet_[first], vantageDistance);
+		dreal secondDistance = childDistance(nodeSet_[second], vantageDistance);
+		if (secondDistance < firstDistance)
+		{
+			std::swap(first, second);
+			std::swap(firstDistance, secondDistance);
+		}
+
+		for (auto [child, d] : {
+			std::make_pair(first, firstDistance),
+			std::make_pair(second, secondDistance)})
+		{
+			dreal bound = (neighbors < kNearest) ?
+				infinity<dreal>() :
+				neighborSet[kNearest - 1].distance * shrink;
+
+			if (d < bound)
+			{
+				searchNearest(
+					child, query, exclude, kNearest, shrink,
+					neighborSet, neighbors, distanceSet);
+			}
+		}
+	}
+
+	void VpTree::scan(
+		const Node& leaf,
+		const dreal* query,
+		dreal bound,
+		dreal* distanceSet) const
+	{
+		integer count = leaf.end - leaf.begin;
+		const sreal* coordinateSet = coordinateSet_.data() + leaf.begin * n_;
+		if (metric_ == Metric::Euclidean)
+		{
+			scanSquaredDistances(coordinateSet, count, n_, query, bound, distanceSet);
+		}
+		else
+		{
+			scanDistances(coordinateSet, count, n_, query, bound, distanceSet);
+		}
+	}
+
+}
@@ -0,0 +1,341 @@
+// Description: VpTree class
+// Detail: A static vantage-point tree for any metric
+// Documentation: vp_tree.txt
+
+#ifndef TIM_VP_TREE_H
+#define TIM_VP_TREE_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/instrumentation.h"
+#include "tim/core/leaf_scan.h"
+
+#include <vector>
+
+namespace Tim
+{
+
+	//! A static vantage-point tree
+	/*!
+	Each inner node picks one of its points as a vantage point,
+	and splits the rest of its points into two halves by their
+	distance to the vantage point. Each child stores the range
+	of distances from the vantage point to its points, so that
+	by the triangle inequality a child can be skipped without
+	looking at its coordinates. Unlike the bounding boxes of a
+	kd-tree, this works the same in any metric, and depends on
+	the intrinsic dimension of the points rather than on the
+	dimension of the space. It has the same interface as
+	PackedKdTree.
+
+	The points of a leaf are stored contiguously in
+	structure-of-arrays form, and scanned by the kernels
+	of leaf_scan.h.
+
+	The points can be hidden and shown individually. Each
+	node maintains the number of visible points in its
+	subtree, so that subtrees without visible points are
+	skipped, and subtrees inside a search ball are counted
+	as a whole. The coordinates are stored as sreal; the 
+	distances are those of the stored coordinates.
+	*/
+	class TIM VpTree
+	{
+	public:
+		//! Constructs an empty tree.
+		VpTree();
+
+		//! Constructs a tree over the given points.
+		/*!
+		Preconditions:
+		dimension >= 0
+		bucketSize >= 2
+
+		pointSet:
+		Pointers to the coordinates of the points. Each
+		pointer identifies its point; the queries report
+		the neighbors by these pointers. The i:th point
+		is referred to by the index i in hide() and show().
+
+		dimension:
+		The number of coordinates to copy from each point.
+
+		metric:
+		The norm in which the distances are measured.
+
+		bucketSize:
+		The maximum number of points in a leaf node.
+
+		Initially all points are visible.
+		*/
+		VpTree(
+			const std::vector<const dreal*>& pointSet,
+			integer dimension,
+			Metric metric = Metric::Maximum,
+			integer bucketSize = 16);
+
+		VpTree(const VpTree& that) = default;
+		VpTree(VpTree&& that);
+		VpTree& operator=(VpTree that);
+
+		//! Swaps two trees.
+		void swap(VpTree& that);
+
+		//! Sets the instrumentation which counts the searches.
+		/*!
+		The instrumentation can be null, which counts nothing.
+		*/
+		void setInstrumentation(Instrumentation* instrumentation);
+
+		//! Returns the dimension of the points.
+		integer n() const;
+
+		//! Returns the norm in which the distances are measured.
+		Metric metric() const;
+
+		//! Returns the number of visible points.
+		integer points() const;
+
+		//! Returns the number of points, visible or hidden.
+		integer size() const;
+
+		//! Hides the i:th point.
+		void hide(integer i);
+
+		//! Shows the i:th point.
+		void show(integer i);
+
+		//! Hides all points.
+		void hide();
+
+		//! Shows all points.
+		void show();
+
+		//! Hides the points [begin, end[.
+		/*!
+		Preconditions:
+		0 <= begin <= end <= size()
+
+		This is as hiding each point, except that the 
+		visible counts of the nodes are updated in a single
+		bottom-up pass, which updates each node only once.
+		*/
+		void hide(integer begin, integer end);
+
+		//! Shows the points [begin, end[.
+		/*!
+		Preconditions:
+		0 <= begin <= end <= size()
+
+		See hide(begin, end).
+		*/
+		void show(integer begin, integer end);
+
+		//! Counts the visible points inside an open ball.
+		/*!
+		Preconditions:
+		maxDistance >= 0
+
+		Returns:
+		The number of visible points whose distance
+		to the query is less than maxDistance.
+		*/
+		integer countRange(
+			const dreal* query,
+			dreal maxDistance) const;
+
+		//! Finds the k nearest visible points.
+		/*!
+		Preconditions:
+		kNearest > 0
+		maxRelativeError >= 0
+
+		See PackedKdTree::searchNearest().
+		*/
+		template <typename Report>
+		dreal searchNearest(
+			const dreal* query,
+			integer kNearest,
+			const dreal* exclude,
+			Report&& report,
+			dreal maxRelativeError = 0) const;
+
+		//! Finds the distance to the k:th nearest visible point.
+		dreal searchNearest(
+			const dreal* query,
+			integer kNearest,
+			const dreal* exclude = nullptr,
+			dreal maxRelativeError = 0) const;
+
+		//! Finds the k nearest visible points of a set of queries.
+		/*!
+		Preconditions:
+		kNearest > 0
+		maxRelativeError >= 0
+
+		See PackedKdTree::searchAllNearest(). The queries
+		are searched in parallel.
+		*/
+		void searchAllNearest(
+			const std::vector<const dreal*>& querySet,
+			integer kNearest,
+			bool excludeQuery,
+			dreal* distanceSet,
+			integer* neighborSet = nullptr,
+			dreal maxRelativeError = 0) const;
+
+	private:
+		struct Node
+		{
+			// The points of the subtree are [begin, end[
+			// in tree order. For an inner node, the vantage
+			// point is at begin.
+			integer begin;
+			integer end;
+
+			// The child nodes, or -1 for a leaf node.
+			integer left;
+			integer right;
+
+			// The parent node, or -1 for the root node.
+			integer parent;
+
+			// The number of visible points in the subtree.
+			integer visible;
+
+			// The distances from the vantage point of the
+			// parent to the points of the subtree are in
+			// [minDistance, maxDistance].
+			dreal minDistance;
+			dreal maxDistance;
+		};
+
+		struct Neighbor
+		{
+			dreal distance;
+			integer position;
+		};
+
+		// Builds the subtree over [begin, end[ of orderSet,
+		// whose distances to the vantage point of the parent
+		// are in [minDistance, maxDistance].
+		integer build(
+			std::vector<integer>& orderSet,
+			const std::vector<const dreal*>& pointSet,
+			integer begin, integer end,
+			integer parent,
+			dreal minDistance,
+			dreal maxDistance);
+
+		// Returns the distance between two points. The
+		// right point is either given or stored.
+		template <typename Real>
+		dreal distance(const dreal* left, const Real* right) const;
+
+		// Returns the lower bound for the distance from
+		// the query to the points of a child, given the
+		// distance from the query to the vantage point.
+		static dreal childDistance(
+			const Node& child,
+			dreal vantageDistance);
+
+		// Returns a bound for the squared Euclidean distances
+		// whose square roots are less than the given distance.
+		static dreal squaredBound(dreal distance);
+
+		// Offers a neighbor candidate to a query, whose
+		// neighbors are kept in ascending order of distance.
+		static void offer(
+			Neighbor* neighborSet,
+			integer& neighbors,
+			integer kNearest,
+			dreal distance,
+			integer position);
+
+		// Sets the visibility of the points [begin, end[.
+		void setVisible(integer begin, integer end, bool visible);
+
+		integer countRange(
+			integer node,
+			const dreal* query,
+			dreal maxDistance,
+			dreal* distanceSet) const;
+
+		// Children are visited only if their distance to the
+		// query is less than shrink times the k:th distance,
+		// where shrink = 1 / (1 + maxRelativeError).
+		void searchNearest(
+			integer node,
+			const dreal* query,
+			const dreal* exclude,
+			integer kNearest,
+			dreal shrink,
+			Neighbor* neighborSet,
+			integer& neighbors,
+			dreal* distanceSet) const;
+
+		// Scans the points of a leaf, as in BruteForceSet; the
+		// Euclidean distances are squared.
+		void scan(
+			const Node& leaf,
+			const dreal* query,
+			dreal bound,
+			dreal* distanceSet) const;
+
+		/*
+		n_:
+		The dimension of the points.
+
+		metric_:
+		The norm in which the distances are measured.
+
+		bucketSize_:
+		The maximum number of points in a leaf.
+
+		nodeSet_:
+		The nodes; the root node is at index 0.
+
+		coordinateSet_:
+		The coordinates of the points in tree order. The
+		j:th coordinate of the point at position begin + i of
+		a leaf [begin, end[ is stored at
+		coordinateSet_[begin * n_ + j * (end - begin) + i]. The
+		coordinates of a vantage point are contiguous.
+
+		pointSet_:
+		The identifying pointer of the point at each position.
+
+		indexSet_:
+		The index, in construction, of the point at each position.
+
+		positionSet_:
+		The position of the i:th point in tree order.
+
+		nodeOfSet_:
+		The node which stores the point at each position;
+		the leaf, or the inner node of a vantage point.
+
+		visibleSet_:
+		Whether the point at each position is visible.
+
+		instrumentation_:
+		The instrumentation which counts the searches, or null.
+		*/
+
+		integer n_;
+		Metric metric_;
+		integer bucketSize_;
+		std::vector<Node> nodeSet_;
+		std::vector<sreal> coordinateSet_;
+		std::vector<const dreal*> pointSet_;
+		std::vector<integer> indexSet_;
+		std::vector<integer> positionSet_;
+		std::vector<integer> nodeOfSet_;
+		std::vector<char> visibleSet_;
+		Instrumentation* instrumentation_;
+	};
+
+}
+
+#include "tim/core/vp_tree.hpp"
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef TIM_VP_TREE_HPP
+#define TIM_VP_TREE_HPP
+
+#include "tim/core/vp_tree.h"
+
+namespace Tim
+{
+
+	template <typename Report>
+	dreal VpTree::searchNearest(
+		const dreal* query,
+		integer kNearest,
+		const dreal* exclude,
+		Report&& report,
+		dreal maxRelativeError) const
+	{
+		PENSURE_OP(kNearest, >, 0);
+		PENSURE_OP(maxRelativeError, >=, 0);
+
+		if (nodeSet_.empty() || nodeSet_[0].visible == 0)
+		{
+			return infinity<dreal>();
+		}
+
+		std::vector<Neighbor> neighborSet(kNearest);
+		std::vector<dreal> distanceSet(bucketSize_);
+
+		integer neighbors = 0;
+		searchNearest(
+			0, query, exclude, kNearest,
+			1 / (1 + maxRelativeError),
+			neighborSet.data(), neighbors, distanceSet.data());
+
+		for (integer i = 0;i < neighbors;++i)
+		{
+			report(neighborSet[i].distance, pointSet_[neighborSet[i].position]);
+		}
+
+		if (neighbors < kNearest)
+		{
+			return infinity<dreal>();
+		}
+
+		return neighborSet[kNearest - 1].distance;
+	}
+
+}
+
+#endif
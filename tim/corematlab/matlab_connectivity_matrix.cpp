@@ -0,0 +1,214 @@
+// Description: mutual_information_matrix, transfer_entropy_matrix, partial_mutual_information_matrix
+// DocumentationOf: mutual_information_matrix.m
+
+#include "tim/corematlab/tim_matlab.h"
+
+#include "tim/core/connectivity_matrix.h"
+
+void force_linking_connectivity_matrix() {};
+
+using namespace Tim;
+
+namespace
+{
+
+	// Copies a row-major n x n matrix to a Matlab matrix.
+	void matlabCopyMatrix(
+		const std::vector<dreal>& estimate,
+		integer n,
+		mxArray*& output)
+	{
+		MatrixView<dreal> result = matlabCreateMatrix<dreal>(n, n, output);
+		for (integer i = 0;i < n;++i)
+		{
+			for (integer j = 0;j < n;++j)
+			{
+				result(i, j) = estimate[i * n + j];
+			}
+		}
+	}
+
+	void matlabMutualInformationMatrix(
+		int outputs, mxArray *outputSet[],
+		int inputs, const mxArray *inputSet[])
+	{
+		enum Input
+		{
+			SignalSet,
+			XLag,
+			YLag,
+			KNearest,
+			Symmetric,
+			MaxMemory,
+			Inputs
+		};
+
+		enum Output
+		{
+			Estimate,
+			Measurements,
+			Outputs
+		};
+
+		ENSURE_OP(inputs, ==, Inputs);
+		ENSURE_OP(outputs, <=, Outputs);
+
+		Array<MatlabMatrix<dreal>> signalSet = matlabAsMatrixArray<dreal>(inputSet[SignalSet]);
+		integer xLag = matlabAsScalar<integer>(inputSet[XLag]);
+		integer yLag = matlabAsScalar<integer>(inputSet[YLag]);
+		integer kNearest = matlabAsScalar<integer>(inputSet[KNearest]);
+		bool symmetric = matlabAsScalar<integer>(inputSet[Symmetric]) != 0;
+		integer maxMemory = matlabAsScalar<integer>(inputSet[MaxMemory]);
+
+		// The estimate is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
+
+		std::vector<dreal> estimate = mutualInformationMatrix(
+			asSignalArray(signalSet),
+			xLag, yLag,
+			kNearest,
+			symmetric,
+			maxMemory,
+			outputs > 1 ? &instrumentation : nullptr);
+
+		matlabCopyMatrix(estimate, signalSet.height(), outputSet[Estimate]);
+
+		if (outputs > 1)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+	}
+
+	void matlabTransferEntropyMatrix(
+		int outputs, mxArray *outputSet[],
+		int inputs, const mxArray *inputSet[])
+	{
+		enum Input
+		{
+			SignalSet,
+			FutureSet,
+			XLag,
+			YLag,
+			WLag,
+			KNearest,
+			MaxMemory,
+			Inputs
+		};
+
+		enum Output
+		{
+			Estimate,
+			Measurements,
+			Outputs
+		};
+
+		ENSURE_OP(inputs, ==, Inputs);
+		ENSURE_OP(outputs, <=, Outputs);
+
+		Array<MatlabMatrix<dreal>> signalSet = matlabAsMatrixArray<dreal>(inputSet[SignalSet]);
+		Array<MatlabMatrix<dreal>> futureSet = matlabAsMatrixArray<dreal>(inputSet[FutureSet]);
+		integer xLag = matlabAsScalar<integer>(inputSet[XLag]);
+		integer yLag = matlabAsScalar<integer>(inputSet[YLag]);
+		integer wLag = matlabAsScalar<integer>(inputSet[WLag]);
+		integer kNearest = matlabAsScalar<integer>(inputSet[KNearest]);
+		integer maxMemory = matlabAsScalar<integer>(inputSet[MaxMemory]);
+
+		// The estimate is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
+
+		std::vector<dreal> estimate = transferEntropyMatrix(
+			asSignalArray(signalSet),
+			asSignalArray(futureSet),
+			xLag, yLag, wLag,
+			kNearest,
+			maxMemory,
+			outputs > 1 ? &instrumentation : nullptr);
+
+		matlabCopyMatrix(estimate, signalSet.height(), outputSet[Estimate]);
+
+		if (outputs > 1)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+	}
+
+	void matlabPartialMutualInformationMatrix(
+		int outputs, mxArray *outputSet[],
+		int inputs, const mxArray *inputSet[])
+	{
+		enum Input
+		{
+			SignalSet,
+			ZSignalSet,
+			XLag,
+			YLag,
+			ZLag,
+			KNearest,
+			Symmetric,
+			MaxMemory,
+			Inputs
+		};
+
+		enum Output
+		{
+			Estimate,
+			Measurements,
+			Outputs
+		};
+
+		ENSURE_OP(inputs, ==, Inputs);
+		ENSURE_OP(outputs, <=, Outputs);
+
+		Array<MatlabMatrix<dreal>> signalSet = matlabAsMatrixArray<dreal>(inputSet[SignalSet]);
+		Array<MatlabMatrix<dreal>> zSignalSet = matlabAsMatrixArray<dreal>(inputSet[ZSignalSet]);
+		integer xLag = matlabAsScalar<integer>(inputSet[XLag]);
+		integer yLag = matlabAsScalar<integer>(inputSet[YLag]);
+		integer zLag = matlabAsScalar<integer>(inputSet[ZLag]);
+		integer kNearest = matlabAsScalar<integer>(inputSet[KNearest]);
+		bool symmetric = matlabAsScalar<integer>(inputSet[Symmetric]) != 0;
+		integer maxMemory = matlabAsScalar<integer>(inputSet[MaxMemory]);
+
+		// The estimate is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
+
+		std::vector<dreal> estimate = partialMutualInformationMatrix(
+			asSignalArray(signalSet),
+			asSignalArray(zSignalSet),
+			xLag, yLag, zLag,
+			kNearest,
+			symmetric,
+			maxMemory,
+			outputs > 1 ? &instrumentation : nullptr);
+
+		matlabCopyMatrix(estimate, signalSet.height(), outputSet[Estimate]);
+
+		if (outputs > 1)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+	}
+
+	void addFunction()
+	{
+		matlabAddFunction(
+			"mutual_information_matrix",
+			matlabMutualInformationMatrix);
+
+		matlabAddFunction(
+			"transfer_entropy_matrix",
+			matlabTransferEntropyMatrix);
+
+		matlabAddFunction(
+			"partial_mutual_information_matrix",
+			matlabPartialMutualInformationMatrix);
+	}
+
+	CallFunction run(addFunction);
+
+}
@@ -0,0 +1,276 @@
+// Description: mutual_information_matrix_t, transfer_entropy_matrix_t, partial_mutual_information_matrix_t
+// DocumentationOf: mutual_information_matrix_t.m
+
+#include "tim/corematlab/tim_matlab.h"
+
+#include "tim/core/connectivity_matrix.h"
+
+void force_linking_connectivity_matrix_t() {};
+
+using namespace Tim;
+
+namespace
+{
+
+	// Copies row-major n x n temporal estimates to an 
+	// (n * n) x samples Matlab matrix, whose row i + j * n
+	// contains the estimate (i, j), and whose columns are 
+	// the time instants starting from 0. The missing 
+	// estimates are NaN.
+	void matlabCopyTemporalMatrix(
+		const std::vector<SignalData>& estimate,
+		integer n,
+		mxArray*& output)
+	{
+		integer samples = 0;
+		for (const SignalData& signal : estimate)
+		{
+			samples = std::max(samples, signal.t() + signal.samples());
+		}
+
+		MatrixView<dreal> result = matlabCreateMatrix<dreal>(n * n, samples, output);
+		ranges::fill(result.range(), (dreal)Nan());
+
+		for (integer i = 0;i < n;++i)
+		{
+			for (integer j = 0;j < n;++j)
+			{
+				const SignalData& signal = estimate[i * n + j];
+				integer skip = std::max(-signal.t(), (integer)0);
+				for (integer s = skip;s < signal.samples();++s)
+				{
+					result(i + j * n, signal.t() + s) = signal.data()(s);
+				}
+			}
+		}
+	}
+
+	void matlabTemporalMutualInformationMatrix(
+		int outputs, mxArray *outputSet[],
+		int inputs, const mxArray *inputSet[])
+	{
+		enum Input
+		{
+			SignalSet,
+			TimeWindowRadius,
+			XLag,
+			YLag,
+			KNearest,
+			FilterIndex,
+			Symmetric,
+			MaxMemory,
+			Hop,
+			RefineThreshold,
+			Fill,
+			Inputs
+		};
+
+		enum Output
+		{
+			Estimate,
+			Measurements,
+			Outputs
+		};
+
+		ENSURE_OP(inputs, ==, Inputs);
+		ENSURE_OP(outputs, <=, Outputs);
+
+		Array<MatlabMatrix<dreal>> signalSet = matlabAsMatrixArray<dreal>(inputSet[SignalSet]);
+		integer timeWindowRadius = matlabAsScalar<integer>(inputSet[TimeWindowRadius]);
+		integer xLag = matlabAsScalar<integer>(inputSet[XLag]);
+		integer yLag = matlabAsScalar<integer>(inputSet[YLag]);
+		integer kNearest = matlabAsScalar<integer>(inputSet[KNearest]);
+		bool symmetric = matlabAsScalar<integer>(inputSet[Symmetric]) != 0;
+		integer maxMemory = matlabAsScalar<integer>(inputSet[MaxMemory]);
+
+		std::vector<dreal> filter;
+		matlabGetScalars(inputSet[FilterIndex], std::back_inserter(filter));
+
+		TemporalHop hop = matlabAsTemporalHop(
+			inputSet[Hop], inputSet[RefineThreshold], inputSet[Fill]);
+
+		// The estimate is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
+
+		std::vector<SignalData> estimate = temporalMutualInformationMatrix(
+			asSignalArray(signalSet),
+			timeWindowRadius,
+			xLag, yLag,
+			kNearest,
+			filter,
+			symmetric,
+			maxMemory,
+			hop,
+			outputs > 1 ? &instrumentation : nullptr);
+
+		matlabCopyTemporalMatrix(estimate, signalSet.height(), outputSet[Estimate]);
+
+		if (outputs > 1)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+	}
+
+	void matlabTemporalTransferEntropyMatrix(
+		int outputs, mxArray *outputSet[],
+		int inputs, const mxArray *inputSet[])
+	{
+		enum Input
+		{
+			SignalSet,
+			FutureSet,
+			TimeWindowRadius,
+			XLag,
+			YLag,
+			WLag,
+			KNearest,
+			FilterIndex,
+			MaxMemory,
+			Hop,
+			RefineThreshold,
+			Fill,
+			Inputs
+		};
+
+		enum Output
+		{
+			Estimate,
+			Measurements,
+			Outputs
+		};
+
+		ENSURE_OP(inputs, ==, Inputs);
+		ENSURE_OP(outputs, <=, Outputs);
+
+		Array<MatlabMatrix<dreal>> signalSet = matlabAsMatrixArray<dreal>(inputSet[SignalSet]);
+		Array<MatlabMatrix<dreal>> futureSet = matlabAsMatrixArray<dreal>(inputSet[FutureSet]);
+		integer timeWindowRadius = matlabAsScalar<integer>(inputSet[TimeWindowRadius]);
+		integer xLag = matlabAsScalar<integer>(inputSet[XLag]);
+		integer yLag = matlabAsScalar<integer>(inputSet[YLag]);
+		integer wLag = matlabAsScalar<integer>(inputSet[WLag]);
+		integer kNearest = matlabAsScalar<integer>(inputSet[KNearest]);
+		integer maxMemory = matlabAsScalar<integer>(inputSet[MaxMemory]);
+
+		std::vector<dreal> filter;
+		matlabGetScalars(inputSet[FilterIndex], std::back_inserter(filter));
+
+		TemporalHop hop = matlabAsTemporalHop(
+			inputSet[Hop], inputSet[RefineThreshold], inputSet[Fill]);
+
+		// The estimate is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
+
+		std::vector<SignalData> estimate = temporalTransferEntropyMatrix(
+			asSignalArray(signalSet),
+			asSignalArray(futureSet),
+			timeWindowRadius,
+			xLag, yLag, wLag,
+			kNearest,
+			filter,
+			maxMemory,
+			hop,
+			outputs > 1 ? &instrumentation : nullptr);
+
+		matlabCopyTemporalMatrix(estimate, signalSet.height(), outputSet[Estimate]);
+
+		if (outputs > 1)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+	}
+
+	void matlabTemporalPartialMutualInformationMatrix(
+		int outputs, mxArray *outputSet[],
+		int inputs, const mxArray *inputSet[])
+	{
+		enum Input
+		{
+			SignalSet,
+			ZSignalSet,
+			TimeWindowRadius,
+			XLag,
+			YLag,
+			ZLag,
+			KNearest,
+			FilterIndex,
+			Symmetric,
+			MaxMemory,
+			Hop,
+			RefineThreshold,
+			Fill,
+			Inputs
+		};
+
+		enum Output
+		{
+			Estimate,
+			Measurements,
+			Outputs
+		};
+
+		ENSURE_OP(inputs, ==, Inputs);
+		ENSURE_OP(outputs, <=, Outputs);
+
+		Array<MatlabMatrix<dreal>> signalSet = matlabAsMatrixArray<dreal>(inputSet[SignalSet]);
+		Array<MatlabMatrix<dreal>> zSignalSet = matlabAsMatrixArray<dreal>(inputSet[ZSignalSet]);
+		integer timeWindowRadius = matlabAsScalar<integer>(inputSet[TimeWindowRadius]);
+		integer xLag = matlabAsScalar<integer>(inputSet[XLag]);
+		integer yLag = matlabAsScalar<integer>(inputSet[YLag]);
+		integer zLag = matlabAsScalar<integer>(inputSet[ZLag]);
+		integer kNearest = matlabAsScalar<integer>(inputSet[KNearest]);
+		bool symmetric = matlabAsScalar<integer>(inputSet[Symmetric]) != 0;
+		integer maxMemory = matlabAsScalar<integer>(inputSet[MaxMemory]);
+
+		std::vector<dreal> filter;
+		matlabGetScalars(inputSet[FilterIndex], std::back_inserter(filter));
+
+		TemporalHop hop = matlabAsTemporalHop(
+			inputSet[Hop], inputSet[RefineThreshold], inputSet[Fill]);
+
+		// The estimate is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
+
+		std::vector<SignalData> estimate = temporalPartialMutualInformationMatrix(
+			asSignalArray(signalSet),
+			asSignalArray(zSignalSet),
+			timeWindowRadius,
+			xLag, yLag, zLag,
+			kNearest,
+			filter,
+			symmetric,
+			maxMemory,
+			hop,
+			outputs > 1 ? &instrumentation : nullptr);
+
+		matlabCopyTemporalMatrix(estimate, signalSet.height(), outputSet[Estimate]);
+
+		if (outputs > 1)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+	}
+
+	void addFunction()
+	{
+		matlabAddFunction(
+			"mutual_information_matrix_t",
+			matlabTemporalMutualInformationMatrix);
+
+		matlabAddFunction(
+			"transfer_entropy_matrix_t",
+			matlabTemporalTransferEntropyMatrix);
+
+		matlabAddFunction(
+			"partial_mutual_information_matrix_t",
+			matlabTemporalPartialMutualInformationMatrix);
+	}
+
+	CallFunction run(addFunction);
+
+}
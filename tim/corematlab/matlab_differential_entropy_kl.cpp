@@ -2,6 +2,7 @@
 // DocumentationOf: differential_entropy_kl.m
 
 #include "tim/corematlab/tim_matlab.h"
+#include "tim/corematlab/prepared_registry.h"
 
 #include "tim/core/differential_entropy_kl.h"
 
@@ -20,25 +21,109 @@ namespace
 		{
 			X,
 			KNearest,
+			MaxRelativeError,
 			Inputs
 		};
 
 		enum Output
 		{
 			Estimate,
+			Measurements,
+			RelativeError,
 			Outputs
 		};
 
 		ENSURE_OP(inputs, ==, Inputs);
-		ENSURE_OP(outputs, ==, Outputs);
+		ENSURE_OP(outputs, <=, Outputs);
 
 		std::vector<MatlabMatrix<dreal>> xMatrices = matlabAsMatrixRange<dreal>(inputSet[X]) | ranges::to_vector;
 		std::vector<Signal> xSignals = matlabMatricesAsSignals(xMatrices) | ranges::to_vector;
 		
 		integer kNearest = matlabAsScalar<integer>(inputSet[KNearest]);
+		dreal maxRelativeError = matlabAsScalar<dreal>(inputSet[MaxRelativeError]);
+
+		dreal relativeError = 0;
+
+		// The estimate is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
 
 		dreal* outResult = matlabCreateScalar<dreal>(outputSet[Estimate]);
-		*outResult = differentialEntropyKl(xSignals, kNearest);
+		*outResult = differentialEntropyKl(
+			xSignals, kNearest, Default_Norm(),
+			maxRelativeError, &relativeError,
+			SignalPointSet::Layout::Automatic,
+			outputs > 1 ? &instrumentation : nullptr);
+
+		if (outputs > 1)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+
+		if (outputs > 2)
+		{
+			*matlabCreateScalar<dreal>(outputSet[RelativeError]) = relativeError;
+		}
+	}
+
+	void matlabPreparedDifferentialEntropyKl(
+		int outputs, mxArray *outputSet[],
+		int inputs, const mxArray *inputSet[])
+	{
+		enum Input
+		{
+			Handle,
+			SignalBegin,
+			SignalEnd,
+			KNearest,
+			MaxRelativeError,
+			Inputs
+		};
+
+		enum Output
+		{
+			Estimate,
+			Measurements,
+			RelativeError,
+			Outputs
+		};
+
+		ENSURE_OP(inputs, ==, Inputs);
+		ENSURE_OP(outputs, <=, Outputs);
+
+		PreparedSignals& prepared = matlabAsPrepared(inputSet[Handle]);
+
+		// The signals [a, b] on Matlab's side are
+		// [a - 1, b[ here.
+		integer signalBegin = matlabAsScalar<integer>(inputSet[SignalBegin]) - 1;
+		integer signalEnd = matlabAsScalar<integer>(inputSet[SignalEnd]);
+
+		integer kNearest = matlabAsScalar<integer>(inputSet[KNearest]);
+		dreal maxRelativeError = matlabAsScalar<dreal>(inputSet[MaxRelativeError]);
+
+		dreal relativeError = 0;
+
+		// The estimate is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
+
+		*matlabCreateScalar<dreal>(outputSet[Estimate]) = 
+			differentialEntropyKl(
+				prepared, signalBegin, signalEnd, kNearest,
+				maxRelativeError, &relativeError,
+				outputs > 1 ? &instrumentation : nullptr);
+
+		if (outputs > 1)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+
+		if (outputs > 2)
+		{
+			*matlabCreateScalar<dreal>(outputSet[RelativeError]) = relativeError;
+		}
 	}
 
 	void addFunction()
@@ -46,6 +131,10 @@ namespace
 		matlabAddFunction(
 			"differential_entropy_kl",
 			matlabDifferentialEntropyKl);
+
+		matlabAddFunction(
+			"prepared_differential_entropy_kl",
+			matlabPreparedDifferentialEntropyKl);
 	}
 
 	CallFunction run(addFunction);
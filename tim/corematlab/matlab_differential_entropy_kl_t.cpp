@@ -22,17 +22,23 @@ namespace
 			TimeWindowRadius,
 			KNearest,
 			FilterIndex,
+			MaxRelativeError,
+			Hop,
+			RefineThreshold,
+			Fill,
 			Inputs
 		};
 
 		enum Output
 		{
 			Estimate,
+			Measurements,
+			RelativeError,
 			Outputs
 		};
 
 		ENSURE_OP(inputs, ==, Inputs);
-		ENSURE_OP(outputs, ==, Outputs);
+		ENSURE_OP(outputs, <=, Outputs);
 
 		std::vector<MatlabMatrix<dreal>> xMatrices = matlabAsMatrixRange<dreal>(inputSet[X]) | ranges::to_vector;
 		std::vector<Signal> xSignals = matlabMatricesAsSignals(xMatrices) | ranges::to_vector;
@@ -43,12 +49,27 @@ namespace
 		std::vector<dreal> filter;
 		matlabGetScalars(inputSet[FilterIndex], std::back_inserter(filter));
 
+		dreal maxRelativeError = matlabAsScalar<dreal>(inputSet[MaxRelativeError]);
+		dreal relativeError = 0;
+
+		TemporalHop hop = matlabAsTemporalHop(
+			inputSet[Hop], inputSet[RefineThreshold], inputSet[Fill]);
+
+		// The estimate is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
+
 		SignalData estimate = temporalDifferentialEntropyKl(
 			xSignals, 
 			timeWindowRadius, 
 			kNearest,
 			Default_Norm(),
-			filter);
+			filter,
+			maxRelativeError,
+			&relativeError,
+			SignalPointSet::Layout::Automatic,
+			hop,
+			outputs > 1 ? &instrumentation : nullptr);
 
 		integer nans = std::max(estimate.t(), (integer)0);
 		integer skip = std::max(-estimate.t(), (integer)0); 
@@ -59,6 +80,17 @@ namespace
 		ranges::copy(
 			estimate.data().slicex(skip).range(),
 			std::begin(result.slicex(nans).range()));
+
+		if (outputs > 1)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+
+		if (outputs > 2)
+		{
+			*matlabCreateScalar<dreal>(outputSet[RelativeError]) = relativeError;
+		}
 	}
 
 	void addFunction()
@@ -27,6 +27,7 @@ namespace
 		enum Output
 		{
 			Estimate,
+			Measurements,
 			IntrinsicDimension,
 			Outputs
 		};
@@ -39,12 +40,16 @@ namespace
 
 		integer intrinsicDimension = 0;
 
+		// The estimate is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
+
 		dreal entropy = 
 			differentialEntropyNk(
 			xSignals, 
 			Euclidean_Norm<dreal>(),
-
-			&intrinsicDimension);
+			&intrinsicDimension,
+			outputs > 1 ? &instrumentation : nullptr);
 
 		if (outputs > 0)
 		{
@@ -54,6 +59,12 @@ namespace
 		}
 
 		if (outputs > 1)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+
+		if (outputs > 2)
 		{
 			integer* outIntrinsicDimension =
 				matlabCreateScalar<integer>(outputSet[IntrinsicDimension]);
@@ -2,6 +2,7 @@
 // DocumentationOf: entropy_combination.m
 
 #include "tim/corematlab/tim_matlab.h"
+#include "tim/corematlab/prepared_registry.h"
 
 #include "tim/core/entropy_combination.h"
 
@@ -12,6 +13,33 @@ using namespace Tim;
 namespace
 {
 
+	std::vector<Integer3> asRangeSet(const mxArray* input)
+	{
+		MatlabMatrix<dreal> rangeArray = matlabAsMatrix<dreal>(input);
+
+		integer marginals = rangeArray.rows();
+		ENSURE_OP(rangeArray.cols(), ==, 3);
+
+		std::vector<Integer3> rangeSet;
+		rangeSet.reserve(marginals);
+		for (integer i = 0;i < marginals;++i)
+		{
+			// FIX: Real weights should not be rounded to integers.
+
+			// On Matlab's side, the range is given in the form [a, b].
+			// This is the same as the range [a, b + 1[. However,
+			// since Matlab indices are 1-based, this finally comes out
+			// as [a - 1, b[.
+			rangeSet.push_back(
+				Integer3(
+				rangeArray.view()(i, 0) - 1,
+				rangeArray.view()(i, 1),
+				rangeArray.view()(i, 2)));
+		}
+
+		return rangeSet;
+	}
+
 	void matlabEntropyCombination(
 		int outputs, mxArray *outputSet[],
 		int inputs, const mxArray *inputSet[])
@@ -22,53 +50,114 @@ namespace
 			RangeSet,
 			LagSet,
 			KNearest,
+			MaxRelativeError,
 			Inputs
 		};
 
 		enum Output
 		{
 			Estimate,
+			Measurements,
+			RelativeError,
 			Outputs
 		};
 
 		ENSURE_OP(inputs, ==, Inputs);
-		ENSURE_OP(outputs, ==, Outputs);
+		ENSURE_OP(outputs, <=, Outputs);
 
 		Array<MatlabMatrix<dreal>> signalSet = matlabAsMatrixArray<dreal>(inputSet[SignalSet]);
 		MatlabMatrix<integer> lagSet = matlabAsMatrix<integer>(inputSet[LagSet]);
-		MatlabMatrix<dreal> rangeArray = matlabAsMatrix<dreal>(inputSet[RangeSet]);
+		std::vector<Integer3> rangeSet = asRangeSet(inputSet[RangeSet]);
 		integer kNearest = matlabAsScalar<integer>(inputSet[KNearest]);
+		dreal maxRelativeError = matlabAsScalar<dreal>(inputSet[MaxRelativeError]);
 
-		integer marginals = rangeArray.rows();
-		ENSURE_OP(rangeArray.cols(), ==, 3);
+		// The estimate is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
 
-		std::vector<Integer3> rangeSet;
-		rangeSet.reserve(marginals);
+		dreal relativeError = 0;
+
+		dreal result = entropyCombination(
+			asSignalArray(signalSet),
+			rangeSet,
+			lagSet.view().range(),
+			kNearest,
+			maxRelativeError,
+			&relativeError,
+			outputs > 1 ? &instrumentation : nullptr);
+
+		*matlabCreateScalar<dreal>(outputSet[Estimate]) = result;
+
+		if (outputs > 1)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+
+		if (outputs > 2)
 		{
-			for (integer i = 0;i < marginals;++i)
-			{
-				// FIX: Real weights should not be rounded to integers.
-
-				// On Matlab's side, the range is given in the form [a, b].
-				// This is the same as the range [a, b + 1[. However,
-				// since Matlab indices are 1-based, this finally comes out
-				// as [a - 1, b[.
-				rangeSet.push_back(
-					Integer3(
-					rangeArray.view()(i, 0) - 1,
-					rangeArray.view()(i, 1),
-					rangeArray.view()(i, 2)));
-			}
+			*matlabCreateScalar<dreal>(outputSet[RelativeError]) = relativeError;
 		}
+	}
+
+	void matlabPreparedEntropyCombination(
+		int outputs, mxArray *outputSet[],
+		int inputs, const mxArray *inputSet[])
+	{
+		enum
+		{
+			Handle,
+			RangeSet,
+			LagSet,
+			KNearest,
+			MaxRelativeError,
+			Inputs
+		};
+
+		enum Output
+		{
+			Estimate,
+			Measurements,
+			RelativeError,
+			Outputs
+		};
+
+		ENSURE_OP(inputs, ==, Inputs);
+		ENSURE_OP(outputs, <=, Outputs);
+
+		PreparedSignals& prepared = matlabAsPrepared(inputSet[Handle]);
+		MatlabMatrix<integer> lagSet = matlabAsMatrix<integer>(inputSet[LagSet]);
+		std::vector<Integer3> rangeSet = asRangeSet(inputSet[RangeSet]);
+		integer kNearest = matlabAsScalar<integer>(inputSet[KNearest]);
+		dreal maxRelativeError = matlabAsScalar<dreal>(inputSet[MaxRelativeError]);
+
+		// The estimate is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
+
+		dreal relativeError = 0;
 
 		dreal result = entropyCombination(
-			asSignalArray(signalSet),
+			prepared,
 			rangeSet,
 			lagSet.view().range(),
-			kNearest);
+			kNearest,
+			maxRelativeError,
+			&relativeError,
+			outputs > 1 ? &instrumentation : nullptr);
 
 		*matlabCreateScalar<dreal>(outputSet[Estimate]) = result;
 
+		if (outputs > 1)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+
+		if (outputs > 2)
+		{
+			*matlabCreateScalar<dreal>(outputSet[RelativeError]) = relativeError;
+		}
 	}
 
 	void addFunction()
@@ -76,6 +165,10 @@ namespace
 		matlabAddFunction(
 			"entropy_combination",
 			matlabEntropyCombination);
+
+		matlabAddFunction(
+			"prepared_entropy_combination",
+			matlabPreparedEntropyCombination);
 	}
 
 	CallFunction run(addFunction);
@@ -0,0 +1,112 @@
+// Description: entropy_combination_lag_sweep
+// DocumentationOf: entropy_combination.m
+
+#include "tim/corematlab/tim_matlab.h"
+
+#include "tim/core/lag_sweep.h"
+
+void force_linking_entropy_combination_lag_sweep() {};
+
+using namespace Tim;
+
+namespace
+{
+
+	void matlabEntropyCombinationLagSweep(
+		int outputs, mxArray *outputSet[],
+		int inputs, const mxArray *inputSet[])
+	{
+		enum
+		{
+			SignalSet,
+			RangeSet,
+			LagSet,
+			SweptSignal,
+			SweepSet,
+			KNearest,
+			MaxRelativeError,
+			Inputs
+		};
+
+		enum Output
+		{
+			Estimate,
+			Measurements,
+			RelativeError,
+			Outputs
+		};
+
+		ENSURE_OP(inputs, ==, Inputs);
+		ENSURE_OP(outputs, <=, Outputs);
+
+		Array<MatlabMatrix<dreal>> signalSet = matlabAsMatrixArray<dreal>(inputSet[SignalSet]);
+		MatlabMatrix<integer> lagSet = matlabAsVectorizedMatrix<integer>(inputSet[LagSet]);
+		MatlabMatrix<dreal> rangeArray = matlabAsMatrix<dreal>(inputSet[RangeSet]);
+		MatlabMatrix<integer> sweepSet = matlabAsVectorizedMatrix<integer>(inputSet[SweepSet]);
+		integer kNearest = matlabAsScalar<integer>(inputSet[KNearest]);
+		dreal maxRelativeError = matlabAsScalar<dreal>(inputSet[MaxRelativeError]);
+
+		// Matlab indices are 1-based.
+		integer sweptSignal = matlabAsScalar<integer>(inputSet[SweptSignal]) - 1;
+
+		integer marginals = rangeArray.rows();
+		ENSURE_OP(rangeArray.cols(), ==, 3);
+
+		std::vector<Integer3> rangeSet;
+		rangeSet.reserve(marginals);
+		{
+			for (integer i = 0;i < marginals;++i)
+			{
+				// See matlab_entropy_combination.cpp.
+				rangeSet.push_back(
+					Integer3(
+					rangeArray.view()(i, 0) - 1,
+					rangeArray.view()(i, 1),
+					rangeArray.view()(i, 2)));
+			}
+		}
+
+		// The estimate is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
+
+		dreal relativeError = 0;
+
+		std::vector<dreal> estimate = entropyCombinationLagSweep(
+			asSignalArray(signalSet),
+			rangeSet,
+			lagSet.view().span(),
+			sweptSignal,
+			sweepSet.view().span(),
+			kNearest,
+			maxRelativeError,
+			&relativeError,
+			outputs > 1 ? &instrumentation : nullptr);
+
+		integer lags = estimate.size();
+
+		MatrixView<dreal> result = matlabCreateMatrix<dreal>(lags, 1, outputSet[Estimate]);
+		ranges::copy(estimate, std::begin(result.range()));
+
+		if (outputs > 1)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+
+		if (outputs > 2)
+		{
+			*matlabCreateScalar<dreal>(outputSet[RelativeError]) = relativeError;
+		}
+	}
+
+	void addFunction()
+	{
+		matlabAddFunction(
+			"entropy_combination_lag_sweep",
+			matlabEntropyCombinationLagSweep);
+	}
+
+	CallFunction run(addFunction);
+
+}
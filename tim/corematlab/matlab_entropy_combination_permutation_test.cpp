@@ -0,0 +1,108 @@
+// Description: entropy_combination_permutation_test
+// DocumentationOf: entropy_combination_permutation_test.m
+
+#include "tim/corematlab/tim_matlab.h"
+
+#include "tim/core/permutation_test.h"
+
+void force_linking_entropy_combination_permutation_test() {};
+
+using namespace Tim;
+
+namespace
+{
+
+	void matlabEntropyCombinationPermutationTest(
+		int outputs, mxArray *outputSet[],
+		int inputs, const mxArray *inputSet[])
+	{
+		enum
+		{
+			SignalSet,
+			RangeSet,
+			LagSet,
+			GroupSet,
+			Permutations,
+			KNearest,
+			Seed,
+			Inputs
+		};
+
+		enum Output
+		{
+			Estimate,
+			NullSet,
+			MaxNull,
+			PValue,
+			Measurements,
+			Outputs
+		};
+
+		ENSURE_OP(inputs, ==, Inputs);
+		ENSURE_OP(outputs, >=, Measurements);
+		ENSURE_OP(outputs, <=, Outputs);
+
+		Array<MatlabMatrix<dreal>> signalSet = matlabAsMatrixArray<dreal>(inputSet[SignalSet]);
+		MatlabMatrix<integer> lagSet = matlabAsVectorizedMatrix<integer>(inputSet[LagSet]);
+		MatlabMatrix<dreal> rangeArray = matlabAsMatrix<dreal>(inputSet[RangeSet]);
+		MatlabMatrix<integer> groupSet = matlabAsVectorizedMatrix<integer>(inputSet[GroupSet]);
+		integer permutations = matlabAsScalar<integer>(inputSet[Permutations]);
+		integer kNearest = matlabAsScalar<integer>(inputSet[KNearest]);
+		integer seed = matlabAsScalar<integer>(inputSet[Seed]);
+
+		integer marginals = rangeArray.rows();
+		ENSURE_OP(rangeArray.cols(), ==, 3);
+
+		std::vector<Integer3> rangeSet;
+		rangeSet.reserve(marginals);
+		{
+			for (integer i = 0;i < marginals;++i)
+			{
+				// See matlab_entropy_combination.cpp.
+				rangeSet.push_back(
+					Integer3(
+					rangeArray.view()(i, 0) - 1,
+					rangeArray.view()(i, 1),
+					rangeArray.view()(i, 2)));
+			}
+		}
+
+		// The test is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
+
+		PermutationTest test = permutationTest(
+			asSignalArray(signalSet),
+			rangeSet,
+			lagSet.view().span(),
+			groupSet.view().span(),
+			permutations,
+			kNearest,
+			seed,
+			outputs > Measurements ? &instrumentation : nullptr);
+
+		*matlabCreateScalar<dreal>(outputSet[Estimate]) = test.estimate;
+
+		MatrixView<dreal> nullSet = matlabCreateMatrix<dreal>(permutations, 1, outputSet[NullSet]);
+		ranges::copy(test.nullSet, std::begin(nullSet.range()));
+
+		*matlabCreateScalar<dreal>(outputSet[MaxNull]) = test.maxNull;
+		*matlabCreateScalar<dreal>(outputSet[PValue]) = test.pValue;
+
+		if (outputs > Measurements)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+	}
+
+	void addFunction()
+	{
+		matlabAddFunction(
+			"entropy_combination_permutation_test",
+			matlabEntropyCombinationPermutationTest);
+	}
+
+	CallFunction run(addFunction);
+
+}
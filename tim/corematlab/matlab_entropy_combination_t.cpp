@@ -24,17 +24,23 @@ namespace
 			LagSet,
 			KNearest,
 			FilterIndex,
+			Hop,
+			RefineThreshold,
+			Fill,
+			MaxRelativeError,
 			Inputs
 		};
 
 		enum Output
 		{
 			Estimate,
+			Measurements,
+			RelativeError,
 			Outputs
 		};
 
 		ENSURE_OP(inputs, ==, Inputs);
-		ENSURE_OP(outputs, ==, Outputs);
+		ENSURE_OP(outputs, <=, Outputs);
 
 		Array<MatlabMatrix<dreal>> signalSet = matlabAsMatrixArray<dreal>(inputSet[SignalSet]);
 		MatlabMatrix<integer> lagSet = matlabAsVectorizedMatrix<integer>(inputSet[LagSet]);
@@ -42,6 +48,9 @@ namespace
 		integer kNearest = matlabAsScalar<integer>(inputSet[KNearest]);
 		MatlabMatrix<dreal> filter = matlabAsVectorizedMatrix<dreal>(inputSet[FilterIndex]);
 		MatlabMatrix<dreal> rangeArray = matlabAsVectorizedMatrix<dreal>(inputSet[RangeSet]);
+		TemporalHop hop = matlabAsTemporalHop(
+			inputSet[Hop], inputSet[RefineThreshold], inputSet[Fill]);
+		dreal maxRelativeError = matlabAsScalar<dreal>(inputSet[MaxRelativeError]);
 
 		integer marginals = rangeArray.rows();
 
@@ -64,13 +73,24 @@ namespace
 			}
 		}
 
+		// The estimate is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
+
+		dreal relativeError = 0;
+
 		SignalData estimate = temporalEntropyCombination(
 			asSignalArray(signalSet),
 			rangeSet,
 			timeWindowRadius,
 			lagSet.view().span(),
 			kNearest,
-			filter.view().span());
+			filter.view().span(),
+			1,
+			hop,
+			maxRelativeError,
+			&relativeError,
+			outputs > 1 ? &instrumentation : nullptr);
 
 		integer nans = std::max(estimate.t(), (integer)0);
 		integer skip = std::max(-estimate.t(), (integer)0); 
@@ -81,6 +101,17 @@ namespace
 		ranges::copy(
 			estimate.data().slicex(skip).range(), 
 			std::begin(result.slicex(nans).range()));
+
+		if (outputs > 1)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+
+		if (outputs > 2)
+		{
+			*matlabCreateScalar<dreal>(outputSet[RelativeError]) = relativeError;
+		}
 	}
 
 	void addFunction()
@@ -0,0 +1,124 @@
+// Description: prepare, release_prepared
+// DocumentationOf: prepare.m
+
+#include "tim/corematlab/tim_matlab.h"
+#include "tim/corematlab/prepared_registry.h"
+
+#include <map>
+
+void force_linking_prepare() {};
+
+namespace Tim
+{
+
+	namespace
+	{
+
+		// The prepared signal sets by their handles. The sets
+		// live until they are released, or the mex file is
+		// cleared from the memory.
+		std::map<integer, std::unique_ptr<PreparedSignals>>& preparedSet()
+		{
+			static std::map<integer, std::unique_ptr<PreparedSignals>> preparedSet;
+			return preparedSet;
+		}
+
+		integer& lastHandle()
+		{
+			static integer lastHandle = 0;
+			return lastHandle;
+		}
+
+	}
+
+	integer addPrepared(std::unique_ptr<PreparedSignals> prepared)
+	{
+		integer handle = ++lastHandle();
+		preparedSet()[handle] = std::move(prepared);
+		return handle;
+	}
+
+	PreparedSignals& matlabAsPrepared(const mxArray* handle)
+	{
+		auto iter = preparedSet().find(
+			matlabAsScalar<integer>(handle));
+		ENSURE(iter != preparedSet().end());
+
+		return *iter->second;
+	}
+
+	void removePrepared(integer handle)
+	{
+		preparedSet().erase(handle);
+	}
+
+}
+
+using namespace Tim;
+
+namespace
+{
+
+	void matlabPrepare(
+		int outputs, mxArray *outputSet[],
+		int inputs, const mxArray *inputSet[])
+	{
+		enum
+		{
+			SignalSet,
+			CacheSize,
+			Inputs
+		};
+
+		enum Output
+		{
+			Handle,
+			Outputs
+		};
+
+		ENSURE_OP(inputs, ==, Inputs);
+		ENSURE_OP(outputs, <=, Outputs);
+
+		Array<MatlabMatrix<dreal>> signalSet = matlabAsMatrixArray<dreal>(inputSet[SignalSet]);
+		integer cacheSize = matlabAsScalar<integer>(inputSet[CacheSize]);
+
+		// The signals are copied, since the Matlab
+		// arrays may be freed after this call.
+
+		integer handle = addPrepared(
+			std::make_unique<PreparedSignals>(
+				asSignalArray(signalSet), cacheSize));
+
+		*matlabCreateScalar<dreal>(outputSet[Handle]) = handle;
+	}
+
+	void matlabReleasePrepared(
+		int outputs, mxArray *outputSet[],
+		int inputs, const mxArray *inputSet[])
+	{
+		enum
+		{
+			Handle,
+			Inputs
+		};
+
+		ENSURE_OP(inputs, ==, Inputs);
+		ENSURE_OP(outputs, ==, 0);
+
+		removePrepared(matlabAsScalar<integer>(inputSet[Handle]));
+	}
+
+	void addFunction()
+	{
+		matlabAddFunction(
+			"prepare",
+			matlabPrepare);
+
+		matlabAddFunction(
+			"release_prepared",
+			matlabReleasePrepared);
+	}
+
+	CallFunction run(addFunction);
+
+}
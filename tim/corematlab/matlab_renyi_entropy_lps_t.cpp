@@ -23,17 +23,23 @@ namespace
 			Q,
 			KNearestSuggestion,
 			FilterIndex,
+			Hop,
+			RefineThreshold,
+			Fill,
+			MaxRelativeError,
 			Inputs
 		};
 
 		enum Output
 		{
 			Estimate,
+			Measurements,
+			RelativeError,
 			Outputs
 		};
 
 		ENSURE_OP(inputs, ==, Inputs);
-		ENSURE_OP(outputs, ==, Outputs);
+		ENSURE_OP(outputs, <=, Outputs);
 
 		std::vector<MatlabMatrix<dreal>> xMatrices = matlabAsMatrixRange<dreal>(inputSet[X]) | ranges::to_vector;
 		std::vector<Signal> xSignals = matlabMatricesAsSignals(xMatrices) | ranges::to_vector;
@@ -45,12 +51,26 @@ namespace
 		std::vector<dreal> filter;
 		matlabGetScalars(inputSet[FilterIndex], std::back_inserter(filter));
 
+		TemporalHop hop = matlabAsTemporalHop(
+			inputSet[Hop], inputSet[RefineThreshold], inputSet[Fill]);
+
+		dreal maxRelativeError = matlabAsScalar<dreal>(inputSet[MaxRelativeError]);
+		dreal relativeError = 0;
+
+		// The estimate is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
+
 		SignalData estimate = temporalRenyiEntropyLps(
 			xSignals,
 			timeWindowRadius, 
 			q,
 			kNearestSuggestion,
-			range(std::begin(filter), std::end(filter)));
+			range(std::begin(filter), std::end(filter)),
+			maxRelativeError,
+			&relativeError,
+			hop,
+			outputs > 1 ? &instrumentation : nullptr);
 
 		integer nans = std::max(estimate.t(), (integer)0);
 		integer skip = std::max(-estimate.t(), (integer)0); 
@@ -61,6 +81,17 @@ namespace
 		ranges::copy(
 			estimate.data().slicex(skip).range(),
 			std::begin(result.slicex(nans).range()));
+
+		if (outputs > 1)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+
+		if (outputs > 2)
+		{
+			*matlabCreateScalar<dreal>(outputSet[RelativeError]) = relativeError;
+		}
 	}
 
 	void addFunction()
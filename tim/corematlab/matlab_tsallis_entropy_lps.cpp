@@ -21,28 +21,51 @@ namespace
 			X,
 			Q,
 			KNearestSuggestion,
+			MaxRelativeError,
 			Inputs
 		};
 
 		enum Output
 		{
 			Estimate,
+			Measurements,
+			RelativeError,
 			Outputs
 		};
 
 		ENSURE_OP(inputs, ==, Inputs);
-		ENSURE_OP(outputs, ==, Outputs);
+		ENSURE_OP(outputs, <=, Outputs);
 
 		std::vector<MatlabMatrix<dreal>> xMatrices = matlabAsMatrixRange<dreal>(inputSet[X]) | ranges::to_vector;
 		std::vector<Signal> xSignals = matlabMatricesAsSignals(xMatrices) | ranges::to_vector;
 
 		dreal q = matlabAsScalar<dreal>(inputSet[Q]);
 		integer kNearestSuggestion = matlabAsScalar<integer>(inputSet[KNearestSuggestion]);
+		dreal maxRelativeError = matlabAsScalar<dreal>(inputSet[MaxRelativeError]);
+
+		dreal relativeError = 0;
+
+		// The estimate is measured only when the
+		// measurements are asked for.
+		Instrumentation instrumentation;
 
 		dreal* outResult = matlabCreateScalar<dreal>(outputSet[Estimate]);
 		*outResult = tsallisEntropyLps(
 			xSignals,
-			q, kNearestSuggestion);
+			q, kNearestSuggestion,
+			maxRelativeError, &relativeError,
+			outputs > 1 ? &instrumentation : nullptr);
+
+		if (outputs > 1)
+		{
+			matlabCreateInstrumentation(
+				instrumentation.report(), outputSet[Measurements]);
+		}
+
+		if (outputs > 2)
+		{
+			*matlabCreateScalar<dreal>(outputSet[RelativeError]) = relativeError;
+		}
 	}
 
 	void addFunction()
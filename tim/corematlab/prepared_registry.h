@@ -0,0 +1,42 @@
+// Description: Registry of prepared signal sets
+// Documentation: prepared_signals.txt
+
+#ifndef TIM_PREPARED_REGISTRY_H
+#define TIM_PREPARED_REGISTRY_H
+
+#include "tim/core/mytypes.h"
+#include "tim/core/prepared_signals.h"
+
+#include <pastelmatlab/matlab_argument.h>
+
+#include <memory>
+
+namespace Tim
+{
+
+	//! Stores a prepared signal set, and returns its handle.
+	/*!
+	The handles are positive, and never reused.
+	*/
+	integer addPrepared(std::unique_ptr<PreparedSignals> prepared);
+
+	//! Returns the prepared signal set of a handle.
+	/*!
+	Preconditions:
+	The handle has been returned by addPrepared(),
+	and has not yet been removed.
+
+	handle:
+	A scalar Matlab array containing the handle.
+	*/
+	PreparedSignals& matlabAsPrepared(const mxArray* handle);
+
+	//! Removes a prepared signal set.
+	/*!
+	Removing an unknown handle does nothing.
+	*/
+	void removePrepared(integer handle);
+
+}
+
+#endif
@@ -25,6 +25,8 @@ void call_force_linking_scalable_free() {
 	scalable_free(ptr);
 }
 
+FORCE_LINKING(connectivity_matrix);
+FORCE_LINKING(connectivity_matrix_t);
 FORCE_LINKING(differential_entropy_kl);
 FORCE_LINKING(differential_entropy_kl_t);
 FORCE_LINKING(differential_entropy_nk);
@@ -35,8 +37,11 @@ FORCE_LINKING(differential_entropy_sp);
 FORCE_LINKING(divergence_wkv);
 FORCE_LINKING(entropy_combination);
 FORCE_LINKING(entropy_combination_t);
+FORCE_LINKING(entropy_combination_lag_sweep);
+FORCE_LINKING(entropy_combination_permutation_test);
 FORCE_LINKING(mutual_information_naive);
 FORCE_LINKING(mutual_information_normal);
+FORCE_LINKING(prepare);
 FORCE_LINKING(renyi_entropy_lps);
 FORCE_LINKING(renyi_entropy_lps_t);
 FORCE_LINKING(tsallis_entropy_lps);
@@ -7,11 +7,15 @@
 #include "tim/core/mytypes.h"
 #include "tim/core/signal.h"
 #include "tim/core/signal_tools.h"
+#include "tim/core/temporal_hop.h"
+#include "tim/core/instrumentation.h"
 
 #include <pastel/sys/ensure.h>
 #include <pastel/sys/sequence/copy_n.h>
 #include <pastelmatlab/matlab_argument.h>
 
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace Tim
@@ -83,6 +87,67 @@ namespace Tim
 		return signalSet;
 	}
 
+	//! Retrieves the time instants of a temporal estimate.
+	/*!
+	The arguments are the hop as an integer, the refinement
+	threshold as a real (Inf for none), and whether to fill
+	the skipped time instants as an integer (0 or 1).
+	*/
+	inline TemporalHop matlabAsTemporalHop(
+		const mxArray* hopArray,
+		const mxArray* refineArray,
+		const mxArray* fillArray)
+	{
+		TemporalHop hop;
+		hop.hop = matlabAsScalar<integer>(hopArray);
+		hop.refineThreshold = matlabAsScalar<dreal>(refineArray);
+		hop.fill = matlabAsScalar<integer>(fillArray) != 0;
+
+		ENSURE_OP(hop.hop, >, 0);
+		ENSURE_OP(hop.refineThreshold, >=, 0);
+
+		return hop;
+	}
+
+	//! Creates a struct of the measurements of an instrumentation.
+	/*!
+	The struct has the field 'enabled', which tells whether
+	TIM was built with instrumentation, a field for the seconds
+	of each phase, named by phaseName() with the suffix '_seconds',
+	and a field for each counter of InstrumentationReport.
+	*/
+	inline void matlabCreateInstrumentation(
+		const InstrumentationReport& report,
+		mxArray*& output)
+	{
+		std::vector<std::pair<std::string, dreal>> fieldSet;
+		fieldSet.emplace_back("enabled", Instrumentation::enabled() ? 1 : 0);
+		for (integer i = 0;i < Phases;++i)
+		{
+			fieldSet.emplace_back(
+				std::string(phaseName((Phase)i)) + "_seconds",
+				report.secondsSet[i]);
+		}
+		fieldSet.emplace_back("nearest_queries", report.nearestQueries);
+		fieldSet.emplace_back("range_queries", report.rangeQueries);
+		fieldSet.emplace_back("nodes_visited", report.nodesVisited);
+		fieldSet.emplace_back("distances", report.distances);
+		fieldSet.emplace_back("points_hidden", report.pointsHidden);
+		fieldSet.emplace_back("points_shown", report.pointsShown);
+
+		std::vector<const char*> nameSet;
+		for (const auto& field : fieldSet)
+		{
+			nameSet.push_back(field.first.c_str());
+		}
+
+		output = mxCreateStructMatrix(1, 1, nameSet.size(), nameSet.data());
+		for (const auto& field : fieldSet)
+		{
+			mxSetField(output, 0, field.first.c_str(), 
+				mxCreateDoubleScalar(field.second));
+		}
+	}
 
 }
 